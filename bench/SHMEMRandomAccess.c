@@ -467,43 +467,5 @@ int main(int argc, char **argv)
 s64Int
 starts(u64Int n)
 {
-  /* s64Int i, j; */
-  int i, j;
-  u64Int m2[64];
-  u64Int temp, ran;
-
-  while (n < 0)
-    n += PERIOD;
-  while (n > PERIOD)
-    n -= PERIOD;
-  if (n == 0)
-    return 0x1;
-
-  temp = 0x1;
-  for (i=0; i<64; i++)
-    {
-      m2[i] = temp;
-      temp = (temp << 1) ^ ((s64Int) temp < 0 ? POLY : 0);
-      temp = (temp << 1) ^ ((s64Int) temp < 0 ? POLY : 0);
-    }
-
-  for (i=62; i>=0; i--)
-    if ((n >> i) & 1)
-      break;
-
-  ran = 0x2;
-
-  while (i > 0)
-    {
-      temp = 0;
-      for (j=0; j<64; j++)
-        if ((ran >> j) & 1)
-          temp ^= m2[j];
-      ran = temp;
-      i -= 1;
-      if ((n >> i) & 1)
-        ran = (ran << 1) ^ ((s64Int) ran < 0 ? POLY : 0);
-    }
-
-  return ran;
+  return (s64Int) xbrtime_hpcc_starts((int64_t) n);
 }
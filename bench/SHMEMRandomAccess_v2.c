@@ -60,9 +60,15 @@ int main(int argc, char *argv[]) {
 
     // Ensure thread pools are correctly initialized
     for (int currentPE = 0; currentPE < npes; currentPE++) {
+        // PE p draws values p * (NUM_UPDATES / npes) onwards of one stream,
+        // so the run makes the same updates whatever the PE count
+        xbrtime_rand_t rng;
+        xbrtime_rand_init(&rng, 1, 0);
+        xbrtime_rand_skip(&rng, (uint64_t)currentPE * (NUM_UPDATES / npes));
+
         for (size_t i = 0; i < NUM_UPDATES / npes; i++) {
             // Generate a random index
-            int64_t index = (rand() % TABLE_SIZE);
+            int64_t index = (int64_t)xbrtime_rand_range(&rng, TABLE_SIZE);
             int target_pe = index % npes;
             int64_t remote_index = index / npes;
 
@@ -277,25 +277,24 @@ int main(int argc, char **argv)
   /* End verification phase */
 
 
-  xbrtime_free(count);
-  xbrtime_free(updates);
-  xbrtime_free(ran);
-  xbrtime_barrier();
+  /* Deferred frees need no barriers of their own: no PE touches the
+ *      blocks past the barrier above, and each is released once the
+ *      epoch has moved on twice since, or at the latest by
+ *      xbrtime_close() */
+  xbrtime_free_deferred(count);
+  xbrtime_free_deferred(updates);
+  xbrtime_free_deferred(ran);
 
   /* Deallocate memory (in reverse order of allocation which should
  *      help fragmentation) */
 
-  xbrtime_free( HPCC_Table );
+  xbrtime_free_deferred( HPCC_Table );
   failed_table:
 
   if (0 == MyProc) if (outFile != stderr) fclose( outFile );
 
-  xbrtime_barrier();
-
-  xbrtime_free(sAbort);
-  xbrtime_free(rAbort);
-
-  xbrtime_barrier();
+  xbrtime_free_deferred(sAbort);
+  xbrtime_free_deferred(rAbort);
 
   xbrtime_close();
 
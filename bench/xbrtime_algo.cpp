@@ -0,0 +1,129 @@
+/* _xbrtime_algo.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Parallel algorithms over xbr::dist_array (xbMrtime-algo.hpp) on N
+ * random 64-bit elements: fill, for_each, transform, transform_reduce,
+ * inclusive_scan, sort and a block to cyclic copy; elements/s of each.
+ * Every result is checked against the same algorithm run serially on one
+ * copy of the data.
+ *
+ * usage: algo.exe [log2 elements]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "xbMrtime-algo.hpp"
+
+#define DEFAULT_LOG_N 22
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static void report(const char *name, size_t n, double t, bool ok) {
+  printf("%-22s: %10zu elements in %f s = %9.2f Melem/s%s\n", name, n, t,
+         n / t / 1e6, ok ? "" : "  WRONG");
+}
+
+/* true when every element of 'a' equals ref */
+template <typename D>
+static bool same(const xbr::dist_array<uint64_t, D> &a,
+                 const std::vector<uint64_t> &ref) {
+  std::vector<uint64_t> v(ref.size());
+  a.get(v.data(), 0, v.size());
+  return v == ref;
+}
+
+int main(int argc, char **argv) {
+  int log_n = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_N;
+  size_t n = (size_t)1 << log_n;
+  int errors = 0;
+  bool ok = false;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  printf("PEs: %d, elements: 2^%d\n", npes, log_n);
+
+  xbr::dist_array<uint64_t> a(n), b(n);
+  xbr::dist_array<uint64_t, xbr::cyclic> c(n);
+  std::vector<uint64_t> ref(n), out(n);
+  uint64_t x = 0x2545f4914f6cdd1dull;
+  for (size_t i = 0; i < n; i++) {
+    x = x * 6364136223846793005ull + 1442695040888963407ull;
+    ref[i] = x >> 16;
+  }
+
+  double t = RTSEC();
+  xbr::fill(a, (uint64_t)3);
+  t = RTSEC() - t;
+  report("fill", n, t, ok = same(a, std::vector<uint64_t>(n, 3)));
+  errors += !ok;
+
+  a.put(ref.data(), 0, n);
+  t = RTSEC();
+  xbr::for_each(a, [](uint64_t &v) { v ^= 0x5555; });
+  t = RTSEC() - t;
+  for (size_t i = 0; i < n; i++)
+    ref[i] ^= 0x5555;
+  report("for_each", n, t, ok = same(a, ref));
+  errors += !ok;
+
+  t = RTSEC();
+  xbr::transform(a, b, [](uint64_t v) { return v * 3 + 1; });
+  t = RTSEC() - t;
+  std::transform(ref.begin(), ref.end(), out.begin(),
+                 [](uint64_t v) { return v * 3 + 1; });
+  report("transform", n, t, ok = same(b, out));
+  errors += !ok;
+
+  t = RTSEC();
+  uint64_t sq = xbr::transform_reduce(a, (uint64_t)0, std::plus<uint64_t>(),
+                                      [](uint64_t v) { return v * v; });
+  t = RTSEC() - t;
+  uint64_t want = 0;
+  for (size_t i = 0; i < n; i++)
+    want += ref[i] * ref[i];
+  report("transform_reduce", n, t, ok = (sq == want));
+  errors += !ok;
+
+  t = RTSEC();
+  xbr::inclusive_scan(a, b);
+  t = RTSEC() - t;
+  std::partial_sum(ref.begin(), ref.end(), out.begin());
+  report("inclusive_scan", n, t, ok = same(b, out));
+  errors += !ok;
+
+  t = RTSEC();
+  xbr::sort(a);
+  t = RTSEC() - t;
+  std::sort(ref.begin(), ref.end());
+  report("sort", n, t, ok = same(a, ref));
+  errors += !ok;
+
+  t = RTSEC();
+  xbr::copy(a, c);
+  t = RTSEC() - t;
+  report("copy block->cyclic", n, t, ok = same(c, ref));
+  errors += !ok;
+
+  xbrtime_close();
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+/* _xbrtime_alloc.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Cost of xbrtime_malloc / xbrtime_free on the symmetric heap:
+ *   1. small, medium and large allocation rates from one PE, then from
+ *      all PEs at once (batches of allocations, then their frees)
+ *   2. collective allocation latency: PE 0 allocates, the address is
+ *      broadcast and all PEs pass a barrier; then PE 0 frees after a
+ *      barrier. Run with several NUM_OF_THREADS to see it against the
+ *      PE count.
+ *   3. a randomized alloc/free trace, reporting the extent, holes and
+ *      fragmentation as it goes
+ * and the heap high-water marks of each part.
+ *
+ * usage: alloc.exe [log2 ops] [log2 trace steps] [trace slots]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "xbMrtime-typed.hpp"
+
+#define DEFAULT_LOG_OPS 18
+#define DEFAULT_LOG_STEPS 20
+#define DEFAULT_SLOTS 4096
+#define COLL_ROUNDS 2000
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t lcg(uint64_t x) {
+  return x * 6364136223846793005ull + 1442695040888963407ull;
+}
+
+static void report(const char *name, size_t ops, double ta, double tf) {
+  printf("%-22s: %10zu pairs  malloc %8.1f ns  free %8.1f ns  %8.3f Mpairs/s\n",
+         name, ops, ta / ops * 1e9, tf / ops * 1e9, ops / (ta + tf) / 1e6);
+}
+
+static void high_water(const char *name) {
+  xbrtime_heap_stats_t st;
+  xbrtime_heap_stats(&st);
+  printf("%-22s: peak %10.3f MiB  peak extent %10.3f MiB  (%llu allocs, "
+         "%llu failed)\n",
+         name, st.peak / 1048576.0, st.peak_extent / 1048576.0,
+         (unsigned long long)st.allocs, (unsigned long long)st.failures);
+  xbrtime_heap_stats_reset();
+}
+
+/* n malloc/free pairs of 'size' bytes, 'batch' blocks at a time */
+static void pairs(size_t n, size_t size, size_t batch, double *ta,
+                  double *tf) {
+  std::vector<void *> p(batch);
+  *ta = *tf = 0;
+  for (size_t done = 0; done < n; done += batch) {
+    size_t k = std::min(batch, n - done);
+    double t = RTSEC();
+    for (size_t i = 0; i < k; i++)
+      p[i] = xbrtime_malloc(size);
+    *ta += RTSEC() - t;
+    t = RTSEC();
+    for (size_t i = k; i-- > 0;)
+      xbrtime_free(p[i]);
+    *tf += RTSEC() - t;
+  }
+}
+
+int main(int argc, char **argv) {
+  int log_ops = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_OPS;
+  int log_steps = (argc > 2) ? atoi(argv[2]) : DEFAULT_LOG_STEPS;
+  size_t slots = (argc > 3) ? strtoull(argv[3], NULL, 10) : DEFAULT_SLOTS;
+  size_t nops = (size_t)1 << log_ops;
+  size_t steps = (size_t)1 << log_steps;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  xbrtime_heap_stats_t st;
+  xbrtime_heap_stats(&st);
+  xbrtime_heap_stats_reset();
+
+  printf("PEs: %d, partition: %zu MiB, ops: 2^%d, trace: 2^%d steps over "
+         "%zu slots\n",
+         npes, st.part_size >> 20, log_ops, log_steps, slots);
+
+  /* ---- 1. allocation rates */
+  static const struct {
+    const char *name;
+    size_t size;
+    int shift; // fewer operations for larger blocks
+  } classes[] = {{"small (64 B)", 64, 0},
+                 {"medium (4 KiB)", 4096, 2},
+                 {"large (1 MiB)", 1 << 20, 8}};
+  for (const auto &c : classes) {
+    size_t n = std::max<size_t>(nops >> c.shift, 1);
+    /* keep a batch of every PE within a quarter of the partition */
+    size_t batch = std::clamp<size_t>(st.part_size / 4 / c.size / npes, 1, 1024);
+    double ta, tf;
+    char name[64];
+
+    pairs(n, c.size, batch, &ta, &tf);
+    snprintf(name, sizeof(name), "%s, 1 PE", c.name);
+    report(name, n, ta, tf);
+
+    double tas[__XBRTIME_MAX_PE], tfs[__XBRTIME_MAX_PE];
+    double t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      pairs(n / npes + 1, c.size, batch, &tas[pe], &tfs[pe]);
+    });
+    t = RTSEC() - t;
+    ta = tf = 0;
+    for (int pe = 0; pe < npes; pe++) {
+      ta += tas[pe];
+      tf += tfs[pe];
+    }
+    size_t total = (n / npes + 1) * npes;
+    snprintf(name, sizeof(name), "%s, %d PEs", c.name, npes);
+    printf("%-22s: %10zu pairs  malloc %8.1f ns  free %8.1f ns  %8.3f "
+           "Mpairs/s aggregate\n",
+           name, total, ta / total * 1e9, tf / total * 1e9, total / t / 1e6);
+  }
+  high_water("rates high-water");
+
+  /* ---- 2. collective allocation latency */
+  {
+    double ta[__XBRTIME_MAX_PE], tf[__XBRTIME_MAX_PE];
+    xbr::detail::on_each_pe([&](int pe) {
+      double a = 0, f = 0;
+      for (int r = 0; r < COLL_ROUNDS; r++) {
+        void *p = NULL;
+        double t = RTSEC();
+        if (pe == 0)
+          p = xbrtime_malloc(4096);
+        xbrtime_coll_broadcast(&p, &p, sizeof(p), 0);
+        static_cast<char *>(xbrtime_ptr(p, pe))[0] = (char)r;
+        xbrtime_coll_barrier();
+        a += RTSEC() - t;
+
+        t = RTSEC();
+        xbrtime_coll_barrier();
+        if (pe == 0)
+          xbrtime_free(p);
+        f += RTSEC() - t;
+      }
+      ta[pe] = a;
+      tf[pe] = f;
+    });
+    printf("%-22s: %d PEs (%s)  malloc %8.2f us  free %8.2f us\n",
+           "collective alloc", npes,
+           xbrtime_coll_mode() == XBRTIME_COLL_HIER ? "two-level" : "flat",
+           ta[0] / COLL_ROUNDS * 1e6, tf[0] / COLL_ROUNDS * 1e6);
+  }
+  high_water("collective high-water");
+
+  /* ---- 3. fragmentation under a random trace */
+  {
+    std::vector<void *> live(slots, nullptr);
+    uint64_t x = 0x2545f4914f6cdd1dull;
+    size_t fails = 0;
+
+    printf("%12s %12s %12s %8s %12s %8s\n", "step", "used MiB", "extent MiB",
+           "holes", "largest KiB", "waste");
+    double t = RTSEC();
+    for (size_t s = 1; s <= steps; s++) {
+      x = lcg(x);
+      size_t i = (size_t)(x >> 33) % slots;
+      if (live[i] != nullptr) {
+        xbrtime_free(live[i]);
+        live[i] = nullptr;
+      } else {
+        /* log-uniform sizes from 16 B to 64 KiB */
+        x = lcg(x);
+        size_t size = (size_t)16 << ((x >> 40) % 13);
+        size += (size_t)((x >> 20) % size);
+        if ((live[i] = xbrtime_malloc(size)) == nullptr)
+          fails++;
+      }
+      if (s % (steps / 8 == 0 ? 1 : steps / 8) == 0) {
+        xbrtime_heap_stats(&st);
+        printf("%12zu %12.3f %12.3f %8zu %12.1f %7.1f%%\n", s,
+               st.used / 1048576.0, st.extent / 1048576.0, st.holes,
+               st.largest_hole / 1024.0,
+               st.extent ? 100.0 * (st.extent - st.used) / st.extent : 0.0);
+      }
+    }
+    t = RTSEC() - t;
+    printf("%-22s: %10zu steps in %f s = %f Msteps/s, %zu failed\n",
+           "random trace", steps, t, steps / t / 1e6, fails);
+    for (void *p : live)
+      xbrtime_free(p);
+  }
+  high_water("trace high-water");
+
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
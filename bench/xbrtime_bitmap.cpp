@@ -0,0 +1,165 @@
+/* _xbrtime_bitmap.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Throughput of xbr::dist_bitmap and xbr::dist_bloom, every PE working on
+ * its own slice of NOPS random bits (or keys):
+ *   1. single-bit test_and_set() (one remote atomic OR each)
+ *   2. batched set() and test(), BATCH bits per call
+ *   3. Bloom filter insert() / contains(), single and batched, and the
+ *      measured false positive rate
+ *
+ * usage: bitmap.exe [log2 bits] [log2 ops] [batch]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "xbMrtime-bitmap.hpp"
+
+#define DEFAULT_LOG_BITS 26
+#define DEFAULT_LOG_OPS 22
+#define DEFAULT_BATCH 4096
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t lcg(uint64_t x) {
+  return x * 6364136223846793005ull + 1442695040888963407ull;
+}
+
+static void report(const char *name, size_t ops, double t) {
+  printf("%-22s: %10zu ops in %f s = %f Mops/s\n", name, ops, t,
+         ops / t / 1e6);
+}
+
+int main(int argc, char **argv) {
+  int log_bits = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_BITS;
+  int log_ops = (argc > 2) ? atoi(argv[2]) : DEFAULT_LOG_OPS;
+  size_t batch = (argc > 3) ? strtoull(argv[3], NULL, 10) : DEFAULT_BATCH;
+  size_t nbits = (size_t)1 << log_bits;
+  size_t nops = (size_t)1 << log_ops;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+
+  uint64_t *idx = (uint64_t *)malloc(nops * sizeof(uint64_t));
+  bool *out = (bool *)malloc(nops * sizeof(bool));
+  if (idx == NULL || out == NULL || batch == 0) {
+    fprintf(stderr, "Failed to allocate %zu operations\n", nops);
+    xbrtime_close();
+    return EXIT_FAILURE;
+  }
+  uint64_t x = 0x2545f4914f6cdd1dull;
+  for (size_t i = 0; i < nops; i++) {
+    x = lcg(x);
+    idx[i] = xbr::detail::mix64(x) & (nbits - 1);
+  }
+
+  printf("PEs: %d, bits: 2^%d, ops: 2^%d, batch: %zu\n", npes, log_bits,
+         log_ops, batch);
+
+  /* ---- 1. and 2. bitmap */
+  {
+    xbr::dist_bitmap bm(nbits);
+    size_t hits[__XBRTIME_MAX_PE] = {0};
+
+    double t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nops * pe / npes, hi = nops * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i++)
+        hits[pe] += bm.test_and_set(idx[i]);
+    });
+    report("test_and_set", nops, RTSEC() - t);
+
+    bm.clear();
+
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nops * pe / npes, hi = nops * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i += batch)
+        bm.set(idx + i, std::min(batch, hi - i), out + i);
+    });
+    report("batched set", nops, RTSEC() - t);
+
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nops * pe / npes, hi = nops * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i += batch)
+        bm.test(idx + i, std::min(batch, hi - i), out + i);
+    });
+    report("batched test", nops, RTSEC() - t);
+    printf("bits set: %zu of %zu\n", bm.count(), nbits);
+  }
+
+  /* ---- 3. Bloom filter: insert the first half of the keys, probe all */
+  {
+    xbr::dist_bloom bf(nbits);
+    size_t half = nops / 2;
+
+    /* full 64-bit keys, so that the probes are (almost surely) absent */
+    for (size_t i = 0; i < nops; i++) {
+      x = lcg(x);
+      idx[i] = xbr::detail::mix64(x);
+    }
+
+    double t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = half * pe / npes, hi = half * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i++)
+        bf.insert(idx[i]);
+    });
+    report("bloom insert", half, RTSEC() - t);
+
+    bf.clear();
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = half * pe / npes, hi = half * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i += batch)
+        bf.insert(idx + i, std::min(batch, hi - i));
+    });
+    report("bloom batched insert", half, RTSEC() - t);
+
+    size_t found[__XBRTIME_MAX_PE] = {0};
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nops * pe / npes, hi = nops * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i++)
+        found[pe] += bf.contains(idx[i]);
+    });
+    report("bloom contains", nops, RTSEC() - t);
+
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nops * pe / npes, hi = nops * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i += batch)
+        bf.contains(idx + i, std::min(batch, hi - i), out + i);
+    });
+    report("bloom batched contains", nops, RTSEC() - t);
+
+    size_t misses = 0, fp = 0;
+    for (size_t i = 0; i < half; i++)
+      misses += !out[i];
+    for (size_t i = half; i < nops; i++)
+      fp += out[i];
+    printf("bloom: %zu false negatives, false positive rate %f (k = %d)\n",
+           misses, (double)fp / (nops - half), bf.hashes());
+  }
+
+  free(idx);
+  free(out);
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/* _xbrtime_channel.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Inter-PE channels (xbr::channel):
+ *   1. ping-pong: PE 0 and PE 1 bounce one record back and forth, in spsc
+ *      and mpsc mode; one-way latency
+ *   2. streaming: every even PE streams records to the next PE in batches
+ *      of 1, 16 and 256; records/s and bandwidth per pair
+ *   3. fan-in: every other PE streams to PE 0 through an mpsc channel
+ * Receivers check that each sender's records arrive complete and in order.
+ *
+ * usage: channel.exe [log2 records] [capacity]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "xbMrtime-channel.hpp"
+
+#define DEFAULT_LOG_RECORDS 20
+#define DEFAULT_CAPACITY 4096
+#define PING_ROUNDS 100000
+#define MAX_BATCH 256
+
+struct record {
+  uint64_t src;
+  uint64_t seq;
+  uint64_t payload[2];
+};
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static const char *mode_name(xbr::chan_mode m) {
+  return m == xbr::chan_mode::spsc ? "spsc" : "mpsc";
+}
+
+/* PE 0 and PE 1 bounce one record 'rounds' times */
+static void ping_pong(xbr::chan_mode mode, size_t rounds) {
+  xbr::channel<record> ch(16, mode);
+  double t[__XBRTIME_MAX_PE] = {0};
+  int bad[__XBRTIME_MAX_PE] = {0};
+
+  xbr::detail::on_each_pe([&](int pe) {
+    record r = {(uint64_t)pe, 0, {0, 0}};
+    xbrtime_coll_barrier();
+    double t0 = RTSEC();
+    for (size_t i = 0; pe < 2 && i < rounds; i++) {
+      if (pe == 0) {
+        r.seq = i;
+        ch.send(1, r);
+        r = ch.recv();
+      } else {
+        r = ch.recv();
+        bad[pe] += (r.seq != i);
+        ch.send(0, r);
+      }
+    }
+    t[pe] = RTSEC() - t0;
+    xbrtime_coll_barrier();
+  });
+  printf("%-22s: %10zu rounds  one-way %8.1f ns%s\n",
+         mode == xbr::chan_mode::spsc ? "ping-pong spsc" : "ping-pong mpsc",
+         rounds, t[0] / rounds / 2 * 1e9, bad[1] ? "  OUT OF ORDER" : "");
+}
+
+/* each sender streams n records to 'dst(pe)' in batches of 'batch' */
+template <typename D>
+static void stream(const char *name, xbr::channel<record> &ch, size_t n,
+                   size_t batch, D dst) {
+  int npes = xbrtime_num_pes();
+  double t[__XBRTIME_MAX_PE] = {0};
+  size_t got[__XBRTIME_MAX_PE] = {0};
+  int bad[__XBRTIME_MAX_PE] = {0};
+
+  ch.reset();
+  xbr::detail::on_each_pe([&](int pe) {
+    int senders = 0;
+    for (int s = 0; s < npes; s++)
+      senders += (dst(s) == pe);
+    record buf[MAX_BATCH];
+    std::vector<uint64_t> next(npes, 0);
+
+    xbrtime_coll_barrier();
+    double t0 = RTSEC();
+    if (dst(pe) >= 0) {
+      for (size_t i = 0; i < n; i += batch) {
+        size_t k = std::min(batch, n - i);
+        for (size_t j = 0; j < k; j++)
+          buf[j] = record{(uint64_t)pe, i + j, {i, j}};
+        ch.send(dst(pe), buf, k);
+      }
+    }
+    for (size_t left = n * senders; left > 0;) {
+      size_t k = ch.try_recv(buf, std::min<size_t>(MAX_BATCH, left));
+      if (k == 0) {
+        buf[0] = ch.recv();
+        k = 1;
+      }
+      for (size_t j = 0; j < k; j++) {
+        uint64_t s = buf[j].src;
+        bad[pe] += (s >= (uint64_t)npes) || (buf[j].seq != next[s]);
+        if (s < (uint64_t)npes)
+          next[s] = buf[j].seq + 1;
+      }
+      got[pe] += k;
+      left -= k;
+    }
+    t[pe] = RTSEC() - t0;
+    xbrtime_coll_barrier();
+  });
+
+  double tmax = 0;
+  size_t total = 0;
+  int errors = 0;
+  for (int pe = 0; pe < npes; pe++) {
+    tmax = std::max(tmax, t[pe]);
+    total += got[pe];
+    errors += bad[pe];
+  }
+  printf("%-22s: batch %4zu  %12zu records in %f s = %8.3f Mrec/s "
+         "%9.1f MB/s%s\n",
+         name, batch, total, tmax, total / tmax / 1e6,
+         total * sizeof(record) / tmax / 1e6, errors ? "  OUT OF ORDER" : "");
+}
+
+int main(int argc, char **argv) {
+  int log_n = argc > 1 ? atoi(argv[1]) : DEFAULT_LOG_RECORDS;
+  size_t cap = argc > 2 ? (size_t)atol(argv[2]) : DEFAULT_CAPACITY;
+  size_t n = (size_t)1 << log_n;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  printf("%d PEs, %zu records of %zu bytes per sender, capacity %zu\n", npes,
+         n, sizeof(record), cap);
+  if (npes < 2) {
+    printf("channels need at least 2 PEs (NUM_OF_THREADS)\n");
+    xbrtime_close();
+    return EXIT_SUCCESS;
+  }
+
+  /* ---- 1. latency */
+  ping_pong(xbr::chan_mode::spsc, PING_ROUNDS);
+  ping_pong(xbr::chan_mode::mpsc, PING_ROUNDS);
+
+  /* ---- 2. pairs: PE 2i -> PE 2i+1 */
+  {
+    auto pair = [npes](int pe) {
+      return (pe % 2 == 0 && pe + 1 < npes) ? pe + 1 : -1;
+    };
+    for (xbr::chan_mode m : {xbr::chan_mode::spsc, xbr::chan_mode::mpsc}) {
+      xbr::channel<record> ch(cap, m);
+      char name[32];
+      snprintf(name, sizeof(name), "stream %s", mode_name(m));
+      for (size_t batch : {(size_t)1, (size_t)16, (size_t)MAX_BATCH})
+        stream(name, ch, n, batch, pair);
+    }
+  }
+
+  /* ---- 3. fan-in: every PE but 0 -> PE 0 */
+  {
+    xbr::channel<record> ch(cap, xbr::chan_mode::mpsc);
+    auto to0 = [](int pe) { return pe == 0 ? -1 : 0; };
+    for (size_t batch : {(size_t)1, (size_t)16, (size_t)MAX_BATCH})
+      stream("fan-in mpsc", ch, n / (npes - 1), batch, to0);
+  }
+
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/* _xbrtime_ckpt.c_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Checkpoint/restart of the symmetric heap:
+ *   1. xbrtime_checkpoint() of a few allocations to a file, then
+ *      xbrtime_restart() after the data was overwritten and the heap
+ *      changed; MB/s of each and a check of every word restored
+ *   2. the XBRTIME_HEAP_SHM round trip: one process fills the heap in a
+ *      shared memory segment and closes, the next one's xbrtime_init()
+ *      attaches to the allocations in place; time of that warm init
+ *   3. a crash after a warm attach: a process attaches, checkpoints, frees
+ *      an allocation and exits without xbrtime_close(); the next one must
+ *      start cold rather than attach to a stale manifest
+ * Steps 2 and 3 run each process as a copy of this program.
+ *
+ * usage: ckpt.exe [MiB per PE] [checkpoint file]
+ *                                      (default: 64 MiB, ./ckpt.bin)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "xbrtime_morello.h"
+
+#define NALLOCS 4
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t word(int pe, int a, size_t i) {
+  return ((uint64_t)pe << 48) ^ ((uint64_t)a << 40) ^
+         (i * 0x9e3779b97f4a7c15ull);
+}
+
+/* fills every PE's copy of the NALLOCS allocations of 'n' words each */
+static void fill(uint64_t **v, size_t n) {
+  for (int pe = 0; pe < xbrtime_num_pes(); pe++)
+    for (int a = 0; a < NALLOCS; a++) {
+      uint64_t *r = (uint64_t *)xbrtime_ptr(v[a], pe);
+      for (size_t i = 0; i < n; i++)
+        r[i] = word(pe, a, i);
+    }
+}
+
+/* words that differ from what fill() wrote */
+static size_t check(uint64_t **v, size_t n) {
+  size_t bad = 0;
+  for (int pe = 0; pe < xbrtime_num_pes(); pe++)
+    for (int a = 0; a < NALLOCS; a++) {
+      uint64_t *r = (uint64_t *)xbrtime_ptr(v[a], pe);
+      for (size_t i = 0; i < n; i++)
+        bad += (r[i] != word(pe, a, i));
+    }
+  return bad;
+}
+
+/* the live allocations, in heap order; returns how many there are */
+static int attached(uint64_t **v) {
+  int k = 0;
+  while (k < NALLOCS && (v[k] = (uint64_t *)xbrtime_heap_allocation(k, NULL)))
+    k++;
+  return k;
+}
+
+/* runs this program again as "-step <step> <MiB>"; returns its status */
+static int step(const char *self, const char *name, const char *mib) {
+  pid_t pid = 0;
+  int status = 0;
+
+  fflush(stdout);
+  if ((pid = fork()) == 0) {
+    execl(self, self, "-step", name, mib, (char *)NULL);
+    _exit(127);
+  }
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+    return -1;
+  return WEXITSTATUS(status);
+}
+
+/* one process of steps 2 and 3; exits 0 when it saw what it expected */
+static int run_step(const char *name, size_t n) {
+  uint64_t *v[NALLOCS];
+  size_t bytes = 0, bad = 0;
+  int k = 0;
+
+  double t0 = RTSEC();
+  xbrtime_init();
+  double tw = RTSEC() - t0;
+  bytes = (size_t)xbrtime_num_pes() * NALLOCS * n * sizeof(uint64_t);
+
+  if (strcmp(name, "fill") == 0) {
+    /* a cold start, which leaves its allocations in the segment */
+    if (attached(v) != 0)
+      return 1;
+    for (k = 0; k < NALLOCS; k++)
+      if ((v[k] = (uint64_t *)xbrtime_malloc(n * sizeof(uint64_t))) == NULL)
+        return 1;
+    fill(v, n);
+    xbrtime_close();
+    return 0;
+  }
+  k = attached(v);
+  if (strcmp(name, "attach") == 0) {
+    bad = (k == NALLOCS) ? check(v, n) : bytes;
+    printf("warm init     : %8.3f s  %d allocations, %zu bad words\n", tw, k,
+           bad);
+    xbrtime_close();
+    return bad != 0;
+  }
+  if (strcmp(name, "crash") == 0) {
+    /* attached, checkpointed and changed, then gone without
+       xbrtime_close() */
+    char path[80];
+    snprintf(path, sizeof(path), "%s.bin", getenv("XBRTIME_HEAP_SHM") + 1);
+    int rc = (k == NALLOCS) ? xbrtime_checkpoint(path) : -1;
+    unlink(path);
+    if (rc == 0)
+      xbrtime_free(v[NALLOCS - 1]);
+    _exit(rc == 0 ? 0 : 1);
+  }
+  printf("after a crash : %d allocations attached (expected 0)\n", k);
+  xbrtime_close();
+  return k != 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 3 && strcmp(argv[1], "-step") == 0)
+    return run_step(argv[2],
+                    strtoull(argv[3], NULL, 10) * 1024 * 1024 / NALLOCS /
+                        sizeof(uint64_t));
+
+  size_t mib = (argc > 1) ? strtoull(argv[1], NULL, 10) : 64;
+  const char *path = (argc > 2) ? argv[2] : "ckpt.bin";
+  size_t n = mib * 1024 * 1024 / NALLOCS / sizeof(uint64_t);
+  uint64_t *v[NALLOCS];
+  char shm[64], arg[32];
+  int errors = 0;
+
+  /* ---- 1. checkpoint and restart through a file */
+  unsetenv("XBRTIME_HEAP_SHM");
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  size_t bytes = (size_t)npes * NALLOCS * n * sizeof(uint64_t);
+  printf("PEs: %d, %zu MiB per PE in %d allocations\n", npes, mib, NALLOCS);
+
+  for (int a = 0; a < NALLOCS; a++)
+    if ((v[a] = (uint64_t *)xbrtime_malloc(n * sizeof(uint64_t))) == NULL) {
+      fprintf(stderr, "Failed to allocate %zu MiB\n", mib);
+      xbrtime_close();
+      return EXIT_FAILURE;
+    }
+  fill(v, n);
+
+  double t0 = RTSEC();
+  int rc = xbrtime_checkpoint(path);
+  double tc = RTSEC() - t0;
+
+  /* overwrite the data and change the heap before restarting */
+  for (int pe = 0; pe < npes; pe++)
+    memset(xbrtime_ptr(v[0], pe), 0, n * sizeof(uint64_t));
+  xbrtime_free(v[1]);
+  void *extra = xbrtime_malloc(4096);
+
+  t0 = RTSEC();
+  rc |= xbrtime_restart(path);
+  double tr = RTSEC() - t0;
+  (void)extra;
+
+  uint64_t *w[NALLOCS];
+  int k = attached(w);
+  size_t bad = (rc == 0 && k == NALLOCS) ? check(w, n) : bytes;
+  printf("checkpoint    : %8.3f s  %10.2f MB/s\n", tc, bytes / tc / 1e6);
+  printf("restart       : %8.3f s  %10.2f MB/s  %d allocations, %zu bad "
+         "words%s\n",
+         tr, bytes / tr / 1e6, k, bad, memcmp(v, w, sizeof(v)) ? "  MOVED" : "");
+  errors += (bad != 0) || memcmp(v, w, sizeof(v));
+  xbrtime_close();
+  unlink(path);
+
+  /* ---- 2. and 3. through a shared memory segment, a process per step */
+  snprintf(shm, sizeof(shm), "/xbrtime_ckpt_%d", (int)getpid());
+  snprintf(arg, sizeof(arg), "%zu", mib);
+  setenv("XBRTIME_HEAP_SHM", shm, 1);
+  errors += (step(argv[0], "fill", arg) != 0);
+  errors += (step(argv[0], "attach", arg) != 0);
+  errors += (step(argv[0], "crash", arg) != 0);
+  errors += (step(argv[0], "cold", arg) != 0);
+
+  shm_unlink(shm);
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
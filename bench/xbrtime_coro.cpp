@@ -0,0 +1,130 @@
+/* _xbrtime_coro.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Coroutine layer (xbr::task, xbMrtime-coro.hpp):
+ *   1. many tasks in flight: NTASKS tasks spread over the PEs, each one
+ *      awaiting a remote get of one word; tasks/s
+ *   2. nested tasks: each of those awaits a task<T> that does the get and
+ *      returns the word
+ *   3. collectives: one coroutine per PE runs ROUNDS of barrier(),
+ *      reduce_all_async() and broadcast_async() from a rotating root;
+ *      rounds/s
+ * Every fetched word and every collective result is checked.
+ *
+ * usage: coro.exe [log2 tasks] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "xbMrtime-coro.hpp"
+
+#define DEFAULT_LOG_TASKS 17
+#define DEFAULT_ROUNDS 2000
+
+static long long *words;               /* PE pe holds pe at words[pe] */
+static size_t bad[__XBRTIME_MAX_PE];   /* written by PE pe's thread only */
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static int next_pe(int pe) { return (pe + 1) % xbrtime_num_pes(); }
+
+static xbr::task<> fetch(void) {
+  int me = xbrtime_mype(), src = next_pe(me);
+  long long v = -1;
+  co_await xbr::get_async(&v, (long long *)xbrtime_ptr(&words[src], src), 1,
+                          src);
+  bad[me] += (v != src);
+}
+
+static xbr::task<long long> leaf(int src) {
+  long long v = -1;
+  co_await xbr::get_async(&v, (long long *)xbrtime_ptr(&words[src], src), 1,
+                          src);
+  co_return v;
+}
+
+static xbr::task<> nested(void) {
+  int me = xbrtime_mype(), src = next_pe(me);
+  long long v = co_await leaf(src);
+  bad[me] += (v != src);
+}
+
+static xbr::task<> collectives(int rounds) {
+  int me = xbrtime_mype(), npes = xbrtime_num_pes();
+  long long in[2] = {me, 1}, out[2];
+  for (int r = 0; r < rounds; r++) {
+    co_await xbr::barrier();
+    co_await xbr::reduce_all_async(out, in, 2);
+    bad[me] += (out[0] != (long long)npes * (npes - 1) / 2) || (out[1] != npes);
+    long long b = me;
+    co_await xbr::broadcast_async(&b, &b, 1, r % npes);
+    bad[me] += (b != r % npes);
+  }
+}
+
+template <typename F>
+static double spawn_all(size_t ntasks, F make) {
+  double t = RTSEC();
+  xbr::task_group g;
+  for (size_t k = 0; k < ntasks; k++)
+    g.spawn((int)(k % xbrtime_num_pes()), make());
+  g.wait();
+  return RTSEC() - t;
+}
+
+int main(int argc, char **argv) {
+  int log_tasks = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_TASKS;
+  int rounds = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROUNDS;
+  size_t ntasks = (size_t)1 << log_tasks;
+  size_t errors = 0;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  words = (long long *)xbrtime_malloc(npes * sizeof(long long));
+  if (words == NULL) {
+    fprintf(stderr, "Failed to allocate %d words\n", npes);
+    xbrtime_close();
+    return EXIT_FAILURE;
+  }
+  for (int pe = 0; pe < npes; pe++)
+    ((long long *)xbrtime_ptr(words, pe))[pe] = pe;
+  printf("PEs: %d, tasks: 2^%d, collective rounds: %d\n", npes, log_tasks,
+         rounds);
+
+  /* ---- 1. and 2. tasks */
+  double t = spawn_all(ntasks, fetch);
+  printf("%-22s: %10zu tasks in %f s = %f Mtasks/s\n", "get_async", ntasks, t,
+         ntasks / t / 1e6);
+  t = spawn_all(ntasks, nested);
+  printf("%-22s: %10zu tasks in %f s = %f Mtasks/s\n", "nested task<T>", ntasks,
+         t, ntasks / t / 1e6);
+
+  /* ---- 3. collectives */
+  t = RTSEC();
+  xbr::run_on_all_pes([rounds](int) { return collectives(rounds); });
+  t = RTSEC() - t;
+  printf("%-22s: %10d rounds in %f s = %f us/round\n", "barrier+reduce+bcast",
+         rounds, t, t / rounds * 1e6);
+
+  for (int pe = 0; pe < npes; pe++)
+    errors += bad[pe];
+  xbrtime_free(words);
+  xbrtime_close();
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/* _xbrtime_counter.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Global counters (xbr::sharded_counter), every PE counting NOPS events:
+ *   1. increments: one remote atomic add on a word of PE 0 per event vs.
+ *      add() on the caller's own shard
+ *   2. reads: value(), approx() and the collective reduce()
+ * Every read is checked against the number of events counted so far,
+ * on the PEs and from the main thread.
+ *
+ * usage: counter.exe [log2 ops]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "xbMrtime-counter.hpp"
+
+#define DEFAULT_LOG_OPS 22
+#define READS 100000
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static void report(const char *name, size_t ops, double t) {
+  printf("%-22s: %10zu ops in %f s = %f Mops/s\n", name, ops, t,
+         ops / t / 1e6);
+}
+
+int main(int argc, char **argv) {
+  int log_ops = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_OPS;
+  size_t nops = (size_t)1 << log_ops;
+  int errors = 0;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  uint64_t total = (uint64_t)npes * nops;
+  printf("PEs: %d, ops per PE: 2^%d\n", npes, log_ops);
+
+  /* ---- 1. increments */
+  {
+    xbr::sym_vector<unsigned long long> hot(1);
+    hot.data(0)[0] = 0;
+    double t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      for (size_t i = 0; i < nops; i++)
+        xbr::atomic_fetch_add(hot.data(0), 1ull, 0);
+    });
+    t = RTSEC() - t;
+    report("one word on PE 0", total, t);
+    errors += (hot.data(0)[0] != total);
+  }
+
+  xbr::sharded_counter<uint64_t> c;
+  double t = RTSEC();
+  xbr::detail::on_each_pe([&](int pe) {
+    for (size_t i = 0; i < nops; i++)
+      c.add();
+  });
+  t = RTSEC() - t;
+  report("sharded add()", total, t);
+
+  /* ---- 2. reads */
+  int bad[__XBRTIME_MAX_PE] = {0};
+  t = RTSEC();
+  xbr::detail::on_each_pe([&](int pe) {
+    for (int i = 0; i < READS; i++)
+      bad[pe] += (c.value() != total);
+  });
+  t = RTSEC() - t;
+  report("value()", (size_t)npes * READS, t);
+
+  /* every PE's approx() now knows the others, and adds its own new events */
+  t = RTSEC();
+  xbr::detail::on_each_pe([&](int pe) {
+    c.add(pe + 1);
+    for (int i = 0; i < READS; i++)
+      bad[pe] += (c.approx() != total + pe + 1);
+  });
+  t = RTSEC() - t;
+  report("approx()", (size_t)npes * READS, t);
+  total += (uint64_t)npes * (npes + 1) / 2;
+
+  t = RTSEC();
+  uint64_t r = 0;
+  for (int i = 0; i < 100; i++)
+    r = c.reduce();
+  t = RTSEC() - t;
+  report("reduce()", 100, t);
+
+  for (int pe = 0; pe < npes; pe++)
+    errors += bad[pe];
+  /* the main thread counts as PE 0 but keeps its own record */
+  c.add(0, 1);
+  errors += (r != total) || (c.value() != total + 1) ||
+            (c.approx() != total + 1);
+  errors += (c.reset() != total + 1) || (c.value() != 0);
+
+  xbrtime_close();
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
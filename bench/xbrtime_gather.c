@@ -34,6 +34,7 @@ int main( int argc, char **argv ){
 	int64_t		target		= 0;
 	int64_t		index			= 0;
 	int64_t 	*idx     	= NULL;
+	xbrtime_rand_t	rng;
   
   uint64_t 	i   			= 0;
   uint64_t  j         = 0;
@@ -75,7 +76,9 @@ int main( int argc, char **argv ){
 #ifdef DEBUG
   printf( "PE=%d; *SHARED = 0x%"PRIu64"\n", xbrtime_mype(), (uint64_t)(shared) );
 #endif
-	srand(1);
+	/* the same indices whatever the PE count: one stream, drawn in bulk */
+	xbrtime_rand_init( &rng, 1, 0 );
+	xbrtime_rand_fill_range( &rng, (uint64_t *)idx, row * col, row * col - 1 );
 	// pe		=	xbrtime_num_pes();
  	for( i = 0; i< col; i++ ){
     for( j = 0; j < col; j++ ){
@@ -83,7 +86,6 @@ int main( int argc, char **argv ){
       // shared[i] 	= (uint64_t)(xbrtime_mype());
       // private[i] 	= 99;
 
-      idx[i*col + j] 			= (uint64_t)(rand()%(row*col-1));
       shared[i*col + j] 	= (uint64_t)(j + xbrtime_mype());
       private[i*col + j] 	= 99;
     }
@@ -0,0 +1,157 @@
+/* _xbrtime_gptr.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Global pointers (xbr::gptr): every PE allocates NODES list nodes with
+ * xbr::malloc_local and links them into a chain, then follows it for
+ * HOPS hops:
+ *   1. a chain within the PE's own partition, through gptr::load()
+ *   2. the same through raw pointers from gptr::local(), the baseline
+ *   3. a chain whose every hop moves on to the next PE
+ *   4. a sequential walk of the PE's nodes with gptr arithmetic
+ * Every node visited is checked to be the one the chain should reach.
+ *
+ * usage: gptr.exe [log2 nodes] [log2 hops]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "xbMrtime-gptr.hpp"
+
+#define DEFAULT_LOG_NODES 16
+#define DEFAULT_LOG_HOPS 22
+#define STRIDE 7919 /* odd: visits every node of a power-of-two chain */
+
+struct node {
+  uint64_t key; /* PE << 32 | index */
+  xbr::gptr<node> next;
+};
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t key(int pe, size_t i) { return ((uint64_t)pe << 32) | i; }
+
+/* links node i of every PE to node i + STRIDE of PE next(pe) */
+template <typename N>
+static void link(std::vector<xbr::gptr<node>> &base, size_t nodes, N next) {
+  xbr::detail::on_each_pe([&](int pe) {
+    node *n = base[pe].local();
+    for (size_t i = 0; i < nodes; i++) {
+      n[i].key = key(pe, i);
+      n[i].next = base[next(pe)] + (std::ptrdiff_t)((i + STRIDE) & (nodes - 1));
+    }
+  });
+}
+
+/* follows 'hops' links from node 0 of every PE; returns the slowest PE's time */
+template <typename N>
+static double chase(const char *name, std::vector<xbr::gptr<node>> &base,
+                    size_t nodes, size_t hops, bool raw, N next,
+                    size_t *errors) {
+  int npes = xbrtime_num_pes();
+  double t[__XBRTIME_MAX_PE] = {0};
+  size_t bad[__XBRTIME_MAX_PE] = {0};
+
+  xbr::detail::on_each_pe([&](int pe) {
+    xbr::gptr<node> p = base[pe];
+    int at = pe;
+    size_t i = 0;
+    xbrtime_coll_barrier();
+    double t0 = RTSEC();
+    for (size_t h = 0; h < hops; h++) {
+      node n = raw ? *p.local() : p.load();
+      bad[pe] += (n.key != key(at, i));
+      p = n.next;
+      at = next(at);
+      i = (i + STRIDE) & (nodes - 1);
+    }
+    t[pe] = RTSEC() - t0;
+    xbrtime_coll_barrier();
+  });
+
+  double tmax = 0;
+  for (int pe = 0; pe < npes; pe++) {
+    tmax = std::max(tmax, t[pe]);
+    *errors += bad[pe];
+  }
+  size_t total = (size_t)npes * hops;
+  printf("%-22s: %10zu hops in %f s = %8.2f ns/hop\n", name, total, tmax,
+         tmax / hops * 1e9);
+  return tmax;
+}
+
+int main(int argc, char **argv) {
+  int log_nodes = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_NODES;
+  int log_hops = (argc > 2) ? atoi(argv[2]) : DEFAULT_LOG_HOPS;
+  size_t nodes = (size_t)1 << log_nodes;
+  size_t hops = (size_t)1 << log_hops;
+  size_t errors = 0;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  std::vector<xbr::gptr<node>> base(npes);
+  printf("PEs: %d, nodes per PE: 2^%d, hops per PE: 2^%d\n", npes, log_nodes,
+         log_hops);
+
+  xbr::detail::on_each_pe(
+      [&](int pe) { base[pe] = xbr::malloc_local<node>(nodes); });
+  for (int pe = 0; pe < npes; pe++)
+    if (!base[pe] || base[pe].pe() != pe) {
+      fprintf(stderr, "Failed to allocate %zu nodes on PE %d\n", nodes, pe);
+      xbrtime_close();
+      return EXIT_FAILURE;
+    }
+
+  /* ---- 1. and 2. local chains */
+  auto same = [](int pe) { return pe; };
+  link(base, nodes, same);
+  chase("local, load()", base, nodes, hops, false, same, &errors);
+  chase("local, raw pointer", base, nodes, hops, true, same, &errors);
+
+  /* ---- 3. every hop to the next PE */
+  auto ring = [npes](int pe) { return (pe + 1) % npes; };
+  link(base, nodes, ring);
+  chase("next PE, load()", base, nodes, hops, false, ring, &errors);
+
+  /* ---- 4. sequential walk */
+  size_t bad[__XBRTIME_MAX_PE] = {0};
+  double t[__XBRTIME_MAX_PE] = {0};
+  xbr::detail::on_each_pe([&](int pe) {
+    double t0 = RTSEC();
+    size_t i = 0;
+    for (xbr::gptr<node> p = base[pe]; p != base[pe] + (std::ptrdiff_t)nodes;
+         ++p, i++)
+      bad[pe] += (static_cast<node>(*p).key != key(pe, i)) || !p.is_local();
+    bad[pe] += (i != nodes);
+    t[pe] = RTSEC() - t0;
+  });
+  double tmax = 0;
+  for (int pe = 0; pe < npes; pe++) {
+    tmax = std::max(tmax, t[pe]);
+    errors += bad[pe];
+  }
+  printf("%-22s: %10zu nodes in %f s = %8.2f ns/node\n", "walk, ++ and *",
+         (size_t)npes * nodes, tmax, tmax / nodes * 1e9);
+
+  xbr::detail::on_each_pe([&](int pe) { xbr::free_local(base[pe]); });
+  xbrtime_close();
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/* _xbrtime_hashmap.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Throughput of xbr::dist_hash_map:
+ *   1. batched insert_all() of NKEYS random keys (collective)
+ *   2. single-key insert() from every PE (remote CAS on the owner)
+ *   3. single-key find() from every PE, half hits and half misses
+ *
+ * usage: hashmap.exe [log2 keys]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "xbMrtime-hashmap.hpp"
+
+#define DEFAULT_LOG_KEYS 20
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t lcg(uint64_t x) {
+  return x * 6364136223846793005ull + 1442695040888963407ull;
+}
+
+int main(int argc, char **argv) {
+  int log_keys = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_KEYS;
+  size_t nkeys = (size_t)1 << log_keys;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+
+  uint64_t *keys = (uint64_t *)malloc(nkeys * sizeof(uint64_t));
+  uint64_t *vals = (uint64_t *)malloc(nkeys * sizeof(uint64_t));
+  if (keys == NULL || vals == NULL) {
+    fprintf(stderr, "Failed to allocate %zu keys\n", nkeys);
+    xbrtime_close();
+    return EXIT_FAILURE;
+  }
+  uint64_t x = 0x2545f4914f6cdd1dull;
+  for (size_t i = 0; i < nkeys; i++) {
+    x = lcg(x);
+    keys[i] = x >> 2; // keep clear of the reserved keys
+    vals[i] = i;
+  }
+
+  printf("PEs: %d, keys: 2^%d\n", npes, log_keys);
+
+  /* ---- 1. batched insert */
+  {
+    xbr::dist_hash_map<uint64_t, uint64_t> m(nkeys / npes / 4);
+    double t = RTSEC();
+    size_t added = m.insert_all(keys, vals, nkeys);
+    t = RTSEC() - t;
+    printf("insert_all : %zu keys in %f s = %f Mkeys/s (capacity/PE %zu)\n",
+           added, t, nkeys / t / 1e6, m.capacity());
+  }
+
+  /* ---- 2. and 3. single-key insert and find from every PE */
+  {
+    xbr::dist_hash_map<uint64_t, uint64_t> m(2 * nkeys / npes);
+    size_t full[__XBRTIME_MAX_PE] = {0};
+    size_t hits[__XBRTIME_MAX_PE] = {0};
+
+    double t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nkeys * pe / npes, hi = nkeys * (pe + 1) / npes;
+      for (size_t i = lo; i < hi; i++)
+        if (m.insert(keys[i], vals[i]) == xbr::insert_result::full)
+          full[pe]++;
+    });
+    t = RTSEC() - t;
+    size_t nfull = 0;
+    for (int pe = 0; pe < npes; pe++)
+      nfull += full[pe];
+    printf("insert     : %zu keys in %f s = %f Mkeys/s (%zu rejected)\n",
+           m.size(), t, nkeys / t / 1e6, nfull);
+
+    t = RTSEC();
+    xbr::detail::on_each_pe([&](int pe) {
+      size_t lo = nkeys * pe / npes, hi = nkeys * (pe + 1) / npes;
+      uint64_t v;
+      for (size_t i = lo; i < hi; i++)
+        hits[pe] += m.find((i & 1) ? keys[i] : keys[i] + 1, &v);
+    });
+    t = RTSEC() - t;
+    size_t nhits = 0;
+    for (int pe = 0; pe < npes; pe++)
+      nhits += hits[pe];
+    printf("find       : %zu lookups in %f s = %f Mlookups/s (%zu hits)\n",
+           nkeys, t, nkeys / t / 1e6, nhits);
+  }
+
+  free(keys);
+  free(vals);
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/* _xbrtime_histogram.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Counting by key over N random keys held in an xbr::dist_array:
+ *   1. dense keys into B bins, one remote atomic add per key on the
+ *      bin's owner, the baseline
+ *   2. the same with the xbr::histogram() collective
+ *   3. the same with the C xbrtime_histogram() into one buffer
+ *   4. sparse 64-bit keys (about N/8 distinct) summed with
+ *      xbr::reduce_by_key()
+ * Every histogram is checked against a serial count, and the
+ * reduce_by_key() result against a std::map.
+ *
+ * usage: histogram.exe [log2 keys] [log2 bins]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "xbMrtime-algo.hpp"
+
+#define DEFAULT_LOG_KEYS 22
+#define DEFAULT_LOG_BINS 12
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static void report(const char *name, size_t n, double t, bool ok) {
+  printf("%-22s: %10zu keys in %f s = %9.2f Mkeys/s%s\n", name, n, t,
+         n / t / 1e6, ok ? "" : "  WRONG");
+}
+
+static uint64_t next_rand(uint64_t *x) {
+  *x = *x * 6364136223846793005ull + 1442695040888963407ull;
+  return *x >> 16;
+}
+
+int main(int argc, char **argv) {
+  int log_keys = (argc > 1) ? atoi(argv[1]) : DEFAULT_LOG_KEYS;
+  int log_bins = (argc > 2) ? atoi(argv[2]) : DEFAULT_LOG_BINS;
+  size_t n = (size_t)1 << log_keys;
+  size_t nbins = (size_t)1 << log_bins;
+  int errors = 0;
+  bool ok = false;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  printf("PEs: %d, keys: 2^%d, bins: 2^%d\n", npes, log_keys, log_bins);
+
+  xbr::dist_array<uint64_t> keys(n), vals(n), bins(nbins);
+  std::vector<uint64_t> k(n), want(nbins, 0), got(nbins);
+  uint64_t x = 0x2545f4914f6cdd1dull;
+  for (size_t i = 0; i < n; i++) {
+    k[i] = next_rand(&x) & (nbins - 1);
+    want[k[i]]++;
+  }
+  keys.put(k.data(), 0, n);
+
+  /* ---- 1. remote atomics */
+  xbr::fill(bins, (uint64_t)0);
+  double t = RTSEC();
+  xbr::detail::on_each_pe([&](int pe) {
+    const uint64_t *mine = keys.local_data(pe);
+    for (size_t i = 0; i < keys.local_size(pe); i++) {
+      xbr::locus l = bins.locate(mine[i]);
+      xbr::atomic_fetch_add(bins.local_data(l.pe) + l.offset, (uint64_t)1,
+                            l.pe);
+    }
+  });
+  t = RTSEC() - t;
+  bins.get(got.data(), 0, nbins);
+  report("remote atomic add", n, t, ok = (got == want));
+  errors += !ok;
+
+  /* ---- 2. and 3. histogram collectives */
+  xbr::fill(bins, (uint64_t)0);
+  t = RTSEC();
+  int rc = xbr::histogram(keys, bins);
+  t = RTSEC() - t;
+  bins.get(got.data(), 0, nbins);
+  report("xbr::histogram", n, t, ok = (rc == 0 && got == want));
+  errors += !ok;
+
+  std::vector<const uint64_t *> local(npes);
+  std::vector<size_t> count(npes);
+  for (int pe = 0; pe < npes; pe++) {
+    local[pe] = keys.local_data(pe);
+    count[pe] = keys.local_size(pe);
+  }
+  std::fill(got.begin(), got.end(), 0);
+  t = RTSEC();
+  rc = xbrtime_histogram(local.data(), count.data(), got.data(), nbins);
+  t = RTSEC() - t;
+  report("xbrtime_histogram", n, t, ok = (rc == 0 && got == want));
+  errors += !ok;
+
+  /* ---- 4. sparse keys */
+  std::vector<uint64_t> v(n);
+  std::map<uint64_t, uint64_t> sums;
+  for (size_t i = 0; i < n; i++) {
+    k[i] = (next_rand(&x) % (n / 8 + 1)) * 0x9e3779b97f4a7c15ull;
+    v[i] = i;
+    sums[k[i]] += i;
+  }
+  keys.put(k.data(), 0, n);
+  vals.put(v.data(), 0, n);
+  t = RTSEC();
+  auto r = xbr::reduce_by_key(keys, vals);
+  t = RTSEC() - t;
+  ok = (r.size() == sums.size()) &&
+       std::equal(sums.begin(), sums.end(), r.begin(),
+                  [](auto &a, auto &b) { return a.first == b.first &&
+                                                a.second == b.second; });
+  report("xbr::reduce_by_key", n, t, ok);
+  printf("%-22s: %10zu\n", "distinct keys", r.size());
+  errors += !ok;
+
+  xbrtime_close();
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
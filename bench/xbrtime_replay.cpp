@@ -0,0 +1,436 @@
+/* _xbrtime_replay.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Replays the communication pattern of an application traced with
+ * XBRTIME_TRACE=file (see runtime/xbMrtime-trace.h) against this build and
+ * configuration of the runtime, and compares the time of every kind of call
+ * with the traced run:
+ *   - gets and puts move the same number of elements of the same width and
+ *     stride to the same PE, at the same offset of a symmetric scratch block
+ *     as in the traced heap (wrapped if the partition is smaller)
+ *   - barriers and collectives are re-issued when every PE stream issued the
+ *     same sequence of them and the PE count is unchanged; otherwise they are
+ *     skipped
+ *   - allocations and frees are re-issued by the same stream
+ * Each PE stream runs on its PE (stream s on PE s % PEs), all in one phase.
+ * Main thread calls made before the first PE call run before that phase, the
+ * rest after it; barriers of the main thread only fence, and its collectives
+ * are skipped.
+ *
+ * usage: replay.exe trace [honor gaps: 0|1]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "xbMrtime-typed.hpp"
+
+#define NOPS (XBRTIME_TRACE_FREE_LOCAL + 1)
+
+static const char *op_name[NOPS] = {
+    "?",         "get",    "put",       "barrier", "coll_barrier", "broadcast",
+    "reduce",    "allreduce", "malloc", "free",    "malloc_local", "free_local"};
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+typedef std::vector<xbrtime_trace_rec_t> stream_t;
+
+/* per stream counts, bytes and times (ns) of each kind of call */
+struct tally {
+  uint64_t n[NOPS] = {};
+  uint64_t bytes[NOPS] = {};
+  uint64_t skipped[NOPS] = {};
+  double traced[NOPS] = {};
+  double replayed[NOPS] = {};
+};
+
+static struct {
+  bool colls;        // re-issue barriers and collectives
+  bool gaps;         // wait out the traced gaps
+  char *arena;       // scratch block standing in for the traced heap
+  size_t arena_size;
+  size_t xfer_bytes; // largest transfer span
+  size_t coll_bytes; // largest collective buffer
+  std::mutex lock;
+  std::map<uint64_t, void *> blocks;           // traced offset -> block
+  std::map<uint64_t, xbrtime_gref_t> lblocks; // same, local allocations
+} R;
+
+static bool is_xfer(const xbrtime_trace_rec_t &r) {
+  return r.op == XBRTIME_TRACE_GET || r.op == XBRTIME_TRACE_PUT;
+}
+
+static bool is_sync(const xbrtime_trace_rec_t &r) {
+  return r.op >= XBRTIME_TRACE_BARRIER && r.op <= XBRTIME_TRACE_ALLREDUCE;
+}
+
+static uint64_t offset_of(const xbrtime_trace_rec_t &r) {
+  return r.target & ((1ull << 48) - 1);
+}
+
+static int pe_of(const xbrtime_trace_rec_t &r) {
+  return (int)(r.target >> 48) - 1;
+}
+
+/* bytes from the first to the past-the-last element of a transfer */
+static size_t span_of(const xbrtime_trace_rec_t &r) {
+  size_t stride = (size_t)std::max(r.stride, 1);
+  return r.nelems == 0 ? 0 : ((r.nelems - 1) * stride + 1) * r.width;
+}
+
+/* reads every chunk of the trace into one record vector per stream */
+static int load(const char *path, xbrtime_trace_hdr_t *h,
+                std::vector<stream_t> &s) {
+  FILE *f = fopen(path, "rb");
+  xbrtime_trace_chunk_t c;
+
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  if (fread(h, sizeof(*h), 1, f) != 1 || h->magic != XBRTIME_TRACE_MAGIC ||
+      h->rec_size != sizeof(xbrtime_trace_rec_t) || h->npes == 0) {
+    fprintf(stderr, "%s: not a trace of this runtime\n", path);
+    fclose(f);
+    return -1;
+  }
+  s.assign(h->npes + 1, stream_t());
+  while (fread(&c, sizeof(c), 1, f) == 1) {
+    if (c.stream > h->npes) {
+      fprintf(stderr, "%s: bad chunk, stopping there\n", path);
+      break;
+    }
+    stream_t &v = s[c.stream];
+    size_t n = v.size();
+    v.resize(n + c.count);
+    if (fread(&v[n], sizeof(xbrtime_trace_rec_t), c.count, f) != c.count) {
+      fprintf(stderr, "%s: truncated, stopping there\n", path);
+      v.resize(n);
+      break;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+/* the sequences of barriers and collectives of all PE streams agree */
+static bool same_syncs(const std::vector<stream_t> &s, int npes) {
+  std::vector<xbrtime_trace_rec_t> first;
+  for (int p = 0; p < npes; p++) {
+    size_t k = 0;
+    for (const auto &r : s[p]) {
+      if (!is_sync(r))
+        continue;
+      if (p == 0) {
+        first.push_back(r);
+      } else if (k >= first.size() || first[k].op != r.op ||
+                 first[k].nelems != r.nelems || first[k].flags != r.flags ||
+                 first[k].target != r.target) {
+        return false;
+      }
+      k++;
+    }
+    if (k != first.size())
+      return false;
+  }
+  return true;
+}
+
+/* replays a transfer with the kernels of its width */
+static void transfer(const xbrtime_trace_rec_t &r, char *remote, char *local) {
+  using namespace xbr::detail;
+  bool get = r.op == XBRTIME_TRACE_GET;
+  size_t stride = (size_t)std::max(r.stride, 1) * r.width;
+  size_t w = 8, words = 0;
+  kernel_fn k = NULL;
+
+  while (r.width % w != 0)
+    w >>= 1;
+  words = r.width / w;
+  switch (w) {
+  case 8: k = get ? kernel<8, false>::get : kernel<8, false>::put; break;
+  case 4: k = get ? kernel<4, false>::get : kernel<4, false>::put; break;
+  case 2: k = get ? kernel<2, false>::get : kernel<2, false>::put; break;
+  default: k = get ? kernel<1, false>::get : kernel<1, false>::put; break;
+  }
+  char *src = get ? remote : local, *dest = get ? local : remote;
+  if (words == 1 || stride == r.width) {
+    run_kernel(k, src, dest, r.nelems * words, words == 1 ? stride : w);
+  } else {
+    for (size_t i = 0; i < r.nelems; i++)
+      run_kernel(k, src + i * stride, dest + i * stride, words, w);
+  }
+  __xbrtime_asm_fence();
+}
+
+/* re-issues one call from 'pe' (-1 for the main thread) */
+static void issue(const xbrtime_trace_rec_t &r, int pe, int npes, char *local,
+                  char *coll_src, char *coll_dst, tally &t) {
+  double t0 = RTSEC();
+  size_t off = 0;
+
+  switch (r.op) {
+  case XBRTIME_TRACE_GET:
+  case XBRTIME_TRACE_PUT: {
+    int target = pe_of(r);
+    size_t span = span_of(r);
+    if (span > R.arena_size) {
+      t.skipped[r.op]++; // larger than the scratch block
+      return;
+    }
+    off = offset_of(r);
+    if (off + span > R.arena_size)
+      off %= R.arena_size - span + 1;
+    target = (target < 0) ? std::max(pe, 0) : target % npes;
+    transfer(r, (char *)xbrtime_ptr(R.arena, target) + off, local);
+    t.bytes[r.op] += (uint64_t)r.nelems * r.width;
+    break;
+  }
+  case XBRTIME_TRACE_BARRIER:
+    if (pe < 0)
+      __xbrtime_asm_fence();
+    else
+      xbrtime_barrier();
+    break;
+  case XBRTIME_TRACE_COLL_BARRIER:
+    xbrtime_coll_barrier();
+    break;
+  case XBRTIME_TRACE_BROADCAST:
+    xbrtime_coll_broadcast(coll_dst, coll_src, r.nelems, pe_of(r));
+    t.bytes[r.op] += r.nelems;
+    break;
+  case XBRTIME_TRACE_REDUCE:
+    xbrtime_coll_reduce(coll_dst, coll_src, r.nelems, r.flags & 15,
+                        r.flags >> 4, pe_of(r));
+    t.bytes[r.op] += (uint64_t)r.nelems * r.width;
+    break;
+  case XBRTIME_TRACE_ALLREDUCE:
+    xbrtime_coll_allreduce(coll_dst, coll_src, r.nelems, r.flags & 15,
+                           r.flags >> 4);
+    t.bytes[r.op] += (uint64_t)r.nelems * r.width;
+    break;
+  case XBRTIME_TRACE_MALLOC: {
+    void *p = xbrtime_malloc(r.nelems);
+    std::lock_guard<std::mutex> lk(R.lock);
+    R.blocks[offset_of(r)] = p;
+    t.bytes[r.op] += r.nelems;
+    break;
+  }
+  case XBRTIME_TRACE_FREE: {
+    void *p = NULL;
+    {
+      std::lock_guard<std::mutex> lk(R.lock);
+      auto i = R.blocks.find(offset_of(r));
+      if (i == R.blocks.end()) {
+        t.skipped[r.op]++; // allocated before the trace was opened
+        return;
+      }
+      p = i->second;
+      R.blocks.erase(i);
+    }
+    t0 = RTSEC();
+    xbrtime_free(p);
+    break;
+  }
+  case XBRTIME_TRACE_MALLOC_LOCAL: {
+    xbrtime_gref_t g = xbrtime_malloc_local(r.nelems);
+    std::lock_guard<std::mutex> lk(R.lock);
+    R.lblocks[offset_of(r)] = g;
+    t.bytes[r.op] += r.nelems;
+    break;
+  }
+  case XBRTIME_TRACE_FREE_LOCAL: {
+    xbrtime_gref_t g = XBRTIME_GREF_NULL;
+    {
+      std::lock_guard<std::mutex> lk(R.lock);
+      auto i = R.lblocks.find(offset_of(r));
+      if (i == R.lblocks.end()) {
+        t.skipped[r.op]++;
+        return;
+      }
+      g = i->second;
+      R.lblocks.erase(i);
+    }
+    t0 = RTSEC();
+    xbrtime_free_local(g);
+    break;
+  }
+  default:
+    t.skipped[0]++;
+    return;
+  }
+  t.n[r.op]++;
+  t.traced[r.op] += (double)xbrtime_trace_ns(r.dur);
+  t.replayed[r.op] += (RTSEC() - t0) * 1e9;
+}
+
+/* replays records [lo, hi) of stream 's' on 'pe' */
+static void replay(const stream_t &s, size_t lo, size_t hi, int pe, int npes,
+                   tally &t) {
+  std::vector<char> local(R.xfer_bytes), src(R.coll_bytes), dst(R.coll_bytes);
+  for (size_t i = lo; i < hi; i++) {
+    const xbrtime_trace_rec_t &r = s[i];
+    if (R.gaps) {
+      double until = RTSEC() + xbrtime_trace_ns(r.gap) * 1e-9;
+      while (RTSEC() < until) {
+      }
+    }
+    if (is_sync(r) && (pe < 0 ? r.op != XBRTIME_TRACE_BARRIER : !R.colls)) {
+      t.skipped[r.op]++;
+      continue;
+    }
+    issue(r, pe, npes, local.data(), src.data(), dst.data(), t);
+  }
+}
+
+/* ns from the opening of the trace to the end of each call of a stream */
+static std::vector<uint64_t> ends(const stream_t &s) {
+  std::vector<uint64_t> e(s.size());
+  uint64_t now = 0;
+  for (size_t i = 0; i < s.size(); i++) {
+    now += xbrtime_trace_ns(s[i].gap) + xbrtime_trace_ns(s[i].dur);
+    e[i] = now;
+  }
+  return e;
+}
+
+int main(int argc, char **argv) {
+  xbrtime_trace_hdr_t h;
+  std::vector<stream_t> s;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace [honor gaps: 0|1]\n", argv[0]);
+    return 1;
+  }
+  if (load(argv[1], &h, s) != 0)
+    return 1;
+  R.gaps = (argc > 2) && atoi(argv[2]) != 0;
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  int tpes = (int)h.npes;
+  xbrtime_heap_stats_t st;
+  xbrtime_heap_stats(&st);
+
+  /* scratch block: the traced heap up to the furthest transfer */
+  size_t need = 0, nrecs = 0;
+  for (const auto &v : s) {
+    nrecs += v.size();
+    for (const auto &r : v) {
+      if (is_xfer(r)) {
+        need = std::max<size_t>(need, offset_of(r) + span_of(r));
+        R.xfer_bytes = std::max<size_t>(R.xfer_bytes, span_of(r));
+      }
+      else if (r.op == XBRTIME_TRACE_BROADCAST)
+        R.coll_bytes = std::max<size_t>(R.coll_bytes, r.nelems);
+      else if (is_sync(r))
+        R.coll_bytes = std::max<size_t>(R.coll_bytes, r.nelems * r.width);
+    }
+  }
+  R.arena_size = std::clamp<size_t>(need, 64, st.part_size / 4);
+  R.xfer_bytes = std::min(R.xfer_bytes, R.arena_size);
+  R.arena = (char *)xbrtime_malloc(R.arena_size);
+  R.colls = (npes == tpes) && same_syncs(s, tpes);
+  if (R.arena == NULL) {
+    fprintf(stderr, "cannot allocate a %zu byte scratch block\n",
+            R.arena_size);
+    xbrtime_close();
+    return 1;
+  }
+
+  printf("trace: %s, %zu calls of %d PEs (partition %llu MiB)\n", argv[1],
+         nrecs, tpes, (unsigned long long)(h.part_size >> 20));
+  printf("replay: %d PEs, scratch %zu of %zu bytes traced%s, gaps %s, "
+         "collectives %s\n",
+         npes, R.arena_size, need, need > R.arena_size ? " (wrapped)" : "",
+         R.gaps ? "honored" : "dropped", R.colls ? "re-issued" : "skipped");
+  if (!R.colls && npes != tpes)
+    printf("        (collectives need the traced PE count, %d)\n", tpes);
+
+  /* main thread calls before the first PE call go first, the rest last */
+  const stream_t &m = s[tpes];
+  std::vector<uint64_t> me = ends(m);
+  uint64_t first = UINT64_MAX, span = 0;
+  for (int p = 0; p < tpes; p++) {
+    std::vector<uint64_t> e = ends(s[p]);
+    if (!s[p].empty()) {
+      first = std::min(first, e[0] - xbrtime_trace_ns(s[p][0].dur));
+      span = std::max(span, e.back());
+    }
+  }
+  if (!me.empty())
+    span = std::max(span, me.back());
+  size_t pro = 0;
+  while (pro < m.size() && me[pro] <= first)
+    pro++;
+
+  std::vector<tally> t(tpes + 1);
+  double wall = RTSEC();
+  replay(m, 0, pro, -1, npes, t[tpes]);
+  xbr::detail::on_each_pe([&](int pe) {
+    /* with fewer PEs than traced, a PE runs several streams in turn */
+    for (int p = pe; p < tpes; p += npes)
+      replay(s[p], 0, s[p].size(), pe, npes, t[p]);
+  });
+  replay(m, pro, m.size(), -1, npes, t[tpes]);
+  wall = RTSEC() - wall;
+
+  /* totals over all streams */
+  tally all;
+  for (const auto &x : t) {
+    for (int o = 0; o < NOPS; o++) {
+      all.n[o] += x.n[o];
+      all.bytes[o] += x.bytes[o];
+      all.skipped[o] += x.skipped[o];
+      all.traced[o] += x.traced[o];
+      all.replayed[o] += x.replayed[o];
+    }
+  }
+  printf("%-13s %10s %12s %10s %12s %12s %8s\n", "call", "count", "MiB",
+         "skipped", "traced ms", "replayed ms", "ratio");
+  double tt = 0, tr = 0;
+  for (int o = 1; o < NOPS; o++) {
+    if (all.n[o] == 0 && all.skipped[o] == 0)
+      continue;
+    printf("%-13s %10llu %12.3f %10llu %12.3f %12.3f %8.3f\n", op_name[o],
+           (unsigned long long)all.n[o], all.bytes[o] / 1048576.0,
+           (unsigned long long)all.skipped[o], all.traced[o] / 1e6,
+           all.replayed[o] / 1e6,
+           all.traced[o] > 0 ? all.replayed[o] / all.traced[o] : 0.0);
+    tt += all.traced[o];
+    tr += all.replayed[o];
+  }
+  printf("%-13s %10s %12s %10s %12.3f %12.3f %8.3f\n", "in calls", "", "", "",
+         tt / 1e6, tr / 1e6, tt > 0 ? tr / tt : 0.0);
+  printf("%-13s %10s %12s %10s %12.3f %12.3f %8.3f\n", "wall", "", "", "",
+         span / 1e6, wall * 1e3, span > 0 ? wall * 1e9 / span : 0.0);
+
+  /* release what the trace left allocated, then the scratch block */
+  for (auto &b : R.blocks)
+    xbrtime_free(b.second);
+  for (auto &b : R.lblocks)
+    xbrtime_free_local(b.second);
+  xbrtime_free(R.arena);
+  xbrtime_close();
+  return 0;
+}
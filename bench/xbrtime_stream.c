@@ -0,0 +1,120 @@
+/* _xbrtime_stream.c_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Scan of a remote symmetric array, checksumming every element:
+ *   1. one blocking get per chunk, then consume the chunk
+ *   2. xbrtime_stream_next(), which fetches the next chunk meanwhile
+ *   3. a single blocking get into a full-size local copy
+ *
+ * usage: stream.exe [MiB] [chunk KiB]      (default: 256 MiB, 256 KiB)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "xbrtime_morello.h"
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+static uint64_t consume(const uint64_t *p, size_t n) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ p[i]) * 0x100000001b3ull;
+  return h;
+}
+
+static void report(const char *name, size_t bytes, double t, uint64_t h) {
+  printf("%-14s: %8.3f s  %10.2f MB/s  (checksum %016llx)\n", name, t,
+         bytes / t / 1e6, (unsigned long long)h);
+}
+
+int main(int argc, char **argv) {
+  size_t mib = (argc > 1) ? strtoull(argv[1], NULL, 10) : 256;
+  size_t chunk = ((argc > 2) ? strtoull(argv[2], NULL, 10) : 256) * 1024;
+  size_t bytes = mib * 1024 * 1024;
+  size_t ne = bytes / sizeof(uint64_t);
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  int target = 1 % npes;
+
+  uint64_t *shared = (uint64_t *)xbrtime_malloc(bytes);
+  uint64_t *buf = (uint64_t *)malloc(chunk);
+  if (shared == NULL || buf == NULL) {
+    fprintf(stderr, "Failed to allocate %zu MiB\n", mib);
+    xbrtime_close();
+    return EXIT_FAILURE;
+  }
+  uint64_t *remote = (uint64_t *)xbrtime_ptr(shared, target);
+  for (size_t i = 0; i < ne; i++)
+    remote[i] = i * 0x9e3779b97f4a7c15ull;
+  xbrtime_barrier();
+
+  printf("PEs: %d, scanning %zu MiB on PE %d in %zu KiB chunks\n", npes, mib,
+         target, chunk / 1024);
+
+  /* ---- 1. blocking get per chunk */
+  {
+    uint64_t h = 0;
+    double t = RTSEC();
+    for (size_t off = 0; off < ne; off += chunk / sizeof(uint64_t)) {
+      size_t n = ne - off;
+      if (n > chunk / sizeof(uint64_t))
+        n = chunk / sizeof(uint64_t);
+      xbrtime_ulonglong_get((unsigned long long *)buf,
+                            (unsigned long long *)remote + off, n, 1, target);
+      h ^= consume(buf, n);
+    }
+    report("blocking get", bytes, RTSEC() - t, h);
+  }
+
+  /* ---- 2. double-buffered stream */
+  {
+    uint64_t h = 0;
+    const void *p;
+    size_t len;
+    double t = RTSEC();
+    xbrtime_stream_t *s = xbrtime_stream_open(shared, bytes, target, chunk);
+    while ((p = xbrtime_stream_next(s, &len)) != NULL)
+      h ^= consume((const uint64_t *)p, len / sizeof(uint64_t));
+    xbrtime_stream_close(s);
+    report("stream", bytes, RTSEC() - t, h);
+  }
+
+  /* ---- 3. one full-size get */
+  {
+    uint64_t *copy = (uint64_t *)malloc(bytes);
+    if (copy != NULL) {
+      uint64_t h = 0;
+      double t = RTSEC();
+      xbrtime_ulonglong_get((unsigned long long *)copy,
+                            (unsigned long long *)remote, ne, 1, target);
+      for (size_t off = 0; off < ne; off += chunk / sizeof(uint64_t)) {
+        size_t n = ne - off;
+        if (n > chunk / sizeof(uint64_t))
+          n = chunk / sizeof(uint64_t);
+        h ^= consume(copy + off, n);
+      }
+      report("full copy", bytes, RTSEC() - t, h);
+      free(copy);
+    }
+  }
+
+  free(buf);
+  xbrtime_free(shared);
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/* _xbrtime_uts.cpp_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ * Unbalanced Tree Search (binomial trees) on xbr::work_pool.
+ *
+ * The root has B0 children; every other node has M children with
+ * probability Q and none otherwise, so with M*Q < 1 the tree is finite but
+ * very irregular. Child descriptors are derived from the parent with a
+ * 64-bit mixing function in place of the SHA-1 splittable RNG of the
+ * reference UTS, which keeps a node at 16 bytes. The tree is searched with
+ * both victim policies and the per-PE work and steal counts are printed.
+ *
+ * usage: uts.exe [B0] [Q] [M] [seed]      (default: the T3-like 2000 0.124875 8 42)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "xbMrtime-workpool.hpp"
+
+// Timer function
+static double RTSEC() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + tp.tv_usec / (double)1.0e6;
+}
+
+struct node {
+  uint64_t id;
+  uint64_t height;
+};
+
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+static const char *policy_name(xbr::victim_policy p) {
+  return p == xbr::victim_policy::random ? "random" : "lifeline";
+}
+
+int main(int argc, char **argv) {
+  uint64_t b0 = (argc > 1) ? strtoull(argv[1], NULL, 10) : 2000;
+  double q = (argc > 2) ? atof(argv[2]) : 0.124875;
+  uint64_t m = (argc > 3) ? strtoull(argv[3], NULL, 10) : 8;
+  uint64_t seed = (argc > 4) ? strtoull(argv[4], NULL, 10) : 42;
+  uint64_t threshold = (uint64_t)(q * 18446744073709551616.0);
+
+  xbrtime_init();
+  int npes = xbrtime_num_pes();
+  printf("UTS binomial: b0=%llu q=%f m=%llu seed=%llu on %d PEs\n",
+         (unsigned long long)b0, q, (unsigned long long)m,
+         (unsigned long long)seed, npes);
+
+  xbr::victim_policy policies[] = {xbr::victim_policy::random,
+                                   xbr::victim_policy::lifeline};
+  for (xbr::victim_policy policy : policies) {
+    xbr::work_pool<node> pool(1 << 16, policy);
+    uint64_t maxh[__XBRTIME_MAX_PE] = {0};
+
+    pool.add(0, node{mix(seed), 0});
+    double t = RTSEC();
+    pool.run([&](const node &n, xbr::work_pool<node> &p) {
+      int me = xbrtime_mype();
+      if (n.height > maxh[me])
+        maxh[me] = n.height;
+      uint64_t kids = 0;
+      if (n.height == 0)
+        kids = b0;
+      else if (mix(n.id) < threshold)
+        kids = m;
+      for (uint64_t i = 0; i < kids; i++)
+        p.spawn(node{mix(n.id * 0x100000001b3ull + i + 1), n.height + 1});
+    });
+    t = RTSEC() - t;
+
+    uint64_t nodes = 0, depth = 0;
+    for (int pe = 0; pe < npes; pe++) {
+      nodes += pool.stats(pe).executed;
+      depth = maxh[pe] > depth ? maxh[pe] : depth;
+    }
+    printf("[%s] nodes=%llu depth=%llu time=%f s rate=%f Mnodes/s\n",
+           policy_name(policy), (unsigned long long)nodes,
+           (unsigned long long)depth, t, nodes / t / 1e6);
+    for (int pe = 0; pe < npes; pe++) {
+      const xbr::work_pool_stats &s = pool.stats(pe);
+      printf("  PE %2d: nodes=%10llu steals=%6llu failed=%8llu "
+             "stolen=%8llu pushed=%8llu received=%8llu\n",
+             pe, (unsigned long long)s.executed,
+             (unsigned long long)s.steals, (unsigned long long)s.failed,
+             (unsigned long long)s.stolen, (unsigned long long)s.pushed,
+             (unsigned long long)s.received);
+    }
+  }
+
+  xbrtime_close();
+  return EXIT_SUCCESS;
+}
@@ -18,6 +18,8 @@
 #include <pthread.h>
 #include <sys/types.h>
 
+#include "xbMrtime-macros.h"
+
 //#include "threadpool.h"
 
 // ---------------------------------------------------------------- PROTOTYPES
@@ -37,6 +39,16 @@ typedef struct tpool_work_queue tpool_work_queue_t;
 // Arguments for the function passed on the work unit
 typedef void (*thread_func_t)(void *arg);
 
+// Priority lanes of a work queue. Workers always drain the lowest-numbered
+// non-empty lane first; work units within a lane keep their FIFO order.
+typedef enum {
+  TPOOL_PRIO_CONTROL = 0,   // barriers, collectives and other control work
+  TPOOL_PRIO_BULK    = 1    // bulk data work (default for tpool_add_work)
+} tpool_prio_t;
+
+// Number of priority lanes per work queue
+#define TPOOL_NUM_PRIOS 2
+
 // Queue creation prototype
 tpool_thread_t *tpool_create(size_t num);
 
@@ -46,9 +58,16 @@ void tpool_destroy(tpool_work_queue_t *wq);
 // Adds work to the queue for processing. 
 bool tpool_add_work(tpool_work_queue_t *wq, thread_func_t func, void *arg);
 
+// Adds work to the given priority lane of the queue for processing.
+bool tpool_add_work_prio(tpool_work_queue_t *wq, thread_func_t func, void *arg,
+                         tpool_prio_t prio);
+
 // Blocks until all work has been completed.
 void tpool_wait(tpool_work_queue_t *wq);
 
+// Pool thread running the caller; NULL when called from outside the pool
+extern __thread tpool_thread_t *tpool_self;
+
 // ------------------------------------------------------------------- STRUCTS  
 struct tpool_thread{
   uint64_t            thread_id;
@@ -64,8 +83,8 @@ struct tpool_work_unit {
 };
 
 struct tpool_work_queue {
-  tpool_work_unit_t  *work_head;     // queue head pointer
-  tpool_work_unit_t  *work_tail;     // queue tail pointer
+  tpool_work_unit_t  *work_head[TPOOL_NUM_PRIOS]; // per-lane head pointers
+  tpool_work_unit_t  *work_tail[TPOOL_NUM_PRIOS]; // per-lane tail pointers
   pthread_mutex_t     work_mutex;    // single mutex for all locking
   pthread_cond_t      work_cond;     // signal: there is work to process
   pthread_cond_t      working_cond;  // signal: no threads processing
@@ -74,13 +93,16 @@ struct tpool_work_queue {
   bool                stop;          // stops the threads
 };
 
+#ifndef __XBRTIME_DECLARE_ONLY
+__thread tpool_thread_t *tpool_self = NULL;
+
 // ---------------------------------- Simple helper for creating work objects.  
 static tpool_work_unit_t *tpool_work_unit_create(thread_func_t func, void *arg)
 {
   if (func == NULL)
     return NULL;
 
-  tpool_work_unit_t *work = malloc(sizeof(tpool_work_unit_t));
+  tpool_work_unit_t *work = (tpool_work_unit_t *) malloc(sizeof(tpool_work_unit_t));
   
   if (work == NULL)  // Handle malloc failure
     return NULL;
@@ -100,36 +122,59 @@ static void tpool_work_unit_destroy(tpool_work_unit_t *work)
   free(work); 
 } 
 
+// ------------------------------------------------------ QUEUE EMPTY FUNCTION
+// Returns true when no lane of the queue holds pending work.
+//   Must be called with the queue mutex held.
+static bool tpool_queue_empty(tpool_work_queue_t *wq)
+{
+  for (int p = 0; p < TPOOL_NUM_PRIOS; p++) {
+    if (wq->work_head[p] != NULL)
+      return false;
+  }
+  return true;
+}
+
 // --------------------------------------------------------- GET WORK FUNCTION  
-// Handles pulling an object from the list and                                  
-//   maintain the list work_head and work_tail references.                      
+// Handles pulling an object from the highest priority non-empty lane and
+//   maintain the lane's work_head and work_tail references.
 static tpool_work_unit_t *tpool_work_unit_get(tpool_work_queue_t *wq)
 {
-  if (wq == NULL || wq->work_head == NULL)
+  if (wq == NULL)
     return NULL;
 
-  tpool_work_unit_t *work = wq->work_head;
-  wq->work_head = work->next;
+  for (int p = 0; p < TPOOL_NUM_PRIOS; p++) {
+    tpool_work_unit_t *work = wq->work_head[p];
+    if (work == NULL)
+      continue;
 
-  // If the work_head becomes NULL after the update, then reset the work_tail as well.
-  if (wq->work_head == NULL)
-    wq->work_tail = NULL;
+    wq->work_head[p] = work->next;
 
-  return work;
+    // If the lane head becomes NULL after the update, reset its tail as well.
+    if (wq->work_head[p] == NULL)
+      wq->work_tail[p] = NULL;
+
+    return work;
+  }
+
+  return NULL;
 }                                                                             
                                                                                 
 // ----------------------------------------------------------- WORKER FUNCTION  
 // At a high level: this function waits for work and processes it.              
 static void *tpool_worker(void *arg) 
 {
-  tpool_work_queue_t *wq = (tpool_work_queue_t *) arg;
+  tpool_thread_t *self = (tpool_thread_t *) arg;
+  tpool_work_queue_t *wq = self->thread_queue;
   tpool_work_unit_t *work;
 
+  // Let the work units find out which pool thread runs them.
+  tpool_self = self;
+
   while (1) {
     pthread_mutex_lock(&(wq->work_mutex));
 
     // Wait for work to be available or for a stop signal.
-    while (wq->work_head == NULL && !wq->stop) {
+    while (tpool_queue_empty(wq) && !wq->stop) {
       pthread_cond_wait(&(wq->work_cond), &(wq->work_mutex));
     }
 
@@ -159,7 +204,7 @@ static void *tpool_worker(void *arg)
 
     // Decrement working count and signal if needed.
     wq->working_cnt--;
-    if (!wq->stop && wq->working_cnt == 0 && wq->work_head == NULL) {
+    if (!wq->stop && wq->working_cnt == 0 && tpool_queue_empty(wq)) {
       pthread_cond_signal(&(wq->working_cond));
     }
 
@@ -179,7 +224,7 @@ tpool_thread_t *tpool_create(size_t num)
     num = 2; 
 
   // Allocate memory for the thread structures.
-  tpool_thread_t *threads = calloc(num, sizeof(*threads));
+  tpool_thread_t *threads = (tpool_thread_t *) calloc(num, sizeof(*threads));
     
   // Check if memory allocation for threads succeeded.
   if (!threads) {
@@ -199,7 +244,7 @@ tpool_thread_t *tpool_create(size_t num)
 #endif
 
     // Allocate and initialize a work queue for the current thread.
-    tpool_work_queue_t *wq = calloc(1, sizeof(*wq));
+    tpool_work_queue_t *wq = (tpool_work_queue_t *) calloc(1, sizeof(*wq));
         
     // Check if memory allocation for the work queue succeeded.
     if (!wq) {
@@ -240,9 +285,9 @@ tpool_thread_t *tpool_create(size_t num)
   // Loop to create the threads.
   for (i = 0; i < num; i++) {
     // Create a new thread with the `tpool_worker` function, 
-    //   passing the work queue as its argument.
+    //   passing its thread structure (and so its work queue) as the argument.
     if (pthread_create(&threads[i].thread_handle, 
-                       NULL, tpool_worker, threads[i].thread_queue)) {
+                       NULL, tpool_worker, &threads[i])) {
       perror("Failed to create thread");
       // You can add more cleanup or error handling here 
       //   if thread creation fails.
@@ -340,12 +385,15 @@ void tpool_destroy(tpool_work_queue_t *wq)
   // Lock the work queue to safely manipulate it.
   pthread_mutex_lock(&(wq->work_mutex));
 
-  // Throwing away all pending work; caller BEWARE!!!
-  work = wq->work_head;
-  while (work != NULL) {
-    work2 = work->next;
-    tpool_work_unit_destroy(work);
-    work = work2;
+  // Throwing away all pending work in every lane; caller BEWARE!!!
+  for (int p = 0; p < TPOOL_NUM_PRIOS; p++) {
+    work = wq->work_head[p];
+    while (work != NULL) {
+      work2 = work->next;
+      tpool_work_unit_destroy(work);
+      work = work2;
+    }
+    wq->work_head[p] = wq->work_tail[p] = NULL;
   }
 
   // Cleaned up the queue; tell the threads they need to stop.
@@ -376,16 +424,11 @@ void tpool_destroy(tpool_work_queue_t *wq)
 }
 */
 
-// -------------------------------------------------- Adding work to the queue     
-bool tpool_add_work(tpool_work_queue_t *wq, thread_func_t func, void *arg)                 
+// ------------------------------------- Adding work to a lane of the queue
+bool tpool_add_work_prio(tpool_work_queue_t *wq, thread_func_t func, void *arg,
+                         tpool_prio_t prio)
 {
-  /*
-   * calculate number of bytes in func to travel up the stack by 
-   *    tpool_work_queue_t *wq, thread_func_t func, void *arg
-   * __asm__
-   *   get rtrn adrr
-   */
-  if (wq == NULL)
+  if (wq == NULL || prio < 0 || prio >= TPOOL_NUM_PRIOS)
     return false;
 
   // Create a work object outside the locked region.
@@ -395,12 +438,12 @@ bool tpool_add_work(tpool_work_queue_t *wq, thread_func_t func, void *arg)
 
   pthread_mutex_lock(&(wq->work_mutex));
 
-  // Add the object to the linked list.
-  if (wq->work_head == NULL) {
-    wq->work_head = wq->work_tail = work;
+  // Append the object to the linked list of its lane.
+  if (wq->work_head[prio] == NULL) {
+    wq->work_head[prio] = wq->work_tail[prio] = work;
   } else {
-    wq->work_tail->next = work;
-    wq->work_tail = work;
+    wq->work_tail[prio]->next = work;
+    wq->work_tail[prio] = work;
   }
 
   pthread_cond_broadcast(&(wq->work_cond));
@@ -409,6 +452,18 @@ bool tpool_add_work(tpool_work_queue_t *wq, thread_func_t func, void *arg)
   return true;
 }
 
+// -------------------------------------------------- Adding work to the queue     
+bool tpool_add_work(tpool_work_queue_t *wq, thread_func_t func, void *arg)                 
+{
+  /*
+   * calculate number of bytes in func to travel up the stack by 
+   *    tpool_work_queue_t *wq, thread_func_t func, void *arg
+   * __asm__
+   *   get rtrn adrr
+   */
+  return tpool_add_work_prio(wq, func, arg, TPOOL_PRIO_BULK);
+}
+
 
 // ----------------------------------------- Waiting for processing to complete  
 void tpool_wait(tpool_work_queue_t *wq)
@@ -450,8 +505,9 @@ void tpool_queue_free(tpool_work_queue_t *queue)
     return;
   }
   
-  tpool_unit_free(queue->work_head);
-  tpool_unit_free(queue->work_tail);
+  // The tail of each lane is part of its head list.
+  for (int p = 0; p < TPOOL_NUM_PRIOS; p++)
+    tpool_unit_free(queue->work_head[p]);
 
   // free(queue->work_mutex);
   // free(queue->work_cond);
@@ -462,8 +518,8 @@ void tpool_queue_free(tpool_work_queue_t *queue)
 
   free(queue);
 }
-// struct tpool_work_queue { tpool_work_unit_t *work_head; 
-//    tpool_work_unit_t *work_tail; pthread_mutex_t work_mutex;
+// struct tpool_work_queue { tpool_work_unit_t *work_head[TPOOL_NUM_PRIOS]; 
+//    tpool_work_unit_t *work_tail[TPOOL_NUM_PRIOS]; pthread_mutex_t work_mutex;
 //    pthread_cond_t work_cond; pthread_cond_t working_cond;
 //    size_t working_cnt; size_t num_threads; bool stop; };
 
@@ -483,5 +539,6 @@ void tpool_thread_free(tpool_thread_t *pool)
 }
 // struct tpool_thread{ uint64_t thread_id; pthread_t thread_handle; 
 //    tpool_work_queue_t *thread_queue; };
+#endif /* __XBRTIME_DECLARE_ONLY */
 
 #endif /* __THREADPOOL_H__ */
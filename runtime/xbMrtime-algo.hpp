@@ -0,0 +1,510 @@
+/*
+ * xbMrtime-algo.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-algo.hpp
+ * \brief Parallel algorithms over xbr::dist_array
+ *
+ * Every algorithm is owner-computes: the per-PE part runs on that PE's pool
+ * thread over its local share, and the global part (combining partial
+ * results, exchanging data) is finished collectively before the call
+ * returns:
+ *
+ * \code
+ *   xbr::fill(a, 1.0);
+ *   xbr::transform(a, b, [](double x) { return x * x; });
+ *   double s = xbr::reduce(b, 0.0);
+ *   xbr::sort(b);
+ *   xbr::inclusive_scan(a, b);
+ *   xbr::histogram(keys, bins);
+ *   auto sums = xbr::reduce_by_key(keys, vals);
+ * \endcode
+ *
+ * Like the C collectives they are called from outside the pool. The local
+ * loops run over restrict-qualified raw pointers so that the compiler can
+ * vectorize them.
+ */
+
+#ifndef _XBRTIME_ALGO_HPP_
+#define _XBRTIME_ALGO_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "xbMrtime-dist.hpp"
+
+namespace xbr {
+
+namespace detail {
+
+/*! \brief True when both arrays place every global index identically */
+template <typename T, typename U, typename D>
+bool same_layout(const dist_array<T, D> &a, const dist_array<U, D> &b) {
+  return a.size() == b.size() && a.distribution() == b.distribution();
+}
+
+/*! \brief Global chunk [lo, hi) assigned to 'pe' for layout-free passes */
+inline void chunk_of(size_t n, int pe, size_t *lo, size_t *hi) {
+  int npes = xbrtime_num_pes();
+  *lo = n * (size_t)pe / npes;
+  *hi = n * (size_t)(pe + 1) / npes;
+}
+
+/*! \brief Combine per-PE partial results in PE order */
+template <typename T, typename Op>
+T combine(T init, const T *partial, const bool *have, Op op) {
+  int npes = xbrtime_num_pes();
+  for (int pe = 0; pe < npes; pe++)
+    if (have[pe])
+      init = op(init, partial[pe]);
+  return init;
+}
+
+} // namespace detail
+
+/* ========================================================================= */
+/*                           ELEMENT-WISE ALGORITHMS                        */
+/* ========================================================================= */
+
+/*! \brief Apply f(x) to every element, in place */
+template <typename T, typename D, typename F>
+void for_each(dist_array<T, D> &a, F f) {
+  detail::on_each_pe([&](int pe) {
+    T *__restrict p = a.local_data(pe);
+    size_t n = a.local_size(pe);
+    for (size_t i = 0; i < n; i++)
+      f(p[i]);
+  });
+}
+
+/*! \brief Set every element to 'value' */
+template <typename T, typename D> void fill(dist_array<T, D> &a, const T &value) {
+  detail::on_each_pe([&](int pe) {
+    T *__restrict p = a.local_data(pe);
+    size_t n = a.local_size(pe);
+    for (size_t i = 0; i < n; i++)
+      p[i] = value;
+  });
+}
+
+/*!
+ * \brief out[i] = f(in[i]); both arrays must share one layout
+ *
+ * 'in' and 'out' may be the same array.
+ */
+template <typename T, typename U, typename D, typename F>
+void transform(const dist_array<T, D> &in, dist_array<U, D> &out, F f) {
+  if (!detail::same_layout(in, out))
+    throw std::invalid_argument("xbr::transform: layouts differ");
+  detail::on_each_pe([&](int pe) {
+    const T *src = in.local_data(pe);
+    U *dst = out.local_data(pe);
+    size_t n = in.local_size(pe);
+    for (size_t i = 0; i < n; i++)
+      dst[i] = f(src[i]);
+  });
+}
+
+/*!
+ * \brief out[i] = in[i]
+ *
+ * With identical layouts every PE copies locally. Otherwise each PE moves
+ * one contiguous global chunk with the bulk range get/put, which issue one
+ * transfer per owner.
+ */
+template <typename T, typename D1, typename D2>
+void copy(const dist_array<T, D1> &in, dist_array<T, D2> &out) {
+  if (in.size() != out.size())
+    throw std::invalid_argument("xbr::copy: sizes differ");
+  if constexpr (std::is_same<D1, D2>::value) {
+    if (detail::same_layout(in, out)) {
+      detail::on_each_pe([&](int pe) {
+        const T *src = in.local_data(pe);
+        T *__restrict dst = out.local_data(pe);
+        size_t n = in.local_size(pe);
+        for (size_t i = 0; i < n; i++)
+          dst[i] = src[i];
+      });
+      return;
+    }
+  }
+  detail::on_each_pe([&](int pe) {
+    size_t lo, hi;
+    detail::chunk_of(in.size(), pe, &lo, &hi);
+    std::vector<T> buf(hi - lo);
+    in.get(buf.data(), lo, hi - lo);
+    out.put(buf.data(), lo, hi - lo);
+  });
+}
+
+/* ========================================================================= */
+/*                           REDUCTIONS                                     */
+/* ========================================================================= */
+
+/*!
+ * \brief init op t(a[0]) op t(a[1]) ...
+ *
+ * Each PE folds its share; the partials are combined in PE order, so the
+ * result is deterministic for a given PE count.
+ */
+template <typename T, typename D, typename R, typename ROp, typename TOp>
+R transform_reduce(const dist_array<T, D> &a, R init, ROp rop, TOp top) {
+  R partial[__XBRTIME_MAX_PE];
+  bool have[__XBRTIME_MAX_PE];
+
+  detail::on_each_pe([&](int pe) {
+    const T *__restrict p = a.local_data(pe);
+    size_t n = a.local_size(pe);
+    have[pe] = n != 0;
+    if (n == 0)
+      return;
+    R acc = top(p[0]);
+    for (size_t i = 1; i < n; i++)
+      acc = rop(acc, top(p[i]));
+    partial[pe] = acc;
+  });
+  return detail::combine(init, partial, have, rop);
+}
+
+/*! \brief init op a[0] op a[1] ... */
+template <typename T, typename D, typename Op = std::plus<T>>
+T reduce(const dist_array<T, D> &a, T init = T{}, Op op = Op{}) {
+  return transform_reduce(a, init, op, [](const T &x) { return x; });
+}
+
+/* ========================================================================= */
+/*                           SCAN                                           */
+/* ========================================================================= */
+
+/*!
+ * \brief out[i] = in[0] op ... op in[i]
+ *
+ * Two passes: every PE scans its piece and publishes its total, then adds
+ * the combined totals of the preceding pieces. Block layouts scan the local
+ * share in place; other layouts scan one contiguous global chunk per PE.
+ */
+template <typename T, typename D, typename Op = std::plus<T>>
+void inclusive_scan(const dist_array<T, D> &in, dist_array<T, D> &out,
+                    Op op = Op{}) {
+  if (!detail::same_layout(in, out))
+    throw std::invalid_argument("xbr::inclusive_scan: layouts differ");
+  int npes = xbrtime_num_pes();
+  T total[__XBRTIME_MAX_PE];
+  bool have[__XBRTIME_MAX_PE];
+  std::vector<std::vector<T>> bufs(npes);
+
+  auto piece = [&](int pe, size_t *lo, size_t *hi) {
+    if constexpr (D::contiguous) {
+      *lo = in.global_index(pe, 0);
+      *hi = *lo + in.local_size(pe);
+    } else {
+      detail::chunk_of(in.size(), pe, lo, hi);
+    }
+  };
+
+  detail::on_each_pe([&](int pe) {
+    size_t lo, hi;
+    piece(pe, &lo, &hi);
+    size_t n = hi > lo ? hi - lo : 0;
+    have[pe] = n != 0;
+    if (n == 0)
+      return;
+    const T *src;
+    T *dst;
+    if constexpr (D::contiguous) {
+      src = in.local_data(pe);
+      dst = out.local_data(pe);
+    } else {
+      bufs[pe].resize(n);
+      in.get(bufs[pe].data(), lo, n);
+      src = dst = bufs[pe].data();
+    }
+    T acc = src[0];
+    dst[0] = acc;
+    for (size_t i = 1; i < n; i++) {
+      acc = op(acc, src[i]);
+      dst[i] = acc;
+    }
+    total[pe] = acc;
+  });
+
+  detail::on_each_pe([&](int pe) {
+    size_t lo, hi;
+    piece(pe, &lo, &hi);
+    if (!have[pe])
+      return;
+    bool any = false;
+    T carry{};
+    for (int q = 0; q < pe; q++) {
+      if (!have[q])
+        continue;
+      carry = any ? op(carry, total[q]) : total[q];
+      any = true;
+    }
+    T *p = D::contiguous ? out.local_data(pe) : bufs[pe].data();
+    if (any)
+      for (size_t i = 0; i < hi - lo; i++)
+        p[i] = op(carry, p[i]);
+    if constexpr (!D::contiguous)
+      out.put(p, lo, hi - lo);
+  });
+}
+
+/* ========================================================================= */
+/*                           SORT                                           */
+/* ========================================================================= */
+
+/*!
+ * \brief Sort the whole array by global index
+ *
+ * Sample sort: each PE sorts its share in place and contributes npes-1
+ * samples, the splitters cut every share into one bucket per destination
+ * PE, each PE fetches and merges its buckets with bulk gets, and finally
+ * writes the merged run to its global rank range. Each on_each_pe() step
+ * acts as the barrier between phases.
+ */
+template <typename T, typename D, typename Compare = std::less<T>>
+void sort(dist_array<T, D> &a, Compare comp = Compare{}) {
+  int npes = xbrtime_num_pes();
+  std::vector<T> samples((size_t)npes * (npes - 1));
+  std::vector<size_t> nsamples(npes, 0);
+  std::vector<T> splitters;
+  std::vector<size_t> cut((size_t)npes * (npes + 1));
+  std::vector<std::vector<T>> merged(npes);
+
+  /* local sort and sampling */
+  detail::on_each_pe([&](int pe) {
+    T *p = a.local_data(pe);
+    size_t n = a.local_size(pe);
+    std::sort(p, p + n, comp);
+    if (n == 0)
+      return;
+    for (int k = 0; k < npes - 1; k++)
+      samples[(size_t)pe * (npes - 1) + k] = p[(k + 1) * n / npes];
+    nsamples[pe] = npes - 1;
+  });
+
+  /* pick npes-1 global splitters */
+  std::vector<T> pool;
+  for (int pe = 0; pe < npes; pe++)
+    pool.insert(pool.end(), samples.begin() + (size_t)pe * (npes - 1),
+                samples.begin() + (size_t)pe * (npes - 1) + nsamples[pe]);
+  std::sort(pool.begin(), pool.end(), comp);
+  for (int k = 1; k < npes && !pool.empty(); k++)
+    splitters.push_back(pool[k * pool.size() / npes]);
+
+  /* bucket boundaries within every share */
+  detail::on_each_pe([&](int pe) {
+    T *p = a.local_data(pe);
+    size_t n = a.local_size(pe);
+    size_t *c = &cut[(size_t)pe * (npes + 1)];
+    c[0] = 0;
+    for (int d = 1; d < npes; d++)
+      c[d] = (size_t)d <= splitters.size()
+                 ? std::lower_bound(p, p + n, splitters[d - 1], comp) - p
+                 : n;
+    c[npes] = n;
+  });
+
+  /* fetch and merge the buckets destined for each PE */
+  detail::on_each_pe([&](int pe) {
+    std::vector<T> &m = merged[pe];
+    size_t len = 0;
+    for (int s = 0; s < npes; s++) {
+      const size_t *c = &cut[(size_t)s * (npes + 1)];
+      len += c[pe + 1] - c[pe];
+    }
+    m.resize(len);
+    size_t at = 0;
+    for (int s = 0; s < npes; s++) {
+      const size_t *c = &cut[(size_t)s * (npes + 1)];
+      size_t cnt = c[pe + 1] - c[pe];
+      xbr::get(m.data() + at, a.local_data(s) + c[pe], cnt, s);
+      std::inplace_merge(m.begin(), m.begin() + at, m.begin() + at + cnt,
+                         comp);
+      at += cnt;
+    }
+  });
+
+  /* write each merged run back at its global rank */
+  detail::on_each_pe([&](int pe) {
+    size_t first = 0;
+    for (int q = 0; q < pe; q++)
+      first += merged[q].size();
+    a.put(merged[pe].data(), first, merged[pe].size());
+  });
+}
+
+/* ========================================================================= */
+/*                           HISTOGRAM AND REDUCE BY KEY                    */
+/* ========================================================================= */
+
+/*!
+ * \brief bins[k] = number of elements of 'keys' equal to k, over all PEs
+ *
+ * Keys of bins.size() or more are not counted. Each PE bins its share into
+ * a private histogram and then sums its own share of 'bins' over all PEs
+ * (see xbrtime_histogram_into()), so no counter is updated remotely.
+ * Block distributions of 'bins' only.
+ */
+template <typename D1, typename D2>
+int histogram(const dist_array<uint64_t, D1> &keys,
+              dist_array<uint64_t, D2> &bins) {
+  static_assert(D2::contiguous,
+                "xbr::histogram: each PE's bins must be one range");
+  int npes = xbrtime_num_pes();
+  std::vector<const uint64_t *> k(npes);
+  std::vector<uint64_t *> out(npes);
+  std::vector<size_t> n(npes), first(npes), count(npes);
+  for (int pe = 0; pe < npes; pe++) {
+    k[pe] = keys.local_data(pe);
+    n[pe] = keys.local_size(pe);
+    out[pe] = bins.local_data(pe);
+    count[pe] = bins.local_size(pe);
+    first[pe] = count[pe] != 0 ? bins.global_index(pe, 0) : 0;
+  }
+  return xbrtime_histogram_into(k.data(), n.data(), bins.size(), out.data(),
+                                first.data(), count.data());
+}
+
+namespace detail {
+
+/* a key and its value; trivially copyable, unlike std::pair */
+template <typename K, typename V> struct keyed {
+  K key;
+  V value;
+};
+
+/* folds runs of equal keys of a sorted range in place; returns the new end */
+template <typename K, typename V, typename Op, typename Compare>
+size_t fold_runs(keyed<K, V> *p, size_t n, Op op, Compare comp) {
+  size_t out = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (out != 0 && !comp(p[out - 1].key, p[i].key))
+      p[out - 1].value = op(p[out - 1].value, p[i].value);
+    else
+      p[out++] = p[i];
+  }
+  return out;
+}
+
+} // namespace detail
+
+/*!
+ * \brief Every distinct key of 'keys' with the values at its positions in
+ *        'vals' combined by 'op', sorted by key
+ *
+ * For sparse keys, where a histogram over the whole key range would be
+ * mostly empty. Each PE sorts and folds its share, the key range is cut
+ * at sampled splitters as in sort(), and each PE fetches and folds the
+ * runs of its key range from all PEs. Values of one key are combined in
+ * PE order and, within a PE, in index order (stable), so a non-commutative
+ * 'op' gives the same result for a given PE count.
+ */
+template <typename K, typename V, typename D, typename Op = std::plus<V>,
+          typename Compare = std::less<K>>
+std::vector<std::pair<K, V>> reduce_by_key(const dist_array<K, D> &keys,
+                                           const dist_array<V, D> &vals,
+                                           Op op = Op{},
+                                           Compare comp = Compare{}) {
+  using kv = detail::keyed<K, V>;
+  if (!detail::same_layout(keys, vals))
+    throw std::invalid_argument("xbr::reduce_by_key: layouts differ");
+  int npes = xbrtime_num_pes();
+  std::vector<std::vector<kv>> runs(npes), merged(npes);
+  std::vector<K> samples((size_t)npes * (npes - 1));
+  std::vector<size_t> nsamples(npes, 0);
+  std::vector<K> splitters;
+  std::vector<size_t> cut((size_t)npes * (npes + 1));
+  auto less = [&](const kv &a, const kv &b) { return comp(a.key, b.key); };
+
+  /* sort and fold every share, and sample its distinct keys */
+  detail::on_each_pe([&](int pe) {
+    const K *k = keys.local_data(pe);
+    const V *v = vals.local_data(pe);
+    size_t n = keys.local_size(pe);
+    std::vector<kv> &r = runs[pe];
+    r.resize(n);
+    for (size_t i = 0; i < n; i++)
+      r[i] = kv{k[i], v[i]};
+    std::stable_sort(r.begin(), r.end(), less);
+    r.resize(detail::fold_runs(r.data(), n, op, comp));
+    if (r.empty())
+      return;
+    for (int s = 0; s < npes - 1; s++)
+      samples[(size_t)pe * (npes - 1) + s] = r[(s + 1) * r.size() / npes].key;
+    nsamples[pe] = npes - 1;
+  });
+
+  std::vector<K> pool;
+  for (int pe = 0; pe < npes; pe++)
+    pool.insert(pool.end(), samples.begin() + (size_t)pe * (npes - 1),
+                samples.begin() + (size_t)pe * (npes - 1) + nsamples[pe]);
+  std::sort(pool.begin(), pool.end(), comp);
+  for (int s = 1; s < npes && !pool.empty(); s++)
+    splitters.push_back(pool[s * pool.size() / npes]);
+
+  /* cut every run at the splitters; equal keys never straddle a cut */
+  detail::on_each_pe([&](int pe) {
+    const std::vector<kv> &r = runs[pe];
+    size_t *c = &cut[(size_t)pe * (npes + 1)];
+    c[0] = 0;
+    for (int d = 1; d < npes; d++)
+      c[d] = (size_t)d <= splitters.size()
+                 ? std::lower_bound(r.begin(), r.end(),
+                                    kv{splitters[d - 1], V{}}, less) -
+                       r.begin()
+                 : r.size();
+    c[npes] = r.size();
+  });
+
+  /* each PE merges its key range from all PEs in PE order and folds it */
+  detail::on_each_pe([&](int pe) {
+    std::vector<kv> &m = merged[pe];
+    size_t len = 0;
+    for (int s = 0; s < npes; s++) {
+      const size_t *c = &cut[(size_t)s * (npes + 1)];
+      len += c[pe + 1] - c[pe];
+    }
+    m.resize(len);
+    size_t at = 0;
+    for (int s = 0; s < npes; s++) {
+      const size_t *c = &cut[(size_t)s * (npes + 1)];
+      size_t cnt = c[pe + 1] - c[pe];
+      xbr::get(m.data() + at, runs[s].data() + c[pe], cnt, s);
+      std::inplace_merge(m.begin(), m.begin() + at, m.begin() + at + cnt,
+                         less);
+      at += cnt;
+    }
+    m.resize(detail::fold_runs(m.data(), len, op, comp));
+  });
+
+  std::vector<std::pair<K, V>> result;
+  size_t total = 0;
+  for (int pe = 0; pe < npes; pe++)
+    total += merged[pe].size();
+  result.reserve(total);
+  for (int pe = 0; pe < npes; pe++)
+    for (const kv &e : merged[pe])
+      result.emplace_back(e.key, e.value);
+  return result;
+}
+
+} // namespace xbr
+
+#endif /* _XBRTIME_ALGO_HPP_ */
+
+/* EOF */
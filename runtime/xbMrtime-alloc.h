@@ -18,7 +18,17 @@
 extern "C" {
 #endif
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__CHERI_PURE_CAPABILITY__)
+#include <cheri.h>
+#endif
 
 typedef struct _XBRTIME_MEM_T{
   uint64_t start_addr;
@@ -147,49 +157,1003 @@ void __xbrtime_asm_quiet_fence();
 //   }
 // }
 
+/* ------------------------------------------------- SYMMETRIC HEAP */
+
+/*
+ * The symmetric heap is a single anonymous mapping that is split into one
+ * equally sized partition per PE.  A symmetric allocation reserves the same
+ * [offset, offset+size) range in every partition, so the copy that belongs
+ * to PE 'p' is always found at base + p*part_size + offset.  The block list
+ * is kept out of band (in the local heap) and covers the whole partition in
+ * address order; free neighbours are coalesced on release.  Free blocks are
+ * also linked into segregated lists by size class, and allocated blocks are
+ * indexed by offset, so neither an allocation nor a release walks the list.
+ *
+ */
+
+/* free list classes: a free block of size s is on list floor(log2(s)) */
+#define __XBRTIME_HEAP_CLASSES 64
+
+/*
+ * 'used' of a block the runtime holds for itself (the local allocator's
+ * reserve and chunks): neither saved in a manifest nor counted in the
+ * statistics
+ */
+#define __XBRTIME_HEAP_PRIVATE 2
+
+typedef struct __xbrtime_heap_blk {
+  size_t offset;                      /* offset of the block in each partition */
+  size_t size;                        /* size of the block in bytes */
+  int    used;                        /* 1 when allocated, or private */
+  struct __xbrtime_heap_blk *prev;    /* previous block in address order */
+  struct __xbrtime_heap_blk *next;    /* next block in address order */
+  struct __xbrtime_heap_blk *fprev;   /* free list neighbours, when free */
+  struct __xbrtime_heap_blk *fnext;
+} __xbrtime_heap_blk_t;
+
+/* one allocation of a heap manifest */
+typedef struct {
+  uint64_t offset;
+  uint64_t size;
+} __xbrtime_manifest_ent_t;
+
+/*
+ * the allocations of a heap, as stored at the head of a checkpoint file
+ * and of a named heap segment
+ *
+ */
+typedef struct {
+  uint64_t magic;                     /* _XBRTIME_MANIFEST_MAGIC_ when valid */
+  uint64_t npes;
+  uint64_t part_size;
+  uint64_t extent;                    /* bytes of each partition in use */
+  uint64_t nallocs;
+  __xbrtime_manifest_ent_t allocs[_XBRTIME_MANIFEST_MAX_];
+} __xbrtime_manifest_t;
+
+#define _XBRTIME_MANIFEST_MAGIC_ 0x3170616568726278ull /* "xbrheap1" */
+
+/*!
+ * \struct xbrtime_heap_stats_t
+ * \brief Usage of the symmetric heap, the same in every partition
+ *
+ * A hole is a free block below the extent; the fewer and larger the
+ * holes, the less fragmented the heap.
+ */
+typedef struct {
+  size_t   part_size;    /*! bytes per PE partition */
+  size_t   used;         /*! bytes allocated */
+  size_t   peak;         /*! high-water mark of used */
+  size_t   extent;       /*! end of the last allocation */
+  size_t   peak_extent;  /*! high-water mark of extent */
+  size_t   holes;        /*! free blocks below the extent */
+  size_t   largest_hole; /*! bytes of the largest hole */
+  size_t   live;         /*! allocations outstanding */
+  uint64_t allocs;       /*! successful allocations */
+  uint64_t frees;        /*! releases */
+  uint64_t failures;     /*! allocations that found no room */
+} xbrtime_heap_stats_t;
+
+typedef struct {
+  char                  *base;        /* start of PE 0's partition */
+  size_t                 part_size;   /* bytes per PE partition */
+  int                    npes;        /* number of partitions */
+  __xbrtime_heap_blk_t  *blocks;      /* block list of a single partition */
+  __xbrtime_heap_blk_t  *free[__XBRTIME_HEAP_CLASSES]; /* free blocks by class */
+  __xbrtime_heap_blk_t **index;       /* allocated blocks, hashed by offset */
+  size_t                 index_cap;   /* slots of 'index', a power of two */
+  size_t                 index_n;     /* blocks in 'index' */
+  pthread_mutex_t        lock;        /* serializes allocation and release */
+  char                  *map;         /* start of the mapping */
+  size_t                 map_len;     /* bytes mapped */
+  __xbrtime_manifest_t  *shm;         /* manifest of a named segment */
+  xbrtime_heap_stats_t   stats;       /* counters; the block list has the rest */
+} __xbrtime_heap_t;
+
+extern __xbrtime_heap_t __xbrtime_heap;
+
+static inline size_t __xbrtime_heap_align_up( size_t v, size_t align ){
+  return (v + align - 1) & ~(align - 1);
+}
+
+/* returns 1 when ptr lies in any PE's partition of the symmetric heap */
+static inline int __xbrtime_heap_contains( const void *ptr ){
+  const char *p = (const char *)ptr;
+  return (__xbrtime_heap.base != NULL) &&
+         (p >= __xbrtime_heap.base) &&
+         (p < __xbrtime_heap.base +
+              (size_t)__xbrtime_heap.npes * __xbrtime_heap.part_size);
+}
+
+/* offset of a symmetric address within its partition */
+static inline size_t __xbrtime_heap_offset( const void *ptr ){
+  return (size_t)((const char *)ptr - __xbrtime_heap.base) %
+         __xbrtime_heap.part_size;
+}
+
+/* address of 'offset' in pe's partition, derived from the heap base */
+static inline void *__xbrtime_heap_at( int pe, size_t offset ){
+  return (void *)(__xbrtime_heap.base +
+                  (size_t)pe * __xbrtime_heap.part_size + offset);
+}
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_heap_t __xbrtime_heap = { NULL, 0, 0, NULL, { NULL }, NULL, 0, 0,
+                                    PTHREAD_MUTEX_INITIALIZER,
+                                    NULL, 0, NULL,
+                                    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+int xbrtime_mype();
+
+/* defined in xbMrtime-cache.h, which is included at the end of this file */
+static void __xbrtime_cache_forget( size_t offset );
+
+static __xbrtime_heap_blk_t *__xbrtime_heap_blk_new( size_t offset,
+                                                      size_t size,
+                                                      int used ){
+  __xbrtime_heap_blk_t *b =
+    (__xbrtime_heap_blk_t *)malloc( sizeof( __xbrtime_heap_blk_t ) );
+  if( b == NULL ){
+    return NULL;
+  }
+  b->offset = offset;
+  b->size   = size;
+  b->used   = used;
+  b->prev   = NULL;
+  b->next   = NULL;
+  b->fprev  = NULL;
+  b->fnext  = NULL;
+  return b;
+}
+
+static inline int __xbrtime_heap_class( size_t size ){
+  return 63 - __builtin_clzll( (unsigned long long)size );
+}
+
+/* puts a free block on the list of its class */
+static void __xbrtime_heap_free_push( __xbrtime_heap_blk_t *b ){
+  __xbrtime_heap_blk_t **head = &__xbrtime_heap.free[__xbrtime_heap_class( b->size )];
+  b->fprev = NULL;
+  b->fnext = *head;
+  if( *head != NULL ){
+    (*head)->fprev = b;
+  }
+  *head = b;
+}
+
+/* takes a free block off the list of its class */
+static void __xbrtime_heap_free_pull( __xbrtime_heap_blk_t *b ){
+  if( b->fprev != NULL ){
+    b->fprev->fnext = b->fnext;
+  }else{
+    __xbrtime_heap.free[__xbrtime_heap_class( b->size )] = b->fnext;
+  }
+  if( b->fnext != NULL ){
+    b->fnext->fprev = b->fprev;
+  }
+  b->fprev = NULL;
+  b->fnext = NULL;
+}
+
+/* home slot of 'offset' in the index */
+static inline size_t __xbrtime_heap_index_home( size_t offset ){
+  uint64_t h = (uint64_t)(offset >> 4) * 0x9e3779b97f4a7c15ull;
+  return (size_t)(h ^ (h >> 29)) & (__xbrtime_heap.index_cap - 1);
+}
+
+/* the allocated block starting at 'offset', or NULL */
+static __xbrtime_heap_blk_t *__xbrtime_heap_index_find( size_t offset ){
+  size_t i = 0;
+  if( __xbrtime_heap.index_cap == 0 ){
+    return NULL;
+  }
+  for( i = __xbrtime_heap_index_home( offset ); __xbrtime_heap.index[i] != NULL;
+       i = (i + 1) & (__xbrtime_heap.index_cap - 1) ){
+    if( __xbrtime_heap.index[i]->offset == offset ){
+      return __xbrtime_heap.index[i];
+    }
+  }
+  return NULL;
+}
+
+static void __xbrtime_heap_index_put( __xbrtime_heap_blk_t *b ){
+  size_t i = __xbrtime_heap_index_home( b->offset );
+  while( __xbrtime_heap.index[i] != NULL ){
+    i = (i + 1) & (__xbrtime_heap.index_cap - 1);
+  }
+  __xbrtime_heap.index[i] = b;
+  __xbrtime_heap.index_n++;
+}
+
+/* makes room for one more block, keeping the index at most half full */
+static int __xbrtime_heap_index_reserve( void ){
+  __xbrtime_heap_blk_t **old = __xbrtime_heap.index;
+  size_t cap = __xbrtime_heap.index_cap, i = 0;
+
+  if( 2 * (__xbrtime_heap.index_n + 1) <= cap ){
+    return 0;
+  }
+  __xbrtime_heap.index_cap = (cap == 0) ? 64 : 2 * cap;
+  __xbrtime_heap.index = (__xbrtime_heap_blk_t **)
+    calloc( __xbrtime_heap.index_cap, sizeof( __xbrtime_heap_blk_t * ) );
+  if( __xbrtime_heap.index == NULL ){
+    __xbrtime_heap.index     = old;
+    __xbrtime_heap.index_cap = cap;
+    return -1;
+  }
+  __xbrtime_heap.index_n = 0;
+  for( i = 0; i < cap; i++ ){
+    if( old[i] != NULL ){
+      __xbrtime_heap_index_put( old[i] );
+    }
+  }
+  free( old );
+  return 0;
+}
+
+/* removes the block at 'offset', shifting its probe chain back */
+static void __xbrtime_heap_index_del( size_t offset ){
+  size_t mask = __xbrtime_heap.index_cap - 1, i = 0, j = 0, k = 0;
+
+  for( i = __xbrtime_heap_index_home( offset ); __xbrtime_heap.index[i] != NULL;
+       i = (i + 1) & mask ){
+    if( __xbrtime_heap.index[i]->offset == offset ){
+      break;
+    }
+  }
+  if( __xbrtime_heap.index[i] == NULL ){
+    return;
+  }
+  for( j = (i + 1) & mask; __xbrtime_heap.index[j] != NULL; j = (j + 1) & mask ){
+    k = __xbrtime_heap_index_home( __xbrtime_heap.index[j]->offset );
+    /* move j into the hole at i unless its home lies in (i, j] */
+    if( (i <= j) ? ((k <= i) || (k > j)) : ((k <= i) && (k > j)) ){
+      __xbrtime_heap.index[i] = __xbrtime_heap.index[j];
+      i = j;
+    }
+  }
+  __xbrtime_heap.index[i] = NULL;
+  __xbrtime_heap.index_n--;
+}
+
+/* rebuilds the free lists and the index from the block list */
+static int __xbrtime_heap_reindex_locked( void ){
+  __xbrtime_heap_blk_t *b = NULL;
+
+  memset( __xbrtime_heap.free, 0, sizeof( __xbrtime_heap.free ) );
+  if( __xbrtime_heap.index != NULL ){
+    memset( __xbrtime_heap.index, 0,
+            __xbrtime_heap.index_cap * sizeof( __xbrtime_heap_blk_t * ) );
+  }
+  __xbrtime_heap.index_n = 0;
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( !b->used ){
+      __xbrtime_heap_free_push( b );
+    }else if( __xbrtime_heap_index_reserve() != 0 ){
+      return -1;
+    }else{
+      __xbrtime_heap_index_put( b );
+    }
+  }
+  return 0;
+}
+
+/*
+ * splits the free, unlisted block 'b' so that it holds exactly 'sz' bytes;
+ * the remainder follows it and goes on its free list
+ */
+static int __xbrtime_heap_blk_split( __xbrtime_heap_blk_t *b, size_t sz ){
+  __xbrtime_heap_blk_t *rest = NULL;
+  if( b->size == sz ){
+    return 0;
+  }
+  rest = __xbrtime_heap_blk_new( b->offset + sz, b->size - sz, 0 );
+  if( rest == NULL ){
+    return -1;
+  }
+  rest->prev = b;
+  rest->next = b->next;
+  if( b->next != NULL ){
+    b->next->prev = rest;
+  }
+  b->next = rest;
+  b->size = sz;
+  __xbrtime_heap_free_push( rest );
+  return 0;
+}
+
+/* merges the free block b->next into b; neither may be on a free list */
+static void __xbrtime_heap_blk_merge( __xbrtime_heap_blk_t *b ){
+  __xbrtime_heap_blk_t *n = b->next;
+  b->size += n->size;
+  b->next  = n->next;
+  if( n->next != NULL ){
+    n->next->prev = b;
+  }
+  free( n );
+}
+
+static void __xbrtime_heap_blk_release_all( void ){
+  __xbrtime_heap_blk_t *b = __xbrtime_heap.blocks;
+  while( b != NULL ){
+    __xbrtime_heap_blk_t *n = b->next;
+    free( b );
+    b = n;
+  }
+  __xbrtime_heap.blocks = NULL;
+  memset( __xbrtime_heap.free, 0, sizeof( __xbrtime_heap.free ) );
+  if( __xbrtime_heap.index != NULL ){
+    memset( __xbrtime_heap.index, 0,
+            __xbrtime_heap.index_cap * sizeof( __xbrtime_heap_blk_t * ) );
+  }
+  __xbrtime_heap.index_n = 0;
+  __xbrtime_heap.stats.used = 0;
+  __xbrtime_heap.stats.live = 0;
+}
+
+/*
+ * recounts the allocated bytes after the block list was replaced, and
+ * restarts the high-water marks from there; the heap lock must be held
+ *
+ */
+static void __xbrtime_heap_recount_locked( void ){
+  __xbrtime_heap_blk_t *b = NULL;
+  size_t used = 0, live = 0, end = 0;
+
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( b->used == 1 ){
+      used += b->size;
+      live++;
+      end = b->offset + b->size;
+    }
+  }
+  __xbrtime_heap.stats.used        = used;
+  __xbrtime_heap.stats.live        = live;
+  __xbrtime_heap.stats.peak        = used;
+  __xbrtime_heap.stats.peak_extent = end;
+}
+
+/* bytes reserved ahead of the partitions for a manifest, page aligned */
+static size_t __xbrtime_heap_hdr_size( void ){
+  return __xbrtime_heap_align_up( sizeof( __xbrtime_manifest_t ),
+                                  (size_t)sysconf( _SC_PAGESIZE ) );
+}
+
+/* records the allocated blocks in 'm'; the heap lock must be held */
+static int __xbrtime_heap_save_locked( __xbrtime_manifest_t *m ){
+  __xbrtime_heap_blk_t *b = NULL;
+  size_t page = (size_t)sysconf( _SC_PAGESIZE );
+  uint64_t n = 0, end = 0;
+
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( b->used != 1 ){
+      continue;
+    }
+    if( n == _XBRTIME_MANIFEST_MAX_ ){
+      return -1;
+    }
+    m->allocs[n].offset = b->offset;
+    m->allocs[n].size   = b->size;
+    end = b->offset + b->size;
+    n++;
+  }
+  m->npes      = (uint64_t)__xbrtime_heap.npes;
+  m->part_size = (uint64_t)__xbrtime_heap.part_size;
+  m->extent    = __xbrtime_heap_align_up( (size_t)end, page );
+  m->nallocs   = n;
+  m->magic     = _XBRTIME_MANIFEST_MAGIC_;
+  return 0;
+}
+
+/* appends a block to the list head..tail; empty blocks are skipped */
+static int __xbrtime_heap_blk_append( __xbrtime_heap_blk_t **head,
+                                      __xbrtime_heap_blk_t **tail,
+                                      size_t offset, size_t size, int used ){
+  __xbrtime_heap_blk_t *b = NULL;
+  if( size == 0 ){
+    return 0;
+  }
+  if( (b = __xbrtime_heap_blk_new( offset, size, used )) == NULL ){
+    return -1;
+  }
+  b->prev = *tail;
+  if( *tail != NULL ){
+    (*tail)->next = b;
+  }else{
+    *head = b;
+  }
+  *tail = b;
+  return 0;
+}
+
+/*
+ * replaces the block list with the allocations of 'm'; the heap lock
+ * must be held
+ *
+ */
+static int __xbrtime_heap_load_locked( const __xbrtime_manifest_t *m ){
+  __xbrtime_heap_blk_t *head = NULL, *tail = NULL, *b = NULL;
+  uint64_t i = 0, at = 0;
+  int rtn = 0;
+
+  if( (m->magic != _XBRTIME_MANIFEST_MAGIC_) ||
+      (m->npes != (uint64_t)__xbrtime_heap.npes) ||
+      (m->extent > (uint64_t)__xbrtime_heap.part_size) ||
+      (m->nallocs > _XBRTIME_MANIFEST_MAX_) ){
+    return -1;
+  }
+
+  /* build the new list aside so that a bad manifest changes nothing: the
+     free gap ahead of each allocation, then the allocation itself */
+  for( i = 0; (i <= m->nallocs) && (rtn == 0); i++ ){
+    uint64_t off  = __xbrtime_heap.part_size;
+    uint64_t size = 0;
+    if( i < m->nallocs ){
+      off  = m->allocs[i].offset;
+      size = m->allocs[i].size;
+      if( (off < at) || (size == 0) || (size > m->extent) ||
+          (off > m->extent - size) ){
+        rtn = -1;
+        break;
+      }
+    }
+    rtn = __xbrtime_heap_blk_append( &head, &tail, (size_t)at,
+                                     (size_t)(off - at), 0 );
+    if( rtn == 0 ){
+      rtn = __xbrtime_heap_blk_append( &head, &tail, (size_t)off,
+                                       (size_t)size, 1 );
+    }
+    at = off + size;
+  }
+  if( rtn != 0 ){
+    while( head != NULL ){
+      b = head->next;
+      free( head );
+      head = b;
+    }
+    return -1;
+  }
+
+  /* the old allocations are gone: none of them may stay cacheable */
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( b->used ){
+      __xbrtime_cache_forget( b->offset );
+    }
+  }
+  __xbrtime_heap_blk_release_all();
+  __xbrtime_heap.blocks = head;
+  if( __xbrtime_heap_reindex_locked() != 0 ){
+    __xbrtime_heap_blk_release_all();
+    return -1;
+  }
+  __xbrtime_heap_recount_locked();
+  return 0;
+}
+
+/*
+ * maps the heap on the named shared memory segment 'name', creating or
+ * resizing it as needed; a segment of the same geometry keeps its contents
+ *
+ */
+static int __xbrtime_heap_map_shm( const char *name, int npes, size_t part ){
+  char path[256];
+  size_t hdr = __xbrtime_heap_hdr_size();
+  size_t len = hdr + (size_t)npes * part;
+  struct stat st;
+  void *p = NULL;
+  int fd = -1;
+
+  snprintf( path, sizeof( path ), "%s%s", (name[0] == '/') ? "" : "/", name );
+  fd = shm_open( path, O_RDWR | O_CREAT, 0600 );
+  if( fd < 0 ){
+    return -1;
+  }
+  if( (fstat( fd, &st ) != 0) ||
+      (((size_t)st.st_size != len) && (ftruncate( fd, (off_t)len ) != 0)) ){
+    close( fd );
+    return -1;
+  }
+  p = mmap( NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( p == MAP_FAILED ){
+    return -1;
+  }
+
+  __xbrtime_heap.map  = (char *)p;
+  __xbrtime_heap.map_len = len;
+  __xbrtime_heap.shm  = (__xbrtime_manifest_t *)p;
+  __xbrtime_heap.base = (char *)p + hdr;
+  if( (size_t)st.st_size != len ){
+    /* new or resized segment: nothing to attach to */
+    __xbrtime_heap.shm->magic = 0;
+  }
+  return 0;
+}
+
+/*
+ * maps the symmetric heap for 'npes' partitions; an existing mapping of the
+ * same geometry is reused so that a runtime restart keeps its address range
+ *
+ */
+static int __xbrtime_heap_init( int npes ){
+  size_t part  = _XBRTIME_HEAP_SIZE_;
+  size_t page  = (size_t)sysconf( _SC_PAGESIZE );
+  char  *str   = getenv( "XBRTIME_HEAP_SIZE" );
+  char  *shm   = getenv( "XBRTIME_HEAP_SHM" );
+  void  *base  = NULL;
+  int    flags = MAP_PRIVATE | MAP_ANON;
+
+  if( npes <= 0 ){
+    return -1;
+  }
+  if( (str != NULL) && (strtoull( str, NULL, 0 ) > 0) ){
+    part = (size_t)strtoull( str, NULL, 0 );
+  }
+  part = __xbrtime_heap_align_up( part, page );
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  if( (__xbrtime_heap.base != NULL) &&
+      ((__xbrtime_heap.npes != npes) || (__xbrtime_heap.part_size != part)) ){
+    munmap( __xbrtime_heap.map, __xbrtime_heap.map_len );
+    __xbrtime_heap.base = NULL;
+    __xbrtime_heap.shm  = NULL;
+  }
+  if( __xbrtime_heap.base == NULL ){
+    if( (shm != NULL) && (shm[0] != '\0') ){
+      /* keep the heap in a named segment that outlives the process */
+      if( __xbrtime_heap_map_shm( shm, npes, part ) != 0 ){
+        pthread_mutex_unlock( &__xbrtime_heap.lock );
+        return -1;
+      }
+    }else{
+#ifdef MAP_NORESERVE
+      flags |= MAP_NORESERVE;
+#endif
+      base = mmap( NULL, (size_t)npes * part, PROT_READ | PROT_WRITE,
+                   flags, -1, 0 );
+      if( base == MAP_FAILED ){
+        pthread_mutex_unlock( &__xbrtime_heap.lock );
+        return -1;
+      }
+      __xbrtime_heap.base    = (char *)base;
+      __xbrtime_heap.map     = (char *)base;
+      __xbrtime_heap.map_len = (size_t)npes * part;
+    }
+    __xbrtime_heap.part_size = part;
+    __xbrtime_heap.npes      = npes;
+  }
+
+  /* attach to the allocations of a named segment (warm start) or start
+     with a single free block spanning the partition */
+  __xbrtime_heap_blk_release_all();
+  if( (__xbrtime_heap.shm == NULL) ||
+      (__xbrtime_heap_load_locked( __xbrtime_heap.shm ) != 0) ){
+    __xbrtime_heap.blocks = __xbrtime_heap_blk_new( 0, part, 0 );
+    __xbrtime_heap_reindex_locked();
+    __xbrtime_heap_recount_locked();
+  }else{
+    /* the allocations change from here on: until xbrtime_close() saves
+       them again, a crash leaves nothing to attach to */
+    __xbrtime_heap.shm->magic = 0;
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+
+  return (__xbrtime_heap.blocks == NULL) ? -1 : 0;
+}
+
+/*
+ * releases every outstanding symmetric block; the mapping itself stays in
+ * place so that late frees (eg, from C++ destructors) remain harmless.
+ * A named segment first records its allocations for the next attach.
+ *
+ */
+static void __xbrtime_heap_reset( void ){
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  if( (__xbrtime_heap.shm != NULL) &&
+      (__xbrtime_heap_save_locked( __xbrtime_heap.shm ) != 0) ){
+    __xbrtime_heap.shm->magic = 0;
+  }
+  __xbrtime_heap_blk_release_all();
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+}
+
+static void __xbrtime_heap_fini( void ){
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  __xbrtime_heap_blk_release_all();
+  free( __xbrtime_heap.index );
+  __xbrtime_heap.index     = NULL;
+  __xbrtime_heap.index_cap = 0;
+  if( __xbrtime_heap.base != NULL ){
+    munmap( __xbrtime_heap.map, __xbrtime_heap.map_len );
+    __xbrtime_heap.base = NULL;
+    __xbrtime_heap.shm  = NULL;
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+}
+
+/* a free block that can hold 'sz' bytes at alignment 'align', or NULL */
+static __xbrtime_heap_blk_t *__xbrtime_heap_fit( size_t align, size_t sz ){
+  __xbrtime_heap_blk_t *b = NULL;
+  size_t need = sz + align - 1, start = 0;
+  int c = 0, n = 0;
+
+  if( (need < sz) || (need == 0) ){
+    return NULL;
+  }
+  /* every block of class c or above fits whatever its alignment */
+  c = __xbrtime_heap_class( need ) + ((need & (need - 1)) != 0);
+
+  /* blocks of the class below may fit too: look at a few of them */
+  for( b = (c > 0) ? __xbrtime_heap.free[c - 1] : NULL;
+       (b != NULL) && (n < _XBRTIME_HEAP_SCAN_); b = b->fnext, n++ ){
+    start = __xbrtime_heap_align_up( b->offset, align );
+    if( (start < b->offset + b->size) &&
+        (sz <= b->offset + b->size - start) ){
+      return b;
+    }
+  }
+  for( ; c < __XBRTIME_HEAP_CLASSES; c++ ){
+    if( __xbrtime_heap.free[c] != NULL ){
+      return __xbrtime_heap.free[c];
+    }
+  }
+  return NULL;
+}
+
+/*
+ * turns [start, start+sz) of the listed free block 'b' into an indexed
+ * block marked 'used'; the rest of 'b' stays free
+ */
+static __xbrtime_heap_blk_t *__xbrtime_heap_take_locked( __xbrtime_heap_blk_t *b,
+                                                         size_t start, size_t sz,
+                                                         int used ){
+  __xbrtime_heap_free_pull( b );
+  /* carve off the leading padding as its own free block */
+  if( start != b->offset ){
+    if( __xbrtime_heap_blk_split( b, start - b->offset ) != 0 ){
+      __xbrtime_heap_free_push( b );
+      return NULL;
+    }
+    __xbrtime_heap_free_push( b );
+    b = b->next;
+    __xbrtime_heap_free_pull( b );
+  }
+  if( __xbrtime_heap_blk_split( b, sz ) != 0 ){
+    __xbrtime_heap_free_push( b );
+    return NULL;
+  }
+  b->used = used;
+  __xbrtime_heap_index_put( b );
+  return b;
+}
+
+/* the best fit for 'sz' bytes, as a block marked 'used' */
+static int __xbrtime_heap_alloc_locked( size_t align, size_t sz, int used,
+                                        size_t *offset ){
+  __xbrtime_heap_blk_t *b = NULL;
+
+  if( (__xbrtime_heap_index_reserve() == 0) &&
+      ((b = __xbrtime_heap_fit( align, sz )) != NULL) &&
+      ((b = __xbrtime_heap_take_locked( b,
+              __xbrtime_heap_align_up( b->offset, align ), sz,
+              used )) != NULL) ){
+    *offset = b->offset;
+    return 0;
+  }
+  return -1;
+}
+
+/* reserves [offset, offset+sz) in every partition; returns the offset */
+static int __xbrtime_heap_alloc( size_t align, size_t sz, size_t *offset ){
+  int rtn = -1;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  rtn = __xbrtime_heap_alloc_locked( align, sz, 1, offset );
+  if( rtn == 0 ){
+    xbrtime_heap_stats_t *st = &__xbrtime_heap.stats;
+    st->used += sz;
+    st->live++;
+    st->allocs++;
+    if( st->used > st->peak ){
+      st->peak = st->used;
+    }
+    if( *offset + sz > st->peak_extent ){
+      st->peak_extent = *offset + sz;
+    }
+  }else{
+    __xbrtime_heap.stats.failures++;
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  return rtn;
+}
+
+/*
+ * reserves a private block of 'sz' bytes wherever it fits, like
+ * __xbrtime_heap_alloc() but kept out of manifests and statistics
+ */
+static int __xbrtime_heap_alloc_private( size_t align, size_t sz,
+                                         size_t *offset ){
+  int rtn = -1;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  rtn = __xbrtime_heap_alloc_locked( align, sz, __XBRTIME_HEAP_PRIVATE,
+                                     offset );
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  return rtn;
+}
+
+/*
+ * reserves a private block of 'sz' bytes at the top of every partition,
+ * out of the way of the allocations; __xbrtime_heap_release() returns it
+ */
+static int __xbrtime_heap_alloc_top( size_t align, size_t sz, size_t *offset ){
+  __xbrtime_heap_blk_t *b = NULL;
+  size_t start = 0;
+  int rtn = -1;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  b = __xbrtime_heap.blocks;
+  while( (b != NULL) && (b->next != NULL) ){
+    b = b->next;
+  }
+  if( (b != NULL) && !b->used && (sz <= b->size) ){
+    start = (b->offset + b->size - sz) & ~(align - 1);
+    if( (start >= b->offset) && (__xbrtime_heap_index_reserve() == 0) &&
+        ((b = __xbrtime_heap_take_locked( b, start, sz,
+                                          __XBRTIME_HEAP_PRIVATE )) != NULL) ){
+      *offset = b->offset;
+      rtn = 0;
+    }
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  return rtn;
+}
+
+static void __xbrtime_heap_release( size_t offset ){
+  __xbrtime_heap_blk_t *b = NULL;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  /* not an allocated block (or already reset by xbrtime_close) */
+  if( (b = __xbrtime_heap_index_find( offset )) == NULL ){
+    pthread_mutex_unlock( &__xbrtime_heap.lock );
+    return;
+  }
+  __xbrtime_heap_index_del( offset );
+  if( b->used == 1 ){
+    __xbrtime_heap.stats.used -= b->size;
+    __xbrtime_heap.stats.live--;
+    __xbrtime_heap.stats.frees++;
+  }
+  b->used = 0;
+  if( (b->next != NULL) && !b->next->used ){
+    __xbrtime_heap_free_pull( b->next );
+    __xbrtime_heap_blk_merge( b );
+  }
+  if( (b->prev != NULL) && !b->prev->used ){
+    b = b->prev;
+    __xbrtime_heap_free_pull( b );
+    __xbrtime_heap_blk_merge( b );
+  }
+  __xbrtime_heap_free_push( b );
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+}
+
+/* finds the allocated block holding 'offset'; returns its start and size */
+static int __xbrtime_heap_block_of( size_t offset, size_t *start,
+                                    size_t *size ){
+  __xbrtime_heap_blk_t *b = NULL;
+  int rtn = -1;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  /* the start of a block is found directly; an interior offset walks */
+  if( (b = __xbrtime_heap_index_find( offset )) != NULL ){
+    *start = b->offset;
+    *size  = b->size;
+    rtn = 0;
+  }
+  for( b = (rtn == 0) ? NULL : __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( offset < b->offset + b->size ){
+      if( b->used && (offset >= b->offset) ){
+        *start = b->offset;
+        *size  = b->size;
+        rtn = 0;
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  return rtn;
+}
+
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+#include "xbMrtime-trace.h"
+
+/* ------------------------------------------------- PUBLIC ALLOCATION API */
+
+__XBRTIME_HOT void *xbrtime_ptr( const void *addr, int pe ){
+  char *ptr = NULL;
+
+  if( !__xbrtime_heap_contains( addr ) ){
+    return NULL;
+  }else if( (pe < 0) || (pe >= __xbrtime_heap.npes) ){
+    return NULL;
+  }
+
+  /* derive from the heap base so the result carries heap-wide bounds */
+  ptr = (char *)__xbrtime_heap_at( pe, __xbrtime_heap_offset( addr ) );
+  return (void *)ptr;
+}
+
+__XBRTIME_HOT int xbrtime_addr_accessible( const void *addr, int pe ){
+  return xbrtime_ptr( addr, pe ) != NULL;
+}
+
+#ifndef __XBRTIME_DECLARE_ONLY
+extern void *xbrtime_malloc_aligned( size_t align, size_t sz ){
+  size_t offset = 0;
+  int pe = 0;
+  char *ptr = NULL;
+  __XBRTIME_TRACE_T0( t );
+
+  /* sanity check */
+  if( sz == 0 ){
+    return NULL;
+  }else if( (align & (align - 1)) != 0 ){
+    return NULL;
+  }
+  if( align < _XBRTIME_HEAP_ALIGN_ ){
+    align = _XBRTIME_HEAP_ALIGN_;
+  }
+
+  if( __xbrtime_heap.base == NULL ){
+    /* no runtime yet: fall back to a private allocation */
+    ptr = NULL;
+    if( posix_memalign( (void **)&ptr, align, sz ) != 0 ){
+      return NULL;
+    }
+    __xbrtime_asm_quiet_fence();
+    return ptr;
+  }
+
+  sz = __xbrtime_heap_align_up( sz, _XBRTIME_HEAP_ALIGN_ );
+#if defined(__CHERI_PURE_CAPABILITY__)
+  /* keep the bounds of large blocks exactly representable */
+  sz = cheri_representable_length( sz );
+  if( align < (size_t)(~cheri_representable_alignment_mask( sz ) + 1) ){
+    align = (size_t)(~cheri_representable_alignment_mask( sz ) + 1);
+  }
+#endif
+
+  if( __xbrtime_heap_alloc( align, sz, &offset ) != 0 ){
+    return NULL;
+  }
+
+  /* hand back the calling PE's copy */
+  pe = xbrtime_mype();
+  if( (pe < 0) || (pe >= __xbrtime_heap.npes) ){
+    pe = 0;
+  }
+  ptr = (char *)__xbrtime_heap_at( pe, offset );
+#if defined(__CHERI_PURE_CAPABILITY__)
+  ptr = (char *)cheri_bounds_set( ptr, sz );
+#endif
+  __xbrtime_asm_quiet_fence();
+  __XBRTIME_TRACE_REC( t, XBRTIME_TRACE_MALLOC, 0, pe, 1, sz, 0, ptr );
+
+  return (void *)ptr;
+}
+
+extern void *xbrtime_heap_allocation( int index, size_t *size ){
+  __xbrtime_heap_blk_t *b = NULL;
+  char *ptr = NULL;
+  int pe = xbrtime_mype();
+
+  if( (pe < 0) || (pe >= __xbrtime_heap.npes) ){
+    pe = 0;
+  }
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  for( b = __xbrtime_heap.blocks; (b != NULL) && (index >= 0); b = b->next ){
+    if( (b->used == 1) && (index-- == 0) ){
+      ptr = (char *)__xbrtime_heap_at( pe, b->offset );
+#if defined(__CHERI_PURE_CAPABILITY__)
+      ptr = (char *)cheri_bounds_set( ptr, b->size );
+#endif
+      if( size != NULL ){
+        *size = b->size;
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  return (void *)ptr;
+}
+
 extern void *xbrtime_malloc( size_t sz ){
 // #ifdef XBGAS_PRINT
 //   printf("[R] Entered xbrtime_malloc()\n");
 // #endif
-  void *ptr = NULL;
-
   /* sanity check */
   if( sz == 0 ){
     return NULL;
-  } /*else if( __XBRTIME_CONFIG == NULL ){
-    return NULL;
-  }*/
+  }
 
-  ptr = malloc(sz);
   // ptr = __xbrtime_shared_malloc( sz );
-  __xbrtime_asm_quiet_fence();
-
-  return ptr;
+  return xbrtime_malloc_aligned( _XBRTIME_HEAP_ALIGN_, sz );
 }
 
 extern void xbrtime_free( void *ptr ){
 // #ifdef XBGAS_PRINT
 //   printf("[R] Entered xbrtime_free()\n");
 // #endif
-    if( ptr == NULL ){
-    return ;
-  } else {
-    free(ptr);
+  __XBRTIME_TRACE_T0( t );
+
+  if( ptr == NULL ){
     return ;
   }
+
+  if( __xbrtime_heap_contains( ptr ) ){
+    __xbrtime_cache_forget( __xbrtime_heap_offset( ptr ) );
+    __xbrtime_heap_release( __xbrtime_heap_offset( ptr ) );
+  }else{
+    /* allocated before the runtime was initialized */
+    free( ptr );
+  }
   __xbrtime_asm_quiet_fence();
-  
-  // if( ptr == NULL ){
-  //   return ;
-  // }/*else if( __XBRTIME_CONFIG == NULL ){
-  //   return ;
-  // }else if( __XBRTIME_CONFIG->_MMAP == NULL ){
-  //   return ;
-  // }*/
-  // __xbrtime_shared_free(ptr);
-  // __xbrtime_asm_quiet_fence();
+  __XBRTIME_TRACE_REC( t, XBRTIME_TRACE_FREE, 0, -1, 1, 0, 0, ptr );
+}
+
+extern void xbrtime_heap_stats( xbrtime_heap_stats_t *stats ){
+  __xbrtime_heap_blk_t *b = NULL, *last = NULL;
+
+  if( stats == NULL ){
+    return;
+  }
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  *stats = __xbrtime_heap.stats;
+  stats->part_size    = __xbrtime_heap.part_size;
+  stats->extent       = 0;
+  stats->holes        = 0;
+  stats->largest_hole = 0;
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( b->used == 1 ){
+      last = b;
+    }
+  }
+  for( b = __xbrtime_heap.blocks; (last != NULL) && (b != last); b = b->next ){
+    if( !b->used ){
+      stats->holes++;
+      if( b->size > stats->largest_hole ){
+        stats->largest_hole = b->size;
+      }
+    }
+  }
+  if( last != NULL ){
+    stats->extent = last->offset + last->size;
+  }
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+}
+
+extern void xbrtime_heap_stats_reset( void ){
+  __xbrtime_heap_blk_t *b = NULL;
+  size_t end = 0;
+
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  for( b = __xbrtime_heap.blocks; b != NULL; b = b->next ){
+    if( b->used == 1 ){
+      end = b->offset + b->size;
+    }
+  }
+  __xbrtime_heap.stats.peak        = __xbrtime_heap.stats.used;
+  __xbrtime_heap.stats.peak_extent = end;
+  __xbrtime_heap.stats.allocs      = 0;
+  __xbrtime_heap.stats.frees       = 0;
+  __xbrtime_heap.stats.failures    = 0;
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
 }
 
+#endif /* __XBRTIME_DECLARE_ONLY */
+
 /* ------------------------------------------------------------------------- */
 /* ========================================================================= */
 /* ------------------------------------------------------------------------- */
@@ -199,6 +1163,8 @@ extern void xbrtime_free( void *ptr ){
 }
 #endif  /* extern "C" */
 
+#include "xbMrtime-cache.h"
+
 #endif /* _XBRTIME_ALLOC_H_ */
 
 /* EOF */
@@ -0,0 +1,327 @@
+/*
+ * xbMrtime-bitmap.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-bitmap.hpp
+ * \brief Distributed atomic bitmap and Bloom filter
+ *
+ * xbr::dist_bitmap is a global array of bits kept as 64-bit words, block
+ * distributed over the PEs. Every update is an atomic OR (or AND) on the
+ * owner's word, so any PE may set bits concurrently:
+ *
+ * \code
+ *   xbr::dist_bitmap visited(nvertices);
+ *   if (!visited.test_and_set(v))    // from any PE
+ *     frontier.push_back(v);
+ *   visited.set(bits, n, was_set);   // batched
+ * \endcode
+ *
+ * Batched operations bucket their bits by owner PE with a stable counting
+ * sort and then issue them owner by owner, so each owner's words are
+ * touched in one burst. Entries for the same word keep their input order,
+ * and results are reported as if the batch had been applied in order.
+ *
+ * xbr::dist_bloom is a Bloom filter on top of a dist_bitmap. All 'k' bits
+ * of a key fall into one word, so an insert is a single remote atomic OR
+ * and a lookup a single remote load, at the price of a higher false
+ * positive rate than a filter spreading the bits over the array (about 4%
+ * instead of 2% at 8 bits per key, 0.4% instead of 0.05% at 16).
+ * Batches are hashed in one branch-free pass over the keys, which the
+ * compiler can vectorize, before going through the bitmap's batch path.
+ */
+
+#ifndef _XBRTIME_BITMAP_HPP_
+#define _XBRTIME_BITMAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "xbMrtime-hashmap.hpp"
+
+namespace xbr {
+
+/* ========================================================================= */
+/*                           DISTRIBUTED BITMAP                             */
+/* ========================================================================= */
+
+class dist_bitmap {
+  /* one entry of a batch, as given */
+  struct req {
+    uint64_t word;
+    uint64_t mask;
+  };
+
+  /* one entry of a batch, located */
+  struct op {
+    uint64_t *p;
+    uint64_t mask;
+    size_t idx;
+    int pe;
+  };
+
+public:
+  dist_bitmap() = default;
+
+  /*! \param nbits Number of bits, all initially clear */
+  explicit dist_bitmap(size_t nbits) : n_(nbits), w_((nbits + 63) / 64) {}
+
+  dist_bitmap(dist_bitmap &&) noexcept = default;
+  dist_bitmap &operator=(dist_bitmap &&) noexcept = default;
+
+  size_t size() const { return n_; }
+  size_t words() const { return w_.size(); }
+
+  /*! \brief PE holding bit 'i' */
+  int owner(size_t i) const { return w_.owner(i >> 6); }
+
+  /* ---- single bits */
+  bool test(size_t i) const { return (word(i >> 6) & bit(i)) != 0; }
+  void set(size_t i) { fetch_or(i >> 6, bit(i)); }
+  void reset(size_t i) { fetch_and(i >> 6, ~bit(i)); }
+
+  /*! \brief Set bit 'i'; returns whether it was already set */
+  bool test_and_set(size_t i) { return (fetch_or(i >> 6, bit(i)) & bit(i)) != 0; }
+
+  /*! \brief Clear bit 'i'; returns whether it was set */
+  bool test_and_reset(size_t i) {
+    return (fetch_and(i >> 6, ~bit(i)) & bit(i)) != 0;
+  }
+
+  /* ---- whole words */
+  uint64_t word(size_t w) const {
+    locus l = w_.locate(w);
+    return atomic_fetch(at(l), l.pe);
+  }
+  uint64_t fetch_or(size_t w, uint64_t mask) {
+    locus l = w_.locate(w);
+    return atomic_fetch_or(at(l), mask, l.pe);
+  }
+  uint64_t fetch_and(size_t w, uint64_t mask) {
+    locus l = w_.locate(w);
+    return atomic_fetch_and(at(l), mask, l.pe);
+  }
+
+  /* ---- batches */
+
+  /*!
+   * \brief Set n bits
+   * \param was_set If not null, receives whether each bit was already set
+   *        (by an earlier entry of the batch or before it)
+   */
+  void set(const uint64_t *bits, size_t n, bool *was_set = nullptr) {
+    or_batch(
+        n, [&](size_t i) { return req{bits[i] >> 6, bit(bits[i])}; },
+        [&](const op &o, uint64_t old) {
+          if (was_set != nullptr)
+            was_set[o.idx] = (old & o.mask) != 0;
+        });
+  }
+
+  /*! \brief Test n bits into out[] */
+  void test(const uint64_t *bits, size_t n, bool *out) const {
+    get_batch(
+        n, [&](size_t i) { return req{bits[i] >> 6, bit(bits[i])}; },
+        [&](const op &o, uint64_t v) { out[o.idx] = (v & o.mask) != 0; });
+  }
+
+  /*!
+   * \brief OR masks[i] into word w[i], for n words
+   * \param old If not null, receives each word as it was before its entry
+   */
+  void fetch_or(const uint64_t *w, const uint64_t *masks, size_t n,
+                uint64_t *old = nullptr) {
+    or_batch(
+        n, [&](size_t i) { return req{w[i], masks[i]}; },
+        [&](const op &o, uint64_t v) {
+          if (old != nullptr)
+            old[o.idx] = v;
+        });
+  }
+
+  /*! \brief Read n words into out[] */
+  void get(const uint64_t *w, size_t n, uint64_t *out) const {
+    get_batch(
+        n, [&](size_t i) { return req{w[i], 0}; },
+        [&](const op &o, uint64_t v) { out[o.idx] = v; });
+  }
+
+  /* ---- collective; called from outside the pool */
+
+  /*! \brief Clear every bit, each PE clearing its own words */
+  void clear() {
+    detail::on_each_pe([&](int pe) {
+      std::fill_n(w_.local_data(pe), w_.local_size(pe), uint64_t{0});
+    });
+  }
+
+  /*! \brief Number of set bits */
+  size_t count() const {
+    std::vector<size_t> part((size_t)xbrtime_num_pes(), 0);
+    detail::on_each_pe([&](int pe) {
+      const uint64_t *p = w_.local_data(pe);
+      for (size_t i = 0; i < w_.local_size(pe); i++)
+        part[pe] += (size_t)__builtin_popcountll(p[i]);
+    });
+    size_t total = 0;
+    for (size_t c : part)
+      total += c;
+    return total;
+  }
+
+private:
+  static uint64_t bit(size_t i) { return 1ull << (i & 63); }
+  uint64_t *at(locus l) const { return w_.local_data(l.pe) + l.offset; }
+
+  /* the batch grouped by owner, in input order within each owner */
+  template <typename Make>
+  std::vector<op> &bucketed(size_t n, Make make) const {
+    static thread_local std::vector<op> ops, tmp;
+    static thread_local std::vector<size_t> at;
+    at.assign((size_t)xbrtime_num_pes() + 1, 0);
+    tmp.resize(n);
+    ops.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      req r = make(i);
+      locus l = w_.locate(r.word);
+      tmp[i] = op{this->at(l), r.mask, i, l.pe};
+      at[l.pe + 1]++;
+    }
+    for (size_t pe = 1; pe < at.size(); pe++)
+      at[pe] += at[pe - 1];
+    for (size_t i = 0; i < n; i++)
+      ops[at[tmp[i].pe]++] = tmp[i];
+    return ops;
+  }
+
+  /* 'result' sees each entry's word as it was before the entry */
+  template <typename Make, typename Result>
+  void or_batch(size_t n, Make make, Result result) {
+    for (const op &o : bucketed(n, make))
+      result(o, atomic_fetch_or(o.p, o.mask, o.pe));
+  }
+
+  template <typename Make, typename Result>
+  void get_batch(size_t n, Make make, Result result) const {
+    for (const op &o : bucketed(n, make))
+      result(o, atomic_fetch(o.p, o.pe));
+  }
+
+  size_t n_ = 0;
+  dist_array<uint64_t> w_;
+};
+
+/* ========================================================================= */
+/*                           DISTRIBUTED BLOOM FILTER                       */
+/* ========================================================================= */
+
+class dist_bloom {
+public:
+  dist_bloom() = default;
+
+  /*!
+   * \param nbits Size of the filter in bits (rounded up to a word; at
+   *        most 2^38)
+   * \param k Bits per key, 1 to 10
+   * \param seed Hash seed
+   */
+  explicit dist_bloom(size_t nbits, int k = 6, uint64_t seed = 0)
+      : k_(std::clamp(k, 1, 10)), seed_(seed),
+        nwords_(check((nbits + 63) / 64)), bits_(nwords_ * 64) {}
+
+  dist_bloom(dist_bloom &&) noexcept = default;
+  dist_bloom &operator=(dist_bloom &&) noexcept = default;
+
+  size_t size() const { return bits_.size(); }
+  int hashes() const { return k_; }
+  const dist_bitmap &bits() const { return bits_; }
+
+  /*! \brief Add 'key'; returns whether it was (probably) present already */
+  bool insert(uint64_t key) {
+    uint64_t w, m;
+    hash(&key, 1, &w, &m);
+    return (bits_.fetch_or(w, m) & m) == m;
+  }
+
+  /*! \brief false if 'key' was never inserted; true if it probably was */
+  bool contains(uint64_t key) const {
+    uint64_t w, m;
+    hash(&key, 1, &w, &m);
+    return (bits_.word(w) & m) == m;
+  }
+
+  /*!
+   * \brief Insert n keys
+   * \param present If not null, receives whether each key was (probably)
+   *        present before its entry
+   */
+  void insert(const uint64_t *keys, size_t n, bool *present = nullptr) {
+    std::vector<uint64_t> w(n), m(n), old(present != nullptr ? n : 0);
+    hash(keys, n, w.data(), m.data());
+    bits_.fetch_or(w.data(), m.data(), n,
+                   present != nullptr ? old.data() : nullptr);
+    if (present != nullptr)
+      for (size_t i = 0; i < n; i++)
+        present[i] = (old[i] & m[i]) == m[i];
+  }
+
+  /*! \brief Look up n keys into out[] */
+  void contains(const uint64_t *keys, size_t n, bool *out) const {
+    std::vector<uint64_t> w(n), m(n), v(n);
+    hash(keys, n, w.data(), m.data());
+    bits_.get(w.data(), n, v.data());
+    for (size_t i = 0; i < n; i++)
+      out[i] = (v[i] & m[i]) == m[i];
+  }
+
+  /*! \brief Empty the filter; called from outside the pool */
+  void clear() { bits_.clear(); }
+
+private:
+  static size_t check(size_t nwords) {
+    if (nwords == 0 || nwords > (1ull << 32))
+      throw std::length_error("dist_bloom: size out of range");
+    return nwords;
+  }
+
+  /*
+   * Word index from the high half of the hash (multiply-shift, no
+   * division) and k 6-bit positions from a second multiply. Each loop is
+   * branch free over the keys so that it vectorizes.
+   */
+  void hash(const uint64_t *keys, size_t n, uint64_t *w, uint64_t *m) const {
+    for (size_t i = 0; i < n; i++) {
+      uint64_t h = detail::mix64(keys[i] ^ seed_);
+      w[i] = ((h >> 32) * (uint64_t)nwords_) >> 32;
+      m[i] = h * 0x9e3779b97f4a7c15ull;
+    }
+    for (size_t i = 0; i < n; i++) {
+      uint64_t g = m[i], mask = 0;
+      for (int j = 0; j < k_; j++)
+        mask |= 1ull << ((g >> (6 * j)) & 63);
+      m[i] = mask;
+    }
+  }
+
+  int k_ = 6;
+  uint64_t seed_ = 0;
+  size_t nwords_ = 0;
+  dist_bitmap bits_;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_BITMAP_HPP_ */
+
+/* EOF */
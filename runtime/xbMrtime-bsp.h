@@ -0,0 +1,429 @@
+/*
+ * _XBRTIME_BSP_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-bsp.h
+ * \brief Bulk synchronous supersteps with buffered puts and gets
+ *
+ * A BSP code computes, issues its communication, then synchronizes. The
+ * xbrtime_bsp_ calls only record the transfers; xbrtime_bsp_sync(),
+ * called by every PE from its own pool thread, carries them all out:
+ *
+ * \code
+ *   void step( void *arg ){
+ *     int me = xbrtime_mype(), right = (me + 1) % xbrtime_num_pes();
+ *     for( i = 0; i < n; i++ ){
+ *       xbrtime_bsp_put( &halo[i], &edge[i], sizeof( double ), right );
+ *     }
+ *     xbrtime_bsp_get( &sum, &total, sizeof( long ), 0 );
+ *     xbrtime_bsp_sync();          // halo and sum are now valid
+ *   }
+ * \endcode
+ *
+ * The semantics are those of BSPlib: a put copies its source when it is
+ * issued, so the buffer may be reused at once, and lands on the target at
+ * the end of the superstep; a get reads the target at the end of the
+ * superstep, before any put of the same superstep lands, and is valid
+ * when xbrtime_bsp_sync() returns. Puts from one PE to the same bytes land
+ * in the order they were issued; puts from different PEs to the same
+ * bytes land in PE order.
+ *
+ * At the sync each PE sorts its own requests by target PE and offset and
+ * combines the ones that continue one another into single transfers. A
+ * single barrier then ends the superstep. After it, every PE serves the
+ * gets aimed at its partition and then applies the puts aimed at it, one
+ * bulk copy per combined transfer, so no get races with a put on the same
+ * partition; it returns once the owners have served its own gets. The
+ * requests of consecutive supersteps go to alternate queues, which is
+ * what lets the next superstep start without a second barrier.
+ */
+
+#ifndef _XBRTIME_BSP_H_
+#define _XBRTIME_BSP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-coll.h"
+#include "threadpool.h"
+
+/* one recorded transfer */
+typedef struct {
+  int     pe;         /* target PE */
+  size_t  off;        /* offset in the target's partition */
+  size_t  len;
+  size_t  seq;        /* call order */
+  size_t  pos;        /* put: payload position in the queue's data */
+  char   *dst;        /* get: where the bytes go */
+} __xbrtime_bsp_op_t;
+
+typedef struct {
+  __xbrtime_bsp_op_t *ops;
+  size_t              n;
+  size_t              cap;
+  size_t             *first;    /* requests to PE p: [first[p], first[p + 1]) */
+} __xbrtime_bsp_list_t;
+
+/* the requests of one superstep */
+typedef struct {
+  __xbrtime_bsp_list_t puts;
+  __xbrtime_bsp_list_t gets;
+  char                *data;    /* payloads of the puts */
+  size_t               used;
+  size_t               size;
+} __xbrtime_bsp_queue_t;
+
+/* one PE; only 'gets_left' is written by other threads */
+typedef struct {
+  __xbrtime_bsp_queue_t q[2];   /* by superstep parity */
+  uint64_t              step;   /* supersteps completed */
+  volatile size_t       gets_left __attribute__((aligned(64)));
+} __attribute__((aligned(64))) __xbrtime_bsp_pe_t;
+
+typedef struct {
+  int                 npes;
+  __xbrtime_bsp_pe_t *pes;
+} __xbrtime_bsp_t;
+
+extern __xbrtime_bsp_t __xbrtime_bsp;
+
+int xbrtime_bsp_put( void *dest, const void *src, size_t nbytes, int pe );
+int xbrtime_bsp_get( void *dest, const void *src, size_t nbytes, int pe );
+int xbrtime_bsp_sync( void );
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_bsp_t __xbrtime_bsp = { 0, NULL };
+
+/* the caller's PE, or -1 outside the pool */
+static int __xbrtime_bsp_self( void ){
+  int pe = (tpool_self != NULL) ? (int)tpool_self->thread_id : -1;
+  if( (__xbrtime_bsp.pes == NULL) || (pe < 0) || (pe >= __xbrtime_bsp.npes) ){
+    return -1;
+  }
+  return pe;
+}
+
+static void __xbrtime_bsp_fini( void ){
+  int i, k;
+
+  if( __xbrtime_bsp.pes != NULL ){
+    for( i = 0; i < __xbrtime_bsp.npes; i++ ){
+      for( k = 0; k < 2; k++ ){
+        __xbrtime_bsp_queue_t *q = &__xbrtime_bsp.pes[i].q[k];
+        free( q->puts.ops );
+        free( q->puts.first );
+        free( q->gets.ops );
+        free( q->gets.first );
+        free( q->data );
+      }
+    }
+  }
+  free( __xbrtime_bsp.pes );
+  __xbrtime_bsp.pes  = NULL;
+  __xbrtime_bsp.npes = 0;
+}
+
+/* sets up empty queues for 'npes' PEs; the buffers grow on first use */
+static int __xbrtime_bsp_init( int npes ){
+  size_t len = (size_t)npes * sizeof( __xbrtime_bsp_pe_t );
+  int i, k;
+
+  __xbrtime_bsp_fini();
+  if( npes <= 0 ){
+    return -1;
+  }
+  if( posix_memalign( (void **)&__xbrtime_bsp.pes, 64, len ) != 0 ){
+    __xbrtime_bsp.pes = NULL;
+    return -1;
+  }
+  memset( __xbrtime_bsp.pes, 0, len );
+  __xbrtime_bsp.npes = npes;
+  for( i = 0; i < npes; i++ ){
+    for( k = 0; k < 2; k++ ){
+      __xbrtime_bsp_queue_t *q = &__xbrtime_bsp.pes[i].q[k];
+      q->puts.first = (size_t *)calloc( (size_t)npes + 1, sizeof( size_t ) );
+      q->gets.first = (size_t *)calloc( (size_t)npes + 1, sizeof( size_t ) );
+      if( (q->puts.first == NULL) || (q->gets.first == NULL) ){
+        __xbrtime_bsp_fini();
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * appends a request, or grows the last one when the new one continues it;
+ * NULL when the list cannot grow
+ */
+static __xbrtime_bsp_op_t *__xbrtime_bsp_add( __xbrtime_bsp_list_t *l, int pe,
+                                              size_t off, size_t len,
+                                              size_t pos, char *dst ){
+  __xbrtime_bsp_op_t *o = (l->n > 0) ? &l->ops[l->n - 1] : NULL;
+
+  if( (o != NULL) && (o->pe == pe) && (o->off + o->len == off) &&
+      ((dst != NULL) ? (o->dst + o->len == dst) : (o->pos + o->len == pos)) ){
+    o->len += len;
+    return o;
+  }
+  if( l->n == l->cap ){
+    size_t cap = (l->cap == 0) ? _XBRTIME_BSP_OPS_ : 2 * l->cap;
+    o = (__xbrtime_bsp_op_t *)realloc( l->ops, cap * sizeof( *o ) );
+    if( o == NULL ){
+      return NULL;
+    }
+    l->ops = o;
+    l->cap = cap;
+  }
+  o = &l->ops[l->n];
+  o->pe  = pe;
+  o->off = off;
+  o->len = len;
+  o->seq = l->n++;
+  o->pos = pos;
+  o->dst = dst;
+  return o;
+}
+
+static int __xbrtime_bsp_cmp( const void *a, const void *b ){
+  const __xbrtime_bsp_op_t *x = (const __xbrtime_bsp_op_t *)a;
+  const __xbrtime_bsp_op_t *y = (const __xbrtime_bsp_op_t *)b;
+  if( x->pe != y->pe ){
+    return (x->pe < y->pe) ? -1 : 1;
+  }
+  if( x->off != y->off ){
+    return (x->off < y->off) ? -1 : 1;
+  }
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static int __xbrtime_bsp_cmp_seq( const void *a, const void *b ){
+  const __xbrtime_bsp_op_t *x = (const __xbrtime_bsp_op_t *)a;
+  const __xbrtime_bsp_op_t *y = (const __xbrtime_bsp_op_t *)b;
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/*
+ * sorts a list by target and offset, combines the requests that continue
+ * one another, and indexes the result by target PE; puts to one PE that
+ * overlap keep their call order instead
+ */
+static void __xbrtime_bsp_order( __xbrtime_bsp_list_t *l, int npes, int put ){
+  __xbrtime_bsp_op_t *o = l->ops;
+  size_t i, j, n = 0;
+  int p;
+
+  for( i = 1; (i < l->n) && (__xbrtime_bsp_cmp( &o[i - 1], &o[i] ) < 0); i++ ){
+  }
+  if( i < l->n ){
+    qsort( o, l->n, sizeof( *o ), __xbrtime_bsp_cmp );
+  }
+  for( i = 0; put && (i < l->n); i = j ){
+    size_t end = o[i].off + o[i].len;
+    int overlap = 0;
+    for( j = i + 1; (j < l->n) && (o[j].pe == o[i].pe); j++ ){
+      overlap |= (end > o[j].off);
+      if( o[j].off + o[j].len > end ){
+        end = o[j].off + o[j].len;
+      }
+    }
+    if( overlap ){
+      qsort( &o[i], j - i, sizeof( *o ), __xbrtime_bsp_cmp_seq );
+    }
+  }
+
+  for( i = 0; i < l->n; i++ ){
+    __xbrtime_bsp_op_t *last = (n > 0) ? &o[n - 1] : NULL;
+    if( (last != NULL) && (last->pe == o[i].pe) &&
+        (last->off + last->len == o[i].off) &&
+        (put ? (last->pos + last->len == o[i].pos)
+             : (last->dst + last->len == o[i].dst)) ){
+      last->len += o[i].len;
+    }else{
+      o[n++] = o[i];
+    }
+  }
+  l->n = n;
+
+  for( p = 0, i = 0; p <= npes; p++ ){
+    while( (i < n) && (o[i].pe < p) ){
+      i++;
+    }
+    l->first[p] = i;
+  }
+}
+
+/* checks a transfer and returns the target offset, or -1 */
+static long long __xbrtime_bsp_check( const void *addr, size_t nbytes,
+                                      int pe ){
+  size_t off = 0;
+
+  if( !__xbrtime_heap_contains( addr ) || (pe < 0) ||
+      (pe >= __xbrtime_bsp.npes) ){
+    return -1;
+  }
+  off = __xbrtime_heap_offset( addr );
+  if( nbytes > __xbrtime_heap.part_size - off ){
+    return -1;
+  }
+  return (long long)off;
+}
+
+/* ------------------------------------------------- PUBLIC BSP API */
+
+extern int xbrtime_bsp_put( void *dest, const void *src, size_t nbytes,
+                            int pe ){
+  __xbrtime_bsp_queue_t *q = NULL;
+  __xbrtime_bsp_op_t *o = NULL;
+  long long off = __xbrtime_bsp_check( dest, nbytes, pe );
+  int me = __xbrtime_bsp_self();
+
+  if( (me < 0) || (off < 0) || ((src == NULL) && (nbytes > 0)) ){
+    return -1;
+  }else if( nbytes == 0 ){
+    return 0;
+  }
+  q = &__xbrtime_bsp.pes[me].q[__xbrtime_bsp.pes[me].step & 1];
+
+  if( q->used + nbytes > q->size ){
+    size_t size = (q->size == 0) ? _XBRTIME_BSP_DATA_ : q->size;
+    char *data = NULL;
+    while( size < q->used + nbytes ){
+      size *= 2;
+    }
+    data = (char *)realloc( q->data, size );
+    if( data == NULL ){
+      return -1;
+    }
+    q->data = data;
+    q->size = size;
+  }
+  o = __xbrtime_bsp_add( &q->puts, pe, (size_t)off, nbytes, q->used, NULL );
+  if( o == NULL ){
+    return -1;
+  }
+  memcpy( q->data + q->used, src, nbytes );
+  q->used += nbytes;
+  return 0;
+}
+
+extern int xbrtime_bsp_get( void *dest, const void *src, size_t nbytes,
+                            int pe ){
+  __xbrtime_bsp_queue_t *q = NULL;
+  __xbrtime_bsp_op_t *o = NULL;
+  long long off = __xbrtime_bsp_check( src, nbytes, pe );
+  int me = __xbrtime_bsp_self();
+
+  if( (me < 0) || (off < 0) || ((dest == NULL) && (nbytes > 0)) ){
+    return -1;
+  }else if( nbytes == 0 ){
+    return 0;
+  }
+  q = &__xbrtime_bsp.pes[me].q[__xbrtime_bsp.pes[me].step & 1];
+  o = __xbrtime_bsp_add( &q->gets, pe, (size_t)off, nbytes, 0, (char *)dest );
+  return (o == NULL) ? -1 : 0;
+}
+
+extern int xbrtime_bsp_sync( void ){
+  __xbrtime_bsp_pe_t *b = NULL;
+  __xbrtime_bsp_queue_t *q = NULL;
+  int me = __xbrtime_bsp_self();
+  int npes = __xbrtime_bsp.npes;
+  int par = 0, p = 0, k = 0, spins = 0;
+  size_t i;
+
+  if( me < 0 ){
+    return -1;
+  }
+  b = &__xbrtime_bsp.pes[me];
+  par = (int)(b->step & 1);
+  q = &b->q[par];
+
+  __xbrtime_bsp_order( &q->puts, npes, 1 );
+  __xbrtime_bsp_order( &q->gets, npes, 0 );
+  __atomic_store_n( &b->gets_left, q->gets.n, __ATOMIC_RELAXED );
+
+  /* every PE has finished the superstep's computation and requests */
+  __xbrtime_coll_sync( me );
+
+  /* serve the gets aimed at this partition before any put lands on it */
+  for( k = 1; k <= npes; k++ ){
+    __xbrtime_bsp_list_t *l = NULL;
+    p = (me + k) % npes;
+    l = &__xbrtime_bsp.pes[p].q[par].gets;
+    if( l->first[me] == l->first[me + 1] ){
+      continue;
+    }
+    for( i = l->first[me]; i < l->first[me + 1]; i++ ){
+      __xbrtime_coll_copy( l->ops[i].dst,
+                           __xbrtime_heap_at( me, l->ops[i].off ),
+                           l->ops[i].len );
+    }
+    __xbrtime_asm_fence();
+    __atomic_sub_fetch( &__xbrtime_bsp.pes[p].gets_left,
+                        l->first[me + 1] - l->first[me], __ATOMIC_RELEASE );
+  }
+
+  /* then apply the puts aimed at it */
+  for( p = 0; p < npes; p++ ){
+    __xbrtime_bsp_queue_t *s = &__xbrtime_bsp.pes[p].q[par];
+    for( i = s->puts.first[me]; i < s->puts.first[me + 1]; i++ ){
+      __xbrtime_coll_copy( __xbrtime_heap_at( me, s->puts.ops[i].off ),
+                           s->data + s->puts.ops[i].pos,
+                           s->puts.ops[i].len );
+    }
+  }
+
+  /* wait for the owners to serve this PE's own gets */
+  while( __atomic_load_n( &b->gets_left, __ATOMIC_ACQUIRE ) != 0 ){
+    if( ++spins >= _XBRTIME_COLL_SPIN_ ){
+      sched_yield();
+      spins = _XBRTIME_COLL_SPIN_;
+    }
+  }
+  __xbrtime_asm_fence();
+
+  /*
+   * every PE was done with the other queue, the previous superstep's,
+   * before it reached the barrier above; it takes the next superstep's
+   */
+  q = &b->q[par ^ 1];
+  q->puts.n = 0;
+  q->gets.n = 0;
+  q->used   = 0;
+  b->step++;
+  return 0;
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_BSP_H_ */
+
+/* EOF */
@@ -0,0 +1,303 @@
+/*
+ * _XBRTIME_CACHE_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-cache.h
+ * \brief Read-only software cache for remote symmetric data
+ *
+ * Allocations opt in with xbrtime_cache_enable(); from then on every get
+ * whose source lies inside such an allocation on another PE is served
+ * from a per-PE cache of fixed-size blocks keyed by (PE, symmetric offset).
+ * A miss fetches the whole block with one transfer.
+ *
+ * The cache is not coherent with puts. Cached blocks are dropped
+ * wholesale at every barrier (a global epoch is bumped) and for a single
+ * allocation with xbrtime_cache_invalidate(), which every PE observes.
+ * Gets from the caller's own partition, gets larger than half of the
+ * cache and gets from threads outside the pool (eg, the main thread)
+ * bypass it. The lookup done by every get is in xbMrtime-inline.h.
+ *
+ * Enabling, disabling and freeing a cacheable allocation are collective:
+ * call them while no PE is reading the allocation.
+ */
+
+#ifndef _XBRTIME_CACHE_H_
+#define _XBRTIME_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void xbrtime_cache_invalidate_all( void );
+
+/*!
+ * \struct xbrtime_cache_stats_t
+ * \brief Per-PE counters of the remote read cache
+ */
+typedef struct {
+  uint64_t hits;          /*! blocks served from the cache */
+  uint64_t misses;        /*! blocks fetched from their owner */
+  uint64_t bypassed;      /*! cacheable gets too large to cache */
+  uint64_t invalidations; /*! epochs observed by this PE's cache */
+} xbrtime_cache_stats_t;
+
+/* one cacheable allocation */
+typedef struct {
+  size_t            offset;   /* symmetric offset; size 0 marks a free slot */
+  size_t            size;     /* bytes */
+  volatile uint64_t gen;      /* bumped to invalidate the allocation */
+} __xbrtime_cache_region_t;
+
+/* one cached block */
+typedef struct {
+  uint64_t tag;               /* (pe+1) << 48 | block offset; 0 when empty */
+  uint64_t epoch;             /* global epoch at fill */
+  uint64_t gen;               /* region generation at fill */
+} __xbrtime_cache_line_t;
+
+/* a PE's private cache, kept on its own cache lines */
+typedef struct {
+  __xbrtime_cache_line_t *lines;
+  char                   *data;
+  uint64_t                epoch;  /* last epoch seen, for the stats */
+  xbrtime_cache_stats_t   stats;
+} __attribute__((aligned(64))) __xbrtime_cache_pe_t;
+
+typedef struct {
+  size_t                   block;       /* bytes per block */
+  size_t                   nlines;      /* blocks per PE (power of two) */
+  volatile uint64_t        epoch;       /* bumped at every barrier */
+  uint64_t                 next_gen;    /* source of region generations */
+  volatile int             nregions;    /* slots in use at the front */
+  __xbrtime_cache_region_t regions[_XBRTIME_CACHE_REGIONS_];
+  __xbrtime_cache_pe_t    *pes;         /* one private cache per PE */
+  int                      npes;
+  pthread_mutex_t          lock;        /* serializes region updates */
+} __xbrtime_cache_t;
+
+extern __xbrtime_cache_t __xbrtime_cache;
+
+/* the cacheable allocation holding [offset, offset+len), if any */
+static inline __xbrtime_cache_region_t *__xbrtime_cache_region( size_t offset,
+                                                               size_t len ){
+  int i = 0;
+  for( i = 0; i < __xbrtime_cache.nregions; i++ ){
+    __xbrtime_cache_region_t *r = &__xbrtime_cache.regions[i];
+    if( (r->size != 0) && (offset >= r->offset) &&
+        (offset + len <= r->offset + r->size) ){
+      return r;
+    }
+  }
+  return NULL;
+}
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_cache_t __xbrtime_cache = { _XBRTIME_CACHE_BLOCK_,
+                                      _XBRTIME_CACHE_LINES_, 1, 1, 0,
+                                      { { 0, 0, 0 } }, NULL, 0,
+                                      PTHREAD_MUTEX_INITIALIZER };
+
+static void __xbrtime_cache_release_all( void ){
+  int i = 0;
+  for( i = 0; i < __xbrtime_cache.npes; i++ ){
+    free( __xbrtime_cache.pes[i].lines );
+    free( __xbrtime_cache.pes[i].data );
+  }
+  free( __xbrtime_cache.pes );
+  __xbrtime_cache.pes  = NULL;
+  __xbrtime_cache.npes = 0;
+  memset( __xbrtime_cache.regions, 0, sizeof( __xbrtime_cache.regions ) );
+  __xbrtime_cache.nregions = 0;
+}
+
+/*
+ * sets up an empty cache for 'npes' PEs with the geometry taken from the
+ * environment; any previous cache and cacheable allocation is dropped
+ *
+ */
+static int __xbrtime_cache_init( int npes ){
+  size_t block = _XBRTIME_CACHE_BLOCK_;
+  size_t lines = _XBRTIME_CACHE_LINES_;
+  size_t page  = (size_t)sysconf( _SC_PAGESIZE );
+  char  *str   = NULL;
+
+  if( (str = getenv( "XBRTIME_CACHE_BLOCK" )) != NULL ){
+    block = (size_t)strtoull( str, NULL, 0 );
+  }
+  if( (str = getenv( "XBRTIME_CACHE_LINES" )) != NULL ){
+    lines = (size_t)strtoull( str, NULL, 0 );
+  }
+  if( (block < 16) || ((block & (block - 1)) != 0) || (block > page) ){
+    block = _XBRTIME_CACHE_BLOCK_;
+  }
+  if( lines == 0 ){
+    lines = _XBRTIME_CACHE_LINES_;
+  }
+
+  pthread_mutex_lock( &__xbrtime_cache.lock );
+  __xbrtime_cache_release_all();
+  __xbrtime_cache.block = block;
+  __xbrtime_cache.nlines = 1;
+  while( __xbrtime_cache.nlines < lines ){
+    __xbrtime_cache.nlines <<= 1;
+  }
+  if( posix_memalign( (void **)&__xbrtime_cache.pes, 64,
+                      (size_t)npes * sizeof( __xbrtime_cache_pe_t ) ) != 0 ){
+    __xbrtime_cache.pes = NULL;
+    pthread_mutex_unlock( &__xbrtime_cache.lock );
+    return -1;
+  }
+  memset( __xbrtime_cache.pes, 0,
+          (size_t)npes * sizeof( __xbrtime_cache_pe_t ) );
+  __xbrtime_cache.npes = npes;
+  pthread_mutex_unlock( &__xbrtime_cache.lock );
+  xbrtime_cache_invalidate_all();
+  return 0;
+}
+
+static void __xbrtime_cache_fini( void ){
+  pthread_mutex_lock( &__xbrtime_cache.lock );
+  __xbrtime_cache_release_all();
+  pthread_mutex_unlock( &__xbrtime_cache.lock );
+}
+
+/* called by xbrtime_free: a released offset must not stay cacheable */
+static void __xbrtime_cache_forget( size_t offset ){
+  int i = 0;
+  if( __xbrtime_cache.nregions == 0 ){
+    return;
+  }
+  pthread_mutex_lock( &__xbrtime_cache.lock );
+  for( i = 0; i < __xbrtime_cache.nregions; i++ ){
+    if( (__xbrtime_cache.regions[i].size != 0) &&
+        (__xbrtime_cache.regions[i].offset == offset) ){
+      __xbrtime_cache.regions[i].size = 0;
+    }
+  }
+  pthread_mutex_unlock( &__xbrtime_cache.lock );
+}
+
+/* ------------------------------------------------- PUBLIC CACHE API */
+
+extern int xbrtime_cache_enable( void *ptr ){
+  size_t start = 0, size = 0;
+  int i = 0, slot = -1;
+
+  if( !__xbrtime_heap_contains( ptr ) ||
+      (__xbrtime_heap_block_of( __xbrtime_heap_offset( ptr ),
+                                &start, &size ) != 0) ){
+    return -1;
+  }
+
+  pthread_mutex_lock( &__xbrtime_cache.lock );
+  for( i = 0; i < __xbrtime_cache.nregions; i++ ){
+    if( __xbrtime_cache.regions[i].size == 0 ){
+      if( slot < 0 ){
+        slot = i;
+      }
+    }else if( __xbrtime_cache.regions[i].offset == start ){
+      pthread_mutex_unlock( &__xbrtime_cache.lock );
+      return 0;
+    }
+  }
+  if( (slot < 0) && (__xbrtime_cache.nregions < _XBRTIME_CACHE_REGIONS_) ){
+    slot = __xbrtime_cache.nregions;
+  }
+  if( slot >= 0 ){
+    __xbrtime_cache.regions[slot].offset = start;
+    __xbrtime_cache.regions[slot].gen    = __xbrtime_cache.next_gen++;
+    __xbrtime_cache.regions[slot].size   = size;
+    if( slot == __xbrtime_cache.nregions ){
+      __xbrtime_cache.nregions = slot + 1;
+    }
+  }
+  pthread_mutex_unlock( &__xbrtime_cache.lock );
+  __xbrtime_asm_quiet_fence();
+
+  return (slot < 0) ? -1 : 0;
+}
+
+extern void xbrtime_cache_disable( void *ptr ){
+  if( __xbrtime_heap_contains( ptr ) ){
+    size_t start = 0, size = 0;
+    if( __xbrtime_heap_block_of( __xbrtime_heap_offset( ptr ),
+                                 &start, &size ) == 0 ){
+      __xbrtime_cache_forget( start );
+    }
+  }
+  __xbrtime_asm_quiet_fence();
+}
+
+extern void xbrtime_cache_invalidate( void *ptr ){
+  __xbrtime_cache_region_t *r = NULL;
+
+  if( !__xbrtime_heap_contains( ptr ) ){
+    return;
+  }
+  pthread_mutex_lock( &__xbrtime_cache.lock );
+  r = __xbrtime_cache_region( __xbrtime_heap_offset( ptr ), 1 );
+  if( r != NULL ){
+    r->gen = __xbrtime_cache.next_gen++;
+  }
+  pthread_mutex_unlock( &__xbrtime_cache.lock );
+  __xbrtime_asm_quiet_fence();
+}
+
+extern void xbrtime_cache_invalidate_all( void ){
+  __sync_fetch_and_add( &__xbrtime_cache.epoch, 1 );
+}
+
+extern void xbrtime_cache_stats( int pe, xbrtime_cache_stats_t *stats ){
+  if( stats == NULL ){
+    return;
+  }
+  if( (pe < 0) || (pe >= __xbrtime_cache.npes) ){
+    memset( stats, 0, sizeof( xbrtime_cache_stats_t ) );
+    return;
+  }
+  *stats = __xbrtime_cache.pes[pe].stats;
+}
+
+extern void xbrtime_cache_stats_reset( void ){
+  int i = 0;
+  for( i = 0; i < __xbrtime_cache.npes; i++ ){
+    memset( &__xbrtime_cache.pes[i].stats, 0,
+            sizeof( xbrtime_cache_stats_t ) );
+  }
+}
+
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_CACHE_H_ */
+
+/* EOF */
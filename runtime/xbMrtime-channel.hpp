@@ -0,0 +1,298 @@
+/*
+ * xbMrtime-channel.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-channel.hpp
+ * \brief Bounded inter-PE channels in symmetric memory
+ *
+ * xbr::channel<T> passes a stream of records from PE to PE, eg between the
+ * stages of a pipeline that runs stage k on PE k. Every PE has an inbox;
+ * any PE sends to an inbox and only its owner receives from it:
+ *
+ * \code
+ *   xbr::channel<record> ch(4096);              // from outside the pool
+ *   xbr::detail::on_each_pe([&](int pe) {
+ *     if (pe > 0)
+ *       n = ch.try_recv(buf, 64);               // up to 64 from our inbox
+ *     if (pe + 1 < xbrtime_num_pes())
+ *       ch.send(pe + 1, buf, n);                // blocks while it is full
+ *   });
+ * \endcode
+ *
+ * An inbox is a ring of 'capacity' records in its owner's partition. Its
+ * control words sit on separate cache lines: 'head', written only by the
+ * owner as it consumes, and 'tail', which publishes the records sent.
+ * Senders copy records straight into the receiver's ring and then move
+ * 'tail'; the receiver reads its ring locally. Both sides keep a private
+ * copy of the other side's index and only read the remote one when the
+ * ring looks full (or empty), so a stream in steady state costs one
+ * remote put and one index update per batch.
+ *
+ * In spsc mode each inbox has at most one sender for the life of the
+ * channel (until reset()), which then needs no atomic read-modify-write.
+ * In mpsc mode senders first reserve their slots with a compare-and-swap
+ * on a third line and publish in reservation order, so every batch that
+ * a single try_send() accepts arrives contiguously.
+ *
+ * Blocking calls wait as the runtime's barriers do: they poll
+ * _XBRTIME_COLL_SPIN_ times, then yield between polls.
+ */
+
+#ifndef _XBRTIME_CHANNEL_HPP_
+#define _XBRTIME_CHANNEL_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <sched.h>
+#include <type_traits>
+#include <vector>
+
+#include "xbMrtime-sym.hpp"
+
+namespace xbr {
+
+/*! \brief How many PEs may send to one inbox */
+enum class chan_mode {
+  spsc, /*!< one sender per receiver */
+  mpsc  /*!< any number of senders per receiver */
+};
+
+template <typename T> class channel {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "channel records are trivially copyable");
+
+  /* control words, one cache line each */
+  struct alignas(64) line {
+    unsigned long long v;
+  };
+  enum { HEAD, TAIL, RESERVE, NCTL };
+
+  /* what a sender knows of one inbox; a line each, since the senders
+     to neighbouring inboxes update theirs concurrently */
+  struct alignas(64) link {
+    uint64_t head; /* last 'head' seen */
+    uint64_t tail; /* spsc: next slot to fill */
+  };
+
+  /* owner-private state of one inbox */
+  struct alignas(64) inbox {
+    uint64_t head;
+    uint64_t tail; /* last 'tail' seen */
+  };
+
+public:
+  /*!
+   * \param capacity Records per inbox (rounded up to a power of two)
+   * \param mode Whether an inbox may have more than one sender
+   *
+   * Collective; called from outside the pool.
+   */
+  explicit channel(size_t capacity = 1024, chan_mode mode = chan_mode::spsc)
+      : cap_(pow2(capacity)), mode_(mode), npes_(xbrtime_num_pes()),
+        ring_(cap_), ctl_(NCTL, std::align_val_t{64}),
+        links_((size_t)npes_ * npes_), inboxes_((size_t)npes_) {}
+
+  channel(channel &&) noexcept = default;
+  channel &operator=(channel &&) noexcept = default;
+
+  size_t capacity() const { return cap_; }
+  chan_mode mode() const { return mode_; }
+
+  /*!
+   * \brief Send as many of the n records as fit in pe's inbox now
+   * \return Number sent, from the front of v
+   */
+  size_t try_send(int pe, const T *v, size_t n) {
+    link &l = links_[(size_t)xbrtime_mype() * npes_ + pe];
+    uint64_t at = 0;
+    size_t k = 0;
+
+    if (n == 0)
+      return 0;
+    if (mode_ == chan_mode::spsc) {
+      at = l.tail;
+      k = std::min<uint64_t>(n, room(pe, l, at, n));
+      if (k == 0)
+        return 0;
+      write(pe, at, v, k);
+      atomic_set(ctlp(pe, TAIL), (unsigned long long)(at + k), pe);
+      l.tail = at + k;
+      return k;
+    }
+
+    /* mpsc: reserve [at, at + k), fill it, publish after the earlier ones */
+    unsigned long long *res = ctlp(pe, RESERVE);
+    unsigned long long r = atomic_fetch(res, pe), seen;
+    while (true) {
+      k = std::min<uint64_t>(n, room(pe, l, r, n));
+      if (k == 0) {
+        /* full, unless 'r' went stale while 'head' was reread */
+        if ((seen = atomic_fetch(res, pe)) == r)
+          return 0;
+      } else if ((seen = atomic_compare_swap(res, r, r + k, pe)) == r) {
+        break;
+      }
+      r = seen;
+    }
+    at = r;
+    write(pe, at, v, k);
+    wait([&] { return atomic_fetch(ctlp(pe, TAIL), pe) == at; });
+    atomic_set(ctlp(pe, TAIL), (unsigned long long)(at + k), pe);
+    return k;
+  }
+
+  /*! \brief Send one record if pe's inbox has room */
+  bool try_send(int pe, const T &v) { return try_send(pe, &v, 1) == 1; }
+
+  /*! \brief Send all n records, waiting while pe's inbox is full */
+  void send(int pe, const T *v, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      size_t k = try_send(pe, v + done, n - done);
+      if (k == 0)
+        wait([&] { return !full(pe); });
+      done += k;
+    }
+  }
+
+  /*! \brief Send one record, waiting while pe's inbox is full */
+  void send(int pe, const T &v) { send(pe, &v, 1); }
+
+  /*!
+   * \brief Take up to 'max' records from the caller's inbox
+   * \return Number received, in the order they were published
+   */
+  size_t try_recv(T *v, size_t max) {
+    int me = xbrtime_mype();
+    inbox &b = inboxes_[me];
+    const T *ring = ring_.data(me);
+
+    if (b.tail - b.head < max)
+      b.tail = atomic_fetch(ctlp(me, TAIL), me);
+    size_t k = std::min<uint64_t>(max, b.tail - b.head);
+    if (k == 0)
+      return 0;
+    for (size_t done = 0; done < k;) {
+      size_t from = (size_t)((b.head + done) & (cap_ - 1));
+      size_t run = std::min(k - done, cap_ - from);
+      std::copy_n(ring + from, run, v + done);
+      done += run;
+    }
+    b.head += k;
+    atomic_set(ctlp(me, HEAD), (unsigned long long)b.head, me);
+    return k;
+  }
+
+  /*! \brief Take one record from the caller's inbox if there is one */
+  bool try_recv(T &v) { return try_recv(&v, 1) == 1; }
+
+  /*! \brief Take exactly n records, waiting while the inbox is empty */
+  void recv(T *v, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      size_t k = try_recv(v + done, n - done);
+      if (k == 0)
+        wait([&] { return size() != 0; });
+      done += k;
+    }
+  }
+
+  /*! \brief Take one record, waiting while the inbox is empty */
+  T recv() {
+    T v;
+    recv(&v, 1);
+    return v;
+  }
+
+  /*! \brief Records published to the caller's inbox and not yet taken */
+  size_t size() const {
+    int me = xbrtime_mype();
+    return (size_t)(atomic_fetch(ctlp(me, TAIL), me) - inboxes_[me].head);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /*! \brief Empty every inbox and forget every sender; from outside the pool */
+  void reset() {
+    for (int pe = 0; pe < npes_; pe++) {
+      line *c = ctl_.data(pe);
+      for (int i = 0; i < NCTL; i++)
+        c[i].v = 0;
+      inboxes_[pe] = inbox{};
+    }
+    std::fill(links_.begin(), links_.end(), link{});
+    __xbrtime_asm_fence();
+  }
+
+private:
+  static size_t pow2(size_t n) {
+    size_t p = 2;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  /* the runtime's wait policy: spin, then yield between polls */
+  template <typename F> static void wait(F ready) {
+    int spins = 0;
+    while (!ready()) {
+      if (++spins >= _XBRTIME_COLL_SPIN_) {
+        sched_yield();
+        spins = _XBRTIME_COLL_SPIN_;
+      }
+    }
+  }
+
+  unsigned long long *ctlp(int pe, int w) const { return &ctl_.data(pe)[w].v; }
+
+  /* free slots after 'at', reading pe's 'head' only if fewer than 'want' */
+  uint64_t room(int pe, link &l, uint64_t at, size_t want) const {
+    uint64_t used = at - l.head;
+    if (used > cap_ || cap_ - used < want) {
+      l.head = atomic_fetch(ctlp(pe, HEAD), pe);
+      used = at - l.head;
+    }
+    return used >= cap_ ? 0 : cap_ - used;
+  }
+
+  bool full(int pe) const {
+    unsigned long long w = mode_ == chan_mode::spsc ? TAIL : RESERVE;
+    return atomic_fetch(ctlp(pe, w), pe) -
+               atomic_fetch(ctlp(pe, HEAD), pe) >=
+           cap_;
+  }
+
+  /* copy k records into pe's ring from slot 'at', in at most two runs */
+  void write(int pe, uint64_t at, const T *v, size_t k) const {
+    for (size_t done = 0; done < k;) {
+      size_t to = (size_t)((at + done) & (cap_ - 1));
+      size_t run = std::min(k - done, cap_ - to);
+      xbr::put(ring_.data(pe) + to, v + done, run, pe);
+      done += run;
+    }
+  }
+
+  size_t cap_;
+  chan_mode mode_;
+  int npes_;
+  sym_vector<T> ring_;
+  sym_vector<line> ctl_;
+  std::vector<link> links_;
+  std::vector<inbox> inboxes_;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_CHANNEL_HPP_ */
+
+/* EOF */
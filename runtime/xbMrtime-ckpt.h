@@ -0,0 +1,342 @@
+/*
+ * _XBRTIME_CKPT_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-ckpt.h
+ * \brief Checkpoint/restart of the symmetric heap
+ *
+ * xbrtime_checkpoint(path) writes a manifest of the live allocations
+ * followed by every PE's partition, up to the end of the last allocation.
+ * Each PE writes its own partition from its pool thread with large
+ * page-aligned pwrite() calls (O_DIRECT where the file system allows).
+ * The file is written next to 'path' and renamed into place, so an
+ * interrupted checkpoint never replaces a good one.
+ *
+ * xbrtime_restart(path) reads the partitions back in parallel and
+ * restores every allocation at its old offset. Pointers saved as offsets
+ * (or as xbr::gptr) stay valid; raw pointers and capabilities stored in
+ * the heap do not survive. xbrtime_heap_allocation() enumerates the
+ * restored allocations.
+ *
+ * With XBRTIME_HEAP_SHM=name in the environment the heap is kept in the
+ * shared memory segment 'name' (eg, /dev/shm/name on Linux) instead of
+ * anonymous memory. The manifest is saved into the segment only by
+ * xbrtime_close(), and the next xbrtime_init() with the same PE count and
+ * heap size attaches to the allocations in place, without any I/O.
+ * Attaching invalidates the saved manifest, and xbrtime_checkpoint() does
+ * not renew it, so after a process dies without xbrtime_close() the next
+ * one starts cold.
+ *
+ * Both calls are collective: call them from outside the pool while no
+ * PE is running.
+ */
+
+#ifndef _XBRTIME_CKPT_H_
+#define _XBRTIME_CKPT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-local.h"
+#include "threadpool.h"
+#include "xbMrtime-epoch.h"
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_asm_fence();
+
+extern volatile tpool_thread_t *threads;
+
+/* a job run on one PE's pool thread by __xbrtime_run_on_pes() */
+typedef struct {
+  void           (*fn)( void * );
+  void            *arg;
+  int             *left;      /* jobs still running */
+  pthread_mutex_t *lock;
+  pthread_cond_t  *cv;
+} __xbrtime_pe_job_t;
+
+#ifndef __XBRTIME_DECLARE_ONLY
+static void __xbrtime_pe_job( void *arg ){
+  __xbrtime_pe_job_t *j = (__xbrtime_pe_job_t *)arg;
+
+  j->fn( j->arg );
+  xbrtime_quiesce();
+  pthread_mutex_lock( j->lock );
+  if( --*j->left == 0 ){
+    pthread_cond_broadcast( j->cv );
+  }
+  pthread_mutex_unlock( j->lock );
+}
+
+/* runs fn( args + pe * size ) on the pool thread of every PE and waits */
+static int __xbrtime_run_on_pes( void (*fn)( void * ), void *args,
+                                 size_t size, int npes ){
+  int left = npes;
+  int pe = 0;
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+  __xbrtime_pe_job_t *jobs = NULL;
+
+  if( npes <= 0 ){
+    return 0;
+  }
+  jobs = (__xbrtime_pe_job_t *)calloc( (size_t)npes,
+                                       sizeof( __xbrtime_pe_job_t ) );
+  if( jobs == NULL ){
+    return -1;
+  }
+  __xbrtime_epoch_phase( 1 );
+  for( pe = 0; pe < npes; pe++ ){
+    jobs[pe].fn   = fn;
+    jobs[pe].arg  = (char *)args + (size_t)pe * size;
+    jobs[pe].left = &left;
+    jobs[pe].lock = &lock;
+    jobs[pe].cv   = &cv;
+    if( (threads == NULL) ||
+        !tpool_add_work_prio( threads[pe].thread_queue, __xbrtime_pe_job,
+                              &jobs[pe], TPOOL_PRIO_CONTROL ) ){
+      __xbrtime_pe_job( &jobs[pe] );
+    }
+  }
+  pthread_mutex_lock( &lock );
+  while( left != 0 ){
+    pthread_cond_wait( &cv, &lock );
+  }
+  pthread_mutex_unlock( &lock );
+  __xbrtime_epoch_phase( 0 );
+
+  free( jobs );
+  return 0;
+}
+
+/* one PE's share of a checkpoint or restart */
+typedef struct {
+  int              fd;
+  int              writing;
+  char            *buf;
+  size_t           len;
+  off_t            at;
+  int              rtn;
+} __xbrtime_ckpt_job_t;
+
+/* moves 'len' bytes between 'buf' and the file at 'at' in large pieces */
+static int __xbrtime_ckpt_xfer( int fd, int writing, char *buf, size_t len,
+                                off_t at ){
+  size_t done = 0;
+
+  while( done < len ){
+    size_t n = len - done;
+    ssize_t r = 0;
+    if( n > _XBRTIME_CKPT_IO_ ){
+      n = _XBRTIME_CKPT_IO_;
+    }
+    r = writing ? pwrite( fd, buf + done, n, at + (off_t)done )
+                : pread( fd, buf + done, n, at + (off_t)done );
+    if( (r < 0) && (errno == EINTR) ){
+      continue;
+    }
+    if( r <= 0 ){
+      return -1;
+    }
+    done += (size_t)r;
+  }
+  return 0;
+}
+
+static void __xbrtime_ckpt_job( void *arg ){
+  __xbrtime_ckpt_job_t *j = (__xbrtime_ckpt_job_t *)arg;
+
+  j->rtn = __xbrtime_ckpt_xfer( j->fd, j->writing, j->buf, j->len, j->at );
+}
+
+/* every PE moves the first 'extent' bytes of its partition */
+static int __xbrtime_ckpt_partitions( int fd, int writing, size_t hdr,
+                                      size_t extent ){
+  int npes = __xbrtime_heap.npes;
+  int pe = 0, rtn = 0;
+  __xbrtime_ckpt_job_t *jobs = NULL;
+
+  if( extent == 0 ){
+    return 0;
+  }
+  jobs = (__xbrtime_ckpt_job_t *)calloc( (size_t)npes,
+                                         sizeof( __xbrtime_ckpt_job_t ) );
+  if( jobs == NULL ){
+    return -1;
+  }
+  for( pe = 0; pe < npes; pe++ ){
+    jobs[pe].fd      = fd;
+    jobs[pe].writing = writing;
+    jobs[pe].buf     = (char *)__xbrtime_heap_at( pe, 0 );
+    jobs[pe].len     = extent;
+    jobs[pe].at      = (off_t)(hdr + (size_t)pe * extent);
+  }
+  rtn = __xbrtime_run_on_pes( __xbrtime_ckpt_job, jobs,
+                              sizeof( __xbrtime_ckpt_job_t ), npes );
+  for( pe = 0; pe < npes; pe++ ){
+    rtn |= jobs[pe].rtn;
+  }
+  free( jobs );
+  return rtn;
+}
+
+/* opens for direct I/O where the file system supports it */
+static int __xbrtime_ckpt_open( const char *path, int flags ){
+#ifdef O_DIRECT
+  int fd = open( path, flags | O_DIRECT, 0644 );
+  if( fd >= 0 ){
+    return fd;
+  }
+#endif
+  return open( path, flags, 0644 );
+}
+
+static __xbrtime_manifest_t *__xbrtime_ckpt_manifest( void ){
+  size_t hdr = __xbrtime_heap_hdr_size();
+  void *m = NULL;
+  if( posix_memalign( &m, (size_t)sysconf( _SC_PAGESIZE ), hdr ) != 0 ){
+    return NULL;
+  }
+  memset( m, 0, hdr );
+  return (__xbrtime_manifest_t *)m;
+}
+
+/* ------------------------------------------------- PUBLIC CHECKPOINT API */
+
+extern int xbrtime_checkpoint( const char *path ){
+  size_t hdr = __xbrtime_heap_hdr_size();
+  __xbrtime_manifest_t *m = NULL;
+  char *tmp = NULL;
+  int fd = -1, rtn = 0;
+
+  if( (path == NULL) || (__xbrtime_heap.base == NULL) ){
+    return -1;
+  }
+  if( (m = __xbrtime_ckpt_manifest()) == NULL ){
+    return -1;
+  }
+  pthread_mutex_lock( &__xbrtime_heap.lock );
+  rtn = __xbrtime_heap_save_locked( m );
+  pthread_mutex_unlock( &__xbrtime_heap.lock );
+  if( (rtn != 0) || ((tmp = (char *)malloc( strlen( path ) + 5 )) == NULL) ){
+    free( m );
+    return -1;
+  }
+  sprintf( tmp, "%s.tmp", path );
+
+  fd = __xbrtime_ckpt_open( tmp, O_WRONLY | O_CREAT | O_TRUNC );
+  if( fd < 0 ){
+    free( tmp );
+    free( m );
+    return -1;
+  }
+  __xbrtime_asm_fence();
+
+  /* data first, manifest last: a partial file never looks valid */
+  rtn = ftruncate( fd, (off_t)(hdr + (size_t)m->npes * m->extent) );
+  if( rtn == 0 ){
+    rtn = __xbrtime_ckpt_partitions( fd, 1, hdr, (size_t)m->extent );
+  }
+  if( rtn == 0 ){
+    rtn = fdatasync( fd );
+  }
+  if( rtn == 0 ){
+    rtn = __xbrtime_ckpt_xfer( fd, 1, (char *)m, hdr, 0 );
+  }
+  if( rtn == 0 ){
+    rtn = fdatasync( fd );
+  }
+  if( close( fd ) != 0 ){
+    rtn = -1;
+  }
+  if( rtn == 0 ){
+    rtn = rename( tmp, path );
+  }
+  if( rtn != 0 ){
+    unlink( tmp );
+  }
+
+  free( tmp );
+  free( m );
+  return (rtn == 0) ? 0 : -1;
+}
+
+extern int xbrtime_restart( const char *path ){
+  size_t hdr = __xbrtime_heap_hdr_size();
+  __xbrtime_manifest_t *m = NULL;
+  int fd = -1, rtn = 0;
+
+  if( (path == NULL) || (__xbrtime_heap.base == NULL) ){
+    return -1;
+  }
+  if( (m = __xbrtime_ckpt_manifest()) == NULL ){
+    return -1;
+  }
+  fd = __xbrtime_ckpt_open( path, O_RDONLY );
+  if( fd < 0 ){
+    free( m );
+    return -1;
+  }
+
+  rtn = __xbrtime_ckpt_xfer( fd, 0, (char *)m, hdr, 0 );
+  if( (rtn == 0) &&
+      ((m->magic != _XBRTIME_MANIFEST_MAGIC_) ||
+       (m->npes != (uint64_t)__xbrtime_heap.npes) ||
+       (m->extent > (uint64_t)__xbrtime_heap.part_size)) ){
+    rtn = -1;
+  }
+  if( rtn == 0 ){
+    rtn = __xbrtime_ckpt_partitions( fd, 0, hdr, (size_t)m->extent );
+  }
+  close( fd );
+  if( rtn == 0 ){
+    pthread_mutex_lock( &__xbrtime_heap.lock );
+    rtn = __xbrtime_heap_load_locked( m );
+    pthread_mutex_unlock( &__xbrtime_heap.lock );
+  }
+  if( rtn == 0 ){
+    __xbrtime_local_restart();
+  }
+  xbrtime_cache_invalidate_all();
+  __xbrtime_asm_fence();
+
+  free( m );
+  return (rtn == 0) ? 0 : -1;
+}
+
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_CKPT_H_ */
+
+/* EOF */
@@ -0,0 +1,779 @@
+/*
+ * _XBRTIME_COLL_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-coll.h
+ * \brief Topology-aware barrier, broadcast, reduce and allreduce
+ *
+ * These collectives are called by every PE, each from its own pool
+ * thread, with the same arguments apart from the buffers:
+ *
+ * \code
+ *   void step( void *arg ){
+ *     long long part = work( xbrtime_mype() ), total = 0;
+ *     xbrtime_coll_allreduce( &total, &part, 1, XBRTIME_COLL_LONGLONG,
+ *                             XBRTIME_COLL_SUM );
+ *     xbrtime_coll_barrier();
+ *   }
+ * \endcode
+ *
+ * xbrtime_init() reads the CPU topology from sysfs and groups the PEs into
+ * domains, one per L3 cache (or per socket): consecutive PEs go to CPUs of
+ * the same domain, and each PE's pool thread is bound to its CPU. The
+ * first PE of a domain is its leader. With more than one domain, and more
+ * PEs than domains, the collectives run in two levels: the PEs of a domain
+ * combine at their leader, the leaders run the collective among
+ * themselves, and every leader fans the result out to its domain. Only
+ * leaders then move data between domains, and PEs waiting in a barrier
+ * spin on a line shared with their own domain only. Otherwise the flat
+ * algorithms are used.
+ *
+ * The environment selects the topology and the mode:
+ *   XBRTIME_TOPO  l3 (default), socket, none, or a number of equal domains
+ *   XBRTIME_COLL  auto (default), flat or hier
+ *   XBRTIME_BIND  0 to leave the pool threads unbound, 1 to always bind
+ *
+ * Reductions combine the contributions in a fixed order for a given
+ * topology, so a floating point result is the same on every PE and on
+ * every run. xbrtime_barrier() and the older broadcast and reduce calls,
+ * which run from the main thread, are not affected.
+ */
+
+#ifndef _XBRTIME_COLL_H_
+#define _XBRTIME_COLL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined( __linux__ )
+#include <sys/syscall.h>
+#endif
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-stream.h"
+#include "xbMrtime-ckpt.h"
+#include "xbMrtime-epoch.h"
+#include "xbMrtime-trace.h"
+
+/*! \brief Pick the mode from the topology */
+#define XBRTIME_COLL_AUTO 0
+/*! \brief One level over all PEs */
+#define XBRTIME_COLL_FLAT 1
+/*! \brief Within each domain, then among the domain leaders */
+#define XBRTIME_COLL_HIER 2
+
+/*! \brief Element types of xbrtime_coll_reduce() and _allreduce() */
+#define XBRTIME_COLL_INT       0
+#define XBRTIME_COLL_LONGLONG  1
+#define XBRTIME_COLL_ULONGLONG 2
+#define XBRTIME_COLL_DOUBLE    3
+
+/*! \brief Reduction operators */
+#define XBRTIME_COLL_SUM 0
+#define XBRTIME_COLL_MIN 1
+#define XBRTIME_COLL_MAX 2
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_asm_fence();
+int xbrtime_mype(void);
+
+/* a barrier counter; the last arrival bumps 'gen' to release the others */
+typedef struct {
+  volatile uint32_t count;
+  volatile uint32_t gen;
+} __attribute__((aligned(64))) __xbrtime_coll_bar_t;
+
+/* the buffers a PE offers to the current collective */
+typedef struct {
+  const void *src;
+  void       *dst;
+} __attribute__((aligned(64))) __xbrtime_coll_slot_t;
+
+typedef struct {
+  int                    npes;
+  int                    mode;      /* XBRTIME_COLL_FLAT or _HIER */
+  int                    ndomains;
+  int                   *domain;    /* domain of each PE */
+  int                   *first;     /* first PE of each domain, then npes */
+  int                   *cpu;       /* CPU each PE is bound to, or -1 */
+  __xbrtime_coll_bar_t  *dbar;      /* one per domain */
+  __xbrtime_coll_bar_t   gbar;      /* all PEs, or all domains */
+  __xbrtime_coll_slot_t *slot;      /* one per PE */
+} __xbrtime_topo_t;
+
+extern __xbrtime_topo_t __xbrtime_topo;
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_topo_t __xbrtime_topo;
+
+/* ------------------------------------------------- TOPOLOGY DISCOVERY */
+
+/* the first number in a sysfs file, or -1 */
+static long __xbrtime_topo_read( const char *path ){
+  FILE *f = fopen( path, "r" );
+  long v = -1;
+
+  if( f == NULL ){
+    return -1;
+  }
+  if( fscanf( f, "%ld", &v ) != 1 ){
+    v = -1;
+  }
+  fclose( f );
+  return v;
+}
+
+/* the domain key of a CPU: the first CPU sharing its L3, or its socket */
+static long __xbrtime_topo_key( int cpu, int l3 ){
+  char path[128];
+  long level = 0;
+  int idx = 0;
+
+  if( l3 ){
+    for( idx = 0; ; idx++ ){
+      snprintf( path, sizeof( path ),
+                "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, idx );
+      if( (level = __xbrtime_topo_read( path )) < 0 ){
+        break;
+      }
+      if( level == 3 ){
+        snprintf( path, sizeof( path ),
+                  "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+                  cpu, idx );
+        return __xbrtime_topo_read( path );
+      }
+    }
+  }
+  snprintf( path, sizeof( path ),
+            "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu );
+  return __xbrtime_topo_read( path );
+}
+
+/* the CPUs this process may run on; returns their number */
+static int __xbrtime_topo_cpus( int *cpus, int max ){
+  int n = 0, c = 0;
+#if defined( __linux__ )
+  unsigned long mask[__XBRTIME_MAX_PE / (8 * sizeof( unsigned long ))];
+  long len = 0;
+
+  memset( mask, 0, sizeof( mask ) );
+  len = syscall( SYS_sched_getaffinity, 0, sizeof( mask ), mask );
+  for( c = 0; (len > 0) && (c < 8 * len) && (n < max); c++ ){
+    if( mask[c / (8 * sizeof( unsigned long ))] &
+        (1ul << (c % (8 * sizeof( unsigned long )))) ){
+      cpus[n++] = c;
+    }
+  }
+  if( n > 0 ){
+    return n;
+  }
+#endif
+  for( c = 0; (c < sysconf( _SC_NPROCESSORS_ONLN )) && (n < max); c++ ){
+    cpus[n++] = c;
+  }
+  return n;
+}
+
+/* binds the calling pool thread to the CPU passed in */
+static void __xbrtime_topo_bind( void *arg ){
+#if defined( __linux__ )
+  int cpu = *(int *)arg;
+  unsigned long mask[__XBRTIME_MAX_PE / (8 * sizeof( unsigned long ))];
+
+  memset( mask, 0, sizeof( mask ) );
+  mask[cpu / (8 * sizeof( unsigned long ))] =
+    1ul << (cpu % (8 * sizeof( unsigned long )));
+  syscall( SYS_sched_setaffinity, 0, sizeof( mask ), mask );
+#else
+  (void)arg;
+#endif
+}
+
+static void __xbrtime_topo_fini( void ){
+  free( __xbrtime_topo.domain );
+  free( __xbrtime_topo.first );
+  free( __xbrtime_topo.cpu );
+  free( __xbrtime_topo.dbar );
+  free( __xbrtime_topo.slot );
+  memset( &__xbrtime_topo, 0, sizeof( __xbrtime_topo ) );
+}
+
+/* the mode AUTO stands for with the current domains */
+static int __xbrtime_topo_auto( void ){
+  return ((__xbrtime_topo.ndomains > 1) &&
+          (__xbrtime_topo.ndomains < __xbrtime_topo.npes))
+           ? XBRTIME_COLL_HIER : XBRTIME_COLL_FLAT;
+}
+
+/*
+ * places 'npes' PEs on the topology named by the environment, binds the
+ * pool threads and picks the collective mode; called by xbrtime_init()
+ */
+static int __xbrtime_topo_init( int npes ){
+  int *cpus = NULL;
+  long *keys = NULL;
+  int ncpus = 0, pe = 0, i = 0, j = 0, bind = -1, fixed = 0, l3 = 1;
+  const char *str = NULL;
+
+  __xbrtime_topo_fini();
+  if( (npes <= 0) || (npes > __XBRTIME_MAX_PE) ){
+    return -1;
+  }
+  __xbrtime_topo.npes   = npes;
+  __xbrtime_topo.domain = (int *)calloc( (size_t)npes, sizeof( int ) );
+  __xbrtime_topo.first  = (int *)calloc( (size_t)npes + 1, sizeof( int ) );
+  __xbrtime_topo.cpu    = (int *)calloc( (size_t)npes, sizeof( int ) );
+  if( (posix_memalign( (void **)&__xbrtime_topo.dbar, 64,
+                       (size_t)npes * sizeof( __xbrtime_coll_bar_t ) ) != 0) ||
+      (posix_memalign( (void **)&__xbrtime_topo.slot, 64,
+                       (size_t)npes * sizeof( __xbrtime_coll_slot_t ) ) != 0) ){
+    __xbrtime_topo.dbar = NULL;
+    __xbrtime_topo.slot = NULL;
+  }
+  if( (__xbrtime_topo.domain == NULL) || (__xbrtime_topo.first == NULL) ||
+      (__xbrtime_topo.cpu == NULL) || (__xbrtime_topo.dbar == NULL) ||
+      (__xbrtime_topo.slot == NULL) ){
+    __xbrtime_topo_fini();
+    return -1;
+  }
+  memset( __xbrtime_topo.dbar, 0, (size_t)npes * sizeof( __xbrtime_coll_bar_t ) );
+  memset( __xbrtime_topo.slot, 0, (size_t)npes * sizeof( __xbrtime_coll_slot_t ) );
+  for( pe = 0; pe < npes; pe++ ){
+    __xbrtime_topo.cpu[pe] = -1;
+  }
+
+  if( (str = getenv( "XBRTIME_TOPO" )) != NULL ){
+    if( strcmp( str, "socket" ) == 0 ){
+      l3 = 0;
+    }else if( strcmp( str, "none" ) == 0 ){
+      fixed = 1;
+    }else if( atoi( str ) > 0 ){
+      fixed = atoi( str );
+    }
+  }
+
+  if( fixed > 0 ){
+    /* 'fixed' equal domains, nothing bound */
+    fixed = (fixed < npes) ? fixed : npes;
+    for( pe = 0; pe < npes; pe++ ){
+      __xbrtime_topo.domain[pe] = (int)((long)pe * fixed / npes);
+    }
+  }else{
+    /* CPUs sorted by domain key; PE p runs on the (p * ncpus / npes)th */
+    cpus = (int *)malloc( __XBRTIME_MAX_PE * sizeof( int ) );
+    keys = (long *)malloc( __XBRTIME_MAX_PE * sizeof( long ) );
+    if( (cpus == NULL) || (keys == NULL) ){
+      free( cpus );
+      free( keys );
+      __xbrtime_topo_fini();
+      return -1;
+    }
+    ncpus = __xbrtime_topo_cpus( cpus, __XBRTIME_MAX_PE );
+    for( i = 0; i < ncpus; i++ ){
+      keys[i] = __xbrtime_topo_key( cpus[i], l3 );
+    }
+    for( i = 1; i < ncpus; i++ ){
+      int c = cpus[i];
+      long k = keys[i];
+      for( j = i; (j > 0) && ((keys[j - 1] > k) ||
+                              ((keys[j - 1] == k) && (cpus[j - 1] > c))); j-- ){
+        cpus[j] = cpus[j - 1];
+        keys[j] = keys[j - 1];
+      }
+      cpus[j] = c;
+      keys[j] = k;
+    }
+    for( pe = 0; (pe < npes) && (ncpus > 0); pe++ ){
+      i = (int)((long)pe * ncpus / npes);
+      __xbrtime_topo.cpu[pe] = cpus[i];
+      __xbrtime_topo.domain[pe] = (pe == 0) ? 0 :
+        __xbrtime_topo.domain[pe - 1] +
+        (keys[i] != keys[(int)((long)(pe - 1) * ncpus / npes)]);
+    }
+    free( cpus );
+    free( keys );
+  }
+
+  /* domains are runs of consecutive PEs */
+  __xbrtime_topo.ndomains = 0;
+  for( pe = 0; pe < npes; pe++ ){
+    if( (pe == 0) || (__xbrtime_topo.domain[pe] != __xbrtime_topo.domain[pe - 1]) ){
+      __xbrtime_topo.first[__xbrtime_topo.ndomains++] = pe;
+    }
+    __xbrtime_topo.domain[pe] = __xbrtime_topo.ndomains - 1;
+  }
+  __xbrtime_topo.first[__xbrtime_topo.ndomains] = npes;
+
+  __xbrtime_topo.mode = __xbrtime_topo_auto();
+  if( (str = getenv( "XBRTIME_COLL" )) != NULL ){
+    if( strcmp( str, "flat" ) == 0 ){
+      __xbrtime_topo.mode = XBRTIME_COLL_FLAT;
+    }else if( strcmp( str, "hier" ) == 0 ){
+      __xbrtime_topo.mode = XBRTIME_COLL_HIER;
+    }
+  }
+
+  /* the domains only mean something if the PEs stay on their CPUs */
+  if( (str = getenv( "XBRTIME_BIND" )) != NULL ){
+    bind = atoi( str );
+  }
+  if( bind < 0 ){
+    bind = (__xbrtime_topo.mode == XBRTIME_COLL_HIER);
+  }
+  if( bind && (__xbrtime_topo.cpu[0] >= 0) ){
+    __xbrtime_run_on_pes( __xbrtime_topo_bind, __xbrtime_topo.cpu,
+                          sizeof( int ), npes );
+  }else{
+    for( pe = 0; pe < npes; pe++ ){
+      __xbrtime_topo.cpu[pe] = -1;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------- SYNCHRONIZATION */
+
+/* waits until *gen moves on from 'old', yielding once spinning is futile */
+static void __xbrtime_coll_wait( volatile uint32_t *gen, uint32_t old ){
+  int spins = 0;
+  while( __atomic_load_n( gen, __ATOMIC_ACQUIRE ) == old ){
+    if( ++spins >= _XBRTIME_COLL_SPIN_ ){
+      sched_yield();
+      spins = _XBRTIME_COLL_SPIN_;
+    }
+  }
+}
+
+/* counts the caller in; returns 1 to the last of 'n' */
+static int __xbrtime_coll_arrive( __xbrtime_coll_bar_t *b, int n,
+                                  uint32_t *gen ){
+  *gen = __atomic_load_n( &b->gen, __ATOMIC_ACQUIRE );
+  return __atomic_add_fetch( &b->count, 1, __ATOMIC_ACQ_REL ) == (uint32_t)n;
+}
+
+static void __xbrtime_coll_release( __xbrtime_coll_bar_t *b ){
+  __atomic_store_n( &b->count, 0, __ATOMIC_RELAXED );
+  __atomic_add_fetch( &b->gen, 1, __ATOMIC_RELEASE );
+}
+
+/*
+ * barrier over all PEs; in two levels, the last PE of each domain stands
+ * for the domain among the domains
+ */
+static void __xbrtime_coll_sync( int pe ){
+  __xbrtime_topo_t *t = &__xbrtime_topo;
+  uint32_t g = 0, dg = 0;
+
+  __xbrtime_asm_fence();
+  xbrtime_quiesce();
+  if( t->mode == XBRTIME_COLL_HIER ){
+    int d = t->domain[pe];
+    __xbrtime_coll_bar_t *db = &t->dbar[d];
+    if( !__xbrtime_coll_arrive( db, t->first[d + 1] - t->first[d], &dg ) ){
+      __xbrtime_coll_wait( &db->gen, dg );
+      return;
+    }
+    if( __xbrtime_coll_arrive( &t->gbar, t->ndomains, &g ) ){
+      xbrtime_cache_invalidate_all();
+      __xbrtime_coll_release( &t->gbar );
+    }else{
+      __xbrtime_coll_wait( &t->gbar.gen, g );
+    }
+    __xbrtime_coll_release( db );
+  }else{
+    if( __xbrtime_coll_arrive( &t->gbar, t->npes, &g ) ){
+      xbrtime_cache_invalidate_all();
+      __xbrtime_coll_release( &t->gbar );
+    }else{
+      __xbrtime_coll_wait( &t->gbar.gen, g );
+    }
+  }
+}
+
+/* barrier over the PEs of the caller's domain */
+static void __xbrtime_coll_dsync( int pe ){
+  __xbrtime_topo_t *t = &__xbrtime_topo;
+  int d = t->domain[pe];
+  uint32_t g = 0;
+
+  __xbrtime_asm_fence();
+  if( __xbrtime_coll_arrive( &t->dbar[d], t->first[d + 1] - t->first[d], &g ) ){
+    __xbrtime_coll_release( &t->dbar[d] );
+  }else{
+    __xbrtime_coll_wait( &t->dbar[d].gen, g );
+  }
+}
+
+/* ------------------------------------------------- COMBINING */
+
+static size_t __xbrtime_coll_size( int type ){
+  switch( type ){
+  case XBRTIME_COLL_INT:       return sizeof( int );
+  case XBRTIME_COLL_LONGLONG:  return sizeof( long long );
+  case XBRTIME_COLL_ULONGLONG: return sizeof( unsigned long long );
+  case XBRTIME_COLL_DOUBLE:    return sizeof( double );
+  default:                     return 0;
+  }
+}
+
+#define __XBRTIME_COLL_COMBINE( T ) do {                                      \
+    T *a_ = (T *)acc;                                                         \
+    const T *b_ = (const T *)in;                                              \
+    if( op == XBRTIME_COLL_SUM ){                                             \
+      for( i = 0; i < n; i++ ) a_[i] += b_[i];                                \
+    }else if( op == XBRTIME_COLL_MIN ){                                       \
+      for( i = 0; i < n; i++ ) a_[i] = (b_[i] < a_[i]) ? b_[i] : a_[i];       \
+    }else{                                                                    \
+      for( i = 0; i < n; i++ ) a_[i] = (b_[i] > a_[i]) ? b_[i] : a_[i];       \
+    }                                                                         \
+  } while( 0 )
+
+/* acc[i] = acc[i] op in[i] for n elements */
+static void __xbrtime_coll_combine( void *acc, const void *in, size_t n,
+                                    int type, int op ){
+  size_t i = 0;
+  switch( type ){
+  case XBRTIME_COLL_INT:       __XBRTIME_COLL_COMBINE( int );                break;
+  case XBRTIME_COLL_LONGLONG:  __XBRTIME_COLL_COMBINE( long long );          break;
+  case XBRTIME_COLL_ULONGLONG: __XBRTIME_COLL_COMBINE( unsigned long long ); break;
+  default:                     __XBRTIME_COLL_COMBINE( double );             break;
+  }
+}
+
+#undef __XBRTIME_COLL_COMBINE
+
+/* combines n elements of another PE's buffer into acc, a chunk at a time */
+static void __xbrtime_coll_fold( void *acc, const void *src, size_t n,
+                                 int type, int op ){
+  uint64_t buf[_XBRTIME_COLL_CHUNK_ / sizeof( uint64_t )];
+  size_t w = __xbrtime_coll_size( type );
+  size_t per = sizeof( buf ) / w;
+  size_t at = 0;
+
+  for( at = 0; at < n; at += per ){
+    size_t len = (n - at < per) ? n - at : per;
+    __xbrtime_copy_bytes( (char *)buf, (const char *)src + at * w, len * w, 0 );
+    __xbrtime_coll_combine( (char *)acc + at * w, buf, len, type, op );
+  }
+}
+
+static void __xbrtime_coll_copy( void *dst, const void *src, size_t nbytes ){
+  if( dst != src ){
+    __xbrtime_copy_bytes( (char *)dst, (const char *)src, nbytes, 0 );
+  }
+}
+
+/* ------------------------------------------------- PUBLIC COLLECTIVE API */
+
+extern int xbrtime_coll_mode( void ){
+  return __xbrtime_topo.mode;
+}
+
+extern int xbrtime_coll_set_mode( int mode ){
+  if( __xbrtime_topo.npes == 0 ){
+    return -1;
+  }
+  switch( mode ){
+  case XBRTIME_COLL_AUTO:
+    __xbrtime_topo.mode = __xbrtime_topo_auto();
+    return 0;
+  case XBRTIME_COLL_FLAT:
+  case XBRTIME_COLL_HIER:
+    __xbrtime_topo.mode = mode;
+    return 0;
+  default:
+    return -1;
+  }
+}
+
+extern int xbrtime_topo_ndomains( void ){
+  return __xbrtime_topo.ndomains;
+}
+
+extern int xbrtime_topo_domain( int pe ){
+  if( (pe < 0) || (pe >= __xbrtime_topo.npes) ){
+    return -1;
+  }
+  return __xbrtime_topo.domain[pe];
+}
+
+extern int xbrtime_topo_cpu( int pe ){
+  if( (pe < 0) || (pe >= __xbrtime_topo.npes) ){
+    return -1;
+  }
+  return __xbrtime_topo.cpu[pe];
+}
+
+extern void xbrtime_coll_barrier( void ){
+  __XBRTIME_TRACE_T0( tr );
+
+  if( __xbrtime_topo.npes == 0 ){
+    __xbrtime_asm_fence();
+    return;
+  }
+  __xbrtime_coll_sync( xbrtime_mype() );
+  __XBRTIME_TRACE_REC( tr, XBRTIME_TRACE_COLL_BARRIER, 0, -1, 0, 0, 0, NULL );
+}
+
+static int __xbrtime_coll_broadcast_impl( void *dest, const void *src,
+                                          size_t nbytes, int root ){
+  __xbrtime_topo_t *t = &__xbrtime_topo;
+  int pe = xbrtime_mype();
+  int d = 0, from = 0;
+
+  if( (t->npes == 0) || (root < 0) || (root >= t->npes) ){
+    return -1;
+  }
+  if( nbytes == 0 ){
+    return 0;
+  }
+  t->slot[pe].src = src;
+  t->slot[pe].dst = dest;
+  __xbrtime_coll_sync( pe );
+
+  if( t->mode != XBRTIME_COLL_HIER ){
+    __xbrtime_coll_copy( dest, t->slot[root].src, nbytes );
+  }else{
+    /* the root feeds its domain; every other leader fetches for its own */
+    d = t->domain[pe];
+    from = (d == t->domain[root]) ? root : t->first[d];
+    if( pe == from ){
+      __xbrtime_coll_copy( dest, t->slot[root].src, nbytes );
+    }
+    __xbrtime_coll_dsync( pe );
+    if( pe != from ){
+      __xbrtime_coll_copy( dest, (from == root) ? t->slot[root].src
+                                                : t->slot[from].dst, nbytes );
+    }
+  }
+  __xbrtime_coll_sync( pe );
+  return 0;
+}
+
+static int __xbrtime_coll_reduce_impl( void *dest, const void *src,
+                                       size_t nelems, int type, int op,
+                                       int root ){
+  __xbrtime_topo_t *t = &__xbrtime_topo;
+  int pe = xbrtime_mype();
+  size_t w = __xbrtime_coll_size( type );
+  void *part = NULL;
+  int d = 0, q = 0, rtn = 0;
+
+  if( (t->npes == 0) || (w == 0) || (op < XBRTIME_COLL_SUM) ||
+      (op > XBRTIME_COLL_MAX) || (root < 0) || (root >= t->npes) ){
+    return -1;
+  }
+  if( nelems == 0 ){
+    return 0;
+  }
+  t->slot[pe].src = src;
+
+  if( t->mode != XBRTIME_COLL_HIER ){
+    __xbrtime_coll_sync( pe );
+    if( pe == root ){
+      __xbrtime_coll_copy( dest, src, nelems * w );
+      for( q = 0; q < t->npes; q++ ){
+        if( q != root ){
+          __xbrtime_coll_fold( dest, t->slot[q].src, nelems, type, op );
+        }
+      }
+    }
+    __xbrtime_coll_sync( pe );
+    return 0;
+  }
+
+  /* each leader combines its domain into a private partial result */
+  d = t->domain[pe];
+  __xbrtime_coll_dsync( pe );
+  if( pe == t->first[d] ){
+    if( (part = malloc( nelems * w )) != NULL ){
+      memcpy( part, src, nelems * w );
+      for( q = pe + 1; q < t->first[d + 1]; q++ ){
+        __xbrtime_coll_fold( part, t->slot[q].src, nelems, type, op );
+      }
+    }
+    t->slot[pe].dst = part;
+  }
+  __xbrtime_coll_sync( pe );
+
+  /* the root combines the partial results of the domains */
+  if( pe == root ){
+    for( d = 0; d < t->ndomains; d++ ){
+      if( t->slot[t->first[d]].dst == NULL ){
+        rtn = -1;
+      }
+    }
+    if( rtn == 0 ){
+      __xbrtime_coll_copy( dest, t->slot[t->first[0]].dst, nelems * w );
+      for( d = 1; d < t->ndomains; d++ ){
+        __xbrtime_coll_fold( dest, t->slot[t->first[d]].dst, nelems, type, op );
+      }
+    }
+  }
+  __xbrtime_coll_sync( pe );
+  free( part );
+  return rtn;
+}
+
+static int __xbrtime_coll_allreduce_impl( void *dest, const void *src,
+                                          size_t nelems, int type, int op ){
+  __xbrtime_topo_t *t = &__xbrtime_topo;
+  int pe = xbrtime_mype();
+  size_t w = __xbrtime_coll_size( type );
+  const int *members = NULL;
+  int n = 0, me = 0, d = 0, q = 0, i = 0;
+  size_t lo = 0, hi = 0;
+
+  if( (t->npes == 0) || (w == 0) || (op < XBRTIME_COLL_SUM) ||
+      (op > XBRTIME_COLL_MAX) ){
+    return -1;
+  }
+  if( nelems == 0 ){
+    return 0;
+  }
+  t->slot[pe].src = src;
+  t->slot[pe].dst = dest;
+
+  /*
+   * the participants of the reduce-scatter and allgather: every PE over
+   * its src, or in two levels the leaders over their domain's partial
+   * result, kept in the leader's dest
+   */
+  if( t->mode != XBRTIME_COLL_HIER ){
+    __xbrtime_coll_sync( pe );
+    members = NULL;
+    n = t->npes;
+    me = pe;
+  }else{
+    d = t->domain[pe];
+    __xbrtime_coll_dsync( pe );
+    if( pe == t->first[d] ){
+      __xbrtime_coll_copy( dest, src, nelems * w );
+      for( q = pe + 1; q < t->first[d + 1]; q++ ){
+        __xbrtime_coll_fold( dest, t->slot[q].src, nelems, type, op );
+      }
+    }
+    __xbrtime_coll_sync( pe );
+    members = t->first;
+    n = t->ndomains;
+    me = (pe == t->first[d]) ? d : -1;
+  }
+
+  /* reduce-scatter: participant 'me' combines slice 'me' of everyone */
+  if( me >= 0 ){
+    lo = nelems * (size_t)me / (size_t)n;
+    hi = nelems * (size_t)(me + 1) / (size_t)n;
+    if( members == NULL ){
+      __xbrtime_coll_copy( (char *)dest + lo * w, (const char *)src + lo * w,
+                           (hi - lo) * w );
+    }
+    for( i = 0; (i < n) && (hi > lo); i++ ){
+      q = (members == NULL) ? i : members[i];
+      if( i != me ){
+        __xbrtime_coll_fold( (char *)dest + lo * w,
+                             (const char *)((members == NULL) ? t->slot[q].src
+                                                              : t->slot[q].dst)
+                               + lo * w,
+                             hi - lo, type, op );
+      }
+    }
+  }
+  __xbrtime_coll_sync( pe );
+
+  /* allgather: participant 'me' fetches every other slice from its owner */
+  if( me >= 0 ){
+    for( i = 0; i < n; i++ ){
+      q = (members == NULL) ? i : members[i];
+      lo = nelems * (size_t)i / (size_t)n;
+      hi = nelems * (size_t)(i + 1) / (size_t)n;
+      if( i != me ){
+        __xbrtime_coll_copy( (char *)dest + lo * w,
+                             (const char *)t->slot[q].dst + lo * w,
+                             (hi - lo) * w );
+      }
+    }
+  }
+
+  /* and every leader fans the result out to its domain */
+  if( t->mode == XBRTIME_COLL_HIER ){
+    __xbrtime_coll_dsync( pe );
+    if( me < 0 ){
+      __xbrtime_coll_copy( dest, t->slot[t->first[d]].dst, nelems * w );
+    }
+  }
+  __xbrtime_coll_sync( pe );
+  return 0;
+}
+
+/* the public collectives: the implementations above, traced */
+extern int xbrtime_coll_broadcast( void *dest, const void *src,
+                                   size_t nbytes, int root ){
+  int rtn = 0;
+  __XBRTIME_TRACE_T0( tr );
+
+  rtn = __xbrtime_coll_broadcast_impl( dest, src, nbytes, root );
+  if( rtn == 0 ){
+    __XBRTIME_TRACE_REC( tr, XBRTIME_TRACE_BROADCAST, 0, root, 1, nbytes, 1,
+                         NULL );
+  }
+  return rtn;
+}
+
+extern int xbrtime_coll_reduce( void *dest, const void *src, size_t nelems,
+                                int type, int op, int root ){
+  int rtn = 0;
+  __XBRTIME_TRACE_T0( tr );
+
+  rtn = __xbrtime_coll_reduce_impl( dest, src, nelems, type, op, root );
+  if( rtn == 0 ){
+    __XBRTIME_TRACE_REC( tr, XBRTIME_TRACE_REDUCE, type | (op << 4), root,
+                         __xbrtime_coll_size( type ), nelems, 1, NULL );
+  }
+  return rtn;
+}
+
+extern int xbrtime_coll_allreduce( void *dest, const void *src, size_t nelems,
+                                   int type, int op ){
+  int rtn = 0;
+  __XBRTIME_TRACE_T0( tr );
+
+  rtn = __xbrtime_coll_allreduce_impl( dest, src, nelems, type, op );
+  if( rtn == 0 ){
+    __XBRTIME_TRACE_REC( tr, XBRTIME_TRACE_ALLREDUCE, type | (op << 4), -1,
+                         __xbrtime_coll_size( type ), nelems, 1, NULL );
+  }
+  return rtn;
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_COLL_H_ */
+
+/* EOF */
@@ -0,0 +1,536 @@
+/*
+ * xbMrtime-coro.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-coro.hpp
+ * \brief C++20 coroutine layer for asynchronous xBGAS operations
+ *
+ * Remote transfers, barriers and collectives are exposed as awaitables.
+ * A coroutine that awaits one is suspended; the operation is carried out
+ * through the per-PE work queues and the coroutine is resumed on the pool
+ * thread of the PE it runs on once the operation has completed.
+ *
+ * A suspended coroutine only holds its frame and a single queued work unit,
+ * so each PE can keep thousands of logical tasks in flight.
+ *
+ * \code
+ *   xbr::task<> kernel(long long *buf, size_t n) {
+ *     int me = xbrtime_mype();
+ *     co_await xbr::get_async(buf, buf + n, n, (me + 1) % xbrtime_num_pes());
+ *     co_await xbr::barrier();
+ *   }
+ *
+ *   xbr::task_group g;
+ *   for (int pe = 0; pe < xbrtime_num_pes(); pe++)
+ *     g.spawn(pe, kernel(buf, n));
+ *   g.wait();
+ * \endcode
+ */
+
+#ifndef _XBRTIME_CORO_HPP_
+#define _XBRTIME_CORO_HPP_
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xbrtime_morello.h"
+
+namespace xbr {
+
+/* ========================================================================= */
+/*                           QUEUE PLUMBING                                 */
+/* ========================================================================= */
+
+namespace detail {
+
+/*! \brief Work unit body: resume the coroutine stored in the argument */
+inline void resume_unit(void *arg) {
+  std::coroutine_handle<>::from_address(arg).resume();
+}
+
+/*! \brief Queue the resumption of a coroutine on the pool thread of a PE */
+inline void resume_on(int pe, std::coroutine_handle<> h,
+                      tpool_prio_t prio = TPOOL_PRIO_BULK) {
+  if (!tpool_add_work_prio(threads[pe].thread_queue, resume_unit, h.address(),
+                           prio)) {
+    // The queue refused the unit; never lose the coroutine.
+    h.resume();
+  }
+}
+
+/*! \brief Copy a contiguous block and order it before later operations */
+inline void copy_block(void *dst, const void *src, size_t bytes) {
+  std::memcpy(dst, src, bytes);
+  __xbrtime_asm_quiet_fence();
+}
+
+} // namespace detail
+
+/* ========================================================================= */
+/*                           TASKS                                          */
+/* ========================================================================= */
+
+class task_group;
+
+template <typename T = void> class task;
+
+namespace detail {
+
+/*! \brief State shared by every task promise */
+struct promise_base {
+  std::coroutine_handle<> continuation; /*!< Awaiting parent, if any */
+  task_group *group = nullptr;          /*!< Owning group of a spawned task */
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept;
+    void await_resume() noexcept {}
+  };
+  final_awaiter final_suspend() noexcept { return {}; }
+
+  // The runtime does not propagate exceptions across PEs.
+  void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T> struct promise : promise_base {
+  T value{};
+  task<T> get_return_object() noexcept;
+  void return_value(T v) { value = std::move(v); }
+};
+
+template <> struct promise<void> : promise_base {
+  task<void> get_return_object() noexcept;
+  void return_void() noexcept {}
+};
+
+} // namespace detail
+
+/*!
+ * \brief Lazily started coroutine running on a PE pool thread
+ *
+ * A task does nothing until it is either awaited by another task (it then
+ * runs on the same PE) or handed to task_group::spawn().
+ */
+template <typename T> class task {
+public:
+  using promise_type = detail::promise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  task() noexcept = default;
+  explicit task(handle_type h) noexcept : h_(h) {}
+  task(task &&o) noexcept : h_(std::exchange(o.h_, {})) {}
+  task &operator=(task &&o) noexcept {
+    if (this != &o) {
+      if (h_)
+        h_.destroy();
+      h_ = std::exchange(o.h_, {});
+    }
+    return *this;
+  }
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() {
+    if (h_)
+      h_.destroy();
+  }
+
+  /*! \brief Give up ownership of the coroutine frame */
+  handle_type release() noexcept { return std::exchange(h_, {}); }
+
+  /*! \brief Run the task on the awaiting PE; it must not be empty */
+  auto operator co_await() && {
+    if (!h_)
+      throw std::logic_error("xbr::task: awaiting an empty task");
+    struct awaiter {
+      handle_type h;
+      bool await_ready() noexcept { return h.done(); }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept {
+        h.promise().continuation = c;
+        return h;
+      }
+      T await_resume() {
+        if constexpr (!std::is_void_v<T>)
+          return std::move(h.promise().value);
+      }
+    };
+    return awaiter{h_};
+  }
+
+private:
+  handle_type h_;
+};
+
+namespace detail {
+
+template <typename T> task<T> promise<T>::get_return_object() noexcept {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/*!
+ * \brief Set of spawned tasks that can be waited on as a whole
+ *
+ * wait() blocks the calling thread, so it must not be called from a PE
+ * pool thread.
+ */
+class task_group {
+public:
+  task_group() = default;
+  task_group(const task_group &) = delete;
+  task_group &operator=(const task_group &) = delete;
+  ~task_group() { wait(); }
+
+  /*! \brief Start a task on the pool thread of PE 'pe' */
+  template <typename T> void spawn(int pe, task<T> t) {
+    auto h = t.release();
+    if (!h)
+      return;
+    h.promise().group = this;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      pending_++;
+    }
+    detail::resume_on(pe, h);
+  }
+
+  /*! \brief Block until every spawned task has finished */
+  void wait() {
+    std::unique_lock<std::mutex> lk(m_);
+    cv_.wait(lk, [this] { return pending_ == 0; });
+  }
+
+  /*! \brief Called by a spawned task when it finishes */
+  void done() {
+    std::lock_guard<std::mutex> lk(m_);
+    if (--pending_ == 0)
+      cv_.notify_all();
+  }
+
+private:
+  std::mutex m_;
+  std::condition_variable cv_;
+  size_t pending_ = 0;
+};
+
+namespace detail {
+
+template <typename P>
+std::coroutine_handle<>
+promise_base::final_awaiter::await_suspend(std::coroutine_handle<P> h) noexcept {
+  promise_base &p = h.promise();
+  if (p.continuation)
+    return p.continuation; // the awaiting task owns and destroys the frame
+
+  // A spawned task owns itself.
+  task_group *g = p.group;
+  h.destroy();
+  if (g != nullptr)
+    g->done();
+  return std::noop_coroutine();
+}
+
+} // namespace detail
+
+/*!
+ * \brief Run one task per PE and wait for all of them
+ * \param make Callable returning the task for a PE; called on the caller
+ */
+template <typename F> void run_on_all_pes(F &&make) {
+  task_group g;
+  for (int pe = 0; pe < xbrtime_num_pes(); pe++)
+    g.spawn(pe, make(pe));
+  g.wait();
+}
+
+/* ========================================================================= */
+/*                           REMOTE TRANSFERS                               */
+/* ========================================================================= */
+
+namespace detail {
+
+/*!
+ * \brief Awaitable remote transfer
+ *
+ * The copy is carried out by the pool thread of the remote PE; the
+ * awaiting coroutine is then queued back on its own PE. Transfers that
+ * target the calling PE complete inline without suspending.
+ */
+struct xfer_op {
+  void *dst;
+  const void *src;
+  size_t bytes;
+  int target;
+  int origin;
+  std::coroutine_handle<> h;
+
+  static void run(void *arg) {
+    xfer_op *op = static_cast<xfer_op *>(arg);
+    copy_block(op->dst, op->src, op->bytes);
+    // 'op' lives in the suspended frame; do not touch it after this.
+    resume_on(op->origin, op->h);
+  }
+
+  bool await_ready() noexcept {
+    if (bytes == 0)
+      return true;
+    if (target == xbrtime_mype()) {
+      copy_block(dst, src, bytes); // local fast path
+      return true;
+    }
+    return false;
+  }
+
+  bool await_suspend(std::coroutine_handle<> c) noexcept {
+    origin = xbrtime_mype();
+    h = c;
+    if (origin < 0 ||
+        !tpool_add_work(threads[target].thread_queue, run, this)) {
+      copy_block(dst, src, bytes);
+      return false;
+    }
+    return true;
+  }
+
+  void await_resume() noexcept {}
+};
+
+} // namespace detail
+
+/*!
+ * \brief Asynchronously read 'nelems' elements of 'src' on PE 'pe'
+ * \param dest Local destination buffer
+ * \param src Source address on the remote PE
+ * \param nelems Number of elements to transfer
+ * \param pe Source processing element identifier
+ */
+template <typename T>
+detail::xfer_op get_async(T *dest, const T *src, size_t nelems, int pe) {
+  return {dest, src, nelems * sizeof(T), pe, -1, {}};
+}
+
+/*!
+ * \brief Asynchronously write 'nelems' elements of 'src' to 'dest' on PE 'pe'
+ * \param dest Destination address on the remote PE
+ * \param src Local source buffer
+ * \param nelems Number of elements to transfer
+ * \param pe Destination processing element identifier
+ */
+template <typename T>
+detail::xfer_op put_async(T *dest, const T *src, size_t nelems, int pe) {
+  return {dest, src, nelems * sizeof(T), pe, -1, {}};
+}
+
+/* ========================================================================= */
+/*                           COLLECTIVES                                    */
+/* ========================================================================= */
+
+namespace detail {
+
+/*! \brief One PE's arrival at a collective */
+struct arrival {
+  std::coroutine_handle<> h;
+  int pe;
+  arrival *next;
+};
+
+/*!
+ * \brief Rendezvous of one coroutine per PE
+ *
+ * Arrivals are chained through the suspended frames. The last PE to arrive
+ * runs the completion on the list of arrivals, queues every other coroutine
+ * back on its PE through the control lane and continues without
+ * suspending. Each collective type has its own rendezvous.
+ */
+template <typename Tag> struct rendezvous {
+  std::mutex m;
+  int arrived = 0;
+  arrival *head = nullptr;
+
+  static rendezvous &instance() {
+    static rendezvous r;
+    return r;
+  }
+
+  /*! \return true when the caller was parked, false when it was last */
+  template <typename Complete>
+  bool arrive(arrival *self, Complete &&complete) {
+    int npes = xbrtime_num_pes();
+    arrival *all;
+    {
+      std::lock_guard<std::mutex> lk(m);
+      self->next = head;
+      head = self;
+      if (++arrived < npes)
+        return true;
+      all = head;
+      head = nullptr;
+      arrived = 0;
+    }
+    complete(all);
+    __xbrtime_asm_fence();
+    for (arrival *a = all; a != nullptr;) {
+      arrival *next = a->next; // 'a' dies once its coroutine resumes
+      if (a != self)
+        resume_on(a->pe, a->h, TPOOL_PRIO_CONTROL);
+      a = next;
+    }
+    return false;
+  }
+};
+
+struct barrier_tag {};
+
+struct barrier_op {
+  arrival self;
+  bool await_ready() noexcept { return xbrtime_num_pes() <= 1; }
+  bool await_suspend(std::coroutine_handle<> c) {
+    self = {c, xbrtime_mype(), nullptr};
+    return rendezvous<barrier_tag>::instance().arrive(&self, [](arrival *) {});
+  }
+  void await_resume() noexcept {}
+};
+
+template <typename T> struct reduce_tag {};
+
+template <typename T, typename Op> struct reduce_op {
+  struct node : arrival {
+    T *dest;
+    const T *src;
+  } self;
+  size_t nelems;
+  Op op;
+
+  bool await_ready() noexcept { return nelems == 0; }
+  bool await_suspend(std::coroutine_handle<> c) {
+    self.h = c;
+    self.pe = xbrtime_mype();
+    size_t n = nelems;
+    Op f = op;
+    return rendezvous<reduce_tag<T>>::instance().arrive(
+        &self, [n, f](arrival *all) {
+          // Combine in PE order so the result does not depend on arrivals.
+          std::vector<node *> by_pe(xbrtime_num_pes(), nullptr);
+          for (arrival *a = all; a != nullptr; a = a->next)
+            by_pe[a->pe] = static_cast<node *>(a);
+          for (size_t i = 0; i < n; i++) {
+            T acc = by_pe[0]->src[i];
+            for (size_t p = 1; p < by_pe.size(); p++)
+              acc = f(acc, by_pe[p]->src[i]);
+            for (node *d : by_pe)
+              d->dest[i] = acc;
+          }
+        });
+  }
+  void await_resume() noexcept {}
+};
+
+template <typename T> struct broadcast_tag {};
+
+template <typename T> struct broadcast_op {
+  struct node : arrival {
+    T *dest;
+    const T *src;
+  } self;
+  size_t nelems;
+  int root;
+
+  bool await_ready() noexcept { return nelems == 0; }
+  bool await_suspend(std::coroutine_handle<> c) {
+    self.h = c;
+    self.pe = xbrtime_mype();
+    size_t n = nelems;
+    int r = root;
+    return rendezvous<broadcast_tag<T>>::instance().arrive(
+        &self, [n, r](arrival *all) {
+          const T *src = nullptr;
+          for (arrival *a = all; a != nullptr; a = a->next)
+            if (a->pe == r)
+              src = static_cast<node *>(a)->src;
+          for (arrival *a = all; a != nullptr; a = a->next) {
+            node *d = static_cast<node *>(a);
+            if (d->dest != src)
+              std::memcpy(d->dest, src, n * sizeof(T));
+          }
+        });
+  }
+  void await_resume() noexcept {}
+};
+
+} // namespace detail
+
+/*!
+ * \brief Awaitable global barrier; exactly one coroutine per PE takes part
+ */
+inline detail::barrier_op barrier() { return {}; }
+
+/*!
+ * \brief Awaitable all-reduce across PEs; one coroutine per PE takes part
+ * \param dest Destination buffer of the calling PE (nelems elements)
+ * \param src Source buffer of the calling PE (nelems elements)
+ * \param nelems Number of elements to reduce
+ * \param op Binary reduction operation
+ */
+template <typename T, typename Op = std::plus<T>>
+detail::reduce_op<T, Op> reduce_all_async(T *dest, const T *src, size_t nelems,
+                                          Op op = Op{}) {
+  detail::reduce_op<T, Op> r{};
+  r.self.dest = dest;
+  r.self.src = src;
+  r.nelems = nelems;
+  r.op = op;
+  return r;
+}
+
+/*!
+ * \brief Awaitable broadcast from 'root'; one coroutine per PE takes part
+ * \param dest Destination buffer of the calling PE (nelems elements)
+ * \param src Source buffer; only read on the root PE
+ * \param nelems Number of elements to broadcast
+ * \param root Root processing element identifier; std::invalid_argument
+ *        if it is not a PE
+ */
+template <typename T>
+detail::broadcast_op<T> broadcast_async(T *dest, const T *src, size_t nelems,
+                                        int root) {
+  if (root < 0 || root >= xbrtime_num_pes())
+    throw std::invalid_argument("xbr::broadcast_async: root out of range");
+  detail::broadcast_op<T> b{};
+  b.self.dest = dest;
+  b.self.src = src;
+  b.nelems = nelems;
+  b.root = root;
+  return b;
+}
+
+} // namespace xbr
+
+#endif /* _XBRTIME_CORO_HPP_ */
+
+/* EOF */
@@ -0,0 +1,182 @@
+/*
+ * xbMrtime-counter.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-counter.hpp
+ * \brief Sharded global counters
+ *
+ * xbr::sharded_counter<T> is a global statistic (updates done, errors
+ * found, ...) that every PE can bump without contention. Each PE owns one
+ * cache line of the counter in its own partition and only ever adds to
+ * that line:
+ *
+ * \code
+ *   xbr::sharded_counter<uint64_t> updates;
+ *   ...                          // on any PE
+ *   updates.add(1);              // local, uncontended
+ *   ...
+ *   uint64_t n = updates.value();     // sum of all shards
+ *   uint64_t m = updates.reduce();    // collective, from outside the pool
+ *   uint64_t a = updates.approx();    // never leaves the caller's PE
+ * \endcode
+ *
+ * value() reads every shard, so each call pulls one line per PE. reduce()
+ * lets every PE read its own shard on its pool thread instead. Both record
+ * what the other PEs had contributed; approx() adds the caller's current
+ * shard to that record and touches no other PE's memory, so it may lag
+ * behind by whatever the others added since. Threads outside the pool
+ * count as PE 0 but keep a record of their own, which only reduce()
+ * refreshes.
+ */
+
+#ifndef _XBRTIME_COUNTER_HPP_
+#define _XBRTIME_COUNTER_HPP_
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "xbMrtime-sym.hpp"
+
+namespace xbr {
+
+template <typename T = uint64_t> class sharded_counter {
+  static_assert(std::is_integral<T>::value,
+                "sharded_counter holds an integer type");
+
+  /* one PE's share, alone on its cache line */
+  struct alignas(64) shard {
+    T v;
+  };
+
+  /* what a PE last saw of the other PEs' shards */
+  struct alignas(64) seen {
+    T others;
+  };
+
+public:
+  sharded_counter()
+      : s_(1, std::align_val_t{64}),
+        seen_((size_t)xbrtime_num_pes() + 1) {}
+
+  sharded_counter(sharded_counter &&) noexcept = default;
+  sharded_counter &operator=(sharded_counter &&) noexcept = default;
+
+  /*! \brief Add 'd' to the calling PE's shard */
+  void add(T d = 1) { add(my_pe(), d); }
+
+  /*! \brief Add 'd' on behalf of 'pe' (eg, from outside the pool) */
+  void add(int pe, T d) {
+    __atomic_fetch_add(&s_.data(pe)->v, d, __ATOMIC_RELAXED);
+  }
+
+  sharded_counter &operator+=(T d) {
+    add(d);
+    return *this;
+  }
+  sharded_counter &operator++() {
+    add(1);
+    return *this;
+  }
+
+  /*! \brief The calling PE's contribution */
+  T local() const { return local(my_pe()); }
+  T local(int pe) const {
+    return __atomic_load_n(&s_.data(pe)->v, __ATOMIC_RELAXED);
+  }
+
+  /*!
+   * \brief Sum of all shards
+   *
+   * Every addition that happened before the call is counted; additions
+   * racing with it may or may not be.
+   */
+  T value() const {
+    int me = my_pe();
+    T own = 0, others = 0;
+    __xbrtime_asm_fence();
+    for (int pe = 0; pe < npes(); pe++) {
+      T v = __atomic_load_n(&s_.data(pe)->v, __ATOMIC_ACQUIRE);
+      if (pe == me)
+        own = v;
+      else
+        others += v;
+    }
+    /* several threads outside the pool may be reading at once */
+    if (tpool_self != NULL)
+      seen_[me].others = others;
+    return own + others;
+  }
+
+  /*!
+   * \brief Collective sum: each PE reads its own shard on its pool thread
+   *
+   * Called from outside the pool. Also refreshes every PE's approx().
+   */
+  T reduce() {
+    int n = npes();
+    std::vector<T> part((size_t)n);
+    detail::on_each_pe([&](int pe) {
+      part[pe] = __atomic_load_n(&s_.data(pe)->v, __ATOMIC_ACQUIRE);
+    });
+    T total = 0;
+    for (int pe = 0; pe < n; pe++)
+      total += part[pe];
+    for (int pe = 0; pe < n; pe++)
+      seen_[pe].others = total - part[pe];
+    seen_[n].others = total - part[0];
+    return total;
+  }
+
+  /*!
+   * \brief Approximate sum without synchronization
+   *
+   * The caller's shard plus the other shards as of the caller's last
+   * value() or the last reduce(). Never touches another PE's memory.
+   */
+  T approx() const {
+    int me = my_pe();
+    return seen_[tpool_self != NULL ? me : npes()].others + local(me);
+  }
+
+  /*!
+   * \brief Zero every shard; called from outside the pool
+   * \return The total before the reset
+   */
+  T reset() {
+    T total = 0;
+    for (int pe = 0; pe < npes(); pe++) {
+      total += __atomic_exchange_n(&s_.data(pe)->v, T{0}, __ATOMIC_ACQ_REL);
+      seen_[pe].others = 0;
+    }
+    seen_[npes()].others = 0;
+    __xbrtime_asm_fence();
+    return total;
+  }
+
+private:
+  static int my_pe() {
+    int pe = xbrtime_mype();
+    return pe < 0 ? 0 : pe;
+  }
+  int npes() const { return (int)seen_.size() - 1; }
+
+  sym_vector<shard> s_;
+  mutable std::vector<seen> seen_;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_COUNTER_HPP_ */
+
+/* EOF */
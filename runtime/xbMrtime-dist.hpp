@@ -0,0 +1,420 @@
+/*
+ * xbMrtime-dist.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-dist.hpp
+ * \brief Distributed global arrays for the xBGAS runtime
+ *
+ * xbr::dist_array<T, Dist> spreads 'n' elements over the PEs according to a
+ * distribution policy and keeps each PE's share in a symmetric block:
+ *
+ * \code
+ *   xbr::dist_array<long> a(n);                          // block
+ *   xbr::dist_array<long, xbr::cyclic> c(n);             // round robin
+ *   xbr::dist_array<long, xbr::block_cyclic> bc(n, xbr::block_cyclic(64));
+ *
+ *   long v = a.get(i);               // local load if the caller owns i
+ *   a.put(i, v);
+ *   a.get(buf, first, count);        // one transfer per owning PE
+ *
+ *   xbr::write_all("a.bin", a);      // every PE writes its share
+ * \endcode
+ *
+ * Owner computation replaces the per-benchmark 'idx / ne' and
+ * 'index % npes' arithmetic. Every divisor is checked once at construction;
+ * when it is a power of two the division and modulo become a shift and a
+ * mask.
+ */
+
+#ifndef _XBRTIME_DIST_HPP_
+#define _XBRTIME_DIST_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "xbMrtime-sym.hpp"
+
+namespace xbr {
+
+namespace detail {
+
+/*!
+ * \brief Divisor known at run time with a power-of-two fast path
+ */
+class fast_divisor {
+public:
+  fast_divisor() = default;
+  explicit fast_divisor(size_t d) : d_(d ? d : 1) {
+    pow2_ = (d_ & (d_ - 1)) == 0;
+    shift_ = 0;
+    while (pow2_ && ((size_t)1 << shift_) != d_)
+      shift_++;
+  }
+
+  size_t value() const { return d_; }
+  bool pow2() const { return pow2_; }
+  size_t div(size_t x) const { return pow2_ ? x >> shift_ : x / d_; }
+  size_t mod(size_t x) const { return pow2_ ? x & (d_ - 1) : x % d_; }
+  size_t mul(size_t x) const { return pow2_ ? x << shift_ : x * d_; }
+
+  friend bool operator==(const fast_divisor &a, const fast_divisor &b) {
+    return a.d_ == b.d_;
+  }
+  friend bool operator!=(const fast_divisor &a, const fast_divisor &b) {
+    return a.d_ != b.d_;
+  }
+
+private:
+  size_t d_ = 1;
+  unsigned shift_ = 0;
+  bool pow2_ = true;
+};
+
+inline size_t clamp_sub(size_t x, size_t lo, size_t width) {
+  return x <= lo ? 0 : std::min(x - lo, width);
+}
+
+} // namespace detail
+
+/*! \brief Owner and local offset of one global element */
+struct locus {
+  int pe;
+  size_t offset;
+};
+
+/* ========================================================================= */
+/*                           DISTRIBUTIONS                                  */
+/* ========================================================================= */
+
+/*
+ * A distribution is bound to (n, npes) by the array and then answers:
+ *   locate(i)                 owner and local offset of global index i
+ *   global(pe, off)           global index of pe's local element 'off'
+ *   local_lower_bound(pe, i)  how many of pe's elements precede global i
+ *   local_capacity()          largest per-PE share
+ * On every PE the global index grows with the local offset, so the elements
+ * of any global range that live on one PE are a contiguous local run.
+ */
+
+/*! \brief Contiguous blocks of ceil(n / npes) elements per PE */
+class block {
+public:
+  static constexpr bool contiguous = true;
+
+  void bind(size_t n, int npes) {
+    b_ = detail::fast_divisor((n + npes - 1) / npes);
+  }
+  locus locate(size_t i) const { return {(int)b_.div(i), b_.mod(i)}; }
+  size_t global(int pe, size_t off) const { return b_.mul(pe) + off; }
+  size_t local_lower_bound(int pe, size_t i) const {
+    return detail::clamp_sub(i, b_.mul(pe), b_.value());
+  }
+  size_t local_capacity() const { return b_.value(); }
+
+  friend bool operator==(const block &a, const block &b) {
+    return a.b_ == b.b_;
+  }
+  friend bool operator!=(const block &a, const block &b) { return !(a == b); }
+
+private:
+  detail::fast_divisor b_;
+};
+
+/*! \brief Round robin: element i lives on PE i % npes */
+class cyclic {
+public:
+  static constexpr bool contiguous = false;
+
+  void bind(size_t n, int npes) {
+    p_ = detail::fast_divisor(npes);
+    cap_ = (n + npes - 1) / npes;
+  }
+  locus locate(size_t i) const { return {(int)p_.mod(i), p_.div(i)}; }
+  size_t global(int pe, size_t off) const { return p_.mul(off) + pe; }
+  size_t local_lower_bound(int pe, size_t i) const {
+    return i <= (size_t)pe ? 0 : p_.div(i - pe + p_.value() - 1);
+  }
+  size_t local_capacity() const { return cap_; }
+
+  friend bool operator==(const cyclic &a, const cyclic &b) {
+    return a.p_ == b.p_;
+  }
+  friend bool operator!=(const cyclic &a, const cyclic &b) { return !(a == b); }
+
+private:
+  detail::fast_divisor p_;
+  size_t cap_ = 0;
+};
+
+/*! \brief Blocks of 'bs' elements dealt round robin to the PEs */
+class block_cyclic {
+public:
+  static constexpr bool contiguous = false;
+
+  explicit block_cyclic(size_t bs = 64) : bs_(bs) {}
+
+  void bind(size_t n, int npes) {
+    p_ = detail::fast_divisor(npes);
+    cycle_ = detail::fast_divisor(bs_.value() * npes);
+    size_t blocks = (n + bs_.value() - 1) / bs_.value();
+    cap_ = bs_.mul((blocks + npes - 1) / npes);
+  }
+  locus locate(size_t i) const {
+    size_t blk = bs_.div(i);
+    return {(int)p_.mod(blk), bs_.mul(p_.div(blk)) + bs_.mod(i)};
+  }
+  size_t global(int pe, size_t off) const {
+    return bs_.mul(p_.mul(bs_.div(off)) + pe) + bs_.mod(off);
+  }
+  size_t local_lower_bound(int pe, size_t i) const {
+    return bs_.mul(cycle_.div(i)) +
+           detail::clamp_sub(cycle_.mod(i), bs_.mul(pe), bs_.value());
+  }
+  size_t local_capacity() const { return cap_; }
+
+  friend bool operator==(const block_cyclic &a, const block_cyclic &b) {
+    return a.bs_ == b.bs_ && a.p_ == b.p_;
+  }
+  friend bool operator!=(const block_cyclic &a, const block_cyclic &b) {
+    return !(a == b);
+  }
+
+private:
+  detail::fast_divisor bs_;
+  detail::fast_divisor p_;
+  detail::fast_divisor cycle_;
+  size_t cap_ = 0;
+};
+
+/* ========================================================================= */
+/*                           DISTRIBUTED ARRAY                              */
+/* ========================================================================= */
+
+/*!
+ * \brief Global array of 'n' elements distributed over all PEs
+ *
+ * Storage is one symmetric block of Dist::local_capacity() elements per
+ * PE. Like the other symmetric containers it is created and destroyed from
+ * outside the pool and is move-only.
+ */
+template <typename T, typename Dist = block> class dist_array {
+public:
+  typedef T value_type;
+  typedef Dist distribution_type;
+  typedef remote_ref<T> reference;
+
+  dist_array() = default;
+
+  /*!
+   * \param n Global number of elements
+   * \param dist Distribution policy (eg, block_cyclic(bs))
+   * \param align Alignment of every PE's share
+   */
+  explicit dist_array(size_t n, Dist dist = Dist{},
+                      std::align_val_t align = std::align_val_t{alignof(T)})
+      : n_(n), dist_(bound(dist, n)),
+        s_(std::max<size_t>(dist_.local_capacity(), 1), align) {}
+
+  dist_array(dist_array &&) noexcept = default;
+  dist_array &operator=(dist_array &&) noexcept = default;
+
+  size_t size() const { return n_; }
+  const Dist &distribution() const { return dist_; }
+
+  /* ---- index arithmetic */
+  locus locate(size_t i) const { return dist_.locate(i); }
+  int owner(size_t i) const { return dist_.locate(i).pe; }
+  size_t global_index(int pe, size_t off) const { return dist_.global(pe, off); }
+
+  /*! \brief Number of elements stored on 'pe' */
+  size_t local_size(int pe) const { return dist_.local_lower_bound(pe, n_); }
+  size_t local_size() const { return local_size(my_pe()); }
+
+  /*! \brief Start of pe's share */
+  T *local_data(int pe) const { return s_.data(pe); }
+  T *local_data() const { return s_.data(); }
+
+  /* ---- element access */
+  T get(size_t i) const {
+    locus l = dist_.locate(i);
+    if (l.pe == my_pe())
+      return s_.data(l.pe)[l.offset];
+    T v;
+    xbr::get(&v, s_.data(l.pe) + l.offset, 1, l.pe);
+    return v;
+  }
+
+  void put(size_t i, const T &v) const {
+    locus l = dist_.locate(i);
+    if (l.pe == my_pe()) {
+      s_.data(l.pe)[l.offset] = v;
+      return;
+    }
+    xbr::put(s_.data(l.pe) + l.offset, &v, 1, l.pe);
+  }
+
+  reference operator[](size_t i) const {
+    locus l = dist_.locate(i);
+    return reference(s_.data(l.pe) + l.offset, l.pe);
+  }
+
+  /* ---- bulk access */
+
+  /*! \brief Read global elements [first, first+count) into 'dest' */
+  void get(T *dest, size_t first, size_t count) const {
+    transfer(dest, first, count, false);
+  }
+
+  /*! \brief Write 'src' to global elements [first, first+count) */
+  void put(const T *src, size_t first, size_t count) const {
+    transfer(const_cast<T *>(src), first, count, true);
+  }
+
+private:
+  static Dist bound(Dist d, size_t n) {
+    d.bind(n, xbrtime_num_pes());
+    return d;
+  }
+
+  static int my_pe() {
+    int pe = xbrtime_mype();
+    return pe < 0 ? 0 : pe;
+  }
+
+  /*
+   * Each owner's part of the range is one contiguous local run and moves
+   * with a single transfer; for non-block layouts it is staged and then
+   * scattered to (or gathered from) its strided positions in 'buf'.
+   */
+  void transfer(T *buf, size_t first, size_t count, bool is_put) const {
+    size_t last = std::min(first + count, n_);
+    int npes = xbrtime_num_pes();
+    int me = my_pe();
+    std::vector<T> stage;
+
+    for (int pe = 0; pe < npes; pe++) {
+      size_t lo = dist_.local_lower_bound(pe, first);
+      size_t hi = dist_.local_lower_bound(pe, last);
+      if (lo >= hi)
+        continue;
+      size_t len = hi - lo;
+      T *remote = s_.data(pe) + lo;
+
+      if constexpr (Dist::contiguous) {
+        T *mine = buf + (dist_.global(pe, lo) - first);
+        if (pe == me && is_put)
+          std::copy(mine, mine + len, remote);
+        else if (pe == me)
+          std::copy(remote, remote + len, mine);
+        else if (is_put)
+          xbr::put(remote, mine, len, pe);
+        else
+          xbr::get(mine, remote, len, pe);
+      } else {
+        stage.resize(len);
+        if (is_put) {
+          for (size_t o = 0; o < len; o++)
+            stage[o] = buf[dist_.global(pe, lo + o) - first];
+          if (pe == me)
+            std::copy(stage.begin(), stage.end(), remote);
+          else
+            xbr::put(remote, stage.data(), len, pe);
+        } else {
+          if (pe == me)
+            std::copy(remote, remote + len, stage.begin());
+          else
+            xbr::get(stage.data(), remote, len, pe);
+          for (size_t o = 0; o < len; o++)
+            buf[dist_.global(pe, lo + o) - first] = stage[o];
+        }
+      }
+    }
+  }
+
+  size_t n_ = 0;
+  Dist dist_;
+  sym_vector<T> s_;
+};
+
+/* ========================================================================= */
+/*                           COLLECTIVE FILE I/O                            */
+/* ========================================================================= */
+
+namespace detail {
+
+template <typename T, typename Dist>
+int dist_file_io(int fd, const char *path, const dist_array<T, Dist> &a,
+                 off_t base, int aggregators, bool writing) {
+  static_assert(Dist::contiguous,
+                "file I/O needs each PE's share to be one run of the file");
+  static_assert(std::is_trivially_copyable_v<T>);
+  int npes = xbrtime_num_pes();
+  std::vector<void *> bufs(npes);
+  std::vector<size_t> counts(npes);
+  std::vector<off_t> offsets(npes);
+  for (int pe = 0; pe < npes; pe++) {
+    bufs[pe] = a.local_data(pe);
+    counts[pe] = a.local_size(pe) * sizeof(T);
+    offsets[pe] = base + (off_t)(a.global_index(pe, 0) * sizeof(T));
+  }
+  if (writing)
+    return path ? xbrtime_write_all_path(path, bufs.data(), counts.data(),
+                                         offsets.data(), aggregators)
+                : xbrtime_write_all(fd, bufs.data(), counts.data(),
+                                    offsets.data(), aggregators);
+  return path ? xbrtime_read_all_path(path, bufs.data(), counts.data(),
+                                      offsets.data(), aggregators)
+              : xbrtime_read_all(fd, bufs.data(), counts.data(),
+                                 offsets.data(), aggregators);
+}
+
+} // namespace detail
+
+/*!
+ * \brief Writes 'a' to a file in global order, element i at byte
+ *        base + i * sizeof(T), every PE writing its own share
+ *
+ * Collective; call it from outside the pool. Block distributions only.
+ */
+template <typename T, typename Dist>
+int write_all(int fd, const dist_array<T, Dist> &a, off_t base = 0,
+              int aggregators = XBRTIME_PIO_AUTO) {
+  return detail::dist_file_io(fd, nullptr, a, base, aggregators, true);
+}
+
+template <typename T, typename Dist>
+int write_all(const char *path, const dist_array<T, Dist> &a, off_t base = 0,
+              int aggregators = XBRTIME_PIO_AUTO) {
+  return detail::dist_file_io(-1, path, a, base, aggregators, true);
+}
+
+/*! \brief Reads 'a' back from the layout written by write_all() */
+template <typename T, typename Dist>
+int read_all(int fd, dist_array<T, Dist> &a, off_t base = 0,
+             int aggregators = XBRTIME_PIO_AUTO) {
+  return detail::dist_file_io(fd, nullptr, a, base, aggregators, false);
+}
+
+template <typename T, typename Dist>
+int read_all(const char *path, dist_array<T, Dist> &a, off_t base = 0,
+             int aggregators = XBRTIME_PIO_AUTO) {
+  return detail::dist_file_io(-1, path, a, base, aggregators, false);
+}
+
+} // namespace xbr
+
+#endif /* _XBRTIME_DIST_HPP_ */
+
+/* EOF */
@@ -0,0 +1,323 @@
+/*
+ * _XBRTIME_EPOCH_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-epoch.h
+ * \brief Deferred symmetric free with epoch-based reclamation
+ *
+ * A symmetric block may only be released once no PE can still be using
+ * it, which is why frees are usually fenced by two barriers:
+ *
+ * \code
+ *   xbrtime_barrier();
+ *   xbrtime_free( p );
+ *   xbrtime_barrier();
+ * \endcode
+ *
+ * xbrtime_free_deferred( p ) instead retires the block to the caller's
+ * limbo list and returns at once. The caller promises that no PE touches
+ * the block past its next barrier; the block is released once every PE
+ * has been seen quiescent twice since it was retired (the global epoch has
+ * moved on by two), by whichever list owner next passes a quiescent point.
+ *
+ * A PE is quiescent in xbrtime_barrier(), in the barriers of the
+ * topology-aware collectives, in xbrtime_quiesce(), and whenever it has no
+ * work queued or running. The main thread is quiescent in the same calls
+ * and while it waits for the PEs in a collective phase (eg
+ * xbr::detail::on_each_pe); the end of such a phase also releases what
+ * the idle PEs retired. xbrtime_close() releases whatever is left.
+ * Threads outside the pool all act as the main thread and share its
+ * limbo list, which they only touch under a lock.
+ */
+
+#ifndef _XBRTIME_EPOCH_H_
+#define _XBRTIME_EPOCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "threadpool.h"
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_asm_fence();
+
+extern volatile tpool_thread_t *threads;
+
+/* 'seen' of a participant that holds no references at all */
+#define __XBRTIME_EPOCH_OFFLINE UINT64_MAX
+
+/* a retired block and the global epoch it was retired in */
+typedef struct {
+  void     *ptr;
+  uint64_t  epoch;
+} __xbrtime_limbo_ent_t;
+
+/* one participant: its last observed epoch and its limbo list */
+typedef struct {
+  volatile uint64_t      seen;
+  __xbrtime_limbo_ent_t *ents;      /* retired blocks, oldest first */
+  size_t                 first;     /* oldest entry not yet released */
+  size_t                 n;         /* entries in use */
+  size_t                 cap;
+} __attribute__((aligned(64))) __xbrtime_limbo_t;
+
+typedef struct {
+  volatile uint64_t  epoch;
+  volatile uint64_t  pending;       /* entries on all limbo lists */
+  int                nslots;        /* one per PE, then the main thread */
+  __xbrtime_limbo_t *slots;
+  pthread_mutex_t    lock;          /* guards the main thread's list */
+} __xbrtime_epoch_t;
+
+extern __xbrtime_epoch_t __xbrtime_epoch;
+
+void xbrtime_quiesce( void );
+void xbrtime_free_deferred( void *ptr );
+size_t xbrtime_free_pending( void );
+void __xbrtime_epoch_phase( int begin );
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_epoch_t __xbrtime_epoch = { 0, 0, 0, NULL,
+                                      PTHREAD_MUTEX_INITIALIZER };
+
+/* the caller's participant: its PE, or the main thread */
+static __xbrtime_limbo_t *__xbrtime_epoch_self( void ){
+  int s = (tpool_self != NULL) ? (int)tpool_self->thread_id
+                               : __xbrtime_epoch.nslots - 1;
+  if( (__xbrtime_epoch.slots == NULL) || (s < 0) ||
+      (s >= __xbrtime_epoch.nslots) ){
+    return NULL;
+  }
+  return &__xbrtime_epoch.slots[s];
+}
+
+/* runs 'fn' on PE pe's participant if the PE has no work; returns idleness */
+static int __xbrtime_epoch_idle( int pe, void (*fn)( __xbrtime_limbo_t * ) ){
+  tpool_work_queue_t *wq = NULL;
+  int idle = 1;
+
+  if( threads == NULL ){
+    return 1;
+  }
+  wq = threads[pe].thread_queue;
+  pthread_mutex_lock( &wq->work_mutex );
+  idle = (wq->working_cnt == 0) && tpool_queue_empty( wq );
+  if( idle && (fn != NULL) ){
+    fn( &__xbrtime_epoch.slots[pe] );
+  }
+  pthread_mutex_unlock( &wq->work_mutex );
+  return idle;
+}
+
+/* moves the global epoch on if every participant has seen it */
+static void __xbrtime_epoch_advance( void ){
+  uint64_t e = __atomic_load_n( &__xbrtime_epoch.epoch, __ATOMIC_ACQUIRE );
+  int s = 0;
+
+  for( s = 0; s < __xbrtime_epoch.nslots; s++ ){
+    uint64_t seen = __atomic_load_n( &__xbrtime_epoch.slots[s].seen,
+                                     __ATOMIC_ACQUIRE );
+    if( (seen == e) || (seen == __XBRTIME_EPOCH_OFFLINE) ){
+      continue;
+    }
+    if( (s < __xbrtime_epoch.nslots - 1) && __xbrtime_epoch_idle( s, NULL ) ){
+      continue;
+    }
+    return;
+  }
+  __atomic_compare_exchange_n( &__xbrtime_epoch.epoch, &e, e + 1, 0,
+                               __ATOMIC_ACQ_REL, __ATOMIC_RELAXED );
+}
+
+/* releases the entries of 'l' retired two or more epochs ago */
+static void __xbrtime_epoch_reclaim( __xbrtime_limbo_t *l ){
+  uint64_t e = __atomic_load_n( &__xbrtime_epoch.epoch, __ATOMIC_ACQUIRE );
+  size_t done = 0;
+
+  while( (l->first < l->n) && (l->ents[l->first].epoch + 2 <= e) ){
+    xbrtime_free( l->ents[l->first].ptr );
+    l->first++;
+    done++;
+  }
+  if( l->first == l->n ){
+    l->first = 0;
+    l->n     = 0;
+  }
+  if( done != 0 ){
+    __atomic_sub_fetch( &__xbrtime_epoch.pending, done, __ATOMIC_RELAXED );
+  }
+}
+
+/* releases every entry of 'l'; nothing may be running */
+static void __xbrtime_epoch_drain( __xbrtime_limbo_t *l ){
+  size_t i = 0;
+  for( i = l->first; i < l->n; i++ ){
+    xbrtime_free( l->ents[i].ptr );
+  }
+  free( l->ents );
+  l->ents  = NULL;
+  l->first = 0;
+  l->n     = 0;
+  l->cap   = 0;
+}
+
+static void __xbrtime_epoch_fini( void ){
+  int s = 0;
+  for( s = 0; s < __xbrtime_epoch.nslots; s++ ){
+    __xbrtime_epoch_drain( &__xbrtime_epoch.slots[s] );
+  }
+  free( __xbrtime_epoch.slots );
+  __xbrtime_epoch.slots   = NULL;
+  __xbrtime_epoch.nslots  = 0;
+  __xbrtime_epoch.pending = 0;
+}
+
+/* sets up empty limbo lists for 'npes' PEs and the main thread */
+static int __xbrtime_epoch_init( int npes ){
+  size_t len = (size_t)(npes + 1) * sizeof( __xbrtime_limbo_t );
+
+  __xbrtime_epoch_fini();
+  if( npes <= 0 ){
+    return -1;
+  }
+  if( posix_memalign( (void **)&__xbrtime_epoch.slots, 64, len ) != 0 ){
+    __xbrtime_epoch.slots = NULL;
+    return -1;
+  }
+  memset( __xbrtime_epoch.slots, 0, len );
+  __xbrtime_epoch.nslots = npes + 1;
+  __xbrtime_epoch.epoch  = 0;
+  return 0;
+}
+
+/* ------------------------------------------------- PUBLIC EPOCH API */
+
+extern void xbrtime_quiesce( void ){
+  __xbrtime_limbo_t *l = __xbrtime_epoch_self();
+
+  if( l == NULL ){
+    return;
+  }
+  __atomic_store_n( &l->seen,
+                    __atomic_load_n( &__xbrtime_epoch.epoch, __ATOMIC_ACQUIRE ),
+                    __ATOMIC_RELEASE );
+  if( __atomic_load_n( &__xbrtime_epoch.pending, __ATOMIC_RELAXED ) == 0 ){
+    return;
+  }
+  __xbrtime_epoch_advance();
+  if( tpool_self == NULL ){
+    pthread_mutex_lock( &__xbrtime_epoch.lock );
+    __xbrtime_epoch_reclaim( l );
+    pthread_mutex_unlock( &__xbrtime_epoch.lock );
+  }else{
+    __xbrtime_epoch_reclaim( l );
+  }
+}
+
+/* appends 'ptr' to the limbo list 'l' */
+static void __xbrtime_epoch_retire( __xbrtime_limbo_t *l, void *ptr ){
+  __xbrtime_epoch_reclaim( l );
+  if( l->n == l->cap ){
+    if( l->first != 0 ){
+      memmove( l->ents, l->ents + l->first,
+               (l->n - l->first) * sizeof( __xbrtime_limbo_ent_t ) );
+      l->n -= l->first;
+      l->first = 0;
+    }else{
+      size_t cap = (l->cap == 0) ? 64 : 2 * l->cap;
+      __xbrtime_limbo_ent_t *e = (__xbrtime_limbo_ent_t *)realloc(
+        l->ents, cap * sizeof( __xbrtime_limbo_ent_t ) );
+      if( e == NULL ){
+        /* never release early: the block is leaked instead */
+        return;
+      }
+      l->ents = e;
+      l->cap  = cap;
+    }
+  }
+  l->ents[l->n].ptr   = ptr;
+  l->ents[l->n].epoch = __atomic_load_n( &__xbrtime_epoch.epoch,
+                                         __ATOMIC_ACQUIRE );
+  l->n++;
+  __atomic_add_fetch( &__xbrtime_epoch.pending, 1, __ATOMIC_RELAXED );
+}
+
+extern void xbrtime_free_deferred( void *ptr ){
+  __xbrtime_limbo_t *l = __xbrtime_epoch_self();
+
+  if( ptr == NULL ){
+    return;
+  }
+  if( l == NULL ){
+    /* no runtime: nothing else can be using the block */
+    xbrtime_free( ptr );
+    return;
+  }
+  if( tpool_self == NULL ){
+    pthread_mutex_lock( &__xbrtime_epoch.lock );
+    __xbrtime_epoch_retire( l, ptr );
+    pthread_mutex_unlock( &__xbrtime_epoch.lock );
+  }else{
+    __xbrtime_epoch_retire( l, ptr );
+  }
+}
+
+extern size_t xbrtime_free_pending( void ){
+  return (size_t)__atomic_load_n( &__xbrtime_epoch.pending, __ATOMIC_RELAXED );
+}
+
+/*
+ * brackets a collective phase run from the main thread: the main thread
+ * holds no references while it waits, and once the PEs are done it
+ * releases what they retired
+ */
+extern void __xbrtime_epoch_phase( int begin ){
+  __xbrtime_limbo_t *l = __xbrtime_epoch_self();
+  int pe = 0;
+
+  if( (l == NULL) || (tpool_self != NULL) ){
+    return;
+  }
+  if( begin ){
+    __atomic_store_n( &l->seen, __XBRTIME_EPOCH_OFFLINE, __ATOMIC_RELEASE );
+    return;
+  }
+  xbrtime_quiesce();
+  for( pe = 0; pe < __xbrtime_epoch.nslots - 1; pe++ ){
+    if( __xbrtime_epoch.slots[pe].n != 0 ){
+      __xbrtime_epoch_idle( pe, __xbrtime_epoch_reclaim );
+    }
+  }
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_EPOCH_H_ */
+
+/* EOF */
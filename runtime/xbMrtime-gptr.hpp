@@ -0,0 +1,228 @@
+/*
+ * xbMrtime-gptr.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-gptr.hpp
+ * \brief Global pointers into the xBGAS symmetric heap
+ *
+ * xbr::gptr<T> names an object by (PE, symmetric offset) and packs both
+ * into one 64-bit word, so linked distributed structures stay compact:
+ *
+ * \code
+ *   struct node { long key; xbr::gptr<node> next; };
+ *   xbr::gptr<node> p(pe, &nodes[i]);     // pe's copy of nodes[i]
+ *   node n = p.load();                    // local load if p is ours
+ *   p.store(n);
+ *   if (node *raw = p.local()) raw->key++;
+ * \endcode
+ *
+ * The offset is relative to a PE's partition, so a gptr is meaningful on
+ * every PE and can be stored in symmetric memory or shipped in a message.
+ * Offsets are 48 bits and PEs 16 bits; the all-zero value is the null
+ * pointer. The layout is that of xbrtime_gref_t, so xbr::malloc_local
+ * hands out gptrs to blocks in the caller's partition:
+ *
+ * \code
+ *   xbr::gptr<node> n = xbr::malloc_local<node>();   // no barrier
+ *   ...
+ *   xbr::free_local(n);                              // from any PE
+ * \endcode
+ */
+
+#ifndef _XBRTIME_GPTR_HPP_
+#define _XBRTIME_GPTR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "xbMrtime-sym.hpp"
+
+namespace xbr {
+
+template <typename T> class gptr {
+  static constexpr unsigned OFF_BITS = 48;
+  static constexpr uint64_t OFF_MASK = ((uint64_t)1 << OFF_BITS) - 1;
+
+public:
+  typedef T element_type;
+  typedef std::ptrdiff_t difference_type;
+
+  /*! \brief Null global pointer */
+  constexpr gptr() = default;
+  constexpr gptr(std::nullptr_t) {}
+
+  /*!
+   * \brief PE pe's copy of the symmetric object at 'addr'
+   * \param addr Any PE's copy of a symmetric object (eg, sym_vector data)
+   *
+   * Addresses outside the symmetric heap give the null pointer.
+   */
+  gptr(int pe, const T *addr) {
+    if (addr != nullptr && __xbrtime_heap_contains(addr))
+      bits_ = pack(pe, __xbrtime_heap_offset(addr));
+  }
+
+  /*! \brief Global pointer to the caller's copy of 'addr' */
+  explicit gptr(const T *addr) : gptr(my_pe(), addr) {}
+
+  /*! \brief Build from raw parts */
+  static gptr from_offset(int pe, size_t offset) {
+    gptr g;
+    g.bits_ = pack(pe, offset);
+    return g;
+  }
+
+  /*! \brief Adopt a C global reference */
+  static gptr from_gref(xbrtime_gref_t ref) {
+    gptr g;
+    g.bits_ = ref;
+    return g;
+  }
+
+  /*! \brief The same pointer as a C global reference */
+  xbrtime_gref_t gref() const { return bits_; }
+
+  int pe() const { return (int)(bits_ >> OFF_BITS) - 1; }
+  size_t offset() const { return (size_t)(bits_ & OFF_MASK); }
+  explicit operator bool() const { return bits_ != 0; }
+
+  /*!
+   * \brief Raw pointer to the target, or nullptr if it is not addressable
+   *
+   * Every PE's partition is mapped into this process, so any non-null gptr
+   * resolves; the caller's own partition is the cheap case.
+   */
+  T *local() const {
+    if (bits_ == 0)
+      return nullptr;
+    return static_cast<T *>(__xbrtime_heap_at(pe(), offset()));
+  }
+
+  /*! \brief True when the target lives in the caller's partition */
+  bool is_local() const { return bits_ != 0 && pe() == my_pe(); }
+
+  /* ---- access */
+
+  T load() const {
+    T *p = local();
+    if (pe() == my_pe())
+      return *p;
+    T v;
+    xbr::get(&v, p, 1, pe());
+    return v;
+  }
+
+  void store(const T &v) const {
+    T *p = local();
+    if (pe() == my_pe()) {
+      *p = v;
+      return;
+    }
+    xbr::put(p, &v, 1, pe());
+  }
+
+  /*! \brief Read n elements starting at the target into 'dest' */
+  void get(T *dest, size_t n) const { xbr::get(dest, local(), n, pe()); }
+
+  /*! \brief Write n elements from 'src' starting at the target */
+  void put(const T *src, size_t n) const { xbr::put(local(), src, n, pe()); }
+
+  remote_ref<T> operator*() const { return remote_ref<T>(local(), pe()); }
+  remote_ref<T> operator[](difference_type i) const {
+    return remote_ref<T>(local() + i, pe());
+  }
+
+  /* ---- arithmetic (within one PE's partition) */
+
+  gptr &operator+=(difference_type n) {
+    bits_ += (uint64_t)(n * (difference_type)sizeof(T));
+    return *this;
+  }
+  gptr &operator-=(difference_type n) { return *this += -n; }
+  gptr &operator++() { return *this += 1; }
+  gptr &operator--() { return *this -= 1; }
+  gptr operator++(int) { gptr t = *this; *this += 1; return t; }
+  gptr operator--(int) { gptr t = *this; *this -= 1; return t; }
+  friend gptr operator+(gptr g, difference_type n) { return g += n; }
+  friend gptr operator+(difference_type n, gptr g) { return g += n; }
+  friend gptr operator-(gptr g, difference_type n) { return g -= n; }
+
+  /*! \brief Distance in elements; both must point into the same PE */
+  friend difference_type operator-(const gptr &a, const gptr &b) {
+    return ((difference_type)a.offset() - (difference_type)b.offset()) /
+           (difference_type)sizeof(T);
+  }
+
+  /* ---- comparison (by PE, then offset) */
+
+  friend bool operator==(const gptr &a, const gptr &b) {
+    return a.bits_ == b.bits_;
+  }
+  friend bool operator!=(const gptr &a, const gptr &b) {
+    return a.bits_ != b.bits_;
+  }
+  friend bool operator<(const gptr &a, const gptr &b) {
+    return a.bits_ < b.bits_;
+  }
+  friend bool operator>(const gptr &a, const gptr &b) {
+    return a.bits_ > b.bits_;
+  }
+  friend bool operator<=(const gptr &a, const gptr &b) {
+    return a.bits_ <= b.bits_;
+  }
+  friend bool operator>=(const gptr &a, const gptr &b) {
+    return a.bits_ >= b.bits_;
+  }
+
+private:
+  static uint64_t pack(int pe, size_t offset) {
+    return ((uint64_t)(pe + 1) << OFF_BITS) | ((uint64_t)offset & OFF_MASK);
+  }
+
+  static int my_pe() {
+    int pe = xbrtime_mype();
+    return pe < 0 ? 0 : pe;
+  }
+
+  uint64_t bits_ = 0;
+};
+
+/*!
+ * \brief Allocate n objects in the caller's partition, without synchronizing
+ * \return Global pointer to them, null when out of memory
+ *
+ * The objects are not constructed: T must be trivially copyable.
+ */
+template <typename T> gptr<T> malloc_local(size_t n = 1) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "local allocations hold trivially copyable types");
+  if (n == 0 || n > SIZE_MAX / sizeof(T))
+    return gptr<T>();
+  return gptr<T>::from_gref(xbrtime_malloc_local(n * sizeof(T)));
+}
+
+/*! \brief Free a block of malloc_local(); any PE may call it */
+template <typename T> void free_local(gptr<T> p) {
+  xbrtime_free_local(p.gref());
+}
+
+static_assert(std::is_trivially_copyable<gptr<long>>::value,
+              "gptr must be trivially copyable");
+static_assert(sizeof(gptr<long>) == 8, "gptr must stay one word");
+
+} // namespace xbr
+
+#endif /* _XBRTIME_GPTR_HPP_ */
+
+/* EOF */
@@ -0,0 +1,346 @@
+/*
+ * xbMrtime-hashmap.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-hashmap.hpp
+ * \brief Distributed hash map on the xBGAS symmetric heap
+ *
+ * xbr::dist_hash_map<K, V> hashes every key to an owner PE and stores it in
+ * an open-addressing table (linear probing) in that PE's symmetric
+ * partition:
+ *
+ * \code
+ *   xbr::dist_hash_map<uint64_t, uint64_t> m(1 << 20);  // initial capacity
+ *   m.insert(k, v);                 // from any PE: remote CAS on the owner
+ *   uint64_t v; bool hit = m.find(k, &v);
+ *   m.insert_all(keys, vals, n);    // collective, shipped to owners in bulk
+ * \endcode
+ *
+ * A slot's key is claimed with a compare-and-swap to a reserved BUSY value,
+ * the value is written, and the key is then published. Readers that meet a
+ * BUSY slot wait for it, so a successful find always sees the value of the
+ * insert that published the key. Keys must be 4 or 8 byte integers; the
+ * two largest values are reserved.
+ *
+ * Growth is collective: grow() and insert_all() are called from outside the
+ * pool while no single-key operation is in flight. Keys never change owner
+ * on growth, so every PE rehashes its own table locally.
+ */
+
+#ifndef _XBRTIME_HASHMAP_HPP_
+#define _XBRTIME_HASHMAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "xbMrtime-dist.hpp"
+
+namespace xbr {
+
+namespace detail {
+
+/*! \brief 64-bit finalizer (splitmix64) applied on top of the user hash */
+inline uint64_t mix64(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+inline size_t next_pow2(size_t n) {
+  size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+} // namespace detail
+
+/*! \brief Result of a single-key insert */
+enum class insert_result {
+  inserted, /*!< the key was added */
+  exists,   /*!< the key was already present; its value is unchanged */
+  full      /*!< the owner's table is at its load limit; grow() and retry */
+};
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class dist_hash_map {
+  static_assert(std::is_integral<K>::value &&
+                    (sizeof(K) == 4 || sizeof(K) == 8),
+                "dist_hash_map keys are 4 or 8 byte integers");
+  static_assert(std::is_trivially_copyable<V>::value,
+                "dist_hash_map values are trivially copyable");
+
+public:
+  /*! \brief Reserved key marking an empty slot */
+  static constexpr K empty_key = std::numeric_limits<K>::max();
+  /*! \brief Reserved key marking a slot whose insert is in progress */
+  static constexpr K busy_key = std::numeric_limits<K>::max() - 1;
+
+  /*!
+   * \param capacity Initial number of slots per PE (rounded up to a power
+   *        of two)
+   * \param max_load Fraction of a table that may be filled before inserts
+   *        report insert_result::full
+   */
+  explicit dist_hash_map(size_t capacity = 1024, double max_load = 0.7)
+      : max_load_(max_load), owners_(xbrtime_num_pes()) {
+    allocate(detail::next_pow2(std::max<size_t>(capacity, 16)));
+  }
+
+  dist_hash_map(dist_hash_map &&) noexcept = default;
+  dist_hash_map &operator=(dist_hash_map &&) noexcept = default;
+
+  /*! \brief Slots per PE */
+  size_t capacity() const { return cap_; }
+
+  /*! \brief PE that owns 'key' */
+  int owner(const K &key) const { return (int)owners_.mod(hash(key) >> 32); }
+
+  /* ---- single-key operations (any PE) */
+
+  insert_result insert(const K &key, const V &value) const {
+    uint64_t h = hash(key);
+    int pe = (int)owners_.mod(h >> 32);
+    K *keys = keys_.data(pe);
+    unsigned long long *count = count_.data(pe);
+
+    if (atomic_fetch(count, pe) >= limit_)
+      return insert_result::full;
+    for (size_t i = 0; i < cap_; i++) {
+      size_t slot = (h + i) & (cap_ - 1);
+      K k = wait_ready(keys + slot, pe);
+      if (k == key)
+        return insert_result::exists;
+      if (k != empty_key)
+        continue;
+      K old = atomic_compare_swap(keys + slot, empty_key, busy_key, pe);
+      if (old == empty_key) {
+        xbr::put(vals_.data(pe) + slot, &value, 1, pe);
+        atomic_set(keys + slot, key, pe);
+        atomic_fetch_add(count, 1ull, pe);
+        return insert_result::inserted;
+      }
+      if (old == busy_key)
+        old = wait_ready(keys + slot, pe);
+      if (old == key)
+        return insert_result::exists;
+    }
+    return insert_result::full;
+  }
+
+  /*! \brief Look up 'key'; on a hit its value is stored to *value */
+  bool find(const K &key, V *value) const {
+    uint64_t h = hash(key);
+    int pe = (int)owners_.mod(h >> 32);
+    K *keys = keys_.data(pe);
+
+    for (size_t i = 0; i < cap_; i++) {
+      size_t slot = (h + i) & (cap_ - 1);
+      K k = wait_ready(keys + slot, pe);
+      if (k == empty_key)
+        return false;
+      if (k == key) {
+        if (value != nullptr)
+          xbr::get(value, vals_.data(pe) + slot, 1, pe);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool contains(const K &key) const { return find(key, nullptr); }
+
+  /* ---- collective operations (outside the pool) */
+
+  /*! \brief Total number of keys */
+  size_t size() const {
+    size_t n = 0;
+    for (int pe = 0; pe < xbrtime_num_pes(); pe++)
+      n += atomic_fetch(count_.data(pe), pe);
+    return n;
+  }
+
+  /*! \brief Double every PE's table (or grow to at least 'capacity') */
+  void grow(size_t capacity = 0) {
+    size_t cap = detail::next_pow2(std::max(capacity, cap_ * 2));
+    sym_vector<K> old_keys = std::move(keys_);
+    sym_vector<V> old_vals = std::move(vals_);
+    size_t old_cap = cap_;
+
+    allocate(cap);
+    detail::on_each_pe([&](int pe) {
+      const K *ok = old_keys.data(pe);
+      const V *ov = old_vals.data(pe);
+      unsigned long long n = 0;
+      for (size_t s = 0; s < old_cap; s++)
+        if (ok[s] != empty_key) {
+          insert_local(pe, ok[s], ov[s]);
+          n++;
+        }
+      count_.data(pe)[0] = n;
+    });
+  }
+
+  /*!
+   * \brief Insert n keys (and values) held by the caller
+   * \return Number of keys that were not present before
+   *
+   * Each PE takes a slice of the input, buckets it by owner and ships every
+   * bucket to its owner's inbox with one bulk put. Owners then insert their
+   * inbox locally; tables are grown first if the incoming keys could push
+   * any of them past the load limit.
+   */
+  size_t insert_all(const K *keys, const V *vals, size_t n) {
+    int npes = xbrtime_num_pes();
+    std::vector<size_t> counts((size_t)npes * npes, 0);
+    std::vector<std::vector<size_t>> order(npes);
+
+    /* bucket each slice by owner */
+    detail::on_each_pe([&](int pe) {
+      size_t lo, hi;
+      slice(n, pe, &lo, &hi);
+      size_t *c = &counts[(size_t)pe * npes];
+      std::vector<size_t> &o = order[pe];
+      o.resize(hi - lo);
+      std::vector<int> dst(hi - lo);
+      for (size_t i = lo; i < hi; i++)
+        c[dst[i - lo] = owner(keys[i])]++;
+      std::vector<size_t> at(npes, 0);
+      for (int d = 1; d < npes; d++)
+        at[d] = at[d - 1] + c[d - 1];
+      for (size_t i = lo; i < hi; i++)
+        o[at[dst[i - lo]]++] = i;
+    });
+
+    /* size the inboxes and make room for the worst case */
+    size_t inbox = 1;
+    size_t worst = 0;
+    for (int d = 0; d < npes; d++) {
+      size_t in = 0;
+      for (int s = 0; s < npes; s++)
+        in += counts[(size_t)s * npes + d];
+      inbox = std::max(inbox, in);
+      worst = std::max<size_t>(worst, in + count_.data(d)[0]);
+    }
+    if (worst > limit_)
+      grow((size_t)((double)worst / max_load_) + 1);
+    sym_vector<K> in_keys(inbox);
+    sym_vector<V> in_vals(inbox);
+
+    /* ship every bucket to its owner */
+    detail::on_each_pe([&](int pe) {
+      const size_t *c = &counts[(size_t)pe * npes];
+      std::vector<K> kb;
+      std::vector<V> vb;
+      size_t first = 0;
+      for (int d = 0; d < npes; d++) {
+        size_t at = 0;
+        for (int s = 0; s < pe; s++)
+          at += counts[(size_t)s * npes + d];
+        kb.resize(c[d]);
+        vb.resize(c[d]);
+        for (size_t j = 0; j < c[d]; j++) {
+          kb[j] = keys[order[pe][first + j]];
+          vb[j] = vals[order[pe][first + j]];
+        }
+        xbr::put(in_keys.data(d) + at, kb.data(), c[d], d);
+        xbr::put(in_vals.data(d) + at, vb.data(), c[d], d);
+        first += c[d];
+      }
+    });
+
+    /* owners insert their inbox */
+    std::vector<size_t> added(npes, 0);
+    detail::on_each_pe([&](int pe) {
+      size_t in = 0;
+      for (int s = 0; s < npes; s++)
+        in += counts[(size_t)s * npes + pe];
+      const K *k = in_keys.data(pe);
+      const V *v = in_vals.data(pe);
+      for (size_t i = 0; i < in; i++)
+        added[pe] += insert_local(pe, k[i], v[i]);
+      count_.data(pe)[0] += added[pe];
+    });
+
+    size_t total = 0;
+    for (int pe = 0; pe < npes; pe++)
+      total += added[pe];
+    return total;
+  }
+
+private:
+  uint64_t hash(const K &key) const {
+    return detail::mix64((uint64_t)Hash{}(key));
+  }
+
+  void allocate(size_t cap) {
+    cap_ = cap;
+    limit_ = (size_t)((double)cap * max_load_);
+    keys_ = sym_vector<K>(cap, empty_key);
+    vals_ = sym_vector<V>(cap);
+    if (count_.empty())
+      count_ = sym_vector<unsigned long long>(1, std::align_val_t{64});
+  }
+
+  static void slice(size_t n, int pe, size_t *lo, size_t *hi) {
+    int npes = xbrtime_num_pes();
+    *lo = n * (size_t)pe / npes;
+    *hi = n * (size_t)(pe + 1) / npes;
+  }
+
+  static K wait_ready(K *slot, int pe) {
+    K k;
+    while ((k = atomic_fetch(slot, pe)) == busy_key)
+      ;
+    return k;
+  }
+
+  /*! \brief Owner-side insert into its own table; returns 1 if added */
+  size_t insert_local(int pe, const K &key, const V &value) {
+    uint64_t h = hash(key);
+    K *keys = keys_.data(pe);
+    V *vals = vals_.data(pe);
+    for (size_t i = 0; i < cap_; i++) {
+      size_t slot = (h + i) & (cap_ - 1);
+      K k = keys[slot];
+      if (k == key)
+        return 0;
+      if (k == empty_key) {
+        vals[slot] = value;
+        keys[slot] = key;
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  double max_load_;
+  detail::fast_divisor owners_;
+  size_t cap_ = 0;
+  size_t limit_ = 0;
+  sym_vector<K> keys_;
+  sym_vector<V> vals_;
+  sym_vector<unsigned long long> count_;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_HASHMAP_HPP_ */
+
+/* EOF */
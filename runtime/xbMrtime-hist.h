@@ -0,0 +1,274 @@
+/*
+ * _XBRTIME_HIST_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-hist.h
+ * \brief Global histogram collective
+ *
+ * xbrtime_histogram() counts the keys held by every PE into one global
+ * histogram: local_keys[pe] holds n[pe] bin numbers, and bins[b] ends up
+ * with the number of keys equal to b over all PEs.
+ *
+ * \code
+ *   for( pe = 0; pe < npes; pe++ ){
+ *     keys[pe] = xbrtime_ptr( degree, pe );
+ *     n[pe]    = nlocal[pe];
+ *   }
+ *   xbrtime_histogram( keys, n, dist, maxdeg + 1 );
+ * \endcode
+ *
+ * Nothing is updated remotely per key. Each PE first bins its own keys
+ * into a private histogram, split into several interleaved copies for
+ * small bin counts so that runs of equal keys do not serialize on one
+ * counter. The private histograms are then reduce-scattered: every PE
+ * owns a slice of the bins and sums that slice over all PEs, reading the
+ * other PEs' counters in bulk. xbrtime_histogram_into() lets the caller
+ * choose the slices, eg the shares of an xbr::dist_array.
+ *
+ * Keys of nbins or more are not counted. Each PE holds a private copy of
+ * all nbins counters during the call. Both calls are collective: call
+ * them from outside the pool while no PE is running.
+ */
+
+#ifndef _XBRTIME_HIST_H_
+#define _XBRTIME_HIST_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-ckpt.h"
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_asm_fence();
+void __xbrtime_get_u8_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+
+/* one PE's share of a histogram */
+typedef struct {
+  const uint64_t   *keys;
+  size_t            n;
+  size_t            nbins;
+  uint64_t        **hists;     /* PE-indexed private histograms */
+  uint64_t         *out;       /* destination of this PE's slice */
+  size_t            first;     /* first bin of the slice */
+  size_t            count;     /* bins in the slice */
+  int               pe;
+  int               npes;
+  int               rtn;
+} __xbrtime_hist_job_t;
+
+#ifndef __XBRTIME_DECLARE_ONLY
+/*
+ * counts n keys into h[0..nbins), with h[nbins] collecting the keys out of
+ * range; 'lanes' (1 or 4) copies of nbins+1 counters follow each other at
+ * h and are folded into the first one
+ */
+static void __xbrtime_hist_bin( const uint64_t *keys, size_t n, size_t nbins,
+                                uint64_t *h, int lanes ){
+  size_t stride = nbins + 1;
+  size_t i = 0, b = 0;
+  int l = 0;
+
+  if( lanes == 4 ){
+    uint64_t *h0 = h;
+    uint64_t *h1 = h + stride;
+    uint64_t *h2 = h + 2 * stride;
+    uint64_t *h3 = h + 3 * stride;
+    for( ; i + 4 <= n; i += 4 ){
+      uint64_t k0 = keys[i];
+      uint64_t k1 = keys[i + 1];
+      uint64_t k2 = keys[i + 2];
+      uint64_t k3 = keys[i + 3];
+      h0[(k0 < nbins) ? k0 : nbins]++;
+      h1[(k1 < nbins) ? k1 : nbins]++;
+      h2[(k2 < nbins) ? k2 : nbins]++;
+      h3[(k3 < nbins) ? k3 : nbins]++;
+    }
+  }
+  for( ; i < n; i++ ){
+    h[(keys[i] < nbins) ? keys[i] : nbins]++;
+  }
+  for( l = 1; l < lanes; l++ ){
+    const uint64_t *__restrict src = h + (size_t)l * stride;
+    uint64_t *__restrict dst = h;
+    for( b = 0; b < stride; b++ ){
+      dst[b] += src[b];
+    }
+  }
+}
+
+/* phase 1: the private histogram of one PE */
+static void __xbrtime_hist_local( void *arg ){
+  __xbrtime_hist_job_t *j = (__xbrtime_hist_job_t *)arg;
+  int lanes = (j->nbins <= _XBRTIME_HIST_SPLIT_MAX_) ? 4 : 1;
+  size_t len = (size_t)lanes * (j->nbins + 1) * sizeof( uint64_t );
+  uint64_t *h = NULL;
+
+  if( posix_memalign( (void **)&h, 64, len ) != 0 ){
+    j->rtn = -1;
+    return;
+  }
+  memset( h, 0, len );
+  __xbrtime_hist_bin( j->keys, j->n, j->nbins, h, lanes );
+  j->hists[j->pe] = h;
+}
+
+/* phase 2: one PE sums its slice over every private histogram */
+static void __xbrtime_hist_slice( void *arg ){
+  __xbrtime_hist_job_t *j = (__xbrtime_hist_job_t *)arg;
+  uint64_t buf[_XBRTIME_HIST_CHUNK_];
+  size_t at = 0, k = 0;
+  int s = 0;
+
+  if( j->count == 0 ){
+    return;
+  }
+  memcpy( j->out, j->hists[j->pe] + j->first, j->count * sizeof( uint64_t ) );
+
+  /* start at a different PE on every PE to spread the reads */
+  for( s = 1; s < j->npes; s++ ){
+    int q = (j->pe + s) % j->npes;
+    for( at = 0; at < j->count; at += _XBRTIME_HIST_CHUNK_ ){
+      size_t len = j->count - at;
+      if( len > _XBRTIME_HIST_CHUNK_ ){
+        len = _XBRTIME_HIST_CHUNK_;
+      }
+      __xbrtime_get_u8_seq( (uint64_t *)(j->hists[q] + j->first + at), buf,
+                            (uint32_t)len, sizeof( uint64_t ) );
+      for( k = 0; k < len; k++ ){
+        j->out[at + k] += buf[k];
+      }
+    }
+  }
+}
+
+/* ------------------------------------------------- PUBLIC HISTOGRAM API */
+
+extern int xbrtime_histogram_into( const uint64_t *const *local_keys,
+                                   const size_t *n, size_t nbins,
+                                   uint64_t *const *slices,
+                                   const size_t *first,
+                                   const size_t *counts ){
+  int npes = __xbrtime_heap.npes;
+  __xbrtime_hist_job_t *jobs = NULL;
+  uint64_t **hists = NULL;
+  int pe = 0, rtn = 0;
+
+  if( (local_keys == NULL) || (n == NULL) || (slices == NULL) ||
+      (first == NULL) || (counts == NULL) || (nbins == 0) || (npes <= 0) ){
+    return -1;
+  }
+  for( pe = 0; pe < npes; pe++ ){
+    if( ((n[pe] != 0) && (local_keys[pe] == NULL)) ||
+        ((counts[pe] != 0) && (slices[pe] == NULL)) ||
+        (first[pe] > nbins) || (counts[pe] > nbins - first[pe]) ){
+      return -1;
+    }
+  }
+  jobs = (__xbrtime_hist_job_t *)calloc( (size_t)npes,
+                                         sizeof( __xbrtime_hist_job_t ) );
+  hists = (uint64_t **)calloc( (size_t)npes, sizeof( uint64_t * ) );
+  if( (jobs == NULL) || (hists == NULL) ){
+    free( jobs );
+    free( hists );
+    return -1;
+  }
+  for( pe = 0; pe < npes; pe++ ){
+    jobs[pe].keys  = local_keys[pe];
+    jobs[pe].n     = n[pe];
+    jobs[pe].nbins = nbins;
+    jobs[pe].hists = hists;
+    jobs[pe].out   = slices[pe];
+    jobs[pe].first = first[pe];
+    jobs[pe].count = counts[pe];
+    jobs[pe].pe    = pe;
+    jobs[pe].npes  = npes;
+  }
+
+  /* the keys reach memory before the PEs read them */
+  __xbrtime_asm_fence();
+  rtn = __xbrtime_run_on_pes( __xbrtime_hist_local, jobs,
+                              sizeof( __xbrtime_hist_job_t ), npes );
+  for( pe = 0; pe < npes; pe++ ){
+    rtn |= jobs[pe].rtn;
+  }
+  if( rtn == 0 ){
+    __xbrtime_asm_fence();
+    rtn = __xbrtime_run_on_pes( __xbrtime_hist_slice, jobs,
+                                sizeof( __xbrtime_hist_job_t ), npes );
+  }
+  xbrtime_cache_invalidate_all();
+  __xbrtime_asm_fence();
+
+  for( pe = 0; pe < npes; pe++ ){
+    free( hists[pe] );
+  }
+  free( hists );
+  free( jobs );
+  return (rtn == 0) ? 0 : -1;
+}
+
+extern int xbrtime_histogram( const uint64_t *const *local_keys,
+                              const size_t *n, uint64_t *bins,
+                              size_t nbins ){
+  int npes = __xbrtime_heap.npes;
+  uint64_t **slices = NULL;
+  size_t *first = NULL, *counts = NULL;
+  int pe = 0, rtn = 0;
+
+  if( (bins == NULL) || (npes <= 0) ){
+    return -1;
+  }
+  slices = (uint64_t **)calloc( (size_t)npes, sizeof( uint64_t * ) );
+  first  = (size_t *)calloc( (size_t)npes, sizeof( size_t ) );
+  counts = (size_t *)calloc( (size_t)npes, sizeof( size_t ) );
+  if( (slices == NULL) || (first == NULL) || (counts == NULL) ){
+    free( slices );
+    free( first );
+    free( counts );
+    return -1;
+  }
+  for( pe = 0; pe < npes; pe++ ){
+    first[pe]  = nbins * (size_t)pe / (size_t)npes;
+    counts[pe] = nbins * (size_t)(pe + 1) / (size_t)npes - first[pe];
+    slices[pe] = bins + first[pe];
+  }
+  rtn = xbrtime_histogram_into( local_keys, n, nbins, slices, first, counts );
+
+  free( slices );
+  free( first );
+  free( counts );
+  return rtn;
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_HIST_H_ */
+
+/* EOF */
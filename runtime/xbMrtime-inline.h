@@ -0,0 +1,475 @@
+/*
+ * _XBRTIME_INLINE_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-inline.h
+ * \brief Hot paths of the runtime
+ *
+ * xbrtime_mype(), xbrtime_num_pes() and the small gets and puts, with the
+ * remote read cache lookup they go through. These are called inside
+ * application loops, so a program linking libxbrtime (-DXBRTIME_LIB, see
+ * xbMrtime-macros.h) still gets them as static inline functions in every
+ * translation unit; everything else stays in the library.
+ */
+
+#ifndef _XBRTIME_INLINE_H_
+#define _XBRTIME_INLINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "xbMrtime-types.h"
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "threadpool.h"
+#include "xbMrtime-trace.h"
+#include <cheri.h>
+
+/* ------------------------------------------------- GLOBALS */
+extern XBRTIME_DATA *__XBRTIME_CONFIG;
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_asm_fence();
+void __xbrtime_asm_quiet_fence();
+void __xbrtime_get_u8_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+
+/* ------------------------------------------------- PE IDENTITY */
+
+__XBRTIME_HOT int xbrtime_mype(void) {
+  if (__XBRTIME_CONFIG == NULL) {
+    return -1;
+  }
+  // Work running on a PE's pool thread belongs to that PE
+  if (tpool_self != NULL) {
+    return (int)tpool_self->thread_id;
+  }
+  return __XBRTIME_CONFIG->_ID;
+}
+
+__XBRTIME_HOT int xbrtime_num_pes(void) {
+  if (__XBRTIME_CONFIG == NULL) {
+    return -1;
+  }
+  return __XBRTIME_CONFIG->_NPES;
+}
+
+/* ------------------------------------------------- REMOTE READ CACHE */
+
+/* the block at 'blk' in pe's partition, fetched on a miss */
+static inline const char *__xbrtime_cache_block( __xbrtime_cache_pe_t *c,
+                                                 int pe, size_t blk,
+                                                 __xbrtime_cache_region_t *r ){
+  size_t   block = __xbrtime_cache.block;
+  uint64_t tag   = ((uint64_t)(pe + 1) << 48) | (uint64_t)blk;
+  uint64_t epoch = __xbrtime_cache.epoch;
+  uint64_t gen   = r->gen;
+  size_t   idx   = (size_t)(((uint64_t)blk / block) ^
+                            ((uint64_t)pe * 0x9e3779b97f4a7c15ull >> 40)) &
+                   (__xbrtime_cache.nlines - 1);
+  __xbrtime_cache_line_t *l = &c->lines[idx];
+  char *data = c->data + idx * block;
+
+  if( (l->tag == tag) && (l->epoch == epoch) && (l->gen == gen) ){
+    c->stats.hits++;
+    return data;
+  }
+  c->stats.misses++;
+  __xbrtime_get_u8_seq( (uint64_t *)__xbrtime_heap_at( pe, blk ),
+                        (uint64_t *)data, (uint32_t)(block / 8), 8 );
+  l->tag   = tag;
+  l->epoch = epoch;
+  l->gen   = gen;
+  return data;
+}
+
+/*
+ * serves a get of 'nelems' elements of 'width' bytes, 'stride' elements
+ * apart, from the cache; returns 0 (and does nothing) when the source is
+ * not cacheable from the calling PE
+ *
+ */
+static inline int __xbrtime_cache_get( void *dest, const void *src,
+                                       size_t nelems, size_t width,
+                                       long stride ){
+  __xbrtime_cache_region_t *r = NULL;
+  __xbrtime_cache_pe_t *c = NULL;
+  size_t span = 0, off = 0, block = 0, i = 0;
+  int me = 0, pe = 0;
+
+  if( (__xbrtime_cache.nregions == 0) || (nelems == 0) || (stride < 1) ||
+      !__xbrtime_heap_contains( src ) ){
+    return 0;
+  }
+  /* a cache belongs to one pool thread; other threads read directly */
+  if( tpool_self == NULL ){
+    return 0;
+  }
+  me = (int)tpool_self->thread_id;
+  if( (me < 0) || (me >= __xbrtime_cache.npes) ){
+    return 0;
+  }
+  pe = (int)((size_t)((const char *)src - __xbrtime_heap.base) /
+             __xbrtime_heap.part_size);
+  if( pe == me ){
+    return 0;
+  }
+  off  = __xbrtime_heap_offset( src );
+  span = ((nelems - 1) * (size_t)stride + 1) * width;
+  if( (r = __xbrtime_cache_region( off, span )) == NULL ){
+    return 0;
+  }
+
+  c = &__xbrtime_cache.pes[me];
+  block = __xbrtime_cache.block;
+  if( span > (__xbrtime_cache.nlines * block) / 2 ){
+    c->stats.bypassed++;
+    return 0;
+  }
+  if( c->lines == NULL ){
+    c->lines = (__xbrtime_cache_line_t *)calloc( __xbrtime_cache.nlines,
+                                         sizeof( __xbrtime_cache_line_t ) );
+    if( (c->lines == NULL) ||
+        (posix_memalign( (void **)&c->data, block,
+                         __xbrtime_cache.nlines * block ) != 0) ){
+      free( c->lines );
+      c->lines = NULL;
+      c->data  = NULL;
+      return 0;
+    }
+  }
+  if( c->epoch != __xbrtime_cache.epoch ){
+    c->epoch = __xbrtime_cache.epoch;
+    c->stats.invalidations++;
+  }
+
+  /* contiguous gets copy block by block, strided ones element by element */
+  if( stride == 1 ){
+    width = span;
+    nelems = 1;
+  }
+  for( i = 0; i < nelems; i++ ){
+    size_t o = off + i * (size_t)stride * width;
+    size_t left = width;
+    char *d = (char *)dest + i * (size_t)stride * width;
+    while( left > 0 ){
+      size_t blk = o & ~(block - 1);
+      size_t n   = block - (o - blk);
+      if( n > left ){
+        n = left;
+      }
+      memcpy( d, __xbrtime_cache_block( c, pe, blk, r ) + (o - blk), n );
+      d += n;
+      o += n;
+      left -= n;
+    }
+  }
+  return 1;
+}
+
+/* ------------------------------------------------- SMALL GETS AND PUTS */
+
+// ------------------------------------------------------- FUNCTION PROTOTYPES
+void __xbrtime_get_u8_seq(uint64_t *base_src,
+                          uint64_t *base_dest, // uint32_t pe,
+                          uint32_t nelems, uint32_t stride);
+
+// ----------------------------------------------------- [xfer] U8 GET FUNCTION
+__XBRTIME_HOT void xbrtime_ulonglong_get(unsigned long long *dest,
+                                         const unsigned long long *src,
+                                         size_t nelems, int stride, int pe) {
+#ifdef XBGAS_PRINT
+  // printf("[R] Entered xbrtime_ulonglong_get()\n");
+  fflush(stdout);
+  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
+  fprintf(stdout, "==================================xbrtime_ulonglong_get\n");
+  fprintf(stdout,
+          "DST:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
+          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
+          (int)cheri_tag_get((void *)dest));
+  fprintf(stdout, "=======================================================\n");
+  fprintf(stdout,
+          "SRC:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)src), cheri_length_get((void *)src),
+          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
+          (int)cheri_tag_get((void *)src));
+  fprintf(stdout, "=======================================================\n");
+  fflush(stdout);
+#endif
+
+  __XBRTIME_TRACE_T0(t);
+
+  if (__xbrtime_cache_get(dest, src, nelems, sizeof(unsigned long long),
+                          stride)) {
+    __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(unsigned long long),
+                        nelems, stride, src);
+    return; /* served by the remote read cache */
+  }
+
+  if (nelems == 0) {
+    return;
+  } else /*if( (stride != 1) || (nelems == 1))*/ {
+    /* sequential execution */
+    // void* func_args = { (void*)src, (void*)dest, (void*)nelems,
+    //                     (void*)(stride*sizeof(unsigned long long)) };
+    //                   { (uint64_t*)src, (uint64_t*)(dest),
+    //                   (uint32_t)(nelems),
+    //                     (uint32_t)(stride*sizeof(unsigned long long)) };
+    //  XXX: multiple arguments do not pass to work!
+    // tpool_add_work(pool, __xbrtime_get_u8_seq, func_args);
+    __xbrtime_get_u8_seq((uint64_t *)src, //__xbrtime_ltor((uint64_t)(src),pe),
+                         (uint64_t *)(dest),
+                         // xbrtime_decode_pe(pe),
+                         (uint32_t)(nelems),
+                         (uint32_t)(stride * sizeof(unsigned long long)));
+    
+    // dest = *src;
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(unsigned long long),
+                      nelems, stride, src);
+
+#ifdef XBGAS_PRINT
+  // printf("[M] Exiting \n");
+#endif
+}
+
+// ------------------------------------------------------- FUNCTION PROTOTYPES
+void __xbrtime_get_s8_seq(uint64_t *base_src,
+                          uint64_t *base_dest, // uint32_t pe,
+                          uint32_t nelems, uint32_t stride);
+
+// ----------------------------------------------------- [xfer] S8 GET FUNCTION
+__XBRTIME_HOT void xbrtime_longlong_get(long long *dest, const long long *src,
+                                        size_t nelems, int stride, int pe) {
+#ifdef XBGAS_PRINT
+  // printf("[R] Entered xbrtime_ulonglong_get()\n");
+  fflush(stdout);
+  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
+  fprintf(stdout, "GET================================xbrtime_longlong_get\n");
+  fprintf(stdout,
+          "DST:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
+          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
+          (int)cheri_tag_get((void *)dest));
+  fprintf(stdout, "=======================================================\n");
+  fprintf(stdout,
+          "SRC:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)src), cheri_length_get((void *)src),
+          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
+          (int)cheri_tag_get((void *)src));
+  fprintf(stdout, "=======================================================\n");
+  fflush(stdout);
+#endif
+
+  __XBRTIME_TRACE_T0(t);
+
+  if (__xbrtime_cache_get(dest, src, nelems, sizeof(long long), stride)) {
+    __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(long long),
+                        nelems, stride, src);
+    return; /* served by the remote read cache */
+  }
+
+  if (nelems == 0) {
+    return;
+  } else /* if( (stride != 1) || (nelems == 1))*/ {
+    /* sequential execution */
+    
+    __xbrtime_get_s8_seq(
+        (uint64_t *)(src), //__xbrtime_ltor((uint64_t)(src),pe),
+        (uint64_t *)(dest),
+        // xbrtime_decode_pe(pe),
+        (uint32_t)(nelems), (uint32_t)(stride * sizeof(long long)));
+    
+    // dest = *src;
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(long long),
+                      nelems, stride, src);
+}
+
+// ------------------------------------------------------- FUNCTION PROTOTYPES
+void __xbrtime_put_s8_seq(uint64_t *base_src,
+                          uint64_t *base_dest, // uint32_t pe,
+                          uint32_t nelems, uint32_t stride);
+
+// ----------------------------------------------------- [xfer] S8 PUT FUNCTION
+__XBRTIME_HOT void xbrtime_longlong_put(long long *dest, const long long *src,
+                                        size_t nelems, int stride, int pe) {
+#ifdef XBGAS_PRINT
+  // printf("[R] Entered xbrtime_ulonglong_get()\n");
+  fflush(stdout);
+  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
+  fprintf(stdout, "===================================xbrtime_longlong_put\n");
+  fprintf(stdout,
+          "DST:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
+          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
+          (int)cheri_tag_get((void *)dest));
+  fprintf(stdout, "=======================================================\n");
+  fprintf(stdout,
+          "SRC:"
+          // "address: %p\n"
+          "\tbase  : %10lu"
+          "\tlength: %10lu\n"
+          "\toffset: %10lu"
+          "\tperms : %10u"
+          "\ttag   : %1d\n",
+          // cheri_address_get(dest),
+          cheri_base_get((void *)src), cheri_length_get((void *)src),
+          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
+          (int)cheri_tag_get((void *)src));
+  fprintf(stdout, "=======================================================\n");
+  fflush(stdout);
+#endif
+
+  __XBRTIME_TRACE_T0(t);
+
+  if (nelems == 0) {
+    return;
+  } else /* if( (stride != 1) || (nelems == 1))*/ {
+    /* sequential execution */
+    /*
+    __xbrtime_put_s8_seq(
+        (uint64_t *)(src),
+        (uint64_t *)(dest), //__xbrtime_ltor((uint64_t)(dest),pe),
+        // xbrtime_decode_pe(pe),
+        (uint32_t)(nelems), (uint32_t)(stride * sizeof(long long)));
+    */
+    // dest = *src;  (only ever rebound the local pointer; not valid C++)
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_PUT, 0, pe, sizeof(long long),
+                      nelems, stride, dest);
+}
+
+// ------------------------------------------------------- FUNCTION PROTOTYPES
+void __xbrtime_get_s4_seq(uint64_t *base_src,
+                          uint64_t *base_dest, // uint32_t pe,
+                          uint32_t nelems, uint32_t stride);
+// ---------------------------------------------------- [xfer] INT GET FUNCTION
+__XBRTIME_HOT void xbrtime_int_get(int *dest, const int *src, size_t nelems,
+                                   int stride, int pe) {
+#ifdef XBGAS_PRINT
+    // Similar debug printing code as in xbrtime_longlong_get
+#endif
+
+  __XBRTIME_TRACE_T0(t);
+
+  if (__xbrtime_cache_get(dest, src, nelems, sizeof(int), stride)) {
+    __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(int),
+                        nelems, stride, src);
+    return; /* served by the remote read cache */
+  }
+
+  if (nelems == 0) {
+    return;
+  } else {
+    // Sequential execution for int data type
+    __xbrtime_get_s4_seq(
+        (uint64_t *)(src), // Cast to int64_t* if necessary
+        (uint64_t *)(dest),
+        (uint32_t)(nelems), 
+        (uint32_t)(stride * sizeof(int))
+    );
+    // dest = *src;
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(int),
+                      nelems, stride, src);
+}
+
+// ------------------------------------------------------- FUNCTION PROTOTYPES
+void __xbrtime_put_s4_seq(uint64_t *base_src,
+                          uint64_t *base_dest, // uint32_t pe,
+                          uint32_t nelems, uint32_t stride);
+// ---------------------------------------------------- [xfer] INT PUT FUNCTION
+__XBRTIME_HOT void xbrtime_int_put(int *dest, const int *src, size_t nelems,
+                                   int stride, int pe) {
+#ifdef XBGAS_PRINT
+    // Similar debug printing code as in xbrtime_longlong_put
+#endif
+  __XBRTIME_TRACE_T0(t);
+
+  if (nelems == 0) {
+    return;
+  } else {
+    // Sequential execution for int data type
+    __xbrtime_put_s4_seq(
+        (uint64_t *)(src), // Cast to int64_t* if necessary
+        (uint64_t *)(dest),
+        (uint32_t)(nelems), 
+        (uint32_t)(stride * sizeof(int))
+    );
+    //  dest = *src;
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_PUT, 0, pe, sizeof(int),
+                      nelems, stride, dest);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_INLINE_H_ */
+
+/* EOF */
@@ -0,0 +1,437 @@
+/*
+ * _XBRTIME_LOCAL_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-local.h
+ * \brief Non-collective allocation in the caller's own partition
+ *
+ * xbrtime_malloc() is collective: every PE must make the same calls. A
+ * PE that grows a distributed structure on its own (queue nodes, request
+ * buffers) uses xbrtime_malloc_local() instead. It needs no other PE and
+ * returns a global reference that any PE may use:
+ *
+ * \code
+ *   xbrtime_gref_t g = xbrtime_malloc_local( sizeof( node_t ) );
+ *   node_t *n = (node_t *)xbrtime_gref_ptr( g );   // the owner's copy
+ *   n->next = XBRTIME_GREF_NULL;
+ *   ... ship g to another PE, which reads it with
+ *   xbrtime_int_get( &v, &n->key, 1, 1, xbrtime_gref_pe( g ) );
+ *   ... and any PE may eventually call
+ *   xbrtime_free_local( g );
+ * \endcode
+ *
+ * A global reference packs (PE, partition offset) into 64 bits exactly
+ * like xbr::gptr, so the two convert freely.
+ *
+ * Each PE, and the main thread, owns an allocator that takes chunks of
+ * _XBRTIME_LOCAL_CHUNK_ bytes and splits them into power-of-two size
+ * classes with a 16-byte header. The owner allocates and frees without
+ * atomics; a free from any other thread is pushed lock-free onto the
+ * owner's remote list, which the owner drains when a size class runs dry.
+ * Threads outside the pool all share the main thread's allocator, and
+ * use it under a lock.
+ * Allocations larger than _XBRTIME_LOCAL_MAX_ are rounded up to a power
+ * of two and carved whole.
+ *
+ * At initialization the runtime reserves a private block of up to
+ * _XBRTIME_LOCAL_RESERVE_ bytes at the top of the symmetric heap; PE p
+ * carves its chunks and large blocks from p's copy of it, without the
+ * heap's lock. Only once that range is used up, and for the main thread,
+ * do chunks and large blocks come from the symmetric heap itself, as
+ * private blocks. Like the reserved block, they stay out of checkpoints,
+ * the shared memory manifest and heap statistics.
+ *
+ * Local allocations do not survive xbrtime_close() and are not carried
+ * across a checkpoint restart.
+ */
+
+#ifndef _XBRTIME_LOCAL_H_
+#define _XBRTIME_LOCAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-trace.h"
+#include "threadpool.h"
+
+/*!
+ * \typedef xbrtime_gref_t
+ * \brief Global reference: PE + 1 in the top 16 bits, partition offset below
+ */
+typedef uint64_t xbrtime_gref_t;
+
+/*! \brief The null global reference */
+#define XBRTIME_GREF_NULL ((xbrtime_gref_t)0)
+
+#define __XBRTIME_GREF_OFF_BITS 48
+#define __XBRTIME_GREF_OFF_MASK ((1ull << __XBRTIME_GREF_OFF_BITS) - 1)
+
+/* size classes are 32 << cls bytes, header included */
+#define __XBRTIME_LOCAL_MIN     32
+#define __XBRTIME_LOCAL_CLASSES 32
+#define __XBRTIME_LOCAL_LARGE   0xffffffffu
+
+/* leads every local block; the payload follows */
+typedef struct {
+  uint32_t cls;       /* size class, or __XBRTIME_LOCAL_LARGE */
+  uint32_t slot;      /* allocator that owns the block */
+  uint64_t pad;
+} __xbrtime_local_hdr_t;
+
+/* one allocator; only 'remote' is written by other threads */
+typedef struct {
+  char *volatile remote;              /* blocks freed by other threads */
+  char *lists[__XBRTIME_LOCAL_CLASSES] __attribute__((aligned(64)));
+  char *bump;                         /* unused part of the current chunk */
+  char *end;
+  char *rbump;                        /* unused part of the reserved range */
+  char *rend;
+  size_t chunks;                      /* chunks started */
+} __attribute__((aligned(64))) __xbrtime_local_t;
+
+typedef struct {
+  int                nslots;          /* one per PE, then the main thread */
+  __xbrtime_local_t *slots;
+  size_t             reserve_off;     /* the reserved symmetric block */
+  size_t             reserve_len;     /* 0 when there is none */
+  pthread_mutex_t    lock;            /* guards the main thread's slot */
+} __xbrtime_local_heap_t;
+
+extern __xbrtime_local_heap_t __xbrtime_local;
+
+xbrtime_gref_t xbrtime_malloc_local( size_t sz );
+void xbrtime_free_local( xbrtime_gref_t ref );
+
+/* ------------------------------------------------- GLOBAL REFERENCES */
+
+__XBRTIME_HOT xbrtime_gref_t xbrtime_gref( int pe, const void *addr ){
+  if( (addr == NULL) || !__xbrtime_heap_contains( addr ) ||
+      (pe < 0) || (pe >= __xbrtime_heap.npes) ){
+    return XBRTIME_GREF_NULL;
+  }
+  return ((uint64_t)(pe + 1) << __XBRTIME_GREF_OFF_BITS) |
+         (uint64_t)__xbrtime_heap_offset( addr );
+}
+
+__XBRTIME_HOT int xbrtime_gref_pe( xbrtime_gref_t ref ){
+  return (int)(ref >> __XBRTIME_GREF_OFF_BITS) - 1;
+}
+
+__XBRTIME_HOT void *xbrtime_gref_ptr( xbrtime_gref_t ref ){
+  if( ref == XBRTIME_GREF_NULL ){
+    return NULL;
+  }
+  return __xbrtime_heap_at( xbrtime_gref_pe( ref ),
+                            (size_t)(ref & __XBRTIME_GREF_OFF_MASK) );
+}
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_local_heap_t __xbrtime_local = { 0, NULL, 0, 0,
+                                            PTHREAD_MUTEX_INITIALIZER };
+
+int xbrtime_mype();
+
+#define __XBRTIME_LOCAL_NEXT( b ) \
+  (*(char **)((b) + sizeof( __xbrtime_local_hdr_t )))
+
+/* the caller's allocator: its PE's, or the main thread's */
+static int __xbrtime_local_self( void ){
+  int s = (tpool_self != NULL) ? (int)tpool_self->thread_id
+                               : __xbrtime_local.nslots - 1;
+  if( (__xbrtime_local.slots == NULL) || (s < 0) ||
+      (s >= __xbrtime_local.nslots) ){
+    return -1;
+  }
+  return s;
+}
+
+/* partition allocator 's' carves its chunks from */
+static int __xbrtime_local_pe( int s ){
+  int pe = s;
+  if( s == __xbrtime_local.nslots - 1 ){
+    pe = xbrtime_mype();
+  }
+  return ((pe < 0) || (pe >= __xbrtime_heap.npes)) ? 0 : pe;
+}
+
+/* moves the blocks other threads freed onto the size class lists */
+static void __xbrtime_local_drain( __xbrtime_local_t *l ){
+  char *b = __atomic_exchange_n( &l->remote, NULL, __ATOMIC_ACQUIRE );
+  while( b != NULL ){
+    char *n = __XBRTIME_LOCAL_NEXT( b );
+    uint32_t cls = ((__xbrtime_local_hdr_t *)b)->cls;
+    __XBRTIME_LOCAL_NEXT( b ) = l->lists[cls];
+    l->lists[cls] = b;
+    b = n;
+  }
+}
+
+/* takes 'size' bytes from the reserved range of 'l', or NULL */
+static char *__xbrtime_local_carve( __xbrtime_local_t *l, size_t size ){
+  char *b = l->rbump;
+  if( (size_t)(l->rend - l->rbump) < size ){
+    return NULL;
+  }
+  l->rbump += size;
+  return b;
+}
+
+/* starts a new chunk; the rest of the old one goes to the free lists */
+static int __xbrtime_local_refill( __xbrtime_local_t *l, int pe ){
+  size_t off = 0;
+  char *c = NULL;
+
+  while( (size_t)(l->end - l->bump) >= __XBRTIME_LOCAL_MIN ){
+    size_t left = (size_t)(l->end - l->bump);
+    size_t size = __XBRTIME_LOCAL_MIN;
+    uint32_t cls = 0;
+    while( (size << 1) <= left ){
+      size <<= 1;
+      cls++;
+    }
+    ((__xbrtime_local_hdr_t *)l->bump)->cls = cls;
+    __XBRTIME_LOCAL_NEXT( l->bump ) = l->lists[cls];
+    l->lists[cls] = l->bump;
+    l->bump += size;
+  }
+  if( (c = __xbrtime_local_carve( l, _XBRTIME_LOCAL_CHUNK_ )) == NULL ){
+    if( __xbrtime_heap_alloc_private( _XBRTIME_LOCAL_CHUNK_,
+                                      _XBRTIME_LOCAL_CHUNK_, &off ) != 0 ){
+      return -1;
+    }
+    c = (char *)__xbrtime_heap_at( pe, off );
+  }
+  l->bump = c;
+  l->end  = c + _XBRTIME_LOCAL_CHUNK_;
+  l->chunks++;
+  return 0;
+}
+
+/*
+ * empties every allocator and reserves the block at the top of the heap
+ * that PE p carves from in its own partition
+ */
+static void __xbrtime_local_reserve( void ){
+  size_t len = _XBRTIME_LOCAL_RESERVE_;
+  int s = 0;
+
+  memset( __xbrtime_local.slots, 0,
+          (size_t)__xbrtime_local.nslots * sizeof( __xbrtime_local_t ) );
+  /* leave most of a small heap to symmetric allocations */
+  while( (len >= _XBRTIME_LOCAL_CHUNK_) &&
+         (len > __xbrtime_heap.part_size / 8) ){
+    len >>= 1;
+  }
+  __xbrtime_local.reserve_len = 0;
+  if( (len < _XBRTIME_LOCAL_CHUNK_) ||
+      (__xbrtime_heap_alloc_top( _XBRTIME_LOCAL_CHUNK_, len,
+                                 &__xbrtime_local.reserve_off ) != 0) ){
+    return;
+  }
+  __xbrtime_local.reserve_len = len;
+  for( s = 0; (s < __xbrtime_local.nslots - 1) &&
+              (s < __xbrtime_heap.npes); s++ ){
+    __xbrtime_local.slots[s].rbump =
+      (char *)__xbrtime_heap_at( s, __xbrtime_local.reserve_off );
+    __xbrtime_local.slots[s].rend =
+      __xbrtime_local.slots[s].rbump + len;
+  }
+}
+
+/*
+ * a restart replaced the heap's blocks, and the manifest never holds the
+ * reserved block: every local block is gone, so start over
+ */
+static void __xbrtime_local_restart( void ){
+  if( __xbrtime_local.slots != NULL ){
+    __xbrtime_local_reserve();
+  }
+}
+
+static void __xbrtime_local_fini( void ){
+  /* the chunks themselves go with the symmetric heap */
+  if( __xbrtime_local.reserve_len != 0 ){
+    __xbrtime_heap_release( __xbrtime_local.reserve_off );
+  }
+  __xbrtime_local.reserve_len = 0;
+  free( __xbrtime_local.slots );
+  __xbrtime_local.slots  = NULL;
+  __xbrtime_local.nslots = 0;
+}
+
+/* sets up empty allocators for 'npes' PEs and the main thread */
+static int __xbrtime_local_init( int npes ){
+  size_t len = (size_t)(npes + 1) * sizeof( __xbrtime_local_t );
+
+  __xbrtime_local_fini();
+  if( npes <= 0 ){
+    return -1;
+  }
+  if( posix_memalign( (void **)&__xbrtime_local.slots, 64, len ) != 0 ){
+    __xbrtime_local.slots = NULL;
+    return -1;
+  }
+  __xbrtime_local.nslots = npes + 1;
+  __xbrtime_local_reserve();
+  return 0;
+}
+
+/* a block of at least 'sz' bytes from allocator 's' in PE pe's partition */
+static __xbrtime_local_hdr_t *__xbrtime_local_get( int s, int pe, size_t sz ){
+  __xbrtime_local_t *l = &__xbrtime_local.slots[s];
+  __xbrtime_local_hdr_t *h = NULL;
+  size_t total = 0, size = __XBRTIME_LOCAL_MIN, off = 0;
+  uint32_t cls = 0;
+
+  total = __xbrtime_heap_align_up( sz, _XBRTIME_HEAP_ALIGN_ ) +
+          sizeof( __xbrtime_local_hdr_t );
+
+  while( (size < total) && (cls < __XBRTIME_LOCAL_CLASSES) ){
+    size <<= 1;
+    cls++;
+  }
+  if( cls < __XBRTIME_LOCAL_CLASSES ){
+    if( (l->lists[cls] == NULL) &&
+        (__atomic_load_n( &l->remote, __ATOMIC_RELAXED ) != NULL) ){
+      __xbrtime_local_drain( l );
+    }
+    if( l->lists[cls] != NULL ){
+      h = (__xbrtime_local_hdr_t *)l->lists[cls];
+      l->lists[cls] = __XBRTIME_LOCAL_NEXT( l->lists[cls] );
+    }else if( total > _XBRTIME_LOCAL_MAX_ ){
+      /* a large block comes whole from the reserved range */
+      h = (__xbrtime_local_hdr_t *)__xbrtime_local_carve( l, size );
+    }else{
+      if( ((size_t)(l->end - l->bump) < size) &&
+          (__xbrtime_local_refill( l, pe ) != 0) ){
+        return NULL;
+      }
+      h = (__xbrtime_local_hdr_t *)l->bump;
+      l->bump += size;
+    }
+  }
+  if( h != NULL ){
+    h->cls = cls;
+  }else{
+    /* the reserved range is used up: a block of the heap of its own */
+    if( __xbrtime_heap_alloc_private( _XBRTIME_HEAP_ALIGN_, total,
+                                      &off ) != 0 ){
+      return NULL;
+    }
+    h = (__xbrtime_local_hdr_t *)__xbrtime_heap_at( pe, off );
+    h->cls = __XBRTIME_LOCAL_LARGE;
+  }
+  h->slot = (uint32_t)s;
+  return h;
+}
+
+/* ------------------------------------------------- PUBLIC LOCAL ALLOCATION API */
+
+extern xbrtime_gref_t xbrtime_malloc_local( size_t sz ){
+  __xbrtime_local_hdr_t *h = NULL;
+  int s = __xbrtime_local_self();
+  int pe = 0;
+  __XBRTIME_TRACE_T0( t );
+
+  if( (s < 0) || (sz == 0) || (sz > __XBRTIME_GREF_OFF_MASK) ){
+    return XBRTIME_GREF_NULL;
+  }
+  pe = __xbrtime_local_pe( s );
+  if( s == __xbrtime_local.nslots - 1 ){
+    pthread_mutex_lock( &__xbrtime_local.lock );
+    h = __xbrtime_local_get( s, pe, sz );
+    pthread_mutex_unlock( &__xbrtime_local.lock );
+  }else{
+    h = __xbrtime_local_get( s, pe, sz );
+  }
+  if( h == NULL ){
+    return XBRTIME_GREF_NULL;
+  }
+  __XBRTIME_TRACE_REC( t, XBRTIME_TRACE_MALLOC_LOCAL, 0, pe, 1, sz, 0, h + 1 );
+  return xbrtime_gref( pe, h + 1 );
+}
+
+/* returns block 'b', which starts past its header, to its owner */
+static void __xbrtime_local_free( char *b ){
+  __xbrtime_local_hdr_t *h = NULL;
+  __xbrtime_local_t *l = NULL;
+  char *head = NULL;
+
+  if( (b == NULL) || (__xbrtime_local.slots == NULL) ){
+    return;
+  }
+  b -= sizeof( __xbrtime_local_hdr_t );
+  h  = (__xbrtime_local_hdr_t *)b;
+  if( h->slot >= (uint32_t)__xbrtime_local.nslots ){
+    return;
+  }
+  if( h->cls == __XBRTIME_LOCAL_LARGE ){
+    __xbrtime_cache_forget( __xbrtime_heap_offset( b ) );
+    __xbrtime_heap_release( __xbrtime_heap_offset( b ) );
+    return;
+  }
+
+  l = &__xbrtime_local.slots[h->slot];
+  if( (int)h->slot == __xbrtime_local_self() ){
+    if( h->slot == (uint32_t)__xbrtime_local.nslots - 1 ){
+      pthread_mutex_lock( &__xbrtime_local.lock );
+      __XBRTIME_LOCAL_NEXT( b ) = l->lists[h->cls];
+      l->lists[h->cls] = b;
+      pthread_mutex_unlock( &__xbrtime_local.lock );
+    }else{
+      __XBRTIME_LOCAL_NEXT( b ) = l->lists[h->cls];
+      l->lists[h->cls] = b;
+    }
+    return;
+  }
+
+  /* another thread's block: push it onto the owner's remote list */
+  head = __atomic_load_n( &l->remote, __ATOMIC_RELAXED );
+  do{
+    __XBRTIME_LOCAL_NEXT( b ) = head;
+  }while( !__atomic_compare_exchange_n( &l->remote, &head, b, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
+}
+
+extern void xbrtime_free_local( xbrtime_gref_t ref ){
+  char *b = (char *)xbrtime_gref_ptr( ref );
+  __XBRTIME_TRACE_T0( t );
+
+  if( b == NULL ){
+    return;
+  }
+  __xbrtime_local_free( b );
+  __XBRTIME_TRACE_REC( t, XBRTIME_TRACE_FREE_LOCAL, 0, -1, 1, 0, 0, b );
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_LOCAL_H_ */
+
+/* EOF */
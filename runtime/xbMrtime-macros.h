@@ -60,6 +60,230 @@ extern "C" {
  */
 #define _XBRTIME_MEM_SLOTS_ 2048
 
+#ifndef _XBRTIME_HEAP_SIZE_
+/**
+ * \brief Default size of each PE's symmetric heap partition (in bytes)
+ *
+ * Every PE owns one partition of this size; a symmetric allocation lives
+ * at the same offset in all of them.  The environment variable
+ * XBRTIME_HEAP_SIZE overrides this value at initialization.
+ */
+#define _XBRTIME_HEAP_SIZE_ (512ull * 1024ull * 1024ull)
+#endif
+
+/**
+ * \brief Minimum alignment of a symmetric heap allocation (in bytes)
+ *
+ * Matches the size of a Morello capability so that capabilities may be
+ * stored in symmetric memory.
+ */
+#define _XBRTIME_HEAP_ALIGN_ 16
+
+#ifndef _XBRTIME_HEAP_SCAN_
+/**
+ * \brief Free blocks of the next smaller size class an allocation checks
+ *
+ * Those may fit the request exactly; blocks of the larger classes always
+ * fit, so an allocation never looks at more than this many blocks.
+ */
+#define _XBRTIME_HEAP_SCAN_ 8
+#endif
+
+/* ========================================================================= */
+/*                           REMOTE READ CACHE                              */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_CACHE_BLOCK_
+/**
+ * \brief Default block size of the remote read cache (in bytes)
+ *
+ * A power of two between 16 bytes and the page size; the environment
+ * variable XBRTIME_CACHE_BLOCK overrides it at initialization.
+ */
+#define _XBRTIME_CACHE_BLOCK_ 64
+#endif
+
+#ifndef _XBRTIME_CACHE_LINES_
+/**
+ * \brief Default number of blocks held by each PE's remote read cache
+ *
+ * Rounded up to a power of two; XBRTIME_CACHE_LINES overrides it.
+ */
+#define _XBRTIME_CACHE_LINES_ 1024
+#endif
+
+/**
+ * \brief Maximum number of allocations that may be cacheable at once
+ */
+#define _XBRTIME_CACHE_REGIONS_ 64
+
+/* ========================================================================= */
+/*                           STREAMING READS                                */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_STREAM_CHUNK_
+/**
+ * \brief Default chunk size of a remote read stream (in bytes)
+ */
+#define _XBRTIME_STREAM_CHUNK_ (64 * 1024)
+#endif
+
+/* ========================================================================= */
+/*                           CHECKPOINT / RESTART                           */
+/* ========================================================================= */
+
+/**
+ * \brief Maximum number of allocations recorded in a heap manifest
+ *
+ * Bounds the header of a checkpoint file and of a named heap segment.
+ */
+#define _XBRTIME_MANIFEST_MAX_ 4096
+
+/**
+ * \brief Size of a single checkpoint read or write (in bytes)
+ */
+#define _XBRTIME_CKPT_IO_ (8ull * 1024ull * 1024ull)
+
+/* ========================================================================= */
+/*                           PARALLEL FILE I/O                              */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_PIO_STRIPE_
+/**
+ * \brief Default stripe size of collective file I/O (in bytes)
+ *
+ * File accesses are split at multiples of this size, and aggregators
+ * combine small pieces one stripe at a time. Match it to the stripe size
+ * of the file system; XBRTIME_PIO_STRIPE overrides it.
+ */
+#define _XBRTIME_PIO_STRIPE_ (1024 * 1024)
+#endif
+
+/**
+ * \brief PEs per aggregator when collective I/O picks aggregation itself
+ */
+#define _XBRTIME_PIO_AGGR_RATIO_ 4
+
+/* ========================================================================= */
+/*                           HISTOGRAM                                      */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_HIST_SPLIT_MAX_
+/**
+ * \brief Largest bin count binned into four interleaved private copies
+ *
+ * Spreading runs of equal keys over four counters keeps consecutive
+ * increments independent; above this size the copies no longer fit in
+ * cache and a single copy is used.
+ */
+#define _XBRTIME_HIST_SPLIT_MAX_ (64 * 1024)
+#endif
+
+/**
+ * \brief Counters read from another PE at a time by the reduce-scatter
+ */
+#define _XBRTIME_HIST_CHUNK_ 512
+
+/* ========================================================================= */
+/*                           TOPOLOGY-AWARE COLLECTIVES                     */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_COLL_SPIN_
+/**
+ * \brief Polls of a barrier flag before a waiting PE starts to yield
+ */
+#define _XBRTIME_COLL_SPIN_ 1024
+#endif
+
+/**
+ * \brief Bytes of another PE's buffer a reduction reads at a time
+ */
+#define _XBRTIME_COLL_CHUNK_ 4096
+
+/* ========================================================================= */
+/*                           LOCAL ALLOCATION                               */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_LOCAL_CHUNK_
+/**
+ * \brief Bytes a PE's local allocator starts a new chunk with
+ *
+ * A power of two. Chunks come from the PE's reserved range first; one
+ * taken from the symmetric heap is only touched in the owner's copy, so
+ * the other partitions spend address space on it but no memory.
+ */
+#define _XBRTIME_LOCAL_CHUNK_ (1024 * 1024)
+#endif
+
+#ifndef _XBRTIME_LOCAL_RESERVE_
+/**
+ * \brief Bytes at the top of its partition each PE's local allocator owns
+ *
+ * A multiple of _XBRTIME_LOCAL_CHUNK_, halved while it exceeds an eighth
+ * of the partition. Chunks and large blocks come from the symmetric heap
+ * only once this range is used up.
+ */
+#define _XBRTIME_LOCAL_RESERVE_ (64ull * 1024ull * 1024ull)
+#endif
+
+/**
+ * \brief Largest local allocation (header included) served from a chunk
+ *
+ * Larger ones are carved whole from the PE's reserved range.
+ */
+#define _XBRTIME_LOCAL_MAX_ (64 * 1024)
+
+/* ========================================================================= */
+/*                           TRACING                                        */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_TRACE_BUF_
+/**
+ * \brief Records a stream buffers before it writes them to the trace file
+ */
+#define _XBRTIME_TRACE_BUF_ 8192
+#endif
+
+/* ========================================================================= */
+/*                           BSP SUPERSTEPS                                 */
+/* ========================================================================= */
+
+#ifndef _XBRTIME_BSP_OPS_
+/**
+ * \brief Requests a PE's BSP queue holds before it first grows
+ */
+#define _XBRTIME_BSP_OPS_ 256
+#endif
+
+#ifndef _XBRTIME_BSP_DATA_
+/**
+ * \brief Bytes of put payload a PE's BSP queue holds before it first grows
+ */
+#define _XBRTIME_BSP_DATA_ 4096
+#endif
+
+/* ========================================================================= */
+/*                           LINKAGE                                        */
+/* ========================================================================= */
+
+/*
+ * By default every header defines the code it declares, so a program
+ * includes xbrtime_morello.h in exactly one translation unit. Programs
+ * built with -DXBRTIME_LIB link libxbrtime instead (runtime/Makefile):
+ * the headers then only declare the runtime state and cold paths, and
+ * keep the hot paths (xbrtime_mype, xbrtime_ptr, small gets and puts) as
+ * static inline functions that any number of translation units may
+ * include. runtime/xbrtime.c builds the library with XBRTIME_LIB_SOURCE.
+ */
+#if defined( XBRTIME_LIB ) && !defined( XBRTIME_LIB_SOURCE )
+/** \brief Set when the headers must not define cold code or state */
+#define __XBRTIME_DECLARE_ONLY 1
+/** \brief Linkage of the hot paths of the runtime */
+#define __XBRTIME_HOT static inline
+#else
+#define __XBRTIME_HOT
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,401 @@
+/*
+ * _XBRTIME_PIO_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-pio.h
+ * \brief Collective parallel I/O on one shared file
+ *
+ * xbrtime_write_all() and xbrtime_read_all() move one region of a file per
+ * PE: bufs[pe] holds counts[pe] bytes that live at file offset
+ * offsets[pe] (or packed in PE order when offsets is NULL). Regions may
+ * leave holes but must not overlap.
+ *
+ * \code
+ *   for( pe = 0; pe < npes; pe++ ){
+ *     bufs[pe]   = xbrtime_ptr( results, pe );
+ *     counts[pe] = nres[pe] * sizeof( double );
+ *   }
+ *   xbrtime_write_all_path( "out.bin", bufs, counts, NULL, XBRTIME_PIO_AUTO );
+ * \endcode
+ *
+ * Without aggregation every PE transfers its own region from its pool
+ * thread with pwrite()/pread(), split at stripe boundaries so that no
+ * request straddles a stripe. With 'aggregators' > 0 the file range is
+ * dealt out stripe by stripe to that many PEs instead; each one gathers
+ * the pieces falling into a stripe from their owners and issues one
+ * request per contiguous run, which turns many small pieces into few
+ * large, aligned requests. XBRTIME_PIO_AUTO aggregates when the average
+ * piece is smaller than a stripe.
+ *
+ * Both calls are collective: call them from outside the pool while no
+ * PE is running. The file descriptor must not be opened with O_DIRECT.
+ */
+
+#ifndef _XBRTIME_PIO_H_
+#define _XBRTIME_PIO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+#include "xbMrtime-stream.h"
+#include "xbMrtime-ckpt.h"
+
+/*! \brief Let collective I/O decide whether to aggregate */
+#define XBRTIME_PIO_AUTO (-1)
+
+/* one PE's region of the file */
+typedef struct {
+  off_t  off;
+  size_t count;
+  char  *buf;
+} __xbrtime_pio_piece_t;
+
+/* what a collective transfer does, shared by all PEs */
+typedef struct {
+  int                    fd;
+  int                    writing;
+  size_t                 stripe;
+  __xbrtime_pio_piece_t *pieces;    /* non-empty regions by file offset */
+  int                    n;
+  off_t                  lo;        /* first stripe touched */
+  size_t                 nstripes;
+  int                    naggr;
+} __xbrtime_pio_plan_t;
+
+/* one PE's share of a collective transfer */
+typedef struct {
+  const __xbrtime_pio_plan_t *plan;
+  __xbrtime_pio_piece_t       piece;   /* direct: the PE's own region */
+  int                         aggr;    /* aggregated: index, or -1 */
+  int                         rtn;
+} __xbrtime_pio_job_t;
+
+#ifndef __XBRTIME_DECLARE_ONLY
+static size_t __xbrtime_pio_stripe_size( void ){
+  const char *env = getenv( "XBRTIME_PIO_STRIPE" );
+  long long v = (env != NULL) ? atoll( env ) : 0;
+  return (v > 0) ? (size_t)v : (size_t)_XBRTIME_PIO_STRIPE_;
+}
+
+static int __xbrtime_pio_cmp( const void *a, const void *b ){
+  off_t x = ((const __xbrtime_pio_piece_t *)a)->off;
+  off_t y = ((const __xbrtime_pio_piece_t *)b)->off;
+  return (x > y) - (x < y);
+}
+
+/* moves one region, never letting a request cross a stripe boundary */
+static int __xbrtime_pio_span( const __xbrtime_pio_plan_t *plan,
+                               const __xbrtime_pio_piece_t *p ){
+  size_t stripe = plan->stripe;
+  size_t step = (_XBRTIME_CKPT_IO_ / stripe) * stripe;
+  size_t done = 0;
+
+  if( step == 0 ){
+    step = stripe;
+  }
+  while( done < p->count ){
+    off_t at = p->off + (off_t)done;
+    size_t left = p->count - done;
+    size_t n = stripe - (size_t)(at % (off_t)stripe);
+    if( (n == stripe) && (left >= stripe) ){
+      n = (left / stripe) * stripe;
+      if( n > step ){
+        n = step;
+      }
+    }
+    if( n > left ){
+      n = left;
+    }
+    if( __xbrtime_ckpt_xfer( plan->fd, plan->writing, p->buf + done, n,
+                             at ) != 0 ){
+      return -1;
+    }
+    done += n;
+  }
+  return 0;
+}
+
+/* first piece ending past 'at' */
+static int __xbrtime_pio_first( const __xbrtime_pio_plan_t *plan, off_t at ){
+  int lo = 0, hi = plan->n;
+  while( lo < hi ){
+    int mid = lo + (hi - lo) / 2;
+    const __xbrtime_pio_piece_t *p = &plan->pieces[mid];
+    if( p->off + (off_t)p->count <= at ){
+      lo = mid + 1;
+    }else{
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/*
+ * Moves one stripe through 'sbuf'. A write gathers the pieces and then
+ * writes each contiguous run; a read reads the runs and then scatters.
+ */
+static int __xbrtime_pio_stripe( const __xbrtime_pio_plan_t *plan,
+                                 char *sbuf, off_t sbeg ){
+  off_t send = sbeg + (off_t)plan->stripe;
+  int first = __xbrtime_pio_first( plan, sbeg );
+  int pass = 0, k = 0, rtn = 0;
+
+  for( pass = 0; pass < 2; pass++ ){
+    int io = (pass == 0) != plan->writing;
+    off_t rb = sbeg, re = sbeg;   /* pending run */
+
+    for( k = first; (k < plan->n) && (plan->pieces[k].off < send); k++ ){
+      const __xbrtime_pio_piece_t *p = &plan->pieces[k];
+      off_t b = p->off > sbeg ? p->off : sbeg;
+      off_t e = p->off + (off_t)p->count;
+      if( e > send ){
+        e = send;
+      }
+      if( !io ){
+        if( plan->writing ){
+          __xbrtime_copy_bytes( sbuf + (b - sbeg), p->buf + (b - p->off),
+                                (size_t)(e - b), 0 );
+        }else{
+          __xbrtime_copy_bytes( p->buf + (b - p->off), sbuf + (b - sbeg),
+                                (size_t)(e - b), 1 );
+        }
+        continue;
+      }
+      if( b != re ){
+        if( (re > rb) &&
+            (__xbrtime_ckpt_xfer( plan->fd, plan->writing, sbuf + (rb - sbeg),
+                                  (size_t)(re - rb), rb ) != 0) ){
+          rtn = -1;
+        }
+        rb = b;
+      }
+      re = e;
+    }
+    if( io && (re > rb) &&
+        (__xbrtime_ckpt_xfer( plan->fd, plan->writing, sbuf + (rb - sbeg),
+                              (size_t)(re - rb), rb ) != 0) ){
+      rtn = -1;
+    }
+    if( rtn != 0 ){
+      break;
+    }
+  }
+  return rtn;
+}
+
+static void __xbrtime_pio_job( void *arg ){
+  __xbrtime_pio_job_t *j = (__xbrtime_pio_job_t *)arg;
+  const __xbrtime_pio_plan_t *plan = j->plan;
+  char *sbuf = NULL;
+  size_t s = 0;
+
+  if( plan->naggr == 0 ){
+    j->rtn = (j->piece.count != 0) ? __xbrtime_pio_span( plan, &j->piece ) : 0;
+    return;
+  }
+  if( j->aggr < 0 ){
+    return;
+  }
+  if( posix_memalign( (void **)&sbuf, 64, plan->stripe ) != 0 ){
+    j->rtn = -1;
+    return;
+  }
+  for( s = (size_t)j->aggr; (s < plan->nstripes) && (j->rtn == 0);
+       s += (size_t)plan->naggr ){
+    j->rtn = __xbrtime_pio_stripe( plan, sbuf,
+                                   plan->lo + (off_t)(s * plan->stripe) );
+  }
+  free( sbuf );
+}
+
+static int __xbrtime_pio_run( int fd, int writing, char *const *bufs,
+                              const size_t *counts, const off_t *offsets,
+                              int aggregators ){
+  int npes = __xbrtime_heap.npes;
+  __xbrtime_pio_plan_t plan;
+  __xbrtime_pio_job_t *jobs = NULL;
+  off_t at = 0, hi = 0;
+  size_t total = 0;
+  int pe = 0, k = 0, rtn = 0;
+
+  if( (fd < 0) || (bufs == NULL) || (counts == NULL) || (npes <= 0) ){
+    return -1;
+  }
+  memset( &plan, 0, sizeof( plan ) );
+  plan.fd      = fd;
+  plan.writing = writing;
+  plan.stripe  = __xbrtime_pio_stripe_size();
+  plan.pieces  = (__xbrtime_pio_piece_t *)calloc( (size_t)npes,
+                                       sizeof( __xbrtime_pio_piece_t ) );
+  jobs = (__xbrtime_pio_job_t *)calloc( (size_t)npes,
+                                        sizeof( __xbrtime_pio_job_t ) );
+  if( (plan.pieces == NULL) || (jobs == NULL) ){
+    free( plan.pieces );
+    free( jobs );
+    return -1;
+  }
+
+  for( pe = 0; pe < npes; pe++ ){
+    off_t off = (offsets != NULL) ? offsets[pe] : at;
+    jobs[pe].plan        = &plan;
+    jobs[pe].aggr        = -1;
+    jobs[pe].piece.off   = off;
+    jobs[pe].piece.count = counts[pe];
+    jobs[pe].piece.buf   = bufs[pe];
+    if( (off < 0) || ((counts[pe] != 0) && (bufs[pe] == NULL)) ){
+      rtn = -1;
+    }
+    if( counts[pe] != 0 ){
+      plan.pieces[plan.n++] = jobs[pe].piece;
+      total += counts[pe];
+    }
+    at = off + (off_t)counts[pe];
+  }
+  qsort( plan.pieces, (size_t)plan.n, sizeof( __xbrtime_pio_piece_t ),
+         __xbrtime_pio_cmp );
+  for( k = 1; k < plan.n; k++ ){
+    if( plan.pieces[k].off <
+        plan.pieces[k - 1].off + (off_t)plan.pieces[k - 1].count ){
+      rtn = -1;
+    }
+  }
+  if( (rtn != 0) || (plan.n == 0) ){
+    free( plan.pieces );
+    free( jobs );
+    return rtn;
+  }
+
+  /* stripes are aligned to the start of the file */
+  hi = plan.pieces[plan.n - 1].off + (off_t)plan.pieces[plan.n - 1].count;
+  plan.lo = plan.pieces[0].off - (plan.pieces[0].off % (off_t)plan.stripe);
+  plan.nstripes = ((size_t)(hi - plan.lo) + plan.stripe - 1) / plan.stripe;
+
+  if( aggregators < 0 ){
+    aggregators = (total / (size_t)plan.n < plan.stripe)
+      ? (npes + _XBRTIME_PIO_AGGR_RATIO_ - 1) / _XBRTIME_PIO_AGGR_RATIO_
+      : 0;
+  }
+  if( aggregators > npes ){
+    aggregators = npes;
+  }
+  if( (size_t)aggregators > plan.nstripes ){
+    aggregators = (int)plan.nstripes;
+  }
+  plan.naggr = aggregators;
+  for( k = 0; k < plan.naggr; k++ ){
+    jobs[(int)(((long long)k * npes) / plan.naggr)].aggr = k;
+  }
+
+  /* stores made by the PEs reach memory before anyone reads them */
+  __xbrtime_asm_fence();
+  rtn = __xbrtime_run_on_pes( __xbrtime_pio_job, jobs,
+                              sizeof( __xbrtime_pio_job_t ), npes );
+  for( pe = 0; pe < npes; pe++ ){
+    rtn |= jobs[pe].rtn;
+  }
+  if( !writing ){
+    xbrtime_cache_invalidate_all();
+  }
+  __xbrtime_asm_fence();
+
+  free( plan.pieces );
+  free( jobs );
+  return (rtn == 0) ? 0 : -1;
+}
+
+/* ------------------------------------------------- PUBLIC PARALLEL I/O API */
+
+extern int xbrtime_write_all( int fd, const void *const *bufs,
+                              const size_t *counts, const off_t *offsets,
+                              int aggregators ){
+  return __xbrtime_pio_run( fd, 1, (char *const *)bufs, counts, offsets,
+                            aggregators );
+}
+
+extern int xbrtime_read_all( int fd, void *const *bufs, const size_t *counts,
+                             const off_t *offsets, int aggregators ){
+  return __xbrtime_pio_run( fd, 0, (char *const *)bufs, counts, offsets,
+                            aggregators );
+}
+
+extern int xbrtime_write_all_path( const char *path, const void *const *bufs,
+                                   const size_t *counts, const off_t *offsets,
+                                   int aggregators ){
+  off_t at = 0, end = 0;
+  int fd = -1, rtn = 0, pe = 0;
+
+  if( path == NULL ){
+    return -1;
+  }
+  if( (fd = open( path, O_WRONLY | O_CREAT, 0644 )) < 0 ){
+    return -1;
+  }
+  rtn = xbrtime_write_all( fd, bufs, counts, offsets, aggregators );
+
+  /* the file ends with the last region: an older, longer file loses its
+     tail, but bytes ahead of the regions (eg a header) stay */
+  for( pe = 0; (rtn == 0) && (pe < __xbrtime_heap.npes); pe++ ){
+    off_t off = (offsets != NULL) ? offsets[pe] : at;
+    at = off + (off_t)counts[pe];
+    if( (counts[pe] != 0) && (at > end) ){
+      end = at;
+    }
+  }
+  if( (rtn == 0) && (ftruncate( fd, end ) != 0) ){
+    rtn = -1;
+  }
+  if( close( fd ) != 0 ){
+    rtn = -1;
+  }
+  return rtn;
+}
+
+extern int xbrtime_read_all_path( const char *path, void *const *bufs,
+                                  const size_t *counts, const off_t *offsets,
+                                  int aggregators ){
+  int fd = -1, rtn = 0;
+
+  if( path == NULL ){
+    return -1;
+  }
+  if( (fd = open( path, O_RDONLY )) < 0 ){
+    return -1;
+  }
+  rtn = xbrtime_read_all( fd, bufs, counts, offsets, aggregators );
+  close( fd );
+  return rtn;
+}
+
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_PIO_H_ */
+
+/* EOF */
@@ -0,0 +1,347 @@
+/*
+ * _XBRTIME_RAND_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-rand.h
+ * \brief Counter-based random numbers for PEs
+ *
+ * xbrtime_rand_t draws from Philox4x32-10: the i-th 64-bit value of stream
+ * s under seed k is a fixed function of (k, s, i). Nothing is shared or
+ * locked, any PE can start any stream at any position, and a run draws
+ * the same numbers whatever the PE count if work is split by position
+ * rather than by PE:
+ *
+ * \code
+ *   xbrtime_rand_t r;
+ *   xbrtime_rand_init( &r, seed, 0 );                  // one global stream
+ *   xbrtime_rand_skip( &r, (uint64_t)xbrtime_mype() * per_pe );
+ *   xbrtime_rand_fill_range( &r, idx, per_pe, table_size );
+ * \endcode
+ *
+ * or with one independent stream per PE, xbrtime_rand_init( &r, seed,
+ * xbrtime_mype() ). xbrtime_rand_at() computes a single value directly.
+ *
+ * The HPCC RandomAccess generator (the GF(2) polynomial POLY shift
+ * register) is here too: xbrtime_hpcc_starts( n ) jumps to its n-th value
+ * in O(log n) steps, xbrtime_hpcc_next() takes one step.
+ *
+ * Everything is static inline and stateless apart from the caller's
+ * xbrtime_rand_t, so it needs no runtime and costs nothing unused.
+ */
+
+#ifndef _XBRTIME_RAND_H_
+#define _XBRTIME_RAND_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ------------------------------------------------- PHILOX4x32-10 */
+
+#define __XBRTIME_PHILOX_M0 0xD2511F53u
+#define __XBRTIME_PHILOX_M1 0xCD9E8D57u
+#define __XBRTIME_PHILOX_W0 0x9E3779B9u
+#define __XBRTIME_PHILOX_W1 0xBB67AE85u
+
+/* blocks computed side by side by the bulk fills */
+#define __XBRTIME_PHILOX_LANES 8
+
+/*!
+ * \struct xbrtime_rand_t
+ * \brief A position in one random stream
+ */
+typedef struct {
+  uint64_t key;     /*! seed */
+  uint64_t stream;  /*! stream number, eg a PE */
+  uint64_t ctr;     /*! next block; a block holds two values */
+  uint64_t spare;   /*! second value of the last block */
+  int      have;    /*! spare is still to be returned */
+} xbrtime_rand_t;
+
+/* ten Philox rounds on one block: counter (ctr, stream), key 'key' */
+static inline void __xbrtime_philox( uint64_t key, uint64_t stream,
+                                     uint64_t ctr, uint64_t out[2] ){
+  uint32_t c0 = (uint32_t)ctr, c1 = (uint32_t)(ctr >> 32);
+  uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+  uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+  int i = 0;
+
+  for( i = 0; i < 10; i++ ){
+    uint64_t p0 = (uint64_t)__XBRTIME_PHILOX_M0 * c0;
+    uint64_t p1 = (uint64_t)__XBRTIME_PHILOX_M1 * c2;
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    k0 += __XBRTIME_PHILOX_W0;
+    k1 += __XBRTIME_PHILOX_W1;
+  }
+  out[0] = ((uint64_t)c1 << 32) | c0;
+  out[1] = ((uint64_t)c3 << 32) | c2;
+}
+
+/*
+ * __XBRTIME_PHILOX_LANES consecutive blocks from 'ctr' into
+ * out[0 .. 2 * lanes); written lane by lane so the rounds vectorize
+ */
+static inline void __xbrtime_philox_lanes( uint64_t key, uint64_t stream,
+                                           uint64_t ctr, uint64_t *out ){
+  uint32_t c0[__XBRTIME_PHILOX_LANES], c1[__XBRTIME_PHILOX_LANES];
+  uint32_t c2[__XBRTIME_PHILOX_LANES], c3[__XBRTIME_PHILOX_LANES];
+  uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+  int i = 0, l = 0;
+
+  for( l = 0; l < __XBRTIME_PHILOX_LANES; l++ ){
+    c0[l] = (uint32_t)(ctr + (uint64_t)l);
+    c1[l] = (uint32_t)((ctr + (uint64_t)l) >> 32);
+    c2[l] = (uint32_t)stream;
+    c3[l] = (uint32_t)(stream >> 32);
+  }
+  for( i = 0; i < 10; i++ ){
+    for( l = 0; l < __XBRTIME_PHILOX_LANES; l++ ){
+      uint64_t p0 = (uint64_t)__XBRTIME_PHILOX_M0 * c0[l];
+      uint64_t p1 = (uint64_t)__XBRTIME_PHILOX_M1 * c2[l];
+      c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+      c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+      c1[l] = (uint32_t)p1;
+      c3[l] = (uint32_t)p0;
+    }
+    k0 += __XBRTIME_PHILOX_W0;
+    k1 += __XBRTIME_PHILOX_W1;
+  }
+  for( l = 0; l < __XBRTIME_PHILOX_LANES; l++ ){
+    out[2 * l]     = ((uint64_t)c1[l] << 32) | c0[l];
+    out[2 * l + 1] = ((uint64_t)c3[l] << 32) | c2[l];
+  }
+}
+
+/* maps 64 random bits 'x' onto [0, n) */
+static inline uint64_t __xbrtime_rand_scale( uint64_t x, uint64_t n ){
+  return (uint64_t)(((unsigned __int128)x * n) >> 64);
+}
+
+/* ------------------------------------------------- PUBLIC RANDOM API */
+
+/*!
+ * \brief Start stream 'stream' of seed 'seed' at its first value
+ */
+static inline void xbrtime_rand_init( xbrtime_rand_t *r, uint64_t seed,
+                                      uint64_t stream ){
+  r->key    = seed;
+  r->stream = stream;
+  r->ctr    = 0;
+  r->spare  = 0;
+  r->have   = 0;
+}
+
+/*!
+ * \brief Value 'index' of stream 'stream' of seed 'seed'
+ */
+static inline uint64_t xbrtime_rand_at( uint64_t seed, uint64_t stream,
+                                        uint64_t index ){
+  uint64_t b[2];
+  __xbrtime_philox( seed, stream, index >> 1, b );
+  return b[index & 1];
+}
+
+/*!
+ * \brief Values drawn from the stream so far
+ */
+static inline uint64_t xbrtime_rand_tell( const xbrtime_rand_t *r ){
+  return 2 * r->ctr - (uint64_t)r->have;
+}
+
+/*!
+ * \brief Move the stream to value 'index'
+ */
+static inline void xbrtime_rand_seek( xbrtime_rand_t *r, uint64_t index ){
+  uint64_t b[2];
+
+  r->ctr  = index >> 1;
+  r->have = 0;
+  if( index & 1 ){
+    __xbrtime_philox( r->key, r->stream, r->ctr++, b );
+    r->spare = b[1];
+    r->have  = 1;
+  }
+}
+
+/*!
+ * \brief Skip the next 'n' values of the stream in constant time
+ */
+static inline void xbrtime_rand_skip( xbrtime_rand_t *r, uint64_t n ){
+  xbrtime_rand_seek( r, xbrtime_rand_tell( r ) + n );
+}
+
+/*!
+ * \brief Next 64 random bits
+ */
+static inline uint64_t xbrtime_rand_u64( xbrtime_rand_t *r ){
+  uint64_t b[2];
+
+  if( r->have ){
+    r->have = 0;
+    return r->spare;
+  }
+  __xbrtime_philox( r->key, r->stream, r->ctr++, b );
+  r->spare = b[1];
+  r->have  = 1;
+  return b[0];
+}
+
+/*!
+ * \brief Next value in [0, n); n == 0 gives 0
+ *
+ * Multiply-shift: one value per call, so positions stay reproducible; the
+ * bias is below n / 2^64.
+ */
+static inline uint64_t xbrtime_rand_range( xbrtime_rand_t *r, uint64_t n ){
+  return __xbrtime_rand_scale( xbrtime_rand_u64( r ), n );
+}
+
+/*!
+ * \brief Next double in [0, 1)
+ */
+static inline double xbrtime_rand_double( xbrtime_rand_t *r ){
+  return (double)(xbrtime_rand_u64( r ) >> 11) * 0x1.0p-53;
+}
+
+/*!
+ * \brief Fill dst[0 .. n) with the next n values of the stream
+ *
+ * Whole runs of blocks are computed __XBRTIME_PHILOX_LANES at a time; the
+ * values are the ones n calls of xbrtime_rand_u64() would return.
+ */
+static inline void xbrtime_rand_fill( xbrtime_rand_t *r, uint64_t *dst,
+                                      size_t n ){
+  const size_t run = 2 * __XBRTIME_PHILOX_LANES;
+  size_t i = 0;
+
+  if( (n > 0) && r->have ){
+    dst[i++] = xbrtime_rand_u64( r );
+  }
+  for( ; i + run <= n; i += run ){
+    __xbrtime_philox_lanes( r->key, r->stream, r->ctr, dst + i );
+    r->ctr += __XBRTIME_PHILOX_LANES;
+  }
+  for( ; i < n; i++ ){
+    dst[i] = xbrtime_rand_u64( r );
+  }
+}
+
+/*!
+ * \brief Fill dst[0 .. n) with the next n values of the stream in [0, bound)
+ *
+ * The values of n calls of xbrtime_rand_range( r, bound ).
+ */
+static inline void xbrtime_rand_fill_range( xbrtime_rand_t *r, uint64_t *dst,
+                                            size_t n, uint64_t bound ){
+  size_t i = 0;
+
+  xbrtime_rand_fill( r, dst, n );
+  for( i = 0; i < n; i++ ){
+    dst[i] = __xbrtime_rand_scale( dst[i], bound );
+  }
+}
+
+/* ------------------------------------------------- HPCC RANDOMACCESS */
+
+/*! \brief Primitive polynomial of the HPCC RandomAccess generator */
+#define XBRTIME_HPCC_POLY   0x0000000000000007ULL
+/*! \brief Period of the HPCC RandomAccess generator */
+#define XBRTIME_HPCC_PERIOD 1317624576693539401LL
+
+/*!
+ * \brief Value after 'ran' in the HPCC RandomAccess sequence
+ */
+static inline uint64_t xbrtime_hpcc_next( uint64_t ran ){
+  return (ran << 1) ^ (((int64_t)ran < 0) ? XBRTIME_HPCC_POLY : 0);
+}
+
+/*!
+ * \brief Value 'n' of the HPCC RandomAccess sequence (HPCC starts())
+ *
+ * Squares the shift register by a precomputed table once per bit of n, so
+ * each PE starts its share of the updates where the serial run would be.
+ */
+static inline uint64_t xbrtime_hpcc_starts( int64_t n ){
+  uint64_t m2[64];
+  uint64_t temp = 0x1, ran = 0x2;
+  int i = 0, j = 0;
+
+  while( n < 0 ){
+    n += XBRTIME_HPCC_PERIOD;
+  }
+  while( n > XBRTIME_HPCC_PERIOD ){
+    n -= XBRTIME_HPCC_PERIOD;
+  }
+  if( n == 0 ){
+    return 0x1;
+  }
+
+  for( i = 0; i < 64; i++ ){
+    m2[i] = temp;
+    temp = xbrtime_hpcc_next( xbrtime_hpcc_next( temp ) );
+  }
+  for( i = 62; i >= 0; i-- ){
+    if( (n >> i) & 1 ){
+      break;
+    }
+  }
+  while( i > 0 ){
+    temp = 0;
+    for( j = 0; j < 64; j++ ){
+      if( (ran >> j) & 1 ){
+        temp ^= m2[j];
+      }
+    }
+    ran = temp;
+    i -= 1;
+    if( (n >> i) & 1 ){
+      ran = xbrtime_hpcc_next( ran );
+    }
+  }
+  return ran;
+}
+
+/*!
+ * \brief Fill dst[0 .. n) with the HPCC values after *ran; *ran moves on
+ */
+static inline void xbrtime_hpcc_fill( uint64_t *ran, uint64_t *dst,
+                                      size_t n ){
+  uint64_t v = *ran;
+  size_t i = 0;
+
+  for( i = 0; i < n; i++ ){
+    v = xbrtime_hpcc_next( v );
+    dst[i] = v;
+  }
+  *ran = v;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_RAND_H_ */
+
+/* EOF */
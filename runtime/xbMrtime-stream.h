@@ -0,0 +1,276 @@
+/*
+ * _XBRTIME_STREAM_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-stream.h
+ * \brief Double-buffered streaming reads of remote memory
+ *
+ * A stream reads a remote range in fixed-size chunks through two local
+ * buffers. While the caller consumes one chunk, the next one is already
+ * being fetched by the stream's transfer thread:
+ *
+ * \code
+ *   xbrtime_stream_t *s = xbrtime_stream_open( src, nbytes, pe, 1 << 20 );
+ *   const void *p;
+ *   size_t len;
+ *   while( (p = xbrtime_stream_next( s, &len )) != NULL ){
+ *     consume( p, len );
+ *   }
+ *   xbrtime_stream_close( s );
+ * \endcode
+ *
+ * A stream holds two chunks of local memory whatever the size of the
+ * range. A chunk returned by xbrtime_stream_next() stays valid until the
+ * following call. Opening a stream starts a thread, so streams pay off
+ * for scans of many chunks.
+ */
+
+#ifndef _XBRTIME_STREAM_H_
+#define _XBRTIME_STREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "xbMrtime-macros.h"
+#include "xbMrtime-alloc.h"
+
+/* ------------------------------------------------- FUNCTION PROTOTYPES */
+void __xbrtime_get_u1_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_get_u2_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_get_u4_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_get_u8_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_put_u1_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_put_u2_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_put_u4_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+void __xbrtime_put_u8_seq( uint64_t *base_src, uint64_t *base_dest,
+                           uint32_t nelems, uint32_t stride );
+
+/*!
+ * \struct xbrtime_stream_t
+ * \brief State of an open stream
+ *
+ * Chunk k lives in buf[k & 1]. Chunks [taken, issued) are requested;
+ * [taken, filled) are ready. The caller owns chunk taken-1.
+ */
+typedef struct xbrtime_stream {
+  const char     *src;       /* first byte of the remote range */
+  size_t          n;         /* bytes in the range */
+  size_t          chunk;     /* bytes per chunk */
+  size_t          nchunks;
+  char           *buf[2];
+  size_t          issued;    /* chunks requested from the transfer thread */
+  size_t          filled;    /* chunks fetched */
+  size_t          taken;     /* chunks handed to the caller */
+  int             quit;
+  pthread_t       helper;
+  pthread_mutex_t lock;
+  pthread_cond_t  cv;
+} xbrtime_stream_t;
+
+#ifndef __XBRTIME_DECLARE_ONLY
+/* moves 'len' bytes with the widest get (or put) kernel the alignment allows */
+static void __xbrtime_copy_bytes( char *dst, const char *src, size_t len,
+                                  int put ){
+  uintptr_t a = (uintptr_t)src | (uintptr_t)dst | (uintptr_t)len;
+  size_t w = (a & 7) == 0 ? 8 : (a & 3) == 0 ? 4 : (a & 1) == 0 ? 2 : 1;
+  size_t max = ((size_t)UINT32_MAX / w) * w;
+  uint64_t *s = NULL, *d = NULL;
+
+  while( len > 0 ){
+    size_t n = len < max ? len : max;
+    uint32_t nelems = (uint32_t)(n / w);
+    s = (uint64_t *)src;
+    d = (uint64_t *)dst;
+    switch( w ){
+    case 8:
+      put ? __xbrtime_put_u8_seq( s, d, nelems, 8 )
+          : __xbrtime_get_u8_seq( s, d, nelems, 8 );
+      break;
+    case 4:
+      put ? __xbrtime_put_u4_seq( s, d, nelems, 4 )
+          : __xbrtime_get_u4_seq( s, d, nelems, 4 );
+      break;
+    case 2:
+      put ? __xbrtime_put_u2_seq( s, d, nelems, 2 )
+          : __xbrtime_get_u2_seq( s, d, nelems, 2 );
+      break;
+    default:
+      put ? __xbrtime_put_u1_seq( s, d, nelems, 1 )
+          : __xbrtime_get_u1_seq( s, d, nelems, 1 );
+      break;
+    }
+    src += n;
+    dst += n;
+    len -= n;
+  }
+}
+
+static size_t __xbrtime_stream_len( const xbrtime_stream_t *s, size_t k ){
+  size_t off = k * s->chunk;
+  return (s->n - off) < s->chunk ? (s->n - off) : s->chunk;
+}
+
+/* transfer thread: fetches requested chunks in order */
+static void *__xbrtime_stream_helper( void *arg ){
+  xbrtime_stream_t *s = (xbrtime_stream_t *)arg;
+  size_t k = 0;
+
+  pthread_mutex_lock( &s->lock );
+  while( !s->quit ){
+    if( s->filled == s->issued ){
+      pthread_cond_wait( &s->cv, &s->lock );
+      continue;
+    }
+    k = s->filled;
+    pthread_mutex_unlock( &s->lock );
+    __xbrtime_copy_bytes( s->buf[k & 1], s->src + k * s->chunk,
+                          __xbrtime_stream_len( s, k ), 0 );
+    __xbrtime_asm_quiet_fence();
+    pthread_mutex_lock( &s->lock );
+    s->filled = k + 1;
+    pthread_cond_broadcast( &s->cv );
+  }
+  pthread_mutex_unlock( &s->lock );
+  return NULL;
+}
+
+/* ------------------------------------------------- PUBLIC STREAM API */
+
+extern xbrtime_stream_t *xbrtime_stream_open( const void *src, size_t n,
+                                              int pe, size_t chunk ){
+  xbrtime_stream_t *s = NULL;
+  const void *remote = NULL;
+
+  if( src == NULL ){
+    return NULL;
+  }
+  if( chunk == 0 ){
+    chunk = _XBRTIME_STREAM_CHUNK_;
+  }
+  if( chunk > n ){
+    chunk = (n == 0) ? 1 : n;
+  }
+
+  /* any PE's copy of a symmetric range names pe's copy */
+  remote = xbrtime_ptr( src, pe );
+  if( remote == NULL ){
+    remote = src;
+  }
+
+  s = (xbrtime_stream_t *)calloc( 1, sizeof( xbrtime_stream_t ) );
+  if( s == NULL ){
+    return NULL;
+  }
+  s->src     = (const char *)remote;
+  s->n       = n;
+  s->chunk   = chunk;
+  s->nchunks = (n + chunk - 1) / chunk;
+  if( (posix_memalign( (void **)&s->buf[0], 64, chunk ) != 0) ||
+      (posix_memalign( (void **)&s->buf[1], 64, chunk ) != 0) ){
+    free( s->buf[0] );
+    free( s );
+    return NULL;
+  }
+  pthread_mutex_init( &s->lock, NULL );
+  pthread_cond_init( &s->cv, NULL );
+
+  /* both buffers start out in flight */
+  s->issued = s->nchunks < 2 ? s->nchunks : 2;
+  if( pthread_create( &s->helper, NULL, __xbrtime_stream_helper, s ) != 0 ){
+    pthread_cond_destroy( &s->cv );
+    pthread_mutex_destroy( &s->lock );
+    free( s->buf[0] );
+    free( s->buf[1] );
+    free( s );
+    return NULL;
+  }
+  return s;
+}
+
+extern const void *xbrtime_stream_next( xbrtime_stream_t *s, size_t *len ){
+  const void *p = NULL;
+
+  if( s == NULL ){
+    return NULL;
+  }
+  pthread_mutex_lock( &s->lock );
+
+  /* the caller is done with chunk taken-1: refill its buffer */
+  if( (s->taken > 0) && (s->issued < s->nchunks) ){
+    s->issued++;
+    pthread_cond_broadcast( &s->cv );
+  }
+  if( s->taken == s->nchunks ){
+    pthread_mutex_unlock( &s->lock );
+    if( len != NULL ){
+      *len = 0;
+    }
+    return NULL;
+  }
+  while( s->filled <= s->taken ){
+    pthread_cond_wait( &s->cv, &s->lock );
+  }
+  p = s->buf[s->taken & 1];
+  if( len != NULL ){
+    *len = __xbrtime_stream_len( s, s->taken );
+  }
+  s->taken++;
+  pthread_mutex_unlock( &s->lock );
+
+  return p;
+}
+
+extern void xbrtime_stream_close( xbrtime_stream_t *s ){
+  if( s == NULL ){
+    return;
+  }
+  pthread_mutex_lock( &s->lock );
+  s->quit = 1;
+  pthread_cond_broadcast( &s->cv );
+  pthread_mutex_unlock( &s->lock );
+  pthread_join( s->helper, NULL );
+
+  pthread_cond_destroy( &s->cv );
+  pthread_mutex_destroy( &s->lock );
+  free( s->buf[0] );
+  free( s->buf[1] );
+  free( s );
+}
+
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_STREAM_H_ */
+
+/* EOF */
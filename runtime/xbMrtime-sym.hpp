@@ -0,0 +1,380 @@
+/*
+ * xbMrtime-sym.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-sym.hpp
+ * \brief RAII containers over the xBGAS symmetric heap
+ *
+ * xbr::sym_vector<T> and xbr::sym_array<T, N> own one symmetric allocation:
+ * every PE has its own copy of the elements at the same heap offset. The
+ * block is allocated when the container is constructed and released when it
+ * is destroyed; containers are move-only. remote(pe) returns a view of PE
+ * pe's copy whose bulk get/put map onto the contiguous transfer kernels:
+ *
+ * \code
+ *   xbr::sym_vector<double> v(n, std::align_val_t{64}); // on every PE
+ *   v[i] = x;                              // calling PE's copy
+ *   v.remote(pe).get(buf, first, count);   // bulk read of pe's copy
+ *   v.remote(pe)[i] = y;                   // single-element put
+ * \endcode
+ *
+ * Like xbrtime_malloc(), containers are created and destroyed from outside
+ * the pool; the elements may then be used from any PE's pool thread.
+ */
+
+#ifndef _XBRTIME_SYM_HPP_
+#define _XBRTIME_SYM_HPP_
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+#include "xbMrtime-typed.hpp"
+
+namespace xbr {
+
+/*! \brief Extent of a view whose length is only known at run time */
+inline constexpr size_t dynamic_extent = static_cast<size_t>(-1);
+
+/* ========================================================================= */
+/*                           REMOTE VIEWS                                   */
+/* ========================================================================= */
+
+/*!
+ * \brief Proxy for one element of a remote PE's copy
+ *
+ * Reading converts through xbr::get, assignment goes through xbr::put.
+ */
+template <typename T> class remote_ref {
+public:
+  remote_ref(T *p, int pe) : p_(p), pe_(pe) {}
+
+  operator T() const {
+    T v;
+    xbr::get(&v, p_, 1, pe_);
+    return v;
+  }
+  const remote_ref &operator=(const T &v) const {
+    xbr::put(p_, &v, 1, pe_);
+    return *this;
+  }
+  const remote_ref &operator=(const remote_ref &o) const {
+    return *this = static_cast<T>(o);
+  }
+
+private:
+  T *p_;
+  int pe_;
+};
+
+/*! \brief Random access iterator over a remote PE's copy */
+template <typename T> class remote_iterator {
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef remote_ref<T> reference;
+  typedef void pointer;
+
+  remote_iterator() = default;
+  remote_iterator(T *p, int pe) : p_(p), pe_(pe) {}
+
+  reference operator*() const { return reference(p_, pe_); }
+  reference operator[](difference_type n) const {
+    return reference(p_ + n, pe_);
+  }
+
+  remote_iterator &operator++() { ++p_; return *this; }
+  remote_iterator operator++(int) { remote_iterator t = *this; ++p_; return t; }
+  remote_iterator &operator--() { --p_; return *this; }
+  remote_iterator operator--(int) { remote_iterator t = *this; --p_; return t; }
+  remote_iterator &operator+=(difference_type n) { p_ += n; return *this; }
+  remote_iterator &operator-=(difference_type n) { p_ -= n; return *this; }
+  friend remote_iterator operator+(remote_iterator it, difference_type n) {
+    return it += n;
+  }
+  friend remote_iterator operator+(difference_type n, remote_iterator it) {
+    return it += n;
+  }
+  friend remote_iterator operator-(remote_iterator it, difference_type n) {
+    return it -= n;
+  }
+  friend difference_type operator-(const remote_iterator &a,
+                                   const remote_iterator &b) {
+    return a.p_ - b.p_;
+  }
+  friend bool operator==(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ == b.p_;
+  }
+  friend bool operator!=(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ != b.p_;
+  }
+  friend bool operator<(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ < b.p_;
+  }
+  friend bool operator>(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ > b.p_;
+  }
+  friend bool operator<=(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ <= b.p_;
+  }
+  friend bool operator>=(const remote_iterator &a, const remote_iterator &b) {
+    return a.p_ >= b.p_;
+  }
+
+private:
+  T *p_ = nullptr;
+  int pe_ = 0;
+};
+
+/*!
+ * \brief View of one PE's copy of a symmetric container
+ *
+ * Ranges are given in elements and are not bounds checked. With a fixed
+ * Extent the whole-view get/put use the compile-time count transfers.
+ */
+template <typename T, size_t Extent = dynamic_extent> class remote_view {
+public:
+  typedef T value_type;
+  typedef remote_ref<T> reference;
+  typedef remote_iterator<T> iterator;
+
+  remote_view(T *data, size_t n, int pe) : data_(data), n_(n), pe_(pe) {}
+
+  int pe() const { return pe_; }
+  size_t size() const { return Extent == dynamic_extent ? n_ : Extent; }
+  T *data() const { return data_; }
+
+  /*! \brief Read 'count' elements starting at 'first' into 'dest' */
+  void get(T *dest, size_t first, size_t count) const {
+    xbr::get(dest, data_ + first, count, pe_);
+  }
+
+  /*! \brief Write 'count' elements from 'src' starting at 'first' */
+  void put(const T *src, size_t first, size_t count) const {
+    xbr::put(data_ + first, src, count, pe_);
+  }
+
+  /*! \brief Read the whole view into 'dest' */
+  void get(T *dest) const {
+    if constexpr (Extent == dynamic_extent)
+      xbr::get(dest, data_, n_, pe_);
+    else
+      xbr::get(dest, data_, std::integral_constant<size_t, Extent>{}, pe_);
+  }
+
+  /*! \brief Overwrite the whole view from 'src' */
+  void put(const T *src) const {
+    if constexpr (Extent == dynamic_extent)
+      xbr::put(data_, src, n_, pe_);
+    else
+      xbr::put(data_, src, std::integral_constant<size_t, Extent>{}, pe_);
+  }
+
+  reference operator[](size_t i) const { return reference(data_ + i, pe_); }
+  iterator begin() const { return iterator(data_, pe_); }
+  iterator end() const { return iterator(data_ + size(), pe_); }
+
+private:
+  T *data_;
+  size_t n_;
+  int pe_;
+};
+
+/* ========================================================================= */
+/*                           SYMMETRIC STORAGE                              */
+/* ========================================================================= */
+
+namespace detail {
+
+/*!
+ * \brief Owner of one symmetric block of 'n' elements per PE
+ *
+ * Only the calling PE's address is kept; other copies are found with
+ * xbrtime_ptr(). Each PE value-initializes its own copy on its pool thread
+ * so that the pages are first touched by the PE that owns them.
+ */
+template <typename T> class sym_storage {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "symmetric containers hold trivially copyable types");
+
+public:
+  sym_storage() noexcept = default;
+  sym_storage(size_t n, size_t align, const T &value) : n_(n) {
+    if (n == 0)
+      return;
+    if (align < alignof(T))
+      align = alignof(T);
+    base_ = static_cast<T *>(xbrtime_malloc_aligned(align, n * sizeof(T)));
+    if (base_ == nullptr)
+      throw std::bad_alloc();
+    on_each_pe([&](int pe) {
+      T *p = copy_of(pe);
+      for (size_t i = 0; i < n_; i++)
+        p[i] = value;
+    });
+    __xbrtime_asm_fence();
+  }
+  ~sym_storage() { release(); }
+
+  sym_storage(const sym_storage &) = delete;
+  sym_storage &operator=(const sym_storage &) = delete;
+
+  sym_storage(sym_storage &&o) noexcept : base_(o.base_), n_(o.n_) {
+    o.base_ = nullptr;
+    o.n_ = 0;
+  }
+  sym_storage &operator=(sym_storage &&o) noexcept {
+    if (this != &o) {
+      release();
+      base_ = o.base_;
+      n_ = o.n_;
+      o.base_ = nullptr;
+      o.n_ = 0;
+    }
+    return *this;
+  }
+
+  size_t size() const { return n_; }
+
+  /*! \brief Address of PE pe's copy */
+  T *copy_of(int pe) const {
+    if (base_ == nullptr)
+      return nullptr;
+    T *p = static_cast<T *>(xbrtime_ptr(base_, pe));
+    return p != nullptr ? p : base_;
+  }
+
+  /*! \brief Address of the calling PE's copy */
+  T *local() const {
+    int pe = xbrtime_mype();
+    return copy_of(pe < 0 ? 0 : pe);
+  }
+
+  void release() {
+    if (base_ != nullptr)
+      xbrtime_free(base_);
+    base_ = nullptr;
+    n_ = 0;
+  }
+
+private:
+  T *base_ = nullptr;
+  size_t n_ = 0;
+};
+
+} // namespace detail
+
+/* ========================================================================= */
+/*                           SYMMETRIC CONTAINERS                           */
+/* ========================================================================= */
+
+/*!
+ * \brief Run-time sized symmetric array: 'n' elements on every PE
+ *
+ * Element access, data() and begin()/end() refer to the calling PE's copy,
+ * so the same code run on every PE's pool thread touches local memory.
+ */
+template <typename T> class sym_vector {
+public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  sym_vector() noexcept = default;
+
+  /*!
+   * \param n Number of elements per PE
+   * \param align Alignment of the block on every PE (a power of two)
+   */
+  explicit sym_vector(size_t n,
+                      std::align_val_t align = std::align_val_t{alignof(T)})
+      : s_(n, static_cast<size_t>(align), T{}) {}
+
+  /*! \brief As above, with every element of every copy set to 'value' */
+  sym_vector(size_t n, const T &value,
+             std::align_val_t align = std::align_val_t{alignof(T)})
+      : s_(n, static_cast<size_t>(align), value) {}
+
+  sym_vector(sym_vector &&) noexcept = default;
+  sym_vector &operator=(sym_vector &&) noexcept = default;
+
+  size_t size() const { return s_.size(); }
+  bool empty() const { return s_.size() == 0; }
+
+  T *data() const { return s_.local(); }
+  T *data(int pe) const { return s_.copy_of(pe); }
+
+  T &operator[](size_t i) const { return data()[i]; }
+  iterator begin() const { return data(); }
+  iterator end() const { return data() + size(); }
+
+  /*! \brief View of PE pe's copy */
+  remote_view<T> remote(int pe) const {
+    return remote_view<T>(s_.copy_of(pe), s_.size(), pe);
+  }
+
+  /*! \brief Free the symmetric block now rather than at destruction */
+  void reset() { s_.release(); }
+
+private:
+  detail::sym_storage<T> s_;
+};
+
+/*!
+ * \brief Fixed size symmetric array: N elements on every PE
+ *
+ * Same interface as sym_vector; remote views carry N so that whole-array
+ * transfers take the compile-time count path.
+ */
+template <typename T, size_t N> class sym_array {
+  static_assert(N > 0, "sym_array needs at least one element");
+
+public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  /*! \param align Alignment of the block on every PE (a power of two) */
+  explicit sym_array(std::align_val_t align = std::align_val_t{alignof(T)})
+      : s_(N, static_cast<size_t>(align), T{}) {}
+
+  sym_array(sym_array &&) noexcept = default;
+  sym_array &operator=(sym_array &&) noexcept = default;
+
+  static constexpr size_t size() { return N; }
+
+  T *data() const { return s_.local(); }
+  T *data(int pe) const { return s_.copy_of(pe); }
+
+  T &operator[](size_t i) const { return data()[i]; }
+  iterator begin() const { return data(); }
+  iterator end() const { return data() + N; }
+
+  /*! \brief View of PE pe's copy */
+  remote_view<T, N> remote(int pe) const {
+    return remote_view<T, N>(s_.copy_of(pe), N, pe);
+  }
+
+private:
+  detail::sym_storage<T> s_;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_SYM_HPP_ */
+
+/* EOF */
@@ -0,0 +1,350 @@
+/*
+ * _XBRTIME_TRACE_H_
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ *
+ */
+
+/*!
+ * \file xbMrtime-trace.h
+ * \brief Binary trace of the runtime calls of an application
+ *
+ * Set XBRTIME_TRACE to a file name and xbrtime_init() records every get,
+ * put, barrier, topology-aware collective and allocation, until
+ * xbrtime_close(). No rebuild is needed; -DXBRTIME_NO_TRACE compiles the
+ * hooks out. A region of a run may be traced instead:
+ *
+ * \code
+ *   xbrtime_trace_open( "solver.xbt" );
+ *   solve();
+ *   xbrtime_trace_close();
+ * \endcode
+ *
+ * Open and close the trace while no PE is working. bench/xbrtime_replay
+ * re-issues a trace against any runtime configuration and reports time.
+ *
+ * The file holds an xbrtime_trace_hdr_t, then chunks: an
+ * xbrtime_trace_chunk_t and 'count' xbrtime_trace_rec_t of one stream.
+ * Streams are the PEs, and as stream 'npes' the main thread and any
+ * other thread outside the pool, which append under a lock; a stream's
+ * records are in call order, and its clock starts when the trace is
+ * opened, so summing gaps and durations places the calls of all streams
+ * on one time line. Each call costs two clock reads and 32 bytes in a
+ * per-stream buffer; a full buffer is written as a chunk.
+ */
+
+#ifndef _XBRTIME_TRACE_H_
+#define _XBRTIME_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xbMrtime-macros.h"
+#include "threadpool.h"
+
+/* ------------------------------------------------- TRACE FORMAT */
+
+#define XBRTIME_TRACE_GET          1  /*! get from 'target' */
+#define XBRTIME_TRACE_PUT          2  /*! put to 'target' */
+#define XBRTIME_TRACE_BARRIER      3  /*! xbrtime_barrier() */
+#define XBRTIME_TRACE_COLL_BARRIER 4  /*! xbrtime_coll_barrier() */
+#define XBRTIME_TRACE_BROADCAST    5  /*! nelems bytes from root */
+#define XBRTIME_TRACE_REDUCE       6  /*! to root; flags = type | op << 4 */
+#define XBRTIME_TRACE_ALLREDUCE    7  /*! flags = type | op << 4 */
+#define XBRTIME_TRACE_MALLOC       8  /*! nelems bytes at 'target' */
+#define XBRTIME_TRACE_FREE         9  /*! the block at 'target' */
+#define XBRTIME_TRACE_MALLOC_LOCAL 10 /*! nelems bytes at 'target' */
+#define XBRTIME_TRACE_FREE_LOCAL   11 /*! the block at 'target' */
+
+/*! \brief "xbrtrce1" */
+#define XBRTIME_TRACE_MAGIC 0x3165637274726278ull
+
+/*!
+ * \struct xbrtime_trace_hdr_t
+ * \brief Head of a trace file
+ */
+typedef struct {
+  uint64_t magic;      /*! XBRTIME_TRACE_MAGIC */
+  uint32_t rec_size;   /*! sizeof( xbrtime_trace_rec_t ) */
+  uint32_t npes;       /*! PEs of the traced run */
+  uint64_t part_size;  /*! bytes per PE partition of the traced run */
+} xbrtime_trace_hdr_t;
+
+/*!
+ * \struct xbrtime_trace_chunk_t
+ * \brief Head of 'count' records of stream 'stream'
+ */
+typedef struct {
+  uint32_t stream;
+  uint32_t count;
+} xbrtime_trace_chunk_t;
+
+/*!
+ * \struct xbrtime_trace_rec_t
+ * \brief One runtime call
+ */
+typedef struct {
+  uint8_t        op;      /*! XBRTIME_TRACE_* */
+  uint8_t        flags;   /*! data type and operation of a reduction */
+  uint16_t       width;   /*! bytes per element */
+  int32_t        stride;  /*! elements from one element to the next */
+  uint64_t       nelems;  /*! elements; bytes for allocations */
+  uint64_t       target;  /*! remote data or block as an xbrtime_gref_t;
+                              only the PE of a collective's root */
+  uint32_t       gap;     /*! time since the stream's previous call ended */
+  uint32_t       dur;     /*! time in the call */
+} xbrtime_trace_rec_t;
+
+/*!
+ * \brief Nanoseconds of a 'gap' or 'dur' field
+ *
+ * Below 2^31 the field counts ns; above, the low 31 bits count us, which
+ * reaches about 35 minutes.
+ */
+static inline uint64_t xbrtime_trace_ns( uint32_t v ){
+  return (v & 0x80000000u) ? (uint64_t)(v & 0x7fffffffu) * 1000ull
+                           : (uint64_t)v;
+}
+
+/* ------------------------------------------------- TRACE STATE */
+
+/* records of one stream not written yet */
+typedef struct {
+  xbrtime_trace_rec_t *recs;
+  uint32_t             n;
+  uint64_t             last;          /* end of the previous call, ns */
+} __attribute__((aligned(64))) __xbrtime_trace_stream_t;
+
+typedef struct {
+  volatile int              on;
+  int                       nstreams; /* one per PE, then the main thread */
+  FILE                     *file;
+  pthread_mutex_t           lock;     /* serializes chunk writes and the
+                                         main thread's stream */
+  __xbrtime_trace_stream_t *streams;
+} __xbrtime_trace_t;
+
+extern __xbrtime_trace_t __xbrtime_trace;
+
+void __xbrtime_trace_rec( uint64_t t0, int op, int flags, int pe,
+                          size_t width, size_t nelems, long stride,
+                          const void *addr );
+int xbrtime_trace_open( const char *path );
+void xbrtime_trace_close( void );
+
+/* encodes 'ns' for a 'gap' or 'dur' field; see xbrtime_trace_ns() */
+static inline uint32_t __xbrtime_trace_enc( uint64_t ns ){
+  if( ns < 0x80000000ull ){
+    return (uint32_t)ns;
+  }
+  ns /= 1000ull;
+  return 0x80000000u | (uint32_t)((ns > 0x7fffffffull) ? 0x7fffffffull : ns);
+}
+
+static inline uint64_t __xbrtime_trace_now( void ){
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * __XBRTIME_TRACE_T0 starts the clock of a call in 't';
+ * __XBRTIME_TRACE_REC records it if tracing was on at the start
+ */
+#ifndef XBRTIME_NO_TRACE
+#define __XBRTIME_TRACE_T0( t ) \
+  uint64_t t = __xbrtime_trace.on ? __xbrtime_trace_now() : 0
+#define __XBRTIME_TRACE_REC( t, op, flags, pe, width, nelems, stride, addr ) \
+  do{ \
+    if( (t) != 0 ){ \
+      __xbrtime_trace_rec( (t), (op), (flags), (pe), (width), (nelems), \
+                           (stride), (addr) ); \
+    } \
+  }while( 0 )
+#else
+#define __XBRTIME_TRACE_T0( t )
+#define __XBRTIME_TRACE_REC( t, op, flags, pe, width, nelems, stride, addr ) \
+  do{ }while( 0 )
+#endif
+
+/* after the hooks: xbMrtime-alloc.h uses them and includes this file */
+#include "xbMrtime-alloc.h"
+
+#ifndef __XBRTIME_DECLARE_ONLY
+__xbrtime_trace_t __xbrtime_trace = { 0, 0, NULL, PTHREAD_MUTEX_INITIALIZER,
+                                      NULL };
+
+/* writes the buffered records of 's' as one chunk; the lock must be held */
+static void __xbrtime_trace_flush_locked( int s ){
+  __xbrtime_trace_stream_t *st = &__xbrtime_trace.streams[s];
+  xbrtime_trace_chunk_t c;
+
+  if( (st->n == 0) || (__xbrtime_trace.file == NULL) ){
+    st->n = 0;
+    return;
+  }
+  c.stream = (uint32_t)s;
+  c.count  = st->n;
+  if( (fwrite( &c, sizeof( c ), 1, __xbrtime_trace.file ) != 1) ||
+      (fwrite( st->recs, sizeof( xbrtime_trace_rec_t ), st->n,
+               __xbrtime_trace.file ) != st->n) ){
+    /* out of space: keep the file readable up to here and stop */
+    __xbrtime_trace.on = 0;
+  }
+  st->n = 0;
+}
+
+/* opens the file named by XBRTIME_TRACE, if any */
+static void __xbrtime_trace_init( void ){
+  char *path = getenv( "XBRTIME_TRACE" );
+  if( (path != NULL) && (path[0] != '\0') && (xbrtime_trace_open( path ) != 0) ){
+    fprintf( stderr, "xbrtime: cannot trace to %s\n", path );
+  }
+}
+
+/* ------------------------------------------------- PUBLIC TRACE API */
+
+extern int xbrtime_trace_open( const char *path ){
+  xbrtime_trace_hdr_t h;
+  int npes = __xbrtime_heap.npes;
+  int s = 0;
+
+  if( (path == NULL) || (npes <= 0) ){
+    return -1;
+  }
+  xbrtime_trace_close();
+  if( posix_memalign( (void **)&__xbrtime_trace.streams, 64,
+                      ((size_t)npes + 1) *
+                      sizeof( __xbrtime_trace_stream_t ) ) != 0 ){
+    __xbrtime_trace.streams = NULL;
+    return -1;
+  }
+  memset( __xbrtime_trace.streams, 0,
+          ((size_t)npes + 1) * sizeof( __xbrtime_trace_stream_t ) );
+  __xbrtime_trace.nstreams = npes + 1;
+  for( s = 0; s < npes + 1; s++ ){
+    __xbrtime_trace.streams[s].last = __xbrtime_trace_now();
+  }
+  if( (__xbrtime_trace.file = fopen( path, "wb" )) == NULL ){
+    xbrtime_trace_close();
+    return -1;
+  }
+  memset( &h, 0, sizeof( h ) );
+  h.magic     = XBRTIME_TRACE_MAGIC;
+  h.rec_size  = (uint32_t)sizeof( xbrtime_trace_rec_t );
+  h.npes      = (uint32_t)npes;
+  h.part_size = (uint64_t)__xbrtime_heap.part_size;
+  if( fwrite( &h, sizeof( h ), 1, __xbrtime_trace.file ) != 1 ){
+    xbrtime_trace_close();
+    return -1;
+  }
+  __xbrtime_trace.on = 1;
+  return 0;
+}
+
+extern void xbrtime_trace_close( void ){
+  int s = 0;
+
+  __xbrtime_trace.on = 0;
+  pthread_mutex_lock( &__xbrtime_trace.lock );
+  for( s = 0; s < __xbrtime_trace.nstreams; s++ ){
+    __xbrtime_trace_flush_locked( s );
+    free( __xbrtime_trace.streams[s].recs );
+  }
+  if( __xbrtime_trace.file != NULL ){
+    fclose( __xbrtime_trace.file );
+    __xbrtime_trace.file = NULL;
+  }
+  free( __xbrtime_trace.streams );
+  __xbrtime_trace.streams  = NULL;
+  __xbrtime_trace.nstreams = 0;
+  pthread_mutex_unlock( &__xbrtime_trace.lock );
+}
+
+/* appends the call that started at 't0' to the caller's stream */
+void __xbrtime_trace_rec( uint64_t t0, int op, int flags, int pe,
+                          size_t width, size_t nelems, long stride,
+                          const void *addr ){
+  uint64_t now = __xbrtime_trace_now();
+  __xbrtime_trace_stream_t *st = NULL;
+  xbrtime_trace_rec_t *r = NULL;
+  int shared = (tpool_self == NULL);
+  int s = shared ? __xbrtime_trace.nstreams - 1 : (int)tpool_self->thread_id;
+
+  if( !__xbrtime_trace.on || (s < 0) || (s >= __xbrtime_trace.nstreams) ){
+    return;
+  }
+  /* every thread outside the pool appends to the last stream */
+  if( shared ){
+    pthread_mutex_lock( &__xbrtime_trace.lock );
+  }
+  st = &__xbrtime_trace.streams[s];
+  if( (st->recs == NULL) &&
+      ((st->recs = (xbrtime_trace_rec_t *)malloc(
+          _XBRTIME_TRACE_BUF_ * sizeof( xbrtime_trace_rec_t ) )) == NULL) ){
+    if( shared ){
+      pthread_mutex_unlock( &__xbrtime_trace.lock );
+    }
+    return;
+  }
+
+  r = &st->recs[st->n];
+  r->op     = (uint8_t)op;
+  r->flags  = (uint8_t)flags;
+  r->width  = (uint16_t)((width > UINT16_MAX) ? UINT16_MAX : width);
+  r->stride = (int32_t)stride;
+  r->nelems = (uint64_t)nelems;
+  r->target = 0;
+  if( (addr != NULL) && __xbrtime_heap_contains( addr ) ){
+    /* the partition addressed, whatever PE the caller named */
+    pe = (int)((size_t)((const char *)addr - __xbrtime_heap.base) /
+               __xbrtime_heap.part_size);
+    r->target = (uint64_t)__xbrtime_heap_offset( addr );
+  }
+  if( (pe >= 0) && (pe < __xbrtime_heap.npes) ){
+    r->target |= (uint64_t)(pe + 1) << 48;
+  }
+  r->gap = __xbrtime_trace_enc( t0 - st->last );
+  r->dur = __xbrtime_trace_enc( now - t0 );
+  st->last = now;
+
+  if( shared ){
+    if( ++st->n == _XBRTIME_TRACE_BUF_ ){
+      __xbrtime_trace_flush_locked( s );
+    }
+    pthread_mutex_unlock( &__xbrtime_trace.lock );
+  }else if( ++st->n == _XBRTIME_TRACE_BUF_ ){
+    pthread_mutex_lock( &__xbrtime_trace.lock );
+    __xbrtime_trace_flush_locked( s );
+    pthread_mutex_unlock( &__xbrtime_trace.lock );
+  }
+}
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif  /* extern "C" */
+
+#endif /* _XBRTIME_TRACE_H_ */
+
+/* EOF */
@@ -0,0 +1,494 @@
+/*
+ * xbMrtime-typed.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-typed.hpp
+ * \brief Typed C++ interface to the xBGAS transfer kernels
+ *
+ * xbr::get<T>, xbr::put<T>, the atomics and the collectives are templated
+ * on the element type. The assembly kernel that matches the width and
+ * signedness of T is chosen at compile time, so a call inlines into a
+ * direct kernel call without any per-type dispatch:
+ *
+ * \code
+ *   xbr::get(dest, src, n, pe);                                 // contiguous
+ *   xbr::get(dest, src, n, stride, pe);                         // strided
+ *   xbr::get(dest, src, std::integral_constant<size_t, 4>{}, pe); // fixed N
+ *   xbr::reduce<xbr::ops::max>(dest, src, n, 1, 0);
+ * \endcode
+ *
+ * Gets from allocations registered with xbrtime_cache_enable() are served
+ * by the remote read cache of xbMrtime-cache.h.
+ */
+
+#ifndef _XBRTIME_TYPED_HPP_
+#define _XBRTIME_TYPED_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "xbrtime_morello.h"
+
+/* ========================================================================= */
+/*                           ASSEMBLY KERNELS                               */
+/* ========================================================================= */
+
+extern "C" {
+void __xbrtime_get_u1_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_u1_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_s1_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_s1_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_u2_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_u2_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_s2_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_s2_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_u4_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_u4_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_s4_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_s4_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_u8_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_u8_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_get_s8_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+void __xbrtime_put_s8_seq(uint64_t *, uint64_t *, uint32_t, uint32_t);
+}
+
+namespace xbr {
+
+namespace detail {
+
+typedef void (*kernel_fn)(uint64_t *, uint64_t *, uint32_t, uint32_t);
+
+/*! \brief Kernel pair for a given element width (bytes) and signedness */
+template <size_t W, bool S> struct kernel;
+
+template <> struct kernel<1, false> {
+  static constexpr kernel_fn get = __xbrtime_get_u1_seq;
+  static constexpr kernel_fn put = __xbrtime_put_u1_seq;
+};
+template <> struct kernel<1, true> {
+  static constexpr kernel_fn get = __xbrtime_get_s1_seq;
+  static constexpr kernel_fn put = __xbrtime_put_s1_seq;
+};
+template <> struct kernel<2, false> {
+  static constexpr kernel_fn get = __xbrtime_get_u2_seq;
+  static constexpr kernel_fn put = __xbrtime_put_u2_seq;
+};
+template <> struct kernel<2, true> {
+  static constexpr kernel_fn get = __xbrtime_get_s2_seq;
+  static constexpr kernel_fn put = __xbrtime_put_s2_seq;
+};
+template <> struct kernel<4, false> {
+  static constexpr kernel_fn get = __xbrtime_get_u4_seq;
+  static constexpr kernel_fn put = __xbrtime_put_u4_seq;
+};
+template <> struct kernel<4, true> {
+  static constexpr kernel_fn get = __xbrtime_get_s4_seq;
+  static constexpr kernel_fn put = __xbrtime_put_s4_seq;
+};
+template <> struct kernel<8, false> {
+  static constexpr kernel_fn get = __xbrtime_get_u8_seq;
+  static constexpr kernel_fn put = __xbrtime_put_u8_seq;
+};
+template <> struct kernel<8, true> {
+  static constexpr kernel_fn get = __xbrtime_get_s8_seq;
+  static constexpr kernel_fn put = __xbrtime_put_s8_seq;
+};
+
+/*! \brief Widest kernel width that divides both the size and alignment */
+template <typename T> constexpr size_t word_width() {
+  for (size_t w = 8; w > 1; w >>= 1)
+    if (sizeof(T) % w == 0 && alignof(T) % w == 0)
+      return w;
+  return 1;
+}
+
+/*!
+ * \brief Kernels for T
+ *
+ * Types of width 1, 2, 4 or 8 move as one word each (floating point as
+ * unsigned words). Wider trivially copyable types, eg, structs, move as
+ * 'words' unsigned words of 'width' bytes each.
+ */
+template <typename T> struct kernel_for {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "xbr transfers need trivially copyable element types");
+  static constexpr bool scalar = sizeof(T) == 1 || sizeof(T) == 2 ||
+                                 sizeof(T) == 4 || sizeof(T) == 8;
+  static constexpr size_t width = scalar ? sizeof(T) : word_width<T>();
+  static constexpr size_t words = sizeof(T) / width;
+  using type = kernel<width, scalar && std::is_signed_v<T> &&
+                                 std::is_integral_v<T>>;
+};
+
+/*!
+ * \brief Run a kernel over nelems elements 'stride' bytes apart
+ *
+ * The kernels count elements in 32 bits and never run on zero elements.
+ */
+template <typename T>
+inline void run_kernel(kernel_fn k, const T *src, T *dest, size_t nelems,
+                       size_t stride) {
+  const size_t max = UINT32_MAX;
+  while (nelems > 0) {
+    size_t n = nelems < max ? nelems : max;
+    k((uint64_t *)const_cast<T *>(src), (uint64_t *)dest, (uint32_t)n,
+      (uint32_t)stride);
+    src = (const T *)((const char *)src + n * stride);
+    dest = (T *)((char *)dest + n * stride);
+    nelems -= n;
+  }
+}
+
+/*! \brief Element copies for a fixed, small count; fully unrolled */
+template <typename T, size_t... I>
+inline void copy_unrolled(T *dest, const T *src, std::index_sequence<I...>) {
+  ((dest[I] = src[I]), ...);
+}
+
+} // namespace detail
+
+/* ========================================================================= */
+/*                           DATA TRANSFER OPERATIONS                       */
+/* ========================================================================= */
+
+/*!
+ * \brief Get (read) contiguous elements from a remote PE
+ * \param dest Destination buffer for the data
+ * \param src Source address on the remote PE
+ * \param nelems Number of elements to transfer
+ * \param pe Source processing element identifier
+ */
+template <typename T>
+inline void get(T *dest, const T *src, size_t nelems, int pe) {
+  __XBRTIME_TRACE_T0(t);
+  if (!__xbrtime_cache_get(dest, src, nelems, sizeof(T), 1)) {
+    if (nelems != 0)
+      detail::run_kernel(detail::kernel_for<T>::type::get, src, dest,
+                         nelems * detail::kernel_for<T>::words,
+                         detail::kernel_for<T>::width);
+    __xbrtime_asm_fence();
+  }
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(T), nelems, 1, src);
+}
+
+/*!
+ * \brief Get (read) strided elements from a remote PE
+ * \param dest Destination buffer for the data
+ * \param src Source address on the remote PE
+ * \param nelems Number of elements to transfer
+ * \param stride Stride between elements, in elements
+ * \param pe Source processing element identifier
+ */
+template <typename T>
+inline void get(T *dest, const T *src, size_t nelems, int stride, int pe) {
+  using K = detail::kernel_for<T>;
+  __XBRTIME_TRACE_T0(t);
+  if (!__xbrtime_cache_get(dest, src, nelems, sizeof(T), stride)) {
+    if (nelems != 0 && K::words == 1)
+      detail::run_kernel(K::type::get, src, dest, nelems,
+                         (size_t)stride * sizeof(T));
+    else
+      for (size_t i = 0; i < nelems; i++)
+        detail::run_kernel(K::type::get, src + i * stride, dest + i * stride,
+                           K::words, K::width);
+    __xbrtime_asm_fence();
+  }
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(T), nelems, stride,
+                      src);
+}
+
+/*!
+ * \brief Get (read) a compile-time number of contiguous elements
+ *
+ * Counts below _XBRTIME_MIN_UNR_THRESHOLD_ are copied inline.
+ */
+template <typename T, size_t N>
+inline void get(T *dest, const T *src, std::integral_constant<size_t, N>,
+                int pe) {
+  __XBRTIME_TRACE_T0(t);
+  if constexpr (N == 0) {
+  } else if constexpr (N < _XBRTIME_MIN_UNR_THRESHOLD_) {
+    (void)detail::kernel_for<T>::type::get;
+    detail::copy_unrolled(dest, src, std::make_index_sequence<N>{});
+  } else if (!__xbrtime_cache_get(dest, src, N, sizeof(T), 1)) {
+    detail::run_kernel(detail::kernel_for<T>::type::get, src, dest,
+                       N * detail::kernel_for<T>::words,
+                       detail::kernel_for<T>::width);
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_GET, 0, pe, sizeof(T), N, 1, src);
+}
+
+/*!
+ * \brief Put (write) contiguous elements to a remote PE
+ * \param dest Destination address on the remote PE
+ * \param src Source buffer containing the data
+ * \param nelems Number of elements to transfer
+ * \param pe Destination processing element identifier
+ */
+template <typename T>
+inline void put(T *dest, const T *src, size_t nelems, int pe) {
+  __XBRTIME_TRACE_T0(t);
+  if (nelems != 0)
+    detail::run_kernel(detail::kernel_for<T>::type::put, src, dest,
+                       nelems * detail::kernel_for<T>::words,
+                       detail::kernel_for<T>::width);
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_PUT, 0, pe, sizeof(T), nelems, 1, dest);
+}
+
+/*!
+ * \brief Put (write) strided elements to a remote PE
+ * \param dest Destination address on the remote PE
+ * \param src Source buffer containing the data
+ * \param nelems Number of elements to transfer
+ * \param stride Stride between elements, in elements
+ * \param pe Destination processing element identifier
+ */
+template <typename T>
+inline void put(T *dest, const T *src, size_t nelems, int stride, int pe) {
+  using K = detail::kernel_for<T>;
+  __XBRTIME_TRACE_T0(t);
+  if (nelems != 0 && K::words == 1)
+    detail::run_kernel(K::type::put, src, dest, nelems,
+                       (size_t)stride * sizeof(T));
+  else
+    for (size_t i = 0; i < nelems; i++)
+      detail::run_kernel(K::type::put, src + i * stride, dest + i * stride,
+                         K::words, K::width);
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_PUT, 0, pe, sizeof(T), nelems, stride,
+                      dest);
+}
+
+/*!
+ * \brief Put (write) a compile-time number of contiguous elements
+ *
+ * Counts below _XBRTIME_MIN_UNR_THRESHOLD_ are copied inline.
+ */
+template <typename T, size_t N>
+inline void put(T *dest, const T *src, std::integral_constant<size_t, N>,
+                int pe) {
+  __XBRTIME_TRACE_T0(t);
+  if constexpr (N == 0) {
+  } else if constexpr (N < _XBRTIME_MIN_UNR_THRESHOLD_) {
+    (void)detail::kernel_for<T>::type::put;
+    detail::copy_unrolled(dest, src, std::make_index_sequence<N>{});
+  } else {
+    detail::run_kernel(detail::kernel_for<T>::type::put, src, dest,
+                       N * detail::kernel_for<T>::words,
+                       detail::kernel_for<T>::width);
+  }
+  __xbrtime_asm_fence();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_PUT, 0, pe, sizeof(T), N, 1, dest);
+}
+
+/* ========================================================================= */
+/*                           ATOMIC OPERATIONS                              */
+/* ========================================================================= */
+
+/*! \brief Atomically read 'src' on PE 'pe' */
+template <typename T> inline T atomic_fetch(const T *src, int pe) {
+  return __atomic_load_n(src, __ATOMIC_SEQ_CST);
+}
+
+/*! \brief Atomically write 'value' to 'dest' on PE 'pe' */
+template <typename T> inline void atomic_set(T *dest, T value, int pe) {
+  __atomic_store_n(dest, value, __ATOMIC_SEQ_CST);
+}
+
+/*! \brief Atomically swap in 'value'; returns the previous value */
+template <typename T> inline T atomic_swap(T *dest, T value, int pe) {
+  return __atomic_exchange_n(dest, value, __ATOMIC_SEQ_CST);
+}
+
+/*!
+ * \brief Atomically replace 'cond' with 'value' at 'dest' on PE 'pe'
+ * \return The value found at 'dest' (equal to 'cond' on success)
+ */
+template <typename T>
+inline T atomic_compare_swap(T *dest, T cond, T value, int pe) {
+  __atomic_compare_exchange_n(dest, &cond, value, false, __ATOMIC_SEQ_CST,
+                              __ATOMIC_SEQ_CST);
+  return cond;
+}
+
+/*! \brief Atomically add 'value' to 'dest' on PE 'pe'; returns the old value */
+template <typename T> inline T atomic_fetch_add(T *dest, T value, int pe) {
+  static_assert(std::is_integral_v<T>, "atomic_fetch_add needs an integer");
+  return __atomic_fetch_add(dest, value, __ATOMIC_SEQ_CST);
+}
+
+/*! \brief Atomically OR 'value' into 'dest' on PE 'pe'; returns the old value */
+template <typename T> inline T atomic_fetch_or(T *dest, T value, int pe) {
+  static_assert(std::is_integral_v<T>, "atomic_fetch_or needs an integer");
+  return __atomic_fetch_or(dest, value, __ATOMIC_SEQ_CST);
+}
+
+/*! \brief Atomically AND 'value' into 'dest' on PE 'pe'; returns the old value */
+template <typename T> inline T atomic_fetch_and(T *dest, T value, int pe) {
+  static_assert(std::is_integral_v<T>, "atomic_fetch_and needs an integer");
+  return __atomic_fetch_and(dest, value, __ATOMIC_SEQ_CST);
+}
+
+/* ========================================================================= */
+/*                           COLLECTIVE OPERATIONS                          */
+/* ========================================================================= */
+
+/*! \brief Reduction operations for xbr::reduce */
+namespace ops {
+struct sum {
+  template <typename T> T operator()(T a, T b) const { return a + b; }
+};
+struct prod {
+  template <typename T> T operator()(T a, T b) const { return a * b; }
+};
+struct min {
+  template <typename T> T operator()(T a, T b) const { return b < a ? b : a; }
+};
+struct max {
+  template <typename T> T operator()(T a, T b) const { return a < b ? b : a; }
+};
+struct band {
+  template <typename T> T operator()(T a, T b) const { return a & b; }
+};
+struct bor {
+  template <typename T> T operator()(T a, T b) const { return a | b; }
+};
+struct bxor {
+  template <typename T> T operator()(T a, T b) const { return a ^ b; }
+};
+} // namespace ops
+
+namespace detail {
+
+/*!
+ * \brief Run f(pe) on the pool thread of every PE and wait for all of them
+ *
+ * The work goes to the control lane. Unlike tpool_wait() this only waits
+ * for the submitted work, not for the queues to drain.
+ */
+template <typename F> void on_each_pe(F &&f) {
+  struct job {
+    F *f;
+    int pe;
+    std::mutex *m;
+    std::condition_variable *cv;
+    int *left;
+  };
+  int npes = xbrtime_num_pes();
+  std::mutex m;
+  std::condition_variable cv;
+  int left = npes;
+  job jobs[__XBRTIME_MAX_PE];
+
+  __xbrtime_epoch_phase(1);
+  auto body = [](void *arg) {
+    job *j = static_cast<job *>(arg);
+    (*j->f)(j->pe);
+    xbrtime_quiesce();
+    std::lock_guard<std::mutex> lk(*j->m);
+    if (--*j->left == 0)
+      j->cv->notify_all();
+  };
+
+  for (int pe = 0; pe < npes; pe++) {
+    jobs[pe] = {&f, pe, &m, &cv, &left};
+    if (!tpool_add_work_prio(threads[pe].thread_queue, body, &jobs[pe],
+                             TPOOL_PRIO_CONTROL))
+      body(&jobs[pe]);
+  }
+  std::unique_lock<std::mutex> lk(m);
+  cv.wait(lk, [&] { return left == 0; });
+  xbrtime_cache_invalidate_all(); // the phase boundary acts as a barrier
+  __xbrtime_epoch_phase(0);
+}
+
+} // namespace detail
+
+/*!
+ * \brief Reduce 'nelems' strided elements with 'Op' across the PEs
+ * \param dest Destination; every one of its nelems elements gets the result
+ * \param src Source elements
+ * \param nelems Number of elements to reduce
+ * \param stride Stride between elements, in elements
+ * \param root Root processing element identifier
+ *
+ * Same contract as xbrtime_int_reduce_sum(): each PE reduces a slice of
+ * 'src' on its pool thread and the partial results are combined in PE
+ * order. Like the C collectives it is called from outside the pool.
+ */
+template <typename Op, typename T>
+void reduce(T *dest, const T *src, size_t nelems, int stride, int root) {
+  if (nelems == 0)
+    return;
+  int npes = xbrtime_num_pes();
+  size_t per_pe = nelems / npes;
+  T partial[__XBRTIME_MAX_PE];
+  bool have[__XBRTIME_MAX_PE];
+  Op op;
+
+  detail::on_each_pe([&](int pe) {
+    size_t start = (size_t)pe * per_pe;
+    size_t end = (pe == npes - 1) ? nelems : start + per_pe;
+    have[pe] = start < end;
+    if (!have[pe])
+      return;
+    T acc = src[start * stride];
+    for (size_t i = start + 1; i < end; i++)
+      acc = op(acc, src[i * stride]);
+    partial[pe] = acc;
+  });
+
+  T result{};
+  bool first = true;
+  for (int pe = 0; pe < npes; pe++) {
+    if (!have[pe])
+      continue;
+    result = first ? partial[pe] : op(result, partial[pe]);
+    first = false;
+  }
+  for (size_t i = 0; i < nelems; i++)
+    dest[i * stride] = result;
+  __xbrtime_asm_fence();
+}
+
+/*!
+ * \brief Broadcast 'nelems' strided elements from 'root'
+ * \param dest Destination buffer
+ * \param src Source buffer on the root PE
+ * \param nelems Number of elements to broadcast
+ * \param stride Stride between elements, in elements
+ * \param root Root processing element identifier
+ *
+ * The copy is made by the root's pool thread; returns once it is visible.
+ */
+template <typename T>
+void broadcast(T *dest, const T *src, size_t nelems, int stride, int root) {
+  if (nelems == 0 || dest == src)
+    return;
+  detail::on_each_pe([&](int pe) {
+    if (pe == root)
+      get(dest, src, nelems, stride, root);
+  });
+}
+
+} // namespace xbr
+
+#endif /* _XBRTIME_TYPED_HPP_ */
+
+/* EOF */
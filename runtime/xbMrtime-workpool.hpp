@@ -0,0 +1,430 @@
+/*
+ * xbMrtime-workpool.hpp
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbMrtime-workpool.hpp
+ * \brief Global task pool with distributed load balancing
+ *
+ * xbr::work_pool<Task> runs irregular, dynamically spawned work across all
+ * PEs. Tasks are trivially copyable values so that they can migrate between
+ * PEs through symmetric memory:
+ *
+ * \code
+ *   xbr::work_pool<node> pool(1 << 16, xbr::victim_policy::lifeline);
+ *   pool.add(0, root);
+ *   pool.run([](const node &n, xbr::work_pool<node> &p) {
+ *     for (...) p.spawn(child);
+ *   });
+ * \endcode
+ *
+ * Each PE owns a split deque in its symmetric partition:
+ *
+ *   tail          split           head
+ *    |  shared      |   private     |
+ *
+ * The owner pushes and pops at 'head' without atomics. Thieves lock the
+ * owner's deque with a remote compare-and-swap and take the older half of
+ * the shared part, advancing 'tail'. The owner moves 'split' forward to
+ * release work when its shared part runs dry, and back (under the lock) to
+ * reacquire it when its private part is empty.
+ *
+ * Victims are either chosen at random, or, with the lifeline policy, an
+ * idle PE makes a round of random attempts and then registers on its
+ * hypercube lifelines and waits. Busy PEs push part of their work into the
+ * mailbox of any waiting buddy.
+ *
+ * Termination: PE 0 holds the number of outstanding tasks. A PE may delay
+ * reporting completed tasks but reports new tasks before they can be
+ * stolen, so the counter never undercounts and reaching zero means all
+ * work is done.
+ */
+
+#ifndef _XBRTIME_WORKPOOL_HPP_
+#define _XBRTIME_WORKPOOL_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <sched.h>
+#include <vector>
+
+#include "xbMrtime-sym.hpp"
+
+namespace xbr {
+
+/*! \brief How an idle PE looks for work */
+enum class victim_policy {
+  random,  /*!< keep stealing from randomly chosen PEs */
+  lifeline /*!< one round of random steals, then wait on hypercube buddies */
+};
+
+/*! \brief Per-PE load balancing counters */
+struct work_pool_stats {
+  uint64_t executed;     /*!< tasks run on this PE */
+  uint64_t steals;       /*!< successful steals */
+  uint64_t failed;       /*!< steal attempts that found no work */
+  uint64_t stolen;       /*!< tasks obtained by stealing */
+  uint64_t pushed;       /*!< tasks handed to lifeline buddies */
+  uint64_t received;     /*!< tasks received through lifelines */
+};
+
+template <typename Task> class work_pool {
+  static_assert(std::is_trivially_copyable<Task>::value,
+                "work_pool tasks are trivially copyable");
+
+  /* control words, one cache line each */
+  struct alignas(64) line {
+    unsigned long long v;
+  };
+  enum { LOCK, TAIL, SPLIT, WAITERS, MBOX, OUTSTANDING, NCTL };
+
+  /* owner-private state of one PE */
+  struct alignas(64) local {
+    uint64_t head;
+    int64_t credit; /* unreported completions (<= 0) */
+    uint64_t rng;
+    work_pool_stats st;
+  };
+
+public:
+  /*!
+   * \param capacity Deque slots per PE (rounded up to a power of two);
+   *        a PE whose deque is full runs new tasks inline
+   * \param policy Victim selection policy
+   */
+  explicit work_pool(size_t capacity = 1 << 16,
+                     victim_policy policy = victim_policy::random)
+      : cap_(pow2(capacity)), mcap_(cap_ / 4 ? cap_ / 4 : 1),
+        policy_(policy), ring_(cap_), mbox_(mcap_),
+        ctl_(NCTL, std::align_val_t{64}),
+        locals_((size_t)xbrtime_num_pes()) {
+    reset();
+  }
+
+  work_pool(work_pool &&) noexcept = default;
+  work_pool &operator=(work_pool &&) noexcept = default;
+
+  /*!
+   * \brief Seed a task on 'pe' before run(); called from outside the pool
+   * \return false if pe's deque is full
+   */
+  bool add(int pe, const Task &t) {
+    local &l = locals_[pe];
+    if (l.head - ctl(pe, TAIL) >= cap_)
+      return false;
+    ring_.data(pe)[l.head & (cap_ - 1)] = t;
+    l.head++;
+    ctl_.data(0)[OUTSTANDING].v++;
+    return true;
+  }
+
+  /*!
+   * \brief Run every task (and everything it spawns) to completion
+   * \param f Called as f(task, pool); may call pool.spawn(child)
+   *
+   * Collective; called from outside the pool.
+   */
+  template <typename F> void run(F f) {
+    fn_ = [](void *fp, const Task &t, work_pool &p) {
+      (*static_cast<F *>(fp))(t, p);
+    };
+    fp_ = &f;
+    detail::on_each_pe([&](int pe) { worker(pe); });
+    fn_ = nullptr;
+    fp_ = nullptr;
+  }
+
+  /*! \brief Push a child task on the calling PE */
+  void spawn(const Task &t) {
+    int me = xbrtime_mype();
+    local &l = locals_[me];
+
+    /* new work is reported before anyone can steal it */
+    if (++l.credit > 0) {
+      atomic_fetch_add(&ctl_.data(0)[OUTSTANDING].v,
+                       (unsigned long long)l.credit, 0);
+      l.credit = 0;
+    }
+    if (l.head - atomic_fetch(&ctl_.data(me)[TAIL].v, me) >= cap_) {
+      execute(me, t); /* deque full: depth-first inline */
+      return;
+    }
+    ring_.data(me)[l.head & (cap_ - 1)] = t;
+    l.head++;
+    release(me);
+  }
+
+  /*! \brief Load balancing counters of 'pe' for the last run() */
+  const work_pool_stats &stats(int pe) const { return locals_[pe].st; }
+
+  /*! \brief Empty every deque and clear the counters */
+  void reset() {
+    for (int pe = 0; pe < xbrtime_num_pes(); pe++) {
+      line *c = ctl_.data(pe);
+      for (int i = 0; i < NCTL; i++)
+        c[i].v = 0;
+      locals_[pe] = local{};
+      locals_[pe].rng = 0x9e3779b97f4a7c15ull * (pe + 1);
+    }
+  }
+
+private:
+  static size_t pow2(size_t n) {
+    size_t p = 2;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  unsigned long long ctl(int pe, int w) const { return ctl_.data(pe)[w].v; }
+  unsigned long long *ctlp(int pe, int w) const { return &ctl_.data(pe)[w].v; }
+
+  bool try_lock(int pe, int me) const {
+    return atomic_compare_swap(ctlp(pe, LOCK), 0ull,
+                               (unsigned long long)me + 1, pe) == 0;
+  }
+  void lock(int pe, int me) const {
+    while (!try_lock(pe, me))
+      sched_yield();
+  }
+  void unlock(int pe) const { atomic_set(ctlp(pe, LOCK), 0ull, pe); }
+
+  uint64_t next_rand(local &l) const {
+    l.rng ^= l.rng << 13;
+    l.rng ^= l.rng >> 7;
+    l.rng ^= l.rng << 17;
+    return l.rng;
+  }
+
+  void execute(int me, const Task &t) {
+    local &l = locals_[me];
+    fn_(fp_, t, *this);
+    l.credit--;
+    l.st.executed++;
+  }
+
+  /* ---- owner side */
+
+  /* expose the older half of the private part once the shared part is dry */
+  void release(int me) {
+    local &l = locals_[me];
+    uint64_t split = ctl(me, SPLIT);
+    if (l.head - split >= 2 && atomic_fetch(ctlp(me, TAIL), me) == split)
+      atomic_set(ctlp(me, SPLIT),
+                 (unsigned long long)(split + (l.head - split) / 2), me);
+  }
+
+  /* take back the newer half of the shared part; true if any was taken */
+  bool reacquire(int me) {
+    local &l = locals_[me];
+    bool got = false;
+    lock(me, me);
+    uint64_t t = ctl(me, TAIL), s = ctl(me, SPLIT);
+    if (s > t) {
+      atomic_set(ctlp(me, SPLIT), (unsigned long long)(t + (s - t) / 2), me);
+      got = true;
+    }
+    /* drain lifeline deliveries into the private part */
+    uint64_t m = ctl(me, MBOX);
+    if (m != 0 && l.head - t + m <= cap_) {
+      Task *box = mbox_.data(me);
+      for (uint64_t i = 0; i < m; i++)
+        ring_.data(me)[(l.head + i) & (cap_ - 1)] = box[i];
+      l.head += m;
+      l.st.received += m;
+      atomic_set(ctlp(me, MBOX), 0ull, me);
+      got = true;
+    }
+    unlock(me);
+    return got;
+  }
+
+  bool pop(int me, Task *t) {
+    local &l = locals_[me];
+    if (l.head == ctl(me, SPLIT) && !reacquire(me))
+      return false;
+    if (l.head == ctl(me, SPLIT))
+      return false;
+    l.head--;
+    *t = ring_.data(me)[l.head & (cap_ - 1)];
+    return true;
+  }
+
+  /* hand part of the private work to buddies waiting on our lifelines */
+  void feed_lifelines(int me) {
+    local &l = locals_[me];
+    unsigned long long w = atomic_fetch(ctlp(me, WAITERS), me);
+    if (w == 0 || l.head - ctl(me, SPLIT) < 2)
+      return;
+    w = atomic_swap(ctlp(me, WAITERS), 0ull, me);
+    for (int d = 0; w != 0; d++, w >>= 1) {
+      if (!(w & 1))
+        continue;
+      int pe = me ^ (1 << d);
+      uint64_t avail = l.head - ctl(me, SPLIT);
+      uint64_t k = avail / 2;
+      if (k == 0) {
+        /* nothing left to spare: the rest stay armed */
+        atomic_fetch_or(ctlp(me, WAITERS), w << d, me);
+        break;
+      }
+      lock(pe, me);
+      uint64_t m = ctl_fetch(pe, MBOX);
+      if (k > mcap_ - m)
+        k = mcap_ - m;
+      if (k == 0) {
+        /* its mailbox is full: feed it another time */
+        unlock(pe);
+        atomic_fetch_or(ctlp(me, WAITERS), 1ull << d, me);
+        continue;
+      }
+      /* the newest k private tasks, in at most two runs */
+      l.head -= k;
+      for (uint64_t done = 0; done < k;) {
+        uint64_t from = (l.head + done) & (cap_ - 1);
+        uint64_t run = std::min<uint64_t>(k - done, cap_ - from);
+        xbr::put(mbox_.data(pe) + m + done, ring_.data(me) + from, run, pe);
+        done += run;
+      }
+      atomic_set(ctlp(pe, MBOX), (unsigned long long)(m + k), pe);
+      unlock(pe);
+      l.st.pushed += k;
+    }
+  }
+
+  /* ---- thief side */
+
+  bool steal(int me, int victim) {
+    local &l = locals_[me];
+    if (ctl_fetch(victim, SPLIT) == ctl_fetch(victim, TAIL) ||
+        !try_lock(victim, me)) {
+      l.st.failed++;
+      return false;
+    }
+    uint64_t t = ctl_fetch(victim, TAIL), s = ctl_fetch(victim, SPLIT);
+    uint64_t k = (s - t + 1) / 2;
+    uint64_t room = cap_ - (l.head - ctl(me, TAIL));
+    if (k > room)
+      k = room;
+    if (k == 0) {
+      unlock(victim);
+      l.st.failed++;
+      return false;
+    }
+    /* copy [t, t+k) out of the victim's ring, in at most two runs */
+    for (uint64_t done = 0; done < k;) {
+      uint64_t from = (t + done) & (cap_ - 1);
+      uint64_t to = (l.head + done) & (cap_ - 1);
+      uint64_t run = k - done;
+      run = std::min<uint64_t>(run, cap_ - from);
+      run = std::min<uint64_t>(run, cap_ - to);
+      xbr::get(ring_.data(me) + to, ring_.data(victim) + from, run, victim);
+      done += run;
+    }
+    atomic_set(ctlp(victim, TAIL), (unsigned long long)(t + k), victim);
+    unlock(victim);
+    l.head += k;
+    l.st.steals++;
+    l.st.stolen += k;
+    return true;
+  }
+
+  unsigned long long ctl_fetch(int pe, int w) const {
+    return atomic_fetch(ctlp(pe, w), pe);
+  }
+
+  /*
+   * a waiter differs from its buddy in one hypercube dimension, so the
+   * buddy's WAITERS word holds bit d for waiter buddy ^ (1 << d): at most
+   * log2(npes) bits, whatever the PE numbers
+   */
+  void register_lifelines(int me) {
+    int npes = xbrtime_num_pes();
+    for (int d = 0; (1 << d) < npes; d++) {
+      int buddy = me ^ (1 << d);
+      if (buddy >= npes)
+        continue;
+      unsigned long long *w = ctlp(buddy, WAITERS);
+      unsigned long long old = atomic_fetch(w, buddy);
+      unsigned long long seen;
+      while ((seen = atomic_compare_swap(w, old, old | (1ull << d), buddy)) !=
+             old)
+        old = seen;
+    }
+  }
+
+  bool terminated() const {
+    return atomic_fetch(ctlp(0, OUTSTANDING), 0) == 0;
+  }
+
+  void report_idle(int me) {
+    local &l = locals_[me];
+    if (l.credit != 0) {
+      atomic_fetch_add(ctlp(0, OUTSTANDING),
+                       (unsigned long long)(int64_t)l.credit, 0);
+      l.credit = 0;
+    }
+  }
+
+  void worker(int me) {
+    local &l = locals_[me];
+    int npes = xbrtime_num_pes();
+    Task t;
+
+    l.st = work_pool_stats{};
+    while (true) {
+      /* drain local work */
+      unsigned n = 0;
+      while (pop(me, &t)) {
+        execute(me, t);
+        if (policy_ == victim_policy::lifeline && (++n & 15) == 0)
+          feed_lifelines(me);
+      }
+
+      /* idle: report completions, then look for work */
+      report_idle(me);
+      if (terminated())
+        return;
+      bool found = false;
+      int attempts = policy_ == victim_policy::lifeline ? npes : 1;
+      for (int a = 0; a < attempts && !found && npes > 1; a++) {
+        int v = (int)(next_rand(l) % (uint64_t)(npes - 1));
+        found = steal(me, v >= me ? v + 1 : v);
+      }
+      if (found)
+        continue;
+      if (policy_ == victim_policy::lifeline) {
+        register_lifelines(me);
+        while (ctl_fetch(me, MBOX) == 0 && !terminated())
+          sched_yield();
+      } else {
+        sched_yield();
+      }
+    }
+  }
+
+  size_t cap_;
+  size_t mcap_;
+  victim_policy policy_;
+  sym_vector<Task> ring_;
+  sym_vector<Task> mbox_;
+  sym_vector<line> ctl_;
+  std::vector<local> locals_;
+  void (*fn_)(void *, const Task &, work_pool &) = nullptr;
+  void *fp_ = nullptr;
+};
+
+} // namespace xbr
+
+#endif /* _XBRTIME_WORKPOOL_HPP_ */
+
+/* EOF */
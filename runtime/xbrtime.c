@@ -0,0 +1,28 @@
+/*
+ * xbrtime.c
+ *
+ * Copyright (C) 2017-2018 Tactical Computing Laboratories, LLC
+ * Copyright (C) 2024 Texas Tech University (Morello adaptation)
+ * All Rights Reserved
+ * contact@tactcomplabs.com
+ *
+ * This file is a part of the XBGAS-RUNTIME package.  For license
+ * information, see the LICENSE file in the top level directory
+ * of the distribution.
+ */
+
+/*!
+ * \file xbrtime.c
+ * \brief The single translation unit of libxbrtime
+ *
+ * Holds the runtime state (thread pool, symmetric heap, remote read
+ * cache, configuration) and every cold path, defined once. Programs
+ * compiled with -DXBRTIME_LIB include the headers as usual from any
+ * number of translation units and link this library.
+ */
+
+#define XBRTIME_LIB_SOURCE 1
+
+#include "xbrtime_morello.h"
+
+/* EOF */
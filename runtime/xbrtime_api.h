@@ -67,7 +67,7 @@ extern void xbrtime_close(void);
  * Returns the logical identifier of the current processing element.
  * This is used to identify which PE is executing the current code.
  */
-extern int xbrtime_mype(void);
+__XBRTIME_HOT int xbrtime_mype(void);
 
 /*!
  * \brief Get the total number of configured PEs
@@ -76,7 +76,7 @@ extern int xbrtime_mype(void);
  * Returns the total number of processing elements available in the
  * current xBGAS runtime configuration.
  */
-extern int xbrtime_num_pes(void);
+__XBRTIME_HOT int xbrtime_num_pes(void);
 
 /* ========================================================================= */
 /*                           MEMORY MANAGEMENT                              */
@@ -93,6 +93,25 @@ extern int xbrtime_num_pes(void);
  */
 extern void *xbrtime_malloc(size_t sz);
 
+/*!
+ * \brief Allocate an aligned block of symmetric memory
+ * \param align Requested alignment in bytes (a power of two)
+ * \param sz Minimum size of the allocated block in bytes
+ * \return Pointer to the calling PE's copy on success, NULL on failure
+ *
+ * The block occupies the same offset in every PE's heap partition, so
+ * the address is aligned to 'align' on all PEs.
+ */
+extern void *xbrtime_malloc_aligned(size_t align, size_t sz);
+
+/*!
+ * \brief Translate a symmetric address to the copy owned by a PE
+ * \param addr Any address inside a symmetric allocation
+ * \param pe Target processing element identifier
+ * \return Address of the target PE's copy, or NULL if addr is not symmetric
+ */
+__XBRTIME_HOT void *xbrtime_ptr(const void *addr, int pe);
+
 /*!
  * \brief Free a previously allocated memory block
  * \param ptr Pointer to the memory block to free
@@ -112,7 +131,7 @@ extern void xbrtime_free(void *ptr);
  * processing element. This is useful for validation before performing
  * remote memory operations.
  */
-extern int xbrtime_addr_accessible(const void *addr, int pe);
+__XBRTIME_HOT int xbrtime_addr_accessible(const void *addr, int pe);
 
 /* ========================================================================= */
 /*                           SYNCHRONIZATION                                */
@@ -142,8 +161,8 @@ extern void xbrtime_barrier(void);
  * Reads long long integer data from a remote processing element.
  * The operation is performed element-by-element with the specified stride.
  */
-extern void xbrtime_longlong_get(long long *dest, const long long *src, 
-                                 size_t nelems, int stride, int pe);
+__XBRTIME_HOT void xbrtime_longlong_get(long long *dest, const long long *src,
+                                        size_t nelems, int stride, int pe);
 
 /*!
  * \brief Put (write) long long data to remote PE
@@ -156,8 +175,8 @@ extern void xbrtime_longlong_get(long long *dest, const long long *src,
  * Writes long long integer data to a remote processing element.
  * The operation is performed element-by-element with the specified stride.
  */
-extern void xbrtime_longlong_put(long long *dest, const long long *src, 
-                                 size_t nelems, int stride, int pe);
+__XBRTIME_HOT void xbrtime_longlong_put(long long *dest, const long long *src,
+                                        size_t nelems, int stride, int pe);
 
 /*!
  * \brief Get (read) unsigned long long data from remote PE
@@ -169,9 +188,9 @@ extern void xbrtime_longlong_put(long long *dest, const long long *src,
  *
  * Reads unsigned long long integer data from a remote processing element.
  */
-extern void xbrtime_ulonglong_get(unsigned long long *dest, 
-                                  const unsigned long long *src, 
-                                  size_t nelems, int stride, int pe);
+__XBRTIME_HOT void xbrtime_ulonglong_get(unsigned long long *dest,
+                                         const unsigned long long *src,
+                                         size_t nelems, int stride, int pe);
 
 /*!
  * \brief Get (read) integer data from remote PE
@@ -183,8 +202,8 @@ extern void xbrtime_ulonglong_get(unsigned long long *dest,
  *
  * Reads integer data from a remote processing element.
  */
-extern void xbrtime_int_get(int *dest, const int *src, 
-                            size_t nelems, int stride, int pe);
+__XBRTIME_HOT void xbrtime_int_get(int *dest, const int *src,
+                                   size_t nelems, int stride, int pe);
 
 /*!
  * \brief Put (write) integer data to remote PE
@@ -196,8 +215,438 @@ extern void xbrtime_int_get(int *dest, const int *src,
  *
  * Writes integer data to a remote processing element.
  */
-extern void xbrtime_int_put(int *dest, const int *src, 
-                            size_t nelems, int stride, int pe);
+__XBRTIME_HOT void xbrtime_int_put(int *dest, const int *src,
+                                   size_t nelems, int stride, int pe);
+
+/* ========================================================================= */
+/*                           REMOTE READ CACHE                              */
+/* ========================================================================= */
+
+/*!
+ * \brief Make remote gets from a symmetric allocation cacheable
+ * \param ptr Any PE's copy of a symmetric allocation
+ * \return 0 on success, nonzero if ptr is not a symmetric allocation or
+ *         too many allocations are cacheable
+ *
+ * Gets from another PE's copy are then served from the caller's cache of
+ * remote blocks. Cached data is dropped at every barrier; puts to the
+ * allocation are not seen before then.
+ */
+extern int xbrtime_cache_enable(void *ptr);
+
+/*!
+ * \brief Stop caching remote gets from a symmetric allocation
+ * \param ptr Any PE's copy of a symmetric allocation
+ */
+extern void xbrtime_cache_disable(void *ptr);
+
+/*!
+ * \brief Drop the cached blocks of one allocation on every PE
+ * \param ptr Any PE's copy of a cacheable allocation
+ */
+extern void xbrtime_cache_invalidate(void *ptr);
+
+/*!
+ * \brief Drop every cached block on every PE
+ *
+ * Called by xbrtime_barrier().
+ */
+extern void xbrtime_cache_invalidate_all(void);
+
+/*!
+ * \brief Read the remote read cache counters of a PE
+ * \param pe Processing element identifier
+ * \param stats Destination of the hit, miss and bypass counts
+ */
+extern void xbrtime_cache_stats(int pe, xbrtime_cache_stats_t *stats);
+
+/*!
+ * \brief Zero the remote read cache counters of every PE
+ */
+extern void xbrtime_cache_stats_reset(void);
+
+/* ========================================================================= */
+/*                           STREAMING READS                                */
+/* ========================================================================= */
+
+/*!
+ * \brief Open a double-buffered stream over a remote range
+ * \param src Remote address, or any PE's copy of a symmetric range
+ * \param n Number of bytes to read
+ * \param pe Source processing element identifier
+ * \param chunk Bytes per chunk; 0 selects the default chunk size
+ * \return Stream on success, NULL on failure
+ *
+ * The stream holds two chunks of local memory. The next chunk is fetched
+ * while the caller consumes the current one.
+ */
+extern xbrtime_stream_t *xbrtime_stream_open(const void *src, size_t n,
+                                             int pe, size_t chunk);
+
+/*!
+ * \brief Get the next chunk of a stream
+ * \param s Open stream
+ * \param len Receives the number of bytes in the chunk
+ * \return Local copy of the chunk, valid until the next call, or NULL at
+ *         the end of the range
+ */
+extern const void *xbrtime_stream_next(xbrtime_stream_t *s, size_t *len);
+
+/*!
+ * \brief Close a stream and release its buffers
+ * \param s Stream returned by xbrtime_stream_open()
+ */
+extern void xbrtime_stream_close(xbrtime_stream_t *s);
+
+/* ========================================================================= */
+/*                           CHECKPOINT / RESTART                           */
+/* ========================================================================= */
+
+/*!
+ * \brief Checkpoint the symmetric heap to a file
+ * \param path Checkpoint file; an existing file is replaced only once the
+ *        new one is complete
+ * \return 0 on success, non-zero on error
+ *
+ * Every PE writes its own partition in parallel, after a manifest of the
+ * live allocations. Collective: call it while no PE is running.
+ */
+extern int xbrtime_checkpoint(const char *path);
+
+/*!
+ * \brief Restore the symmetric heap from a checkpoint
+ * \param path File written by xbrtime_checkpoint() with the same PE count
+ * \return 0 on success, non-zero on error
+ *
+ * Replaces all current allocations. Every allocation of the checkpoint is
+ * restored at its old offset. Collective: call it while no PE is running.
+ */
+extern int xbrtime_restart(const char *path);
+
+/*!
+ * \brief Enumerate the live symmetric allocations
+ * \param index Position of the allocation, in heap order
+ * \param size Receives the allocation size (may be NULL)
+ * \return The caller's copy of the allocation, or NULL past the last one
+ *
+ * Finds the allocations of a restart, or of a heap attached to a named
+ * segment (XBRTIME_HEAP_SHM) at initialization.
+ */
+extern void *xbrtime_heap_allocation(int index, size_t *size);
+
+/*!
+ * \brief Get the usage of the symmetric heap
+ * \param stats Destination of the used bytes, high-water marks, holes and
+ *        allocation counts
+ */
+extern void xbrtime_heap_stats(xbrtime_heap_stats_t *stats);
+
+/*!
+ * \brief Restart the high-water marks from the current usage and zero the
+ *        allocation counts
+ */
+extern void xbrtime_heap_stats_reset(void);
+
+/*!
+ * \brief Free a symmetric block without synchronizing
+ * \param ptr Base pointer of the allocation
+ *
+ * Retires the block to the caller's limbo list; it is freed once every PE
+ * has passed a later barrier or quiescent point, so no PE may use it past
+ * its next barrier. Replaces a free between two barriers.
+ */
+extern void xbrtime_free_deferred(void *ptr);
+
+/*!
+ * \brief Declare that the caller no longer uses any retired block
+ *
+ * Barriers and collective phases do this implicitly; PEs that retire
+ * blocks between barriers may call it to let them be freed sooner.
+ */
+extern void xbrtime_quiesce(void);
+
+/*!
+ * \brief Get the number of retired blocks not yet freed
+ */
+extern size_t xbrtime_free_pending(void);
+
+/*!
+ * \brief Allocate a block in the caller's own partition
+ * \param sz Size of the block in bytes
+ * \return Global reference to the block, or XBRTIME_GREF_NULL
+ *
+ * Not collective and needs no barrier: one PE may grow a distributed
+ * structure on its own. Any PE may use the reference.
+ */
+extern xbrtime_gref_t xbrtime_malloc_local(size_t sz);
+
+/*!
+ * \brief Free a block of xbrtime_malloc_local()
+ * \param ref Global reference of the block; any PE may free it
+ */
+extern void xbrtime_free_local(xbrtime_gref_t ref);
+
+/*!
+ * \brief Global reference of pe's copy of a symmetric address
+ * \param pe Target PE
+ * \param addr Any PE's copy of the address
+ * \return The reference, or XBRTIME_GREF_NULL if addr is not symmetric
+ */
+__XBRTIME_HOT xbrtime_gref_t xbrtime_gref(int pe, const void *addr);
+
+/*!
+ * \brief PE a non-null global reference points into
+ */
+__XBRTIME_HOT int xbrtime_gref_pe(xbrtime_gref_t ref);
+
+/*!
+ * \brief Address a global reference points to, in its PE's partition
+ * \return The address, or NULL for XBRTIME_GREF_NULL
+ */
+__XBRTIME_HOT void *xbrtime_gref_ptr(xbrtime_gref_t ref);
+
+/* ========================================================================= */
+/*                           PARALLEL FILE I/O                              */
+/* ========================================================================= */
+
+/*!
+ * \brief Write one region per PE of a shared file, in parallel
+ * \param fd File open for writing (not O_DIRECT)
+ * \param bufs Source buffer of each PE, indexed by PE
+ * \param counts Bytes written by each PE
+ * \param offsets File offset of each PE's region, or NULL to pack the
+ *        regions in PE order from offset 0
+ * \param aggregators Number of PEs that combine small pieces into whole
+ *        stripes, 0 for none, or XBRTIME_PIO_AUTO
+ * \return 0 on success, non-zero on error
+ *
+ * Regions must not overlap. Collective: call it while no PE is running.
+ */
+extern int xbrtime_write_all(int fd, const void *const *bufs,
+                             const size_t *counts, const off_t *offsets,
+                             int aggregators);
+
+/*!
+ * \brief Read one region per PE of a shared file, in parallel
+ * \param fd File open for reading (not O_DIRECT)
+ * \param bufs Destination buffer of each PE, indexed by PE
+ * \param counts Bytes read by each PE
+ * \param offsets File offset of each PE's region, or NULL for packed
+ * \param aggregators As for xbrtime_write_all()
+ * \return 0 on success, non-zero on error (including a short file)
+ */
+extern int xbrtime_read_all(int fd, void *const *bufs, const size_t *counts,
+                            const off_t *offsets, int aggregators);
+
+/*!
+ * \brief xbrtime_write_all() on a path; the file is created if missing
+ *        and cut off after the last region
+ */
+extern int xbrtime_write_all_path(const char *path, const void *const *bufs,
+                                  const size_t *counts, const off_t *offsets,
+                                  int aggregators);
+
+/*!
+ * \brief xbrtime_read_all() on a path
+ */
+extern int xbrtime_read_all_path(const char *path, void *const *bufs,
+                                 const size_t *counts, const off_t *offsets,
+                                 int aggregators);
+
+/* ========================================================================= */
+/*                           HISTOGRAM                                      */
+/* ========================================================================= */
+
+/*!
+ * \brief Count the keys of every PE into one global histogram
+ * \param local_keys Bin numbers held by each PE, indexed by PE
+ * \param n Number of keys of each PE
+ * \param bins Receives the nbins counters
+ * \param nbins Number of bins; larger keys are not counted
+ * \return 0 on success, non-zero on error
+ *
+ * Each PE bins its keys privately, then sums its own slice of the bins
+ * over all PEs. Collective: call it while no PE is running.
+ */
+extern int xbrtime_histogram(const uint64_t *const *local_keys,
+                             const size_t *n, uint64_t *bins, size_t nbins);
+
+/*!
+ * \brief xbrtime_histogram() into caller-chosen slices
+ * \param slices Destination of each PE's slice, indexed by PE
+ * \param first First bin of each PE's slice
+ * \param counts Number of bins in each PE's slice
+ *
+ * Bins outside every slice are counted but not stored.
+ */
+extern int xbrtime_histogram_into(const uint64_t *const *local_keys,
+                                  const size_t *n, size_t nbins,
+                                  uint64_t *const *slices, const size_t *first,
+                                  const size_t *counts);
+
+/* ========================================================================= */
+/*                           TOPOLOGY-AWARE COLLECTIVES                     */
+/* ========================================================================= */
+
+/*
+ * Called by every PE from its own pool thread. With several L3 (or
+ * socket) domains they run within each domain first and then among the
+ * domain leaders; see xbMrtime-coll.h.
+ */
+
+/*!
+ * \brief Get the collective mode in effect
+ * \return XBRTIME_COLL_FLAT or XBRTIME_COLL_HIER
+ */
+extern int xbrtime_coll_mode(void);
+
+/*!
+ * \brief Set the collective mode while no collective is running
+ * \param mode XBRTIME_COLL_AUTO, XBRTIME_COLL_FLAT or XBRTIME_COLL_HIER
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_coll_set_mode(int mode);
+
+/*!
+ * \brief Get the number of topology domains holding PEs
+ */
+extern int xbrtime_topo_ndomains(void);
+
+/*!
+ * \brief Get the domain of a PE; the PEs of a domain are consecutive
+ */
+extern int xbrtime_topo_domain(int pe);
+
+/*!
+ * \brief Get the CPU a PE is bound to, or -1
+ */
+extern int xbrtime_topo_cpu(int pe);
+
+/*!
+ * \brief Barrier over all PEs
+ */
+extern void xbrtime_coll_barrier(void);
+
+/*!
+ * \brief Copy nbytes from src at root to dest at every PE
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_coll_broadcast(void *dest, const void *src, size_t nbytes,
+                                  int root);
+
+/*!
+ * \brief Combine src of every PE into dest at root
+ * \param type XBRTIME_COLL_INT, _LONGLONG, _ULONGLONG or _DOUBLE
+ * \param op XBRTIME_COLL_SUM, _MIN or _MAX
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_coll_reduce(void *dest, const void *src, size_t nelems,
+                               int type, int op, int root);
+
+/*!
+ * \brief Combine src of every PE into dest at every PE; dest may be src
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_coll_allreduce(void *dest, const void *src, size_t nelems,
+                                  int type, int op);
+
+/* ========================================================================= */
+/*                           TRACING                                        */
+/* ========================================================================= */
+
+/*!
+ * \brief Start recording the runtime calls of every PE to a trace file
+ * \param path File to create
+ * \return 0 on success, non-zero on error
+ *
+ * xbrtime_init() does this when XBRTIME_TRACE names a file. Call it while
+ * no PE is working; bench/xbrtime_replay re-issues the trace.
+ */
+extern int xbrtime_trace_open(const char *path);
+
+/*!
+ * \brief Write out and close the trace; xbrtime_close() does it too
+ */
+extern void xbrtime_trace_close(void);
+
+/* ========================================================================= */
+/*                           RANDOM NUMBERS                                 */
+/* ========================================================================= */
+
+/*!
+ * \brief Start stream 'stream' of a counter-based generator
+ * \param r Stream state, private to the caller
+ * \param seed Key shared by all streams of a run
+ * \param stream Stream number, eg xbrtime_mype()
+ *
+ * The i-th value of a stream depends only on (seed, stream, i).
+ */
+static inline void xbrtime_rand_init(xbrtime_rand_t *r, uint64_t seed,
+                                     uint64_t stream);
+
+/*!
+ * \brief Value 'index' of a stream, without any state
+ */
+static inline uint64_t xbrtime_rand_at(uint64_t seed, uint64_t stream,
+                                       uint64_t index);
+
+/*!
+ * \brief Jump over the next n values of a stream in constant time
+ */
+static inline void xbrtime_rand_skip(xbrtime_rand_t *r, uint64_t n);
+
+/*!
+ * \brief Next 64 random bits of a stream
+ */
+static inline uint64_t xbrtime_rand_u64(xbrtime_rand_t *r);
+
+/*!
+ * \brief Next value of a stream in [0, n)
+ */
+static inline uint64_t xbrtime_rand_range(xbrtime_rand_t *r, uint64_t n);
+
+/*!
+ * \brief Next n values of a stream in [0, bound), computed in bulk
+ */
+static inline void xbrtime_rand_fill_range(xbrtime_rand_t *r, uint64_t *dst,
+                                           size_t n, uint64_t bound);
+
+/*!
+ * \brief Value n of the HPCC RandomAccess sequence (HPCC starts())
+ * \return Generator state; xbrtime_hpcc_next() steps it
+ */
+static inline uint64_t xbrtime_hpcc_starts(int64_t n);
+
+/* ========================================================================= */
+/*                           BSP SUPERSTEPS                                 */
+/* ========================================================================= */
+
+/*!
+ * \brief Record a put for the end of the superstep
+ * \param dest Symmetric destination; its copy on 'pe' is written
+ * \param src Source, copied before the call returns
+ * \param nbytes Bytes to move
+ * \param pe Target PE
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_bsp_put(void *dest, const void *src, size_t nbytes, int pe);
+
+/*!
+ * \brief Record a get for the end of the superstep
+ * \param dest Local destination, valid after xbrtime_bsp_sync()
+ * \param src Symmetric source; its copy on 'pe' is read
+ * \return 0 on success, non-zero on error
+ */
+extern int xbrtime_bsp_get(void *dest, const void *src, size_t nbytes, int pe);
+
+/*!
+ * \brief End the superstep; called by every PE from its pool thread
+ * \return 0 on success, non-zero on error
+ *
+ * The gets read the values from before the superstep's puts land. One
+ * barrier completes the superstep.
+ */
+extern int xbrtime_bsp_sync(void);
 
 /* ========================================================================= */
 /*                           COLLECTIVE OPERATIONS                          */
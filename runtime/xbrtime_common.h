@@ -52,8 +52,19 @@ extern "C" {
 
 #include "xbMrtime-types.h"
 #include "xbMrtime-alloc.h"
+#include "xbMrtime-stream.h"
 #include "xbMrtime-macros.h"
 #include "threadpool.h"
+#include "xbMrtime-inline.h"
+#include "xbMrtime-epoch.h"
+#include "xbMrtime-local.h"
+#include "xbMrtime-trace.h"
+#include "xbMrtime-rand.h"
+#include "xbMrtime-ckpt.h"
+#include "xbMrtime-pio.h"
+#include "xbMrtime-hist.h"
+#include "xbMrtime-coll.h"
+#include "xbMrtime-bsp.h"
 
 /* ========================================================================= */
 /*                           CONFIGURATION MACROS                           */
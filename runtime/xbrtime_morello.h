@@ -42,11 +42,22 @@ extern "C" {
 #include "xbMrtime-types.h"
 // #include "xbMrtime-api.h"
 #include "xbMrtime-alloc.h"
+#include "xbMrtime-stream.h"
 // #include "xbrtime-version.h"
 #include "xbMrtime-macros.h"
 // #include "xbrtime-collectives.h"
 // #include "xbrtime-atomics.h"
 #include "threadpool.h" // From xbgas-runtime-thread
+#include "xbMrtime-inline.h"
+#include "xbMrtime-epoch.h"
+#include "xbMrtime-local.h"
+#include "xbMrtime-trace.h"
+#include "xbMrtime-rand.h"
+#include "xbMrtime-ckpt.h"
+#include "xbMrtime-pio.h"
+#include "xbMrtime-hist.h"
+#include "xbMrtime-coll.h"
+#include "xbMrtime-bsp.h"
 #include <cheri.h>
 // #include <cheriintrin.h>
 
@@ -55,6 +66,10 @@ extern "C" {
 
 #define MAX_NUM_OF_THREADS 16 // From xbgas-runtime-thread
 
+extern volatile uint64_t *xb_barrier;
+extern volatile tpool_thread_t *threads;
+
+#ifndef __XBRTIME_DECLARE_ONLY
 volatile uint64_t *xb_barrier;
 volatile tpool_thread_t *threads;
 
@@ -73,7 +88,7 @@ __attribute__((constructor)) void __xbrtime_ctor() {
   printf("[R] Entered __xbrtime_ctor()\n");
 #endif
 
-  xb_barrier = malloc(sizeof(uint64_t) * 2 * 10);
+  xb_barrier = (volatile uint64_t *) malloc(sizeof(uint64_t) * 2 * 10);
 
   //  ...   ...   ...   ...   ...   ...   ...   ...   ...   ...   numOfThreads
   // int i = 0;
@@ -173,11 +188,16 @@ __attribute__((destructor)) void __xbrtime_dtor() {
     // Cleanup the allocated memory for `xb_barrier`
     free((void *)xb_barrier);
 
+    // Unmap the symmetric heap and drop the remote read cache
+    __xbrtime_heap_fini();
+    __xbrtime_cache_fini();
+
 #if XBGAS_DEBUG
     fprintf(stdout, "[R] Destructor completed.\n");
     fflush(stdout);
 #endif
 }
+#endif /* __XBRTIME_DECLARE_ONLY */
 
 
 /* ---------------------------------------- FUNCTION PROTOTYPES */
@@ -200,7 +220,7 @@ void xbrtime_close();
       \param pe is the target processing element
       \return 1 on success, 0 otherwise
 */
-extern int xbrtime_addr_accessible(const void *addr, int pe);
+__XBRTIME_HOT int xbrtime_addr_accessible(const void *addr, int pe);
 
 /*!   \fn void *xbrtime_malloc( size_t sz )
       \brief Allocates a block of contiguous shared memory of minimum size, 'sz'
@@ -209,6 +229,23 @@ extern int xbrtime_addr_accessible(const void *addr, int pe);
 */
 extern void *xbrtime_malloc(size_t sz);
 
+/*!   \fn void *xbrtime_malloc_aligned( size_t align, size_t sz )
+      \brief Allocates a symmetric block of at least 'sz' bytes whose address
+             is a multiple of 'align' on every PE
+      \param align is the requested alignment; must be a power of two
+      \param sz is the minimum size of the allocated block
+      \return Valid pointer to the calling PE's copy on success, NULL otherwise
+*/
+extern void *xbrtime_malloc_aligned(size_t align, size_t sz);
+
+/*!   \fn void *xbrtime_ptr( const void *addr, int pe )
+      \brief Translates a symmetric address into the copy owned by 'pe'
+      \param addr is any address inside a symmetric allocation
+      \param pe is the target processing element
+      \return Address of pe's copy on success, NULL if addr is not symmetric
+*/
+__XBRTIME_HOT void *xbrtime_ptr(const void *addr, int pe);
+
 /*!   \fn void xbrtime_free( void *ptr )
       \brief Free's a target memory block starting at ptr
       \param *ptr is a valid base pointer to an allocated block
@@ -220,13 +257,13 @@ extern void xbrtime_free(void *ptr);
       \brief Returns the logical PE number of the calling entity
       \return Logical PE on success, nonzero otherwise
 */
-extern int xbrtime_mype();
+__XBRTIME_HOT int xbrtime_mype();
 
 /*!   \fn int xbrtime_num_pes()
       \brief Returns the total number of configured PEs
       \return Total PEs on success, nonzero otherwise
 */
-extern int xbrtime_num_pes();
+__XBRTIME_HOT int xbrtime_num_pes();
 
 /*!   \fn void xbrtime_barrier()
       \brief Performs a global barrier operation of all configured PEs
@@ -234,6 +271,395 @@ extern int xbrtime_num_pes();
 */
 extern void xbrtime_barrier();
 
+/*!   \fn void xbrtime_barrier_all()
+      \brief Queues a barrier on the control lane of every PE
+      \return Void
+*/
+extern void xbrtime_barrier_all();
+
+/*!   \fn void xbrtime_int_broadcast( int *src, int *dest, size_t nelems, int stride, int root_pe )
+      \brief Copies nelems ints from root_pe's src into every PE's dest
+      \return Void
+*/
+extern void xbrtime_int_broadcast(int *src, int *dest, size_t nelems,
+                                  int stride, int root_pe);
+
+/*!   \fn void xbrtime_longlong_broadcast( long long *src, long long *dest, size_t nelems, int stride, int root_pe )
+      \brief Copies nelems long longs from root_pe's src into every PE's dest
+      \return Void
+*/
+extern void xbrtime_longlong_broadcast(long long *src, long long *dest,
+                                       size_t nelems, int stride, int root_pe);
+
+/*!   \fn void xbrtime_int_reduce_sum( int *dest, const int *src, size_t nelems, int stride, int pe )
+      \brief Sums nelems ints of src into every element of dest
+      \return Void
+*/
+extern void xbrtime_int_reduce_sum(int *dest, const int *src, size_t nelems,
+                                   int stride, int pe);
+
+/*!   \fn void xbrtime_longlong_reduce_sum( long long *dest, const long long *src, size_t nelems, int stride, int pe )
+      \brief Sums nelems long longs of src into every element of dest
+      \return Void
+*/
+extern void xbrtime_longlong_reduce_sum(long long *dest, const long long *src,
+                                        size_t nelems, int stride, int pe);
+
+/*!   \fn int xbrtime_cache_enable( void *ptr )
+      \brief Makes remote gets from a symmetric allocation cacheable
+      \param ptr Any PE's copy of a symmetric allocation
+      \return 0 on success, nonzero if ptr is not cacheable
+*/
+extern int xbrtime_cache_enable(void *ptr);
+
+/*!   \fn void xbrtime_cache_disable( void *ptr )
+      \brief Stops caching remote gets from a symmetric allocation
+      \param ptr Any PE's copy of a symmetric allocation
+      \return Void
+*/
+extern void xbrtime_cache_disable(void *ptr);
+
+/*!   \fn void xbrtime_cache_invalidate( void *ptr )
+      \brief Drops the blocks of one allocation from every PE's cache
+      \param ptr Any PE's copy of a cacheable allocation
+      \return Void
+*/
+extern void xbrtime_cache_invalidate(void *ptr);
+
+/*!   \fn void xbrtime_cache_invalidate_all()
+      \brief Drops every cached block; implied by xbrtime_barrier
+      \return Void
+*/
+extern void xbrtime_cache_invalidate_all(void);
+
+/*!   \fn void xbrtime_cache_stats( int pe, xbrtime_cache_stats_t *stats )
+      \brief Copies the remote read cache counters of 'pe'
+      \param pe Processing element identifier
+      \param stats Destination of the counters
+      \return Void
+*/
+extern void xbrtime_cache_stats(int pe, xbrtime_cache_stats_t *stats);
+
+/*!   \fn void xbrtime_cache_stats_reset()
+      \brief Zeroes the remote read cache counters of every PE
+      \return Void
+*/
+extern void xbrtime_cache_stats_reset(void);
+
+/*!   \fn xbrtime_stream_t *xbrtime_stream_open( const void *src, size_t n,
+                                              int pe, size_t chunk )
+      \brief Opens a double-buffered stream over n bytes at src on PE pe
+      \param src Remote address, or any PE's copy of a symmetric range
+      \param n Number of bytes to read
+      \param pe Source processing element identifier
+      \param chunk Bytes per chunk; 0 selects _XBRTIME_STREAM_CHUNK_
+      \return Stream on success, NULL otherwise
+*/
+extern xbrtime_stream_t *xbrtime_stream_open(const void *src, size_t n,
+                                             int pe, size_t chunk);
+
+/*!   \fn const void *xbrtime_stream_next( xbrtime_stream_t *s, size_t *len )
+      \brief Returns the next chunk and starts fetching the one after it
+      \param s Open stream
+      \param len Receives the number of bytes in the chunk
+      \return Local copy of the chunk, or NULL at the end of the range
+*/
+extern const void *xbrtime_stream_next(xbrtime_stream_t *s, size_t *len);
+
+/*!   \fn void xbrtime_stream_close( xbrtime_stream_t *s )
+      \brief Stops a stream and releases its buffers
+      \param s Stream returned by xbrtime_stream_open
+      \return Void
+*/
+extern void xbrtime_stream_close(xbrtime_stream_t *s);
+
+/*!   \fn int xbrtime_checkpoint( const char *path )
+      \brief Writes every PE's heap partition and the allocation manifest
+      \param path Checkpoint file, replaced only once complete
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_checkpoint(const char *path);
+
+/*!   \fn int xbrtime_restart( const char *path )
+      \brief Restores the heap and its allocations from a checkpoint
+      \param path Checkpoint file written with the same number of PEs
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_restart(const char *path);
+
+/*!   \fn void *xbrtime_heap_allocation( int index, size_t *size )
+      \brief Returns the caller's copy of the index-th live allocation
+      \param index Position of the allocation in heap order
+      \param size Receives the size of the allocation (optional)
+      \return Symmetric address, or NULL past the last allocation
+*/
+extern void *xbrtime_heap_allocation(int index, size_t *size);
+
+/*!   \fn void xbrtime_heap_stats( xbrtime_heap_stats_t *stats )
+      \brief Copies the usage, high-water marks and holes of the symmetric heap
+      \param stats Destination of the counters
+      \return Void
+*/
+extern void xbrtime_heap_stats(xbrtime_heap_stats_t *stats);
+
+/*!   \fn void xbrtime_heap_stats_reset()
+      \brief Restarts the high-water marks and zeroes the allocation counts
+      \return Void
+*/
+extern void xbrtime_heap_stats_reset(void);
+
+/*!   \fn void xbrtime_free_deferred( void *ptr )
+      \brief Retires a symmetric block; it is freed once every PE has passed a later quiescent point
+      \param *ptr is a valid base pointer to an allocated block
+      \return Void
+*/
+extern void xbrtime_free_deferred(void *ptr);
+
+/*!   \fn void xbrtime_quiesce()
+      \brief Declares that the caller no longer uses any retired block
+      \return Void
+*/
+extern void xbrtime_quiesce(void);
+
+/*!   \fn size_t xbrtime_free_pending()
+      \brief Returns the number of retired blocks not yet freed
+      \return Blocks on all limbo lists
+*/
+extern size_t xbrtime_free_pending(void);
+
+/*!   \fn xbrtime_gref_t xbrtime_malloc_local( size_t sz )
+      \brief Allocates a block in the caller's own partition without synchronizing
+      \param sz is the size of the block in bytes
+      \return Global reference to the block on success, XBRTIME_GREF_NULL otherwise
+*/
+extern xbrtime_gref_t xbrtime_malloc_local(size_t sz);
+
+/*!   \fn void xbrtime_free_local( xbrtime_gref_t ref )
+      \brief Frees a block of xbrtime_malloc_local(); any PE may call it
+      \param ref is the global reference of the block
+      \return Void
+*/
+extern void xbrtime_free_local(xbrtime_gref_t ref);
+
+/*!   \fn xbrtime_gref_t xbrtime_gref( int pe, const void *addr )
+      \brief Builds the global reference of pe's copy of a symmetric address
+      \param pe is the target processing element
+      \param *addr is any PE's copy of the address
+      \return Global reference, XBRTIME_GREF_NULL if addr is not symmetric
+*/
+__XBRTIME_HOT xbrtime_gref_t xbrtime_gref(int pe, const void *addr);
+
+/*!   \fn int xbrtime_gref_pe( xbrtime_gref_t ref )
+      \brief Returns the PE a global reference points into
+      \param ref is a non-null global reference
+      \return PE number
+*/
+__XBRTIME_HOT int xbrtime_gref_pe(xbrtime_gref_t ref);
+
+/*!   \fn void *xbrtime_gref_ptr( xbrtime_gref_t ref )
+      \brief Returns the address a global reference points to
+      \param ref is a global reference
+      \return Address in the owning PE's partition, NULL for XBRTIME_GREF_NULL
+*/
+__XBRTIME_HOT void *xbrtime_gref_ptr(xbrtime_gref_t ref);
+
+/*!   \fn int xbrtime_trace_open( const char *path )
+      \brief Records the runtime calls of every PE to a trace file
+      \param path is the file to create
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_trace_open(const char *path);
+
+/*!   \fn void xbrtime_trace_close()
+      \brief Writes out and closes the trace
+      \return Void
+*/
+extern void xbrtime_trace_close(void);
+
+/*!   \fn void xbrtime_rand_init( xbrtime_rand_t *r, uint64_t seed, uint64_t stream )
+      \brief Starts a counter-based random stream at its first value
+      \param r is the stream state
+      \param seed is the key shared by all streams of a run
+      \param stream is the stream number, eg the PE
+      \return Void
+*/
+static inline void xbrtime_rand_init(xbrtime_rand_t *r, uint64_t seed,
+                                     uint64_t stream);
+
+/*!   \fn uint64_t xbrtime_rand_at( uint64_t seed, uint64_t stream, uint64_t index )
+      \brief Returns value 'index' of a stream without any state
+      \return 64 random bits
+*/
+static inline uint64_t xbrtime_rand_at(uint64_t seed, uint64_t stream,
+                                       uint64_t index);
+
+/*!   \fn void xbrtime_rand_skip( xbrtime_rand_t *r, uint64_t n )
+      \brief Jumps over the next n values of a stream in constant time
+      \return Void
+*/
+static inline void xbrtime_rand_skip(xbrtime_rand_t *r, uint64_t n);
+
+/*!   \fn uint64_t xbrtime_rand_u64( xbrtime_rand_t *r )
+      \brief Returns the next 64 random bits of a stream
+      \return 64 random bits
+*/
+static inline uint64_t xbrtime_rand_u64(xbrtime_rand_t *r);
+
+/*!   \fn uint64_t xbrtime_rand_range( xbrtime_rand_t *r, uint64_t n )
+      \brief Returns the next value of a stream in [0, n)
+      \return Random value below n
+*/
+static inline uint64_t xbrtime_rand_range(xbrtime_rand_t *r, uint64_t n);
+
+/*!   \fn void xbrtime_rand_fill_range( xbrtime_rand_t *r, uint64_t *dst, size_t n, uint64_t bound )
+      \brief Fills dst with the next n values of a stream in [0, bound)
+      \return Void
+*/
+static inline void xbrtime_rand_fill_range(xbrtime_rand_t *r, uint64_t *dst,
+                                           size_t n, uint64_t bound);
+
+/*!   \fn uint64_t xbrtime_hpcc_starts( int64_t n )
+      \brief Returns value n of the HPCC RandomAccess sequence
+      \return Generator state to continue from with xbrtime_hpcc_next()
+*/
+static inline uint64_t xbrtime_hpcc_starts(int64_t n);
+
+/*!   \fn int xbrtime_bsp_put( void *dest, const void *src, size_t nbytes, int pe )
+      \brief Records a put of nbytes to symmetric dest on pe for the next xbrtime_bsp_sync()
+      \param src Copied at once, so it may be reused when the call returns
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_bsp_put(void *dest, const void *src, size_t nbytes, int pe);
+
+/*!   \fn int xbrtime_bsp_get( void *dest, const void *src, size_t nbytes, int pe )
+      \brief Records a get of nbytes from symmetric src on pe for the next xbrtime_bsp_sync()
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_bsp_get(void *dest, const void *src, size_t nbytes, int pe);
+
+/*!   \fn int xbrtime_bsp_sync()
+      \brief Ends a superstep on every PE: serves its gets, then lands its puts
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_bsp_sync(void);
+
+/*!   \fn int xbrtime_write_all( int fd, const void *const *bufs, const size_t *counts, const off_t *offsets, int aggregators )
+      \brief Every PE writes its region of one shared file in parallel
+      \param fd File open for writing (not O_DIRECT)
+      \param bufs PE-indexed array of source buffers
+      \param counts PE-indexed array of byte counts
+      \param offsets PE-indexed file offsets, or NULL to pack in PE order
+      \param aggregators PEs combining small pieces, 0 for none, or XBRTIME_PIO_AUTO
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_write_all(int fd, const void *const *bufs,
+                             const size_t *counts, const off_t *offsets,
+                             int aggregators);
+
+/*!   \fn int xbrtime_read_all( int fd, void *const *bufs, const size_t *counts, const off_t *offsets, int aggregators )
+      \brief Every PE reads its region of one shared file in parallel
+      \param fd File open for reading (not O_DIRECT)
+      \param bufs PE-indexed array of destination buffers
+      \param counts PE-indexed array of byte counts
+      \param offsets PE-indexed file offsets, or NULL to pack in PE order
+      \param aggregators PEs combining small pieces, 0 for none, or XBRTIME_PIO_AUTO
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_read_all(int fd, void *const *bufs, const size_t *counts,
+                            const off_t *offsets, int aggregators);
+
+/*!   \fn int xbrtime_write_all_path( const char *path, const void *const *bufs, const size_t *counts, const off_t *offsets, int aggregators )
+      \brief xbrtime_write_all on 'path', created if missing and cut off
+             after the last region
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_write_all_path(const char *path, const void *const *bufs,
+                                  const size_t *counts, const off_t *offsets,
+                                  int aggregators);
+
+/*!   \fn int xbrtime_read_all_path( const char *path, void *const *bufs, const size_t *counts, const off_t *offsets, int aggregators )
+      \brief xbrtime_read_all on 'path'
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_read_all_path(const char *path, void *const *bufs,
+                                 const size_t *counts, const off_t *offsets,
+                                 int aggregators);
+
+/*!   \fn int xbrtime_histogram( const uint64_t *const *local_keys, const size_t *n, uint64_t *bins, size_t nbins )
+      \brief Counts the keys of every PE into one global histogram
+      \param local_keys PE-indexed arrays of bin numbers
+      \param n PE-indexed key counts
+      \param bins Receives nbins counters; keys of nbins or more are not counted
+      \param nbins Number of bins
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_histogram(const uint64_t *const *local_keys,
+                             const size_t *n, uint64_t *bins, size_t nbins);
+
+/*!   \fn int xbrtime_histogram_into( const uint64_t *const *local_keys, const size_t *n, size_t nbins, uint64_t *const *slices, const size_t *first, const size_t *counts )
+      \brief xbrtime_histogram where PE pe stores bins [first[pe], first[pe] + counts[pe]) at slices[pe]
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_histogram_into(const uint64_t *const *local_keys,
+                                  const size_t *n, size_t nbins,
+                                  uint64_t *const *slices, const size_t *first,
+                                  const size_t *counts);
+
+/*!   \fn int xbrtime_coll_mode()
+      \brief Returns the collective mode in effect, XBRTIME_COLL_FLAT or XBRTIME_COLL_HIER
+*/
+extern int xbrtime_coll_mode(void);
+
+/*!   \fn int xbrtime_coll_set_mode( int mode )
+      \brief Sets the collective mode; XBRTIME_COLL_AUTO picks it from the topology
+      \param mode XBRTIME_COLL_AUTO, XBRTIME_COLL_FLAT or XBRTIME_COLL_HIER
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_coll_set_mode(int mode);
+
+/*!   \fn int xbrtime_topo_ndomains()
+      \brief Returns the number of L3 (or socket) domains holding PEs
+*/
+extern int xbrtime_topo_ndomains(void);
+
+/*!   \fn int xbrtime_topo_domain( int pe )
+      \brief Returns the domain of PE pe
+*/
+extern int xbrtime_topo_domain(int pe);
+
+/*!   \fn int xbrtime_topo_cpu( int pe )
+      \brief Returns the CPU PE pe is bound to, or -1
+*/
+extern int xbrtime_topo_cpu(int pe);
+
+/*!   \fn void xbrtime_coll_barrier()
+      \brief Barrier of all PEs, each calling from its pool thread
+*/
+extern void xbrtime_coll_barrier(void);
+
+/*!   \fn int xbrtime_coll_broadcast( void *dest, const void *src, size_t nbytes, int root )
+      \brief Copies nbytes from src at root to dest at every PE
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_coll_broadcast(void *dest, const void *src, size_t nbytes,
+                                  int root);
+
+/*!   \fn int xbrtime_coll_reduce( void *dest, const void *src, size_t nelems, int type, int op, int root )
+      \brief Combines nelems elements of src of every PE into dest at root
+      \param type XBRTIME_COLL_INT, _LONGLONG, _ULONGLONG or _DOUBLE
+      \param op XBRTIME_COLL_SUM, _MIN or _MAX
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_coll_reduce(void *dest, const void *src, size_t nelems,
+                               int type, int op, int root);
+
+/*!   \fn int xbrtime_coll_allreduce( void *dest, const void *src, size_t nelems, int type, int op )
+      \brief Combines nelems elements of src of every PE into dest at every PE
+      \return 0 on success, nonzero otherwise
+*/
+extern int xbrtime_coll_allreduce(void *dest, const void *src, size_t nelems,
+                                  int type, int op);
+
 /* ------------------------------------------------------------------------- */
 /* ========================================================================= */
 /* ------------------------------------------------------------------------- */
@@ -244,6 +670,7 @@ extern void xbrtime_barrier();
 // extern volatile  uint64_t* barrier;
 // #define INIT_ADDR 0xBB00000000000000ull // MERT – MOVED UP
 
+#ifndef __XBRTIME_DECLARE_ONLY
 /* ------------------------------------------------- GLOBALS */
 XBRTIME_DATA *__XBRTIME_CONFIG;
 
@@ -268,12 +695,23 @@ extern void xbrtime_close() {
     /* hard fence */
     __xbrtime_asm_fence();
 
+    /* finish the trace before the runtime releases its own blocks */
+    xbrtime_trace_close();
+
+    /* release the blocks still waiting on a deferred free */
+    __xbrtime_epoch_fini();
+    __xbrtime_local_fini();
+    __xbrtime_bsp_fini();
+
     /* free all the remaining shared blocks */
     for (i = 0; i < _XBRTIME_MEM_SLOTS_; i++) {
       if (__XBRTIME_CONFIG->_MMAP[i].size != 0) {
         xbrtime_free((void *)(__XBRTIME_CONFIG->_MMAP[i].start_addr));
       }
     }
+    __xbrtime_heap_reset();
+    __xbrtime_cache_fini();
+    __xbrtime_topo_fini();
 
     if (__XBRTIME_CONFIG->_MAP != NULL) {
       free(__XBRTIME_CONFIG->_MAP);
@@ -302,7 +740,7 @@ extern int xbrtime_init() {
   }
 
   // Allocate memory for the global configuration
-  __XBRTIME_CONFIG = malloc(sizeof(XBRTIME_DATA));
+  __XBRTIME_CONFIG = (XBRTIME_DATA *) malloc(sizeof(XBRTIME_DATA));
   // Check if the memory allocation for the global config was successful
   if (!__XBRTIME_CONFIG) {
     fprintf(stderr, "Error: Failed to allocate memory for __XBRTIME_CONFIG.\n");
@@ -310,7 +748,8 @@ extern int xbrtime_init() {
   }
 
   // Allocate memory for the memory map in the configuration
-  __XBRTIME_CONFIG->_MMAP = malloc(sizeof(XBRTIME_MEM_T) * _XBRTIME_MEM_SLOTS_);
+  __XBRTIME_CONFIG->_MMAP =
+      (XBRTIME_MEM_T *) malloc(sizeof(XBRTIME_MEM_T) * _XBRTIME_MEM_SLOTS_);
   // Check if the memory allocation for the memory map was successful
   if (!__XBRTIME_CONFIG->_MMAP) {
     fprintf(stderr, "Error: Failed to allocate memory for _MMAP.\n");
@@ -350,8 +789,23 @@ extern int xbrtime_init() {
     return -1;
   }
 
+  // Map the symmetric heap: one partition per PE
+  if (__xbrtime_heap_init(__XBRTIME_CONFIG->_NPES) != 0) {
+    fprintf(stderr, "Error: Failed to map the symmetric heap.\n");
+    free(__XBRTIME_CONFIG->_MMAP); // Free memory map
+    free(__XBRTIME_CONFIG);        // Free global config
+    return -1;
+  }
+  __XBRTIME_CONFIG->_MEMSIZE = __xbrtime_heap.part_size;
+  __XBRTIME_CONFIG->_START_ADDR = (uint64_t)(uintptr_t)__xbrtime_heap.base;
+  __xbrtime_cache_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_topo_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_epoch_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_local_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_bsp_init(__XBRTIME_CONFIG->_NPES);
+
   // Allocate memory for the PE mapping block
-  __XBRTIME_CONFIG->_MAP =
+  __XBRTIME_CONFIG->_MAP = (XBRTIME_PE_MAP *)
       malloc(sizeof(XBRTIME_PE_MAP) * __XBRTIME_CONFIG->_NPES);
   // Check if memory allocation for the PE mapping block was successful
   if (!__XBRTIME_CONFIG->_MAP) {
@@ -387,6 +841,9 @@ extern int xbrtime_init() {
 
   pthread_cond_init(&barrier_cond, NULL);
 
+  /* record the application's calls from here on if XBRTIME_TRACE is set */
+  __xbrtime_trace_init();
+
   initialized = 1;  // Mark as initialized
   return 0; // Return 0 to indicate successful initialization
 }
@@ -444,6 +901,19 @@ extern int xbrtime_init() {
     return -1;
   }
 
+  /* map the symmetric heap */
+  if (__xbrtime_heap_init(__XBRTIME_CONFIG->_NPES) != 0) {
+    free(__XBRTIME_CONFIG);
+    return -1;
+  }
+  __XBRTIME_CONFIG->_MEMSIZE = __xbrtime_heap.part_size;
+  __XBRTIME_CONFIG->_START_ADDR = (uint64_t)(uintptr_t)__xbrtime_heap.base;
+  __xbrtime_cache_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_topo_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_epoch_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_local_init(__XBRTIME_CONFIG->_NPES);
+  __xbrtime_bsp_init(__XBRTIME_CONFIG->_NPES);
+
   /* init the pe mapping block */
   __XBRTIME_CONFIG->_MAP =
       malloc(sizeof(XBRTIME_PE_MAP) * __XBRTIME_CONFIG->_NPES);
@@ -475,273 +945,15 @@ extern int xbrtime_init() {
   printf("[R] init the PE mapping structure\n");
 #endif
 
+  /* record the application's calls from here on if XBRTIME_TRACE is set */
+  __xbrtime_trace_init();
+
   // int init = 1;                    // MERT - COMMENTED OUT
   // *((uint64_t *)INIT_ADDR) = init; // MERT - COMMENTED OUT
   return 0;
 }
 #endif
 
-extern int xbrtime_mype() {
-  if (__XBRTIME_CONFIG == NULL) {
-    return -1;
-  }
-  return __XBRTIME_CONFIG->_ID;
-}
-
-extern int xbrtime_num_pes() {
-  if (__XBRTIME_CONFIG == NULL) {
-    return -1;
-  }
-  return __XBRTIME_CONFIG->_NPES;
-}
-
-/* ------------------------------------------------------------------------- */
-/* ========================================================================= */
-/* ------------------------------------------------------------------------- */
-/* ========================================================================= */
-
-/* _XBRTIME_API_C_ */
-
-/* ------------------------------------------------- FUNCTION PROTOTYPES */
-void __xbrtime_asm_fence();
-void __xbrtime_asm_quiet_fence();
-
-// ------------------------------------------------------- FUNCTION PROTOTYPES
-void __xbrtime_get_u8_seq(uint64_t *base_src,
-                          uint64_t *base_dest, // uint32_t pe,
-                          uint32_t nelems, uint32_t stride);
-
-// ----------------------------------------------------- [xfer] U8 GET FUNCTION
-void xbrtime_ulonglong_get(unsigned long long *dest,
-                           const unsigned long long *src, size_t nelems,
-                           int stride, int pe) {
-#ifdef XBGAS_PRINT
-  // printf("[R] Entered xbrtime_ulonglong_get()\n");
-  fflush(stdout);
-  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
-  fprintf(stdout, "==================================xbrtime_ulonglong_get\n");
-  fprintf(stdout,
-          "DST:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
-          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
-          (int)cheri_tag_get((void *)dest));
-  fprintf(stdout, "=======================================================\n");
-  fprintf(stdout,
-          "SRC:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)src), cheri_length_get((void *)src),
-          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
-          (int)cheri_tag_get((void *)src));
-  fprintf(stdout, "=======================================================\n");
-  fflush(stdout);
-#endif
-
-  if (nelems == 0) {
-    return;
-  } else /*if( (stride != 1) || (nelems == 1))*/ {
-    /* sequential execution */
-    // void* func_args = { (void*)src, (void*)dest, (void*)nelems,
-    //                     (void*)(stride*sizeof(unsigned long long)) };
-    //                   { (uint64_t*)src, (uint64_t*)(dest),
-    //                   (uint32_t)(nelems),
-    //                     (uint32_t)(stride*sizeof(unsigned long long)) };
-    //  XXX: multiple arguments do not pass to work!
-    // tpool_add_work(pool, __xbrtime_get_u8_seq, func_args);
-    __xbrtime_get_u8_seq((uint64_t *)src, //__xbrtime_ltor((uint64_t)(src),pe),
-                         (uint64_t *)(dest),
-                         // xbrtime_decode_pe(pe),
-                         (uint32_t)(nelems),
-                         (uint32_t)(stride * sizeof(unsigned long long)));
-    
-    // dest = *src;
-  }
-  __xbrtime_asm_fence();
-
-#ifdef XBGAS_PRINT
-  // printf("[M] Exiting \n");
-#endif
-}
-
-// ------------------------------------------------------- FUNCTION PROTOTYPES
-void __xbrtime_get_s8_seq(uint64_t *base_src,
-                          uint64_t *base_dest, // uint32_t pe,
-                          uint32_t nelems, uint32_t stride);
-
-// ----------------------------------------------------- [xfer] S8 GET FUNCTION
-void xbrtime_longlong_get(long long *dest, const long long *src, size_t nelems,
-                          int stride, int pe) {
-#ifdef XBGAS_PRINT
-  // printf("[R] Entered xbrtime_ulonglong_get()\n");
-  fflush(stdout);
-  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
-  fprintf(stdout, "GET================================xbrtime_longlong_get\n");
-  fprintf(stdout,
-          "DST:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
-          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
-          (int)cheri_tag_get((void *)dest));
-  fprintf(stdout, "=======================================================\n");
-  fprintf(stdout,
-          "SRC:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)src), cheri_length_get((void *)src),
-          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
-          (int)cheri_tag_get((void *)src));
-  fprintf(stdout, "=======================================================\n");
-  fflush(stdout);
-#endif
-
-  if (nelems == 0) {
-    return;
-  } else /* if( (stride != 1) || (nelems == 1))*/ {
-    /* sequential execution */
-    
-    __xbrtime_get_s8_seq(
-        (uint64_t *)(src), //__xbrtime_ltor((uint64_t)(src),pe),
-        (uint64_t *)(dest),
-        // xbrtime_decode_pe(pe),
-        (uint32_t)(nelems), (uint32_t)(stride * sizeof(long long)));
-    
-    // dest = *src;
-  }
-  __xbrtime_asm_fence();
-}
-
-// ------------------------------------------------------- FUNCTION PROTOTYPES
-void __xbrtime_put_s8_seq(uint64_t *base_src,
-                          uint64_t *base_dest, // uint32_t pe,
-                          uint32_t nelems, uint32_t stride);
-
-// ----------------------------------------------------- [xfer] S8 PUT FUNCTION
-void xbrtime_longlong_put(long long *dest, const long long *src, size_t nelems,
-                          int stride, int pe) {
-#ifdef XBGAS_PRINT
-  // printf("[R] Entered xbrtime_ulonglong_get()\n");
-  fflush(stdout);
-  fprintf(stdout, "[R] Thread: \t%lu\n", (uint64_t)pthread_self());
-  fprintf(stdout, "===================================xbrtime_longlong_put\n");
-  fprintf(stdout,
-          "DST:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)dest), cheri_length_get((void *)dest),
-          cheri_offset_get((void *)dest), cheri_perms_get((void *)dest),
-          (int)cheri_tag_get((void *)dest));
-  fprintf(stdout, "=======================================================\n");
-  fprintf(stdout,
-          "SRC:"
-          // "address: %p\n"
-          "\tbase  : %10lu"
-          "\tlength: %10lu\n"
-          "\toffset: %10lu"
-          "\tperms : %10u"
-          "\ttag   : %1d\n",
-          // cheri_address_get(dest),
-          cheri_base_get((void *)src), cheri_length_get((void *)src),
-          cheri_offset_get((void *)src), cheri_perms_get((void *)src),
-          (int)cheri_tag_get((void *)src));
-  fprintf(stdout, "=======================================================\n");
-  fflush(stdout);
-#endif
-
-  if (nelems == 0) {
-    return;
-  } else /* if( (stride != 1) || (nelems == 1))*/ {
-    /* sequential execution */
-    /*
-    __xbrtime_put_s8_seq(
-        (uint64_t *)(src),
-        (uint64_t *)(dest), //__xbrtime_ltor((uint64_t)(dest),pe),
-        // xbrtime_decode_pe(pe),
-        (uint32_t)(nelems), (uint32_t)(stride * sizeof(long long)));
-    */
-    dest = *src;
-  }
-  __xbrtime_asm_fence();
-}
-
-// ------------------------------------------------------- FUNCTION PROTOTYPES
-void __xbrtime_get_s4_seq(uint64_t *base_src,
-                          uint64_t *base_dest, // uint32_t pe,
-                          uint32_t nelems, uint32_t stride);
-// ---------------------------------------------------- [xfer] INT GET FUNCTION
-void xbrtime_int_get(int *dest, const int *src, size_t nelems, int stride, 
-                     int pe) {
-#ifdef XBGAS_PRINT
-    // Similar debug printing code as in xbrtime_longlong_get
-#endif
-
-  if (nelems == 0) {
-    return;
-  } else {
-    // Sequential execution for int data type
-    __xbrtime_get_s4_seq(
-        (uint64_t *)(src), // Cast to int64_t* if necessary
-        (uint64_t *)(dest),
-        (uint32_t)(nelems), 
-        (uint32_t)(stride * sizeof(int))
-    );
-    // dest = *src;
-  }
-  __xbrtime_asm_fence();
-}
-
-// ------------------------------------------------------- FUNCTION PROTOTYPES
-void __xbrtime_put_s4_seq(uint64_t *base_src,
-                          uint64_t *base_dest, // uint32_t pe,
-                          uint32_t nelems, uint32_t stride);
-// ---------------------------------------------------- [xfer] INT PUT FUNCTION
-void xbrtime_int_put(int *dest, const int *src, size_t nelems, int stride, 
-                     int pe) {
-#ifdef XBGAS_PRINT
-    // Similar debug printing code as in xbrtime_longlong_put
-#endif
-  if (nelems == 0) {
-    return;
-  } else {
-    // Sequential execution for int data type
-    __xbrtime_put_s4_seq(
-        (uint64_t *)(src), // Cast to int64_t* if necessary
-        (uint64_t *)(dest),
-        (uint32_t)(nelems), 
-        (uint32_t)(stride * sizeof(int))
-    );
-    //  dest = *src;
-  }
-  __xbrtime_asm_fence();
-}
-
 /* ------------------------------------------------------------------------- */
 /* ========================================================================= */
 
@@ -771,16 +983,6 @@ void xbrtime_reduce_sum_broadcast(long long *dest, long long *src,
   }
 }
 
-void xbrtime_reduce_sum_broadcast_all(long long *dest, long long *src, 
-                                      size_t nelems, int stride, int root) {
-  void *func_args = { dest, src, nelems, stride, root };
-  for (int currentPE = 0; currentPE < __XBRTIME_CONFIG->_NPES; currentPE++) {
-    tpool_add_work(threads[currentPE].thread_queue, 
-                   xbrtime_reduce_sum_broadcast, 
-                   func_args);
-  }
-}
-
 /* ------------------------------------------------------------------------- */
 /* ========================================================================= */
 /* ------------------------------------------------------------------------- */
@@ -879,8 +1081,9 @@ void xbrtime_int_broadcast(int *src, int *dest, size_t nelems, int stride, int r
     taskArgs->root_pe = root_pe; // Additional info, if needed
     printf("\t[Bro] taskArgs->root_pe = %d\n", taskArgs->root_pe);
 
-    // Add task to the thread pool
-    tpool_add_work(threads[i].thread_queue, broadcast_task, taskArgs);
+    // Add task to the control lane so it is not stuck behind bulk work
+    tpool_add_work_prio(threads[i].thread_queue, broadcast_task, taskArgs,
+                        TPOOL_PRIO_CONTROL);
   }
 
   // Wait for all tasks in the pool to complete
@@ -930,8 +1133,9 @@ void xbrtime_longlong_broadcast(long long *src, long long *dest, size_t nelems,
     taskArgs->dest = dest;
     taskArgs->root_pe = root_pe;
 
-    // Add task to the thread pool
-    tpool_add_work(threads[i].thread_queue, longlong_broadcast_task, taskArgs);
+    // Add task to the control lane so it is not stuck behind bulk work
+    tpool_add_work_prio(threads[i].thread_queue, longlong_broadcast_task,
+                        taskArgs, TPOOL_PRIO_CONTROL);
   }
 
   // Wait for all tasks in the pool to complete
@@ -985,7 +1189,7 @@ void xbrtime_int_reduce_sum(int *dest, const int *src, size_t nelems,
 
   ReduceTaskArgs args[num_pes];
   for (int i = 0; i < num_pes; i++) {
-    args[i].src = src;
+    args[i].src = (int *)src;
     printf("\t[Red] args[%d].src = %d\n", i, args[i].src);
 
     args[i].dest = dest;
@@ -997,7 +1201,8 @@ void xbrtime_int_reduce_sum(int *dest, const int *src, size_t nelems,
     args[i].end = (i == num_pes - 1) ? nelems : args[i].start + elems_per_task;
     printf("\t[Red] args[%d].end = %d\n", i, args[i].end);  
 
-    tpool_add_work(threads[i].thread_queue, reduction_task, &args[i]);
+    tpool_add_work_prio(threads[i].thread_queue, reduction_task, &args[i],
+                        TPOOL_PRIO_CONTROL);
   }
 
   for (int i = 0; i < num_pes; i++) {
@@ -1060,7 +1265,8 @@ void xbrtime_longlong_reduce_sum(long long *dest, const long long *src, size_t n
     args[i].start = i * elems_per_task;
     args[i].end = (i == num_pes - 1) ? nelems : args[i].start + elems_per_task;
 
-    tpool_add_work(threads[i].thread_queue, longlong_reduction_task, &args[i]);
+    tpool_add_work_prio(threads[i].thread_queue, longlong_reduction_task,
+                        &args[i], TPOOL_PRIO_CONTROL);
   }
 
   for (int i = 0; i < num_pes; i++) {
@@ -1091,7 +1297,10 @@ void xbrtime_barrier() {
             "xbrtime_init() first.\n");
     return;
   }
+  __XBRTIME_TRACE_T0(t);
   __xbrtime_asm_fence(); // Ensure all preceding instructions are complete
+  xbrtime_cache_invalidate_all(); // Remote data may change past this point
+  xbrtime_quiesce(); // Blocks retired before this point may be released
 
   pthread_mutex_lock(&barrier_mutex);
 
@@ -1127,6 +1336,7 @@ void xbrtime_barrier() {
   // Ensure all subsequent instructions wait for this barrier
 
   pthread_mutex_unlock(&barrier_mutex);
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_BARRIER, 0, -1, 0, 0, 0, NULL);
 }
 #else
 extern void xbrtime_barrier() {
@@ -1135,10 +1345,18 @@ extern void xbrtime_barrier() {
 #endif
 
   // TODO: Implement thread-aware barrier
+  __XBRTIME_TRACE_T0(t);
 
   /* force a heavy fence */
   __xbrtime_asm_fence(); /* wait for all the PEs to reach the barrier */
 
+  /* cached remote blocks may be stale past the barrier */
+  xbrtime_cache_invalidate_all();
+
+  /* blocks retired before the barrier may be released */
+  xbrtime_quiesce();
+  __XBRTIME_TRACE_REC(t, XBRTIME_TRACE_BARRIER, 0, -1, 0, 0, 0, NULL);
+
 #ifdef XBGAS_DEBUG
   printf("[XBGAS_DEBUG] PE=%d; BARRIER COMPLETE\n", xbrtime_mype());
 #endif
@@ -1149,10 +1367,19 @@ extern void xbrtime_barrier() {
 #endif
 
 void xbrtime_barrier_all() {
+  // Barriers go to the control lane: they must not wait behind bulk updates
   for (int currentPE = 0; currentPE < __XBRTIME_CONFIG->_NPES; currentPE++) {
-    tpool_add_work(threads[currentPE].thread_queue, xbrtime_barrier, NULL);
+    tpool_add_work_prio(threads[currentPE].thread_queue,
+                        (thread_func_t)xbrtime_barrier, NULL,
+                        TPOOL_PRIO_CONTROL);
   }
 }
+#endif /* __XBRTIME_DECLARE_ONLY */
+
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
+/* ------------------------------------------------------------------------- */
+/* ========================================================================= */
 
 #ifdef __cplusplus
 }